@@ -0,0 +1,72 @@
+// shared by cluster_build.comp, lighting.frag and forward.frag, must match ClusteredLighting
+// define CLUSTER_SET and CLUSTER_ACCESS (readonly/writeonly) before including
+
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_COUNT (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+struct PointLightData {
+    vec3 position;
+    float range;
+    vec3 color;
+    float intensity;
+};
+
+layout(set = CLUSTER_SET, binding = 0) uniform ClusterParams {
+    mat4 view;
+    mat4 invProj;
+    uvec4 gridSize;     // xyz: cluster grid, w: light count
+    vec4 screen;        // xy: tile size in pixels, zw: screen size in pixels
+    vec4 depth;         // x: near, y: far, z: slice scale, w: slice bias
+    vec4 pointShadow;   // x: 1 when pointLights[0] casts a shadow, y: near, z: far, w: depth bias
+} clusterParams;
+
+layout(std430, set = CLUSTER_SET, binding = 1) readonly buffer PointLightBuffer {
+    PointLightData pointLights[];
+};
+
+layout(std430, set = CLUSTER_SET, binding = 2) CLUSTER_ACCESS buffer ClusterBuffer {
+    uint clusterLightCounts[CLUSTER_COUNT];
+    uint clusterLightIndices[];
+};
+
+// depth cube of the primary light, rendered by point_shadow.vert
+layout(set = CLUSTER_SET, binding = 3) uniform samplerCubeShadow pointShadowMap;
+
+uint getClusterIndex(vec2 fragCoord, float viewDepth) {
+    uvec2 tile = min(uvec2(fragCoord / clusterParams.screen.xy), uvec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    float slice = log(max(viewDepth, clusterParams.depth.x)) * clusterParams.depth.z - clusterParams.depth.w;
+    uint z = uint(clamp(slice, 0.0, float(CLUSTER_GRID_Z - 1)));
+    return tile.x + tile.y * CLUSTER_GRID_X + z * CLUSTER_GRID_X * CLUSTER_GRID_Y;
+}
+
+// inverse square falloff, windowed so it reaches zero at the light's range
+float rangeAttenuation(float distance, float range) {
+    float ratio = distance / range;
+    float ratio2 = ratio * ratio;
+    float window = clamp(1.0 - ratio2 * ratio2, 0.0, 1.0);
+    return window * window / max(distance * distance, 0.0001);
+}
+
+// visibility of the light at lightIndex, only the primary light (index 0) has a shadow cube
+float pointLightShadow(uint lightIndex, vec3 worldPos, vec3 normal) {
+    if (lightIndex != 0u || clusterParams.pointShadow.x == 0.0) {
+        return 1.0;
+    }
+
+    // push the receiver out along its normal by about a texel at its distance, against acne
+    vec3 lightPos = pointLights[0].position;
+    float texelSize = 2.0 * length(worldPos - lightPos) / float(textureSize(pointShadowMap, 0).x);
+    vec3 toFragment = worldPos + normal * texelSize * 1.5 - lightPos;
+
+    // each face stores perspective depth along its own axis, which is the major axis of the lookup
+    float faceDepth = max(abs(toFragment.x), max(abs(toFragment.y), abs(toFragment.z)));
+    float n = clusterParams.pointShadow.y;
+    float f = clusterParams.pointShadow.z;
+    float reference = (faceDepth - n) * f / ((f - n) * faceDepth) - clusterParams.pointShadow.w;
+
+    // explicit zero gradients, this runs inside the per light loop
+    return textureGrad(pointShadowMap, vec4(toFragment, reference), vec3(0.0), vec3(0.0));
+}
@@ -0,0 +1,25 @@
+#version 460
+
+layout(set = 0, binding = 0) uniform CameraUBO {
+    mat4 view;
+    mat4 proj;
+} camera;
+
+layout(std430, set = 0, binding = 1) readonly buffer Transforms {
+    mat4 transforms[];
+};
+
+// x: model index, y: material index of the draw
+layout(std430, set = 0, binding = 2) readonly buffer Instances {
+    uvec2 instances[];
+};
+
+layout(location = 0) in vec3 inPosition;
+
+// must match geometry.vert bit for bit so the g-buffer pass can test with EQUAL
+invariant gl_Position;
+
+void main() {
+    vec4 worldPos = transforms[instances[gl_InstanceIndex].x] * vec4(inPosition, 1.0);
+    gl_Position = camera.proj * camera.view * worldPos;
+}
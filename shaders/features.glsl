@@ -0,0 +1,7 @@
+// permutation constants, constant_id is the bit index in ShaderFeatures. every pipeline variant
+// sets them, so branches on them are gone from the compiled shader. the defaults keep everything on
+
+layout(constant_id = 0) const bool FEATURE_DIFFUSE_TEXTURE = true;
+layout(constant_id = 1) const bool FEATURE_NORMAL_MAP = true;
+layout(constant_id = 2) const bool FEATURE_DIRECTIONAL_LIGHT = true;
+layout(constant_id = 3) const bool FEATURE_POINT_LIGHTS = true;
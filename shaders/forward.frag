@@ -1,5 +1,6 @@
 #version 460
 #extension GL_KHR_vulkan_glsl : enable
+#extension GL_GOOGLE_include_directive : require
 
 layout(set = 0, binding = 0) uniform CameraUBO {
     mat4 view;
@@ -8,8 +9,9 @@ layout(set = 0, binding = 0) uniform CameraUBO {
     mat4 invProj;
 } camera;
 
-layout(set = 1, binding = 0) uniform sampler2D texSampler;
-layout(set = 1, binding = 1) uniform sampler2D normalMapSampler;
+#define MATERIAL_SET 1
+#include "materials.glsl"
+#include "features.glsl"
 
 layout(set = 2, binding = 0) uniform LightingUBO {
     vec3 direction;
@@ -22,25 +24,16 @@ layout(set = 2, binding = 0) uniform LightingUBO {
     float padding;
 } light;
 
-layout(set = 3, binding = 0) uniform PointLightUBO {
-    vec3 position;
-    float intensity;
-    vec3 color;
-    float padding;
-} pointLight;
-
-layout(push_constant) uniform MaterialPushConstants {
-    vec4 diffuseColor;
-    uint hasTexture;
-    uint hasNormalMap;
-    float dissolve;
-    float roughness;
-} material;
+// point lights binned per cluster by cluster_build.comp
+#define CLUSTER_SET 3
+#define CLUSTER_ACCESS readonly
+#include "clusters.glsl"
 
 layout(location = 0) in vec3 fragWorldPos;
 layout(location = 1) in vec3 fragNormal;
 layout(location = 2) in vec2 fragTexCoord;
 layout(location = 3) in vec4 fragTangent;
+layout(location = 4) flat in uint fragMaterial;
 
 layout(location = 0) out vec4 outColor;
 
@@ -77,9 +70,11 @@ float geometrySmith(float NdotV, float NdotL, float roughness) {
 }
 
 void main() {
+    MaterialData material = materials[fragMaterial];
+
     vec4 albedo;
-    if (material.hasTexture == 1) {
-        albedo = texture(texSampler, fragTexCoord);
+    if (FEATURE_DIFFUSE_TEXTURE) {
+        albedo = texture(materialTextures[material.diffuseTexture], fragTexCoord);
     } else {
         albedo = vec4(material.diffuseColor.rgb, 1.0);
     }
@@ -91,14 +86,14 @@ void main() {
     }
 
     vec3 normal;
-    if (material.hasNormalMap == 1) {
+    if (FEATURE_NORMAL_MAP) {
         vec3 N = normalize(fragNormal);
         vec3 T = normalize(fragTangent.xyz);
         T = normalize(T - dot(T, N) * N);
         vec3 B = cross(N, T) * fragTangent.w;
         mat3 TBN = mat3(T, B, N);
 
-        vec3 sampledNormal = texture(normalMapSampler, fragTexCoord).rgb;
+        vec3 sampledNormal = texture(materialTextures[material.normalTexture], fragTexCoord).rgb;
         sampledNormal = sampledNormal * 2.0 - 1.0;
         normal = normalize(TBN * sampledNormal);
     } else {
@@ -106,55 +101,78 @@ void main() {
     }
 
     vec3 viewDir = normalize(light.cameraPosition - fragWorldPos);
-
-    vec3 lightDir = normalize(-light.direction);
-
-    vec3 halfDir = normalize(lightDir + viewDir);
-
-    // dot products
-    float NdotL = max(dot(normal, lightDir), 0.0);
     float NdotV = max(dot(normal, viewDir), 0.0);
-    float NdotH = max(dot(normal, halfDir), 0.0);
-    float HdotV = max(dot(halfDir, viewDir), 0.0);
+    float roughness = max(material.roughness, 0.04);
+    vec3 F0 = vec3(0.04); // default dielectric F0
 
     // ambient
     vec3 ambient = light.ambientColor * light.ambientIntensity * albedo.rgb;
-    vec3 diffuse = light.color * light.intensity * NdotL * albedo.rgb;
+    vec3 diffuse = vec3(0.0);
+    vec3 specular = vec3(0.0);
 
-    // specular
-    float roughness = max(material.roughness, 0.04);
-    vec3 F0 = vec3(0.04); // default dielectric F0
-    vec3 F = fresnelSchlick(HdotV, F0);
-    float D = distributionGGX(NdotH, roughness);
-    float G = geometrySmith(NdotV, NdotL, roughness);
-
-    // Cook-Torrance
-    float denominator = 4.0 * NdotV * NdotL + 0.0001;
-    vec3 specular = (D * F * G) / denominator;
-    specular = specular * light.color * light.intensity * NdotL;
-
-    // point light contribution
-    vec3 pointLightDir = normalize(pointLight.position - fragWorldPos);
-    float distance = length(pointLight.position - fragWorldPos);
-    float attenuation = 1.0 / (distance * distance);
-
-    float pNdotL = max(dot(normal, pointLightDir), 0.0);
-    vec3 pHalfDir = normalize(pointLightDir + viewDir);
-    float pNdotH = max(dot(normal, pHalfDir), 0.0);
-    float pHdotV = max(dot(pHalfDir, viewDir), 0.0);
-
-    // point light diffuse
-    vec3 pDiffuse = pointLight.color * pointLight.intensity * pNdotL * albedo.rgb * attenuation;
-
-    // point light specular
-    vec3 pF = fresnelSchlick(pHdotV, F0);
-    float pD = distributionGGX(pNdotH, roughness);
-    float pG = geometrySmith(NdotV, pNdotL, roughness);
-    float pDenom = 4.0 * NdotV * pNdotL + 0.0001;
-    vec3 pSpecular = (pD * pF * pG) / pDenom;
-    pSpecular = pSpecular * pointLight.color * pointLight.intensity * pNdotL * attenuation;
-
-    vec3 finalColor = ambient + diffuse + specular + pDiffuse + pSpecular;
+    if (FEATURE_DIRECTIONAL_LIGHT) {
+        vec3 lightDir = normalize(-light.direction);
+        vec3 halfDir = normalize(lightDir + viewDir);
+
+        // dot products
+        float NdotL = max(dot(normal, lightDir), 0.0);
+        float NdotH = max(dot(normal, halfDir), 0.0);
+        float HdotV = max(dot(halfDir, viewDir), 0.0);
+
+        diffuse = light.color * light.intensity * NdotL * albedo.rgb;
+
+        // specular
+        vec3 F = fresnelSchlick(HdotV, F0);
+        float D = distributionGGX(NdotH, roughness);
+        float G = geometrySmith(NdotV, NdotL, roughness);
+
+        // Cook-Torrance
+        float denominator = 4.0 * NdotV * NdotL + 0.0001;
+        specular = (D * F * G) / denominator;
+        specular = specular * light.color * light.intensity * NdotL;
+    }
+
+    // point lights touching this pixel's cluster
+    vec3 pointLighting = vec3(0.0);
+    uint clusterLightCount = 0;
+    uint cluster = 0;
+    if (FEATURE_POINT_LIGHTS) {
+        float viewDepth = -(camera.view * vec4(fragWorldPos, 1.0)).z;
+        cluster = getClusterIndex(gl_FragCoord.xy, viewDepth);
+        clusterLightCount = clusterLightCounts[cluster];
+    }
+
+    for (uint i = 0; i < clusterLightCount; ++i) {
+        uint lightIndex = clusterLightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + i];
+        PointLightData pointLight = pointLights[lightIndex];
+
+        vec3 toLight = pointLight.position - fragWorldPos;
+        float distance = length(toLight);
+        vec3 pointLightDir = toLight / max(distance, 0.0001);
+        float attenuation = rangeAttenuation(distance, pointLight.range);
+
+        float pNdotL = max(dot(normal, pointLightDir), 0.0);
+        vec3 pHalfDir = normalize(pointLightDir + viewDir);
+        float pNdotH = max(dot(normal, pHalfDir), 0.0);
+        float pHdotV = max(dot(pHalfDir, viewDir), 0.0);
+
+        // point light diffuse
+        vec3 pDiffuse = pointLight.color * pointLight.intensity * pNdotL * albedo.rgb * attenuation;
+
+        // point light specular
+        vec3 pF = fresnelSchlick(pHdotV, F0);
+        float pD = distributionGGX(pNdotH, roughness);
+        float pG = geometrySmith(NdotV, pNdotL, roughness);
+        float pDenom = 4.0 * NdotV * pNdotL + 0.0001;
+        vec3 pSpecular = (pD * pF * pG) / pDenom;
+        pSpecular = pSpecular * pointLight.color * pointLight.intensity * pNdotL * attenuation;
+
+        float pShadow = pNdotL > 0.0 ? pointLightShadow(lightIndex, fragWorldPos, normal) : 1.0;
+
+        pointLighting += (pDiffuse + pSpecular) * pShadow;
+    }
+
+    vec3 finalColor = ambient + diffuse + specular + pointLighting;
 
     outColor = vec4(finalColor, alpha);
 }
@@ -0,0 +1,86 @@
+// shared by geometry.frag, geometry_cutout.frag and lighting.frag, must match GBuffer
+// define GBUFFER_WRITE (g-buffer outputs) or GBUFFER_READ (lighting subpass inputs) before including,
+// COMPACT_GBUFFER selects the packed layout (shadercompile.bat builds both)
+//
+// default: albedo RGBA8, normal A2R10G10B10, roughness R8
+// compact: albedo RGBA8 with roughness in alpha, normal octahedral RG16
+
+// octahedral mapping of a unit vector to [0, 1]^2
+vec2 encodeOctahedral(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return n.xy * 0.5 + 0.5;
+}
+
+vec3 decodeOctahedral(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+#ifdef GBUFFER_WRITE
+
+#ifdef COMPACT_GBUFFER
+layout(location = 0) out vec4 outAlbedo;    // rgb: albedo, a: roughness
+layout(location = 1) out vec2 outNormal;
+#else
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormal;
+layout(location = 2) out float outRoughness;
+#endif
+
+void writeGBuffer(vec3 albedo, vec3 normal, float roughness) {
+#ifdef COMPACT_GBUFFER
+    outAlbedo = vec4(albedo, roughness);
+    outNormal = encodeOctahedral(normal);
+#else
+    outAlbedo = vec4(albedo, 1.0);
+    outNormal = vec4(normal * 0.5 + 0.5, 1.0);
+    outRoughness = roughness;
+#endif
+}
+
+#endif
+
+#ifdef GBUFFER_READ
+
+// read from the previous subpass, only the current pixel is available
+// input_attachment_index follows the declaration order in Application::createFrameGraph
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput albedoInput;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput normalInput;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput depthInput;
+#ifndef COMPACT_GBUFFER
+layout(input_attachment_index = 3, set = 1, binding = 3) uniform subpassInput roughnessInput;
+#endif
+
+vec3 readAlbedo() {
+    return subpassLoad(albedoInput).rgb;
+}
+
+vec3 readNormal() {
+#ifdef COMPACT_GBUFFER
+    return decodeOctahedral(subpassLoad(normalInput).rg);
+#else
+    return normalize(subpassLoad(normalInput).rgb * 2.0 - 1.0);
+#endif
+}
+
+float readDepth() {
+    return subpassLoad(depthInput).r;
+}
+
+float readRoughness() {
+#ifdef COMPACT_GBUFFER
+    return subpassLoad(albedoInput).a;
+#else
+    return subpassLoad(roughnessInput).r;
+#endif
+}
+
+#endif
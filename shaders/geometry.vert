@@ -5,6 +5,17 @@ layout(set = 0, binding = 0) uniform CameraUBO {
     mat4 proj;
 } camera;
 
+// model matrix by model index, and this frame's visible instances, a draw's firstInstance
+// points at its run so gl_InstanceIndex selects the instance directly
+layout(std430, set = 0, binding = 1) readonly buffer Transforms {
+    mat4 transforms[];
+};
+
+// x: model index, y: material index of the draw
+layout(std430, set = 0, binding = 2) readonly buffer Instances {
+    uvec2 instances[];
+};
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec3 inColor;
@@ -15,11 +26,22 @@ layout(location = 0) out vec3 fragWorldPos;
 layout(location = 1) out vec3 fragNormal;
 layout(location = 2) out vec2 fragTexCoord;
 layout(location = 3) out vec4 fragTangent;
+layout(location = 4) flat out uint fragMaterial;
+
+// matches depth_prepass.vert so EQUAL depth testing after the prepass is exact
+invariant gl_Position;
 
 void main() {
-    gl_Position = camera.proj * camera.view * vec4(inPosition, 1.0);
-    fragWorldPos = inPosition;
-    fragNormal = inNormal;
+    uvec2 instance = instances[gl_InstanceIndex];
+    mat4 model = transforms[instance.x];
+    vec4 worldPos = model * vec4(inPosition, 1.0);
+    // inverse transpose keeps normals perpendicular under non-uniform scale
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
+
+    gl_Position = camera.proj * camera.view * worldPos;
+    fragWorldPos = worldPos.xyz;
+    fragNormal = normalMatrix * inNormal;
     fragTexCoord = inTexCoord;
-    fragTangent = inTangent;
+    fragTangent = vec4(mat3(model) * inTangent.xyz, inTangent.w);
+    fragMaterial = instance.y;
 }
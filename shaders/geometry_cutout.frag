@@ -0,0 +1,47 @@
+#version 460
+#extension GL_KHR_vulkan_glsl : enable
+#extension GL_GOOGLE_include_directive : require
+
+#define MATERIAL_SET 1
+#include "materials.glsl"
+#include "features.glsl"
+
+layout(location = 0) in vec3 fragWorldPos;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec2 fragTexCoord;
+layout(location = 3) in vec4 fragTangent;
+layout(location = 4) flat in uint fragMaterial;
+
+#define GBUFFER_WRITE
+#include "gbuffer.glsl"
+
+// alpha tested variant of geometry.frag for cutout materials
+const float ALPHA_CUTOFF = 0.5;
+
+void main() {
+    MaterialData material = materials[fragMaterial];
+
+    // cutout materials always have a diffuse texture
+    vec4 albedo = texture(materialTextures[material.diffuseTexture], fragTexCoord);
+    if (albedo.a < ALPHA_CUTOFF) {
+        discard;
+    }
+
+    // two sided: flip the normal for back faces
+    vec3 N = normalize(gl_FrontFacing ? fragNormal : -fragNormal);
+
+    vec3 normal;
+    if (FEATURE_NORMAL_MAP) {
+        vec3 T = normalize(fragTangent.xyz);
+        T = normalize(T - dot(T, N) * N);
+        vec3 B = cross(N, T) * fragTangent.w;
+        mat3 TBN = mat3(T, B, N);
+        vec3 sampledNormal = texture(materialTextures[material.normalTexture], fragTexCoord).rgb;
+        sampledNormal = sampledNormal * 2.0 - 1.0;
+        normal = normalize(TBN * sampledNormal);
+    } else {
+        normal = N;
+    }
+
+    writeGBuffer(albedo.rgb, normal, material.roughness);
+}
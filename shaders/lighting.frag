@@ -1,5 +1,6 @@
 #version 460
 #extension GL_KHR_vulkan_glsl : enable
+#extension GL_GOOGLE_include_directive : require
 
 layout(set = 0, binding = 0) uniform CameraUBO {
     mat4 view;
@@ -8,10 +9,9 @@ layout(set = 0, binding = 0) uniform CameraUBO {
     mat4 invProj;
 } camera;
 
-layout(set = 1, binding = 0) uniform sampler2D albedoSampler;
-layout(set = 1, binding = 1) uniform sampler2D normalSampler;
-layout(set = 1, binding = 2) uniform sampler2D depthSampler;
-layout(set = 1, binding = 3) uniform sampler2D roughnessSampler;
+#define GBUFFER_READ
+#include "gbuffer.glsl"
+#include "features.glsl"
 
 layout(set = 2, binding = 0) uniform LightingUBO {
     vec3 direction;
@@ -22,14 +22,21 @@ layout(set = 2, binding = 0) uniform LightingUBO {
     float specularPower;
     vec3 cameraPosition;
     float padding;
+    mat4 cascadeViewProj[4];
+    vec4 cascadeSplits;         // view depth where each cascade ends
+    vec4 cascadeTexelSizes;     // world units per shadow map texel
+    uint cascadeCount;          // 0 when shadows are off
+    int pcfRadius;
+    float shadowBias;
+    float shadowPadding;
 } light;
 
-layout(set = 3, binding = 0) uniform PointLightUBO {
-    vec3 position;
-    float intensity;
-    vec3 color;
-    float padding;
-} pointLight;
+layout(set = 2, binding = 1) uniform sampler2DArrayShadow shadowMap;
+
+// point lights binned per cluster by cluster_build.comp
+#define CLUSTER_SET 3
+#define CLUSTER_ACCESS readonly
+#include "clusters.glsl"
 
 layout(location = 0) in vec2 fragTexCoord;
 
@@ -75,60 +82,122 @@ float geometrySmith(float NdotV, float NdotL, float roughness) {
     return ggx1 * ggx2;
 }
 
+// percentage closer filtering over (2 * pcfRadius + 1)^2 taps, each tap is a bilinear 2x2 compare
+float sampleShadow(vec3 worldPos, vec3 normal, float viewDepth) {
+    if (light.cascadeCount == 0u || viewDepth > light.cascadeSplits[light.cascadeCount - 1u]) {
+        return 1.0;
+    }
+
+    uint cascade = 0u;
+    while (cascade < light.cascadeCount - 1u && viewDepth > light.cascadeSplits[cascade]) {
+        cascade++;
+    }
+
+    // push the lookup out along the normal by about a texel to avoid acne on grazing surfaces
+    vec3 offsetPos = worldPos + normal * light.cascadeTexelSizes[cascade] * 1.5;
+    vec4 shadowPos = light.cascadeViewProj[cascade] * vec4(offsetPos, 1.0);
+    vec3 shadowCoord = shadowPos.xyz / shadowPos.w;
+    vec2 uv = shadowCoord.xy * 0.5 + 0.5;
+    float reference = shadowCoord.z - light.shadowBias;
+
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int y = -light.pcfRadius; y <= light.pcfRadius; ++y) {
+        for (int x = -light.pcfRadius; x <= light.pcfRadius; ++x) {
+            // explicit zero gradients, the lookup happens in non uniform control flow
+            lit += textureGrad(shadowMap, vec4(uv + vec2(x, y) * texelSize, float(cascade), reference), vec2(0.0), vec2(0.0));
+        }
+    }
+
+    float taps = float(2 * light.pcfRadius + 1);
+    return lit / (taps * taps);
+}
+
 void main() {
-    vec3 albedo = texture(albedoSampler, fragTexCoord).rgb;
-    vec3 normal = normalize(texture(normalSampler, fragTexCoord).rgb * 2.0 - 1.0);
-    float depth = texture(depthSampler, fragTexCoord).r;
-    float roughness = max(texture(roughnessSampler, fragTexCoord).r, 0.04);
+    vec3 albedo = readAlbedo();
+    vec3 normal = readNormal();
+    float depth = readDepth();
+    float roughness = max(readRoughness(), 0.04);
     if (depth >= 1.0) {
         outColor = vec4(albedo, 1.0);
         return;
     }
     vec3 worldPos = reconstructWorldPosition(depth, fragTexCoord);
+    float viewDepth = -(camera.view * vec4(worldPos, 1.0)).z;
     vec3 viewDir = normalize(light.cameraPosition - worldPos);
-    vec3 lightDir = normalize(-light.direction);
-    vec3 halfDir = normalize(lightDir + viewDir);
-
-    float NdotL = max(dot(normal, lightDir), 0.0);
     float NdotV = max(dot(normal, viewDir), 0.0);
-    float NdotH = max(dot(normal, halfDir), 0.0);
-    float HdotV = max(dot(halfDir, viewDir), 0.0);
+    vec3 F0 = vec3(0.04); // default dielectric
 
     vec3 ambient = light.ambientColor * light.ambientIntensity * albedo;
-    vec3 diffuse = light.color * light.intensity * NdotL * albedo;
-    vec3 F0 = vec3(0.04); // default dielectric
-    vec3 F = fresnelSchlick(HdotV, F0);
-    float D = distributionGGX(NdotH, roughness);
-    float G = geometrySmith(NdotV, NdotL, roughness);
-
-    // Cook-Torrance
-    float denominator = 4.0 * NdotV * NdotL + 0.0001;
-    vec3 specular = (D * F * G) / denominator;
-    specular = specular * light.color * light.intensity * NdotL;
-
-    // point light
-    vec3 pointLightDir = normalize(pointLight.position - worldPos);
-    float distance = length(pointLight.position - worldPos);
-    float attenuation = 1.0 / (distance * distance);
-
-    float pNdotL = max(dot(normal, pointLightDir), 0.0);
-    vec3 pHalfDir = normalize(pointLightDir + viewDir);
-    float pNdotH = max(dot(normal, pHalfDir), 0.0);
-    float pHdotV = max(dot(pHalfDir, viewDir), 0.0);
-
-    // point light diffuse
-    vec3 pDiffuse = pointLight.color * pointLight.intensity * pNdotL * albedo * attenuation;
-
-    // point light specular
-    vec3 pF = fresnelSchlick(pHdotV, F0);
-    float pD = distributionGGX(pNdotH, roughness);
-    float pG = geometrySmith(NdotV, pNdotL, roughness);
-    float pDenom = 4.0 * NdotV * pNdotL + 0.0001;
-    vec3 pSpecular = (pD * pF * pG) / pDenom;
-    pSpecular = pSpecular * pointLight.color * pointLight.intensity * pNdotL * attenuation;
+    vec3 diffuse = vec3(0.0);
+    vec3 specular = vec3(0.0);
+
+    // a disabled sun costs neither the BRDF nor the cascade lookups
+    if (FEATURE_DIRECTIONAL_LIGHT) {
+        vec3 lightDir = normalize(-light.direction);
+        vec3 halfDir = normalize(lightDir + viewDir);
+
+        float NdotL = max(dot(normal, lightDir), 0.0);
+        float NdotH = max(dot(normal, halfDir), 0.0);
+        float HdotV = max(dot(halfDir, viewDir), 0.0);
+
+        diffuse = light.color * light.intensity * NdotL * albedo;
+        vec3 F = fresnelSchlick(HdotV, F0);
+        float D = distributionGGX(NdotH, roughness);
+        float G = geometrySmith(NdotV, NdotL, roughness);
+
+        // Cook-Torrance
+        float denominator = 4.0 * NdotV * NdotL + 0.0001;
+        specular = (D * F * G) / denominator;
+        specular = specular * light.color * light.intensity * NdotL;
+
+        // directional light shadow
+        float shadow = NdotL > 0.0 ? sampleShadow(worldPos, normal, viewDepth) : 1.0;
+        diffuse *= shadow;
+        specular *= shadow;
+    }
+
+    // point lights touching this pixel's cluster
+    uint cluster = 0;
+    uint clusterLightCount = 0;
+    if (FEATURE_POINT_LIGHTS) {
+        cluster = getClusterIndex(gl_FragCoord.xy, viewDepth);
+        clusterLightCount = clusterLightCounts[cluster];
+    }
+    vec3 pointLighting = vec3(0.0);
+
+    for (uint i = 0; i < clusterLightCount; ++i) {
+        uint lightIndex = clusterLightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + i];
+        PointLightData pointLight = pointLights[lightIndex];
+
+        vec3 toLight = pointLight.position - worldPos;
+        float distance = length(toLight);
+        vec3 pointLightDir = toLight / max(distance, 0.0001);
+        float attenuation = rangeAttenuation(distance, pointLight.range);
+
+        float pNdotL = max(dot(normal, pointLightDir), 0.0);
+        vec3 pHalfDir = normalize(pointLightDir + viewDir);
+        float pNdotH = max(dot(normal, pHalfDir), 0.0);
+        float pHdotV = max(dot(pHalfDir, viewDir), 0.0);
+
+        // point light diffuse
+        vec3 pDiffuse = pointLight.color * pointLight.intensity * pNdotL * albedo * attenuation;
+
+        // point light specular
+        vec3 pF = fresnelSchlick(pHdotV, F0);
+        float pD = distributionGGX(pNdotH, roughness);
+        float pG = geometrySmith(NdotV, pNdotL, roughness);
+        float pDenom = 4.0 * NdotV * pNdotL + 0.0001;
+        vec3 pSpecular = (pD * pF * pG) / pDenom;
+        pSpecular = pSpecular * pointLight.color * pointLight.intensity * pNdotL * attenuation;
+
+        float pShadow = pNdotL > 0.0 ? pointLightShadow(lightIndex, worldPos, normal) : 1.0;
+
+        pointLighting += (pDiffuse + pSpecular) * pShadow;
+    }
 
     // combine lighting
-    vec3 finalColor = ambient + diffuse + specular + pDiffuse + pSpecular;
+    vec3 finalColor = ambient + diffuse + specular + pointLighting;
 
     outColor = vec4(finalColor, 1.0);
 }
@@ -0,0 +1,25 @@
+// shared by geometry.frag, geometry_cutout.frag and forward.frag, must match MaterialManager::GPUMaterial
+// define MATERIAL_SET before including
+
+#define MAX_MATERIAL_TEXTURES 512
+
+struct MaterialData {
+    vec4 diffuseColor;
+    uint hasTexture;
+    uint hasNormalMap;
+    float dissolve;
+    float roughness;
+    uint diffuseTexture;    // slots in materialTextures
+    uint normalTexture;
+    uint padding0;
+    uint padding1;
+};
+
+// every loaded material, 0 is the fallback for submeshes without one
+layout(std430, set = MATERIAL_SET, binding = 0) readonly buffer MaterialBuffer {
+    MaterialData materials[];
+};
+
+// every texture any material uses, unused slots hold the default texture. the index comes from
+// the draw's material, which is the same for every fragment of a draw
+layout(set = MATERIAL_SET, binding = 1) uniform sampler2D materialTextures[MAX_MATERIAL_TEXTURES];
@@ -0,0 +1,48 @@
+#version 460
+#extension GL_EXT_multiview : require
+
+// rendered once with six views, gl_ViewIndex is the cube face
+layout(push_constant) uniform PointShadowPushConstants {
+    vec4 lightPosition;     // xyz: light position
+    vec2 depthRange;        // x: near, y: far (the light's range)
+} shadow;
+
+// set 1 holds the scene's model matrices and the instances in the light's range
+layout(std430, set = 1, binding = 0) readonly buffer Transforms {
+    mat4 transforms[];
+};
+
+layout(std430, set = 1, binding = 1) readonly buffer Instances {
+    uint instances[];
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+
+layout(location = 0) out vec2 fragTexCoord;
+
+// view space of each cube face (+x, -x, +y, -y, +z, -z) looking at -z, the same as
+// glm::lookAt with the usual cubemap up vectors
+vec3 toFaceView(vec3 r, int face) {
+    switch (face) {
+    case 0: return vec3(-r.z, -r.y, -r.x);
+    case 1: return vec3( r.z, -r.y,  r.x);
+    case 2: return vec3( r.x,  r.z, -r.y);
+    case 3: return vec3( r.x, -r.z,  r.y);
+    case 4: return vec3( r.x, -r.y, -r.z);
+    default: return vec3(-r.x, -r.y, r.z);
+    }
+}
+
+void main() {
+    vec3 worldPos = (transforms[instances[gl_InstanceIndex]] * vec4(inPosition, 1.0)).xyz;
+    vec3 view = toFaceView(worldPos - shadow.lightPosition.xyz, gl_ViewIndex);
+
+    // 90 degree perspective with 0..1 depth, matches the reference in clusters.glsl
+    float n = shadow.depthRange.x;
+    float f = shadow.depthRange.y;
+    float w = -view.z;
+    gl_Position = vec4(view.xy, (w - n) * f / (f - n), w);
+
+    fragTexCoord = inTexCoord;
+}
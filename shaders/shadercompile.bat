@@ -2,10 +2,20 @@ C:/VulkanSDK/1.4.328.0/Bin/glslc.exe shader.vert -o vert.spv
 C:/VulkanSDK/1.4.328.0/Bin/glslc.exe shader.frag -o frag.spv
 C:/VulkanSDK/1.4.328.0/Bin/glslc.exe lighting.vert -o lighting_vert.spv
 C:/VulkanSDK/1.4.328.0/Bin/glslc.exe lighting.frag -o lighting_frag.spv
+C:/VulkanSDK/1.4.328.0/Bin/glslc.exe -DCOMPACT_GBUFFER lighting.frag -o lighting_compact_frag.spv
 C:/VulkanSDK/1.4.328.0/Bin/glslc.exe geometry.vert -o geometry_vert.spv
 C:/VulkanSDK/1.4.328.0/Bin/glslc.exe geometry.frag -o geometry_frag.spv
+C:/VulkanSDK/1.4.328.0/Bin/glslc.exe -DCOMPACT_GBUFFER geometry.frag -o geometry_compact_frag.spv
+C:/VulkanSDK/1.4.328.0/Bin/glslc.exe geometry_cutout.frag -o geometry_cutout_frag.spv
+C:/VulkanSDK/1.4.328.0/Bin/glslc.exe -DCOMPACT_GBUFFER geometry_cutout.frag -o geometry_cutout_compact_frag.spv
 C:/VulkanSDK/1.4.328.0/Bin/glslc.exe forward.frag -o forward_frag.spv
 C:/VulkanSDK/1.4.328.0/Bin/glslc.exe debug.frag -o debug_frag.spv
 C:/VulkanSDK/1.4.328.0/Bin/glslc.exe debug.vert -o debug_vert.spv
+C:/VulkanSDK/1.4.328.0/Bin/glslc.exe cluster_build.comp -o cluster_build_comp.spv
+C:/VulkanSDK/1.4.328.0/Bin/glslc.exe shadow.vert -o shadow_vert.spv
+C:/VulkanSDK/1.4.328.0/Bin/glslc.exe shadow_cutout.frag -o shadow_cutout_frag.spv
+C:/VulkanSDK/1.4.328.0/Bin/glslc.exe point_shadow.vert -o point_shadow_vert.spv
+C:/VulkanSDK/1.4.328.0/Bin/glslc.exe depth_prepass.vert -o depth_prepass_vert.spv
+C:/VulkanSDK/1.4.328.0/Bin/glslc.exe upscale.frag -o upscale_frag.spv
 
 pause
\ No newline at end of file
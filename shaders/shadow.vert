@@ -0,0 +1,25 @@
+#version 460
+
+layout(push_constant) uniform ShadowPushConstants {
+    mat4 lightViewProj;
+} shadow;
+
+// set 1 holds the scene's model matrices and the instances culled for this cascade
+layout(std430, set = 1, binding = 0) readonly buffer Transforms {
+    mat4 transforms[];
+};
+
+layout(std430, set = 1, binding = 1) readonly buffer Instances {
+    uint instances[];
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+
+layout(location = 0) out vec2 fragTexCoord;
+
+void main() {
+    vec4 worldPos = transforms[instances[gl_InstanceIndex]] * vec4(inPosition, 1.0);
+    gl_Position = shadow.lightViewProj * worldPos;
+    fragTexCoord = inTexCoord;
+}
@@ -0,0 +1,14 @@
+#version 460
+
+layout(set = 0, binding = 0) uniform sampler2D texSampler;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+// same cutoff as geometry_cutout.frag so shadows match the visible shape
+const float ALPHA_CUTOFF = 0.5;
+
+void main() {
+    if (texture(texSampler, fragTexCoord).a < ALPHA_CUTOFF) {
+        discard;
+    }
+}
@@ -0,0 +1,19 @@
+#version 460
+#extension GL_KHR_vulkan_glsl : enable
+
+// scene passes rendered into the top left of this image, see DynamicResolution
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+
+layout(push_constant) uniform UpscalePushConstants {
+    vec2 uvScale;   // render extent / image size
+    vec2 uvMax;     // last texel center inside the render extent
+} upscale;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec2 uv = min(fragTexCoord * upscale.uvScale, upscale.uvMax);
+    outColor = vec4(texture(sceneColor, uv).rgb, 1.0);
+}
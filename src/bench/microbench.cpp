@@ -0,0 +1,605 @@
+#include "../core/scene.hpp"
+#include "../core/transformhierarchy.hpp"
+#include "../renderer/mesh.hpp"
+#include "../renderer/frustum.hpp"
+#include "../renderer/indirectdrawing.hpp"
+#include "../renderer/drawsort.hpp"
+#include "../ui/primitives/aabb.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+    CPU microbenchmarks for the loader and culling hot paths. Runs the same code the renderer
+    runs, on the bundled assets and on procedurally generated grids, without creating a window
+    or a device. Every case is warmed up and then timed over a number of repetitions, the
+    report is the spread of those repetitions so a change can be judged against the noise.
+*/
+
+namespace {
+    struct Options {
+        uint32_t repetitions = 30;
+        uint32_t warmup = 3;
+        uint32_t gridSize = 512;     // --grid, quads per side of the procedural mesh
+        uint32_t gridGroups = 64;    // --groups, submeshes of the procedural mesh
+        uint32_t draws = 50000;      // --draws, synthetic instances for the culling and transform cases
+        uint32_t batches = 2048;     // --batches, transparent batches to sort
+        std::string assetsPath = "assets";
+        std::string filter;          // --filter, only run cases whose name contains it
+        std::string jsonPath;        // --json, also write the results to a file
+    };
+
+    struct Result {
+        std::string name;
+        std::string input;
+        size_t items;       // work items per repetition, for the throughput column
+        double minMs;
+        double medianMs;
+        double meanMs;
+        double stddevMs;
+        double p95Ms;
+    };
+
+    // everything timed feeds into this so the optimizer cannot drop the work
+    volatile uint64_t sink = 0;
+
+    double elapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    // setup runs untimed before every repetition, for cases that consume their input
+    Result measure(const Options& options, const std::string& name, const std::string& input, size_t items,
+        const std::function<void()>& setup, const std::function<void()>& body) {
+
+        for (uint32_t i = 0; i < options.warmup; i++) {
+            setup();
+            body();
+        }
+
+        std::vector<double> times;
+        times.reserve(options.repetitions);
+        for (uint32_t i = 0; i < options.repetitions; i++) {
+            setup();
+            auto start = std::chrono::steady_clock::now();
+            body();
+            auto end = std::chrono::steady_clock::now();
+            times.push_back(elapsedMs(start, end));
+        }
+
+        std::sort(times.begin(), times.end());
+        double mean = std::accumulate(times.begin(), times.end(), 0.0) / static_cast<double>(times.size());
+        double variance = 0.0;
+        for (double time : times) {
+            variance += (time - mean) * (time - mean);
+        }
+        variance /= static_cast<double>(std::max<size_t>(times.size() - 1, 1));
+
+        // nearest rank, same as the frame benchmark report
+        size_t rank = static_cast<size_t>(std::ceil(0.95 * static_cast<double>(times.size())));
+
+        Result result;
+        result.name = name;
+        result.input = input;
+        result.items = items;
+        result.minMs = times.front();
+        result.medianMs = times.size() % 2 == 1
+            ? times[times.size() / 2]
+            : 0.5 * (times[times.size() / 2 - 1] + times[times.size() / 2]);
+        result.meanMs = mean;
+        result.stddevMs = std::sqrt(variance);
+        result.p95Ms = times[std::clamp<size_t>(rank, 1, times.size()) - 1];
+        return result;
+    }
+
+    bool selected(const Options& options, const std::string& name) {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    /*
+        A rolling heightfield split into row bands, one `g` group each, so it parses into as many
+        submeshes as asked for. Written once per size and reused on the next run.
+    */
+    std::string writeGridObj(uint32_t size, uint32_t groups) {
+        std::filesystem::path path = std::filesystem::temp_directory_path() /
+            ("gathas_bench_grid_" + std::to_string(size) + "_" + std::to_string(groups) + ".obj");
+        if (std::filesystem::exists(path)) {
+            return path.string();
+        }
+
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to write procedural mesh: " + path.string());
+        }
+
+        file << std::fixed << std::setprecision(5);
+        uint32_t side = size + 1;
+        for (uint32_t z = 0; z < side; z++) {
+            for (uint32_t x = 0; x < side; x++) {
+                float fx = static_cast<float>(x);
+                float fz = static_cast<float>(z);
+                float height = std::sin(fx * 0.15f) * std::cos(fz * 0.1f) * 2.0f;
+                file << "v " << fx << " " << height << " " << fz << "\n";
+                file << "vt " << fx / static_cast<float>(size) << " " << fz / static_cast<float>(size) << "\n";
+
+                // analytic normal of the height function
+                float dx = std::cos(fx * 0.15f) * std::cos(fz * 0.1f) * 0.3f;
+                float dz = -std::sin(fx * 0.15f) * std::sin(fz * 0.1f) * 0.2f;
+                glm::vec3 normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+                file << "vn " << normal.x << " " << normal.y << " " << normal.z << "\n";
+            }
+        }
+
+        groups = std::clamp(groups, 1u, size);
+        for (uint32_t g = 0; g < groups; g++) {
+            file << "g band" << g << "\n";
+            uint32_t rowBegin = g * size / groups;
+            uint32_t rowEnd = (g + 1) * size / groups;
+            for (uint32_t z = rowBegin; z < rowEnd; z++) {
+                for (uint32_t x = 0; x < size; x++) {
+                    // obj indices are 1 based
+                    uint32_t a = z * side + x + 1;
+                    uint32_t b = a + 1;
+                    uint32_t c = a + side + 1;
+                    uint32_t d = a + side;
+                    file << "f " << a << "/" << a << "/" << a << " " << d << "/" << d << "/" << d << " "
+                         << c << "/" << c << "/" << c << " " << b << "/" << b << "/" << b << "\n";
+                }
+            }
+        }
+
+        std::cout << "wrote procedural mesh: " << path.string() << std::endl;
+        return path.string();
+    }
+
+    void benchMesh(const Options& options, const std::string& input, const std::string& objPath, std::vector<Result>& results) {
+        if (selected(options, "load_cpu")) {
+            results.push_back(measure(options, "load_cpu", input, 1, [] {}, [&objPath] {
+                Mesh mesh;
+                mesh.loadCpuData(objPath);
+                sink = sink + mesh.getVertexCount();
+            }));
+        }
+
+        Mesh mesh;
+        mesh.loadCpuData(objPath);
+        const std::vector<Vertex>& vertices = mesh.getVertices();
+        const std::vector<uint32_t>& indices = mesh.getIndices();
+
+        // unwelded arrays like the loader has them before its second pass
+        std::vector<Vertex> rawVertices;
+        std::vector<uint32_t> rawIndices(indices.size());
+        rawVertices.reserve(indices.size());
+        for (uint32_t index : indices) {
+            rawVertices.push_back(vertices[index]);
+        }
+        std::iota(rawIndices.begin(), rawIndices.end(), 0u);
+
+        if (selected(options, "tangents")) {
+            std::vector<Vertex> scratch;
+            results.push_back(measure(options, "tangents", input, rawIndices.size() / 3,
+                [&] { scratch = rawVertices; },
+                [&] {
+                    Mesh::calculateTangents(scratch, rawIndices);
+                    sink = sink + static_cast<uint64_t>(scratch.back().tangent.w > 0.0f);
+                }));
+        }
+
+        if (selected(options, "weld")) {
+            std::vector<Vertex> outVertices;
+            std::vector<uint32_t> outIndices;
+            results.push_back(measure(options, "weld", input, rawVertices.size(),
+                [&] { outVertices.clear(); outIndices.clear(); },
+                [&] {
+                    Mesh::weldVertices(rawVertices, rawIndices, outVertices, outIndices);
+                    sink = sink + outVertices.size();
+                }));
+        }
+
+        if (selected(options, "aabb_submesh")) {
+            results.push_back(measure(options, "aabb_submesh", input, indices.size(), [] {}, [&] {
+                for (uint32_t i = 0; i < mesh.getSubmeshCount(); i++) {
+                    const SubMesh& submesh = mesh.getSubmesh(i);
+                    AABB aabb = AABB::computeFromSubmesh(vertices, indices, submesh.indexOffset, submesh.indexCount);
+                    sink = sink + static_cast<uint64_t>(aabb.max.x > aabb.min.x);
+                }
+            }));
+        }
+    }
+
+    /*
+        Unit boxes scattered through a cube around the origin, each a model of its own, and
+        instanced draws of 16 instances on average that place them at random. The cameras sit in
+        the middle and look along eight directions, so roughly a quarter of the instances survive
+        each view.
+    */
+    struct CullingInputs {
+        std::vector<Scene::Model> models;
+        TransformHierarchy transforms;
+        std::vector<IndirectDrawCommand> drawCommands;
+        std::vector<glm::mat4> viewProjs;
+    };
+
+    CullingInputs buildCullingInputs(uint32_t drawCount) {
+        CullingInputs inputs;
+        std::mt19937 rng(1337);
+        float extent = std::cbrt(static_cast<float>(drawCount)) * 4.0f;
+        std::uniform_real_distribution<float> position(-extent, extent);
+        std::uniform_real_distribution<float> scale(0.5f, 3.0f);
+
+        uint32_t modelCount = std::max(drawCount / 4, 1u);
+        inputs.models.resize(modelCount);
+        for (Scene::Model& model : inputs.models) {
+            for (uint32_t s = 0; s < 4; s++) {
+                glm::vec3 offset(static_cast<float>(s) * 2.0f, 0.0f, 0.0f);
+                model.submeshAABBs.emplace_back(offset - glm::vec3(0.5f), offset + glm::vec3(0.5f));
+            }
+            glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(position(rng), position(rng), position(rng)));
+            transform = glm::scale(transform, glm::vec3(scale(rng)));
+            inputs.transforms.addNode(transform, model.submeshAABBs);
+        }
+        inputs.transforms.update(false);
+
+        uint32_t commandCount = std::max(drawCount / 16, 1u);
+        std::uniform_int_distribution<uint32_t> pickModel(0, modelCount - 1);
+        std::uniform_int_distribution<uint32_t> pickSubmesh(0, 3);
+        std::uniform_int_distribution<uint32_t> pickCommand(0, commandCount - 1);
+        inputs.drawCommands.resize(commandCount);
+        for (uint32_t i = 0; i < commandCount; i++) {
+            IndirectDrawCommand& cmd = inputs.drawCommands[i];
+            cmd.indirectCommand = { 36, 0, i * 36, 0, 0 };
+            cmd.mesh = nullptr;
+            cmd.submeshIndex = pickSubmesh(rng);
+        }
+        for (uint32_t i = 0; i < drawCount; i++) {
+            inputs.drawCommands[pickCommand(rng)].instances.push_back(pickModel(rng));
+        }
+
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, extent * 2.0f);
+        for (uint32_t i = 0; i < 8; i++) {
+            float yaw = glm::two_pi<float>() * static_cast<float>(i) / 8.0f;
+            glm::vec3 forward(std::cos(yaw), 0.2f, std::sin(yaw));
+            inputs.viewProjs.push_back(projection * glm::lookAt(glm::vec3(0.0f), forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
+        return inputs;
+    }
+
+    void benchCulling(const Options& options, std::vector<Result>& results) {
+        CullingInputs inputs = buildCullingInputs(options.draws);
+        std::string input = std::to_string(options.draws) + " instances";
+        size_t items = static_cast<size_t>(options.draws) * inputs.viewProjs.size();
+
+        std::vector<Frustum> frustums(inputs.viewProjs.size());
+        for (size_t i = 0; i < frustums.size(); i++) {
+            frustums[i].extractFromViewProj(inputs.viewProjs[i]);
+        }
+
+        // mesh space boxes moved by their model matrix, against the world boxes the hierarchy caches
+        if (selected(options, "frustum_aabb")) {
+            results.push_back(measure(options, "frustum_aabb", input, items, [] {}, [&] {
+                uint64_t visible = 0;
+                for (const Frustum& frustum : frustums) {
+                    for (const IndirectDrawCommand& cmd : inputs.drawCommands) {
+                        for (uint32_t modelIndex : cmd.instances) {
+                            const Scene::Model& model = inputs.models[modelIndex];
+                            visible += frustum.testAABB(model.submeshAABBs[cmd.submeshIndex],
+                                inputs.transforms.getWorldTransform(modelIndex));
+                        }
+                    }
+                }
+                sink = sink + visible;
+            }));
+        }
+
+        if (selected(options, "frustum_world")) {
+            results.push_back(measure(options, "frustum_world", input, items, [] {}, [&] {
+                uint64_t visible = 0;
+                for (const Frustum& frustum : frustums) {
+                    for (const IndirectDrawCommand& cmd : inputs.drawCommands) {
+                        for (uint32_t modelIndex : cmd.instances) {
+                            visible += frustum.testAABB(inputs.transforms.getWorldBounds(modelIndex, cmd.submeshIndex));
+                        }
+                    }
+                }
+                sink = sink + visible;
+            }));
+        }
+
+        std::vector<SortedDraw> visibleDraws;
+        std::vector<SortedDraw> sortScratch;
+        std::vector<VisibleInstance> visibleInstances;
+        Scene::CullScratch scratch;
+        for (bool blended : { false, true }) {
+            std::string name = blended ? "cull_blended" : "cull";
+            if (!selected(options, name)) {
+                continue;
+            }
+            uint64_t key = blended ? DrawSort::makeBlended(DrawSort::PASS_FORWARD, DrawSort::PIPELINE_DEFAULT, 0, 0) :
+                DrawSort::make(DrawSort::PASS_GEOMETRY, DrawSort::PIPELINE_DEFAULT, 0, 0);
+            results.push_back(measure(options, name, input, items, [] {}, [&] {
+                for (const Frustum& frustum : frustums) {
+                    visibleDraws.clear();
+                    visibleInstances.clear();
+                    Scene::cullDraws(frustum, inputs.drawCommands, inputs.transforms, glm::vec3(0.0f), key, 0, blended,
+                        0, visibleDraws, visibleInstances, scratch);
+                    // the draws are ordered by their depth bits as updateCulling does
+                    DrawSort::radixSort(visibleDraws, sortScratch);
+                    sink = sink + visibleInstances.size();
+                }
+            }));
+        }
+    }
+
+    /*
+        Chains of eight nodes, each with four submesh boxes, so every level holds an eighth of
+        the nodes. Moving every root dirties the whole hierarchy, which is the worst case of an
+        update, once on this thread and once with the levels split across threads.
+    */
+    void benchTransforms(const Options& options, std::vector<Result>& results) {
+        TransformHierarchy transforms;
+        std::vector<AABB> bounds;
+        for (uint32_t s = 0; s < 4; s++) {
+            glm::vec3 offset(static_cast<float>(s) * 2.0f, 0.0f, 0.0f);
+            bounds.emplace_back(offset - glm::vec3(0.5f), offset + glm::vec3(0.5f));
+        }
+
+        glm::mat4 step = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, 0.0f)),
+            0.1f, glm::vec3(0.0f, 1.0f, 0.0f));
+        for (uint32_t i = 0; i < options.draws; i++) {
+            bool root = i % 8 == 0;
+            transforms.addNode(root ? glm::mat4(1.0f) : step, bounds, root ? TransformHierarchy::NO_PARENT : i - 1);
+        }
+        transforms.update(false);
+
+        std::string input = std::to_string(options.draws) + " nodes";
+        float angle = 0.0f;
+        auto moveRoots = [&] {
+            angle += 0.01f;
+            glm::mat4 rootTransform = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f));
+            for (uint32_t i = 0; i < options.draws; i += 8) {
+                transforms.setLocalTransform(i, rootTransform);
+            }
+        };
+
+        for (bool parallel : { false, true }) {
+            std::string name = parallel ? "transform_update_mt" : "transform_update";
+            if (!selected(options, name)) {
+                continue;
+            }
+            results.push_back(measure(options, name, input, options.draws, moveRoots, [&] {
+                sink = sink + transforms.update(parallel);
+            }));
+        }
+    }
+
+    void benchTransparentSort(const Options& options, const std::string& gridPath, std::vector<Result>& results) {
+        if (!selected(options, "transparent_sort")) {
+            return;
+        }
+
+        Mesh mesh;
+        mesh.loadCpuData(gridPath);
+        std::vector<AABB> submeshAABBs;
+        for (uint32_t s = 0; s < mesh.getSubmeshCount(); s++) {
+            const SubMesh& submesh = mesh.getSubmesh(s);
+            submeshAABBs.push_back(AABB::computeFromSubmesh(mesh.getVertices(), mesh.getIndices(),
+                submesh.indexOffset, submesh.indexCount));
+        }
+
+        // a few instances per batch spread over the grid, so the instances get ordered too
+        constexpr uint32_t instancesPerBatch = 4;
+        float center = static_cast<float>(options.gridSize) * 0.5f;
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> position(0.0f, static_cast<float>(options.gridSize));
+        TransformHierarchy transforms;
+        std::vector<MaterialBatch> batches(options.batches);
+        for (uint32_t i = 0; i < options.batches; i++) {
+            for (uint32_t j = 0; j < instancesPerBatch; j++) {
+                uint32_t node = transforms.addNode(glm::translate(glm::mat4(1.0f),
+                    glm::vec3(position(rng) - center, 0.0f, position(rng) - center)), submeshAABBs);
+                batches[i].addInstance(&mesh, i % mesh.getSubmeshCount(), node);
+            }
+        }
+        transforms.update(false);
+
+        std::vector<const MaterialBatch*> order;
+        for (const MaterialBatch& batch : batches) {
+            order.push_back(&batch);
+        }
+        std::vector<SortedDraw> visibleDraws;
+        std::vector<SortedDraw> sortScratch;
+        std::vector<VisibleInstance> visibleInstances;
+        Scene::CullScratch scratch;
+
+        glm::vec3 cameraPosition(center, 20.0f, -10.0f);
+        Frustum frustum;
+        frustum.extractFromViewProj(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f) *
+            glm::lookAt(cameraPosition, glm::vec3(center, 0.0f, center), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+        // the scene hands over batches in hash map order, so start from a shuffle each time
+        results.push_back(measure(options, "transparent_sort", std::to_string(options.batches) + " batches", order.size(),
+            [&] { std::shuffle(order.begin(), order.end(), rng); },
+            [&] {
+                visibleDraws.clear();
+                visibleInstances.clear();
+                for (uint32_t i = 0; i < order.size(); i++) {
+                    Scene::cullDraws(frustum, order[i]->drawCommands, transforms, cameraPosition,
+                        DrawSort::makeBlended(DrawSort::PASS_FORWARD, DrawSort::PIPELINE_DEFAULT, 0, i), 0, true, i,
+                        visibleDraws, visibleInstances, scratch);
+                }
+                DrawSort::radixSort(visibleDraws, sortScratch);
+                sink = sink + visibleInstances.size();
+            }));
+    }
+
+    /*
+        Draw lists as updateCulling builds them: two pipeline kinds in four feature variants each,
+        a few hundred materials and a depth per draw, in the order the batches come out of the
+        hash maps. The radix sort is what the renderer uses, std::sort on the same keys is the
+        baseline it replaced.
+    */
+    void benchDrawSort(const Options& options, std::vector<Result>& results) {
+        std::mt19937 rng(11);
+        std::uniform_int_distribution<uint32_t> material(1, 512);
+        std::uniform_real_distribution<float> distance(0.0f, 10000.0f);
+
+        std::vector<SortedDraw> unsorted(options.draws);
+        for (uint32_t i = 0; i < options.draws; i++) {
+            uint32_t pipeline = DrawSort::makePipeline(i % 8 == 0 ? DrawSort::PIPELINE_CUTOUT : DrawSort::PIPELINE_DEFAULT, i % 4);
+            unsorted[i].key = DrawSort::make(DrawSort::PASS_GEOMETRY, pipeline, material(rng),
+                DrawSort::orderedDepth(distance(rng)));
+            unsorted[i].command.firstInstance = i;
+        }
+
+        std::string input = std::to_string(options.draws) + " draws";
+        std::vector<SortedDraw> draws;
+        std::vector<SortedDraw> scratch;
+
+        if (selected(options, "draw_sort_radix")) {
+            results.push_back(measure(options, "draw_sort_radix", input, options.draws,
+                [&] { draws = unsorted; },
+                [&] {
+                    DrawSort::radixSort(draws, scratch);
+                    sink = sink + draws.front().command.firstInstance;
+                }));
+        }
+
+        if (selected(options, "draw_sort_std")) {
+            results.push_back(measure(options, "draw_sort_std", input, options.draws,
+                [&] { draws = unsorted; },
+                [&] {
+                    std::stable_sort(draws.begin(), draws.end(),
+                        [](const SortedDraw& a, const SortedDraw& b) { return a.key < b.key; });
+                    sink = sink + draws.front().command.firstInstance;
+                }));
+        }
+    }
+
+    void printResults(const std::vector<Result>& results) {
+        std::cout << std::endl << std::left
+                  << std::setw(22) << "case" << std::setw(26) << "input"
+                  << std::right << std::setw(11) << "min ms" << std::setw(11) << "median ms"
+                  << std::setw(11) << "mean ms" << std::setw(11) << "stddev" << std::setw(11) << "p95 ms"
+                  << std::setw(14) << "M items/s" << std::endl;
+
+        std::cout << std::fixed << std::setprecision(3);
+        for (const Result& result : results) {
+            double throughput = result.medianMs > 0.0 ? static_cast<double>(result.items) / result.medianMs / 1000.0 : 0.0;
+            std::cout << std::left << std::setw(22) << result.name << std::setw(26) << result.input
+                      << std::right << std::setw(11) << result.minMs << std::setw(11) << result.medianMs
+                      << std::setw(11) << result.meanMs << std::setw(11) << result.stddevMs << std::setw(11) << result.p95Ms
+                      << std::setw(14) << throughput << std::endl;
+        }
+    }
+
+    void writeJson(const Options& options, const std::vector<Result>& results) {
+        std::ofstream file(options.jsonPath);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to write microbenchmark report: " + options.jsonPath);
+        }
+
+        file << std::fixed << std::setprecision(4);
+        file << "{\n  \"repetitions\": " << options.repetitions << ",\n  \"warmup\": " << options.warmup << ",\n";
+        file << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& result = results[i];
+            file << "    { \"name\": \"" << result.name << "\", \"input\": \"" << result.input << "\""
+                 << ", \"items\": " << result.items
+                 << ", \"minMs\": " << result.minMs << ", \"medianMs\": " << result.medianMs
+                 << ", \"meanMs\": " << result.meanMs << ", \"stddevMs\": " << result.stddevMs
+                 << ", \"p95Ms\": " << result.p95Ms << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        file << "  ]\n}\n";
+
+        std::cout << "microbenchmark report written: " << options.jsonPath << std::endl;
+    }
+
+    uint32_t parseCount(const char* text, uint32_t fallback) {
+        int value = std::atoi(text);
+        return value > 0 ? static_cast<uint32_t>(value) : fallback;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            options.repetitions = parseCount(argv[++i], options.repetitions);
+        }
+        else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmup = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+        }
+        else if (std::strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            options.gridSize = parseCount(argv[++i], options.gridSize);
+        }
+        else if (std::strcmp(argv[i], "--groups") == 0 && i + 1 < argc) {
+            options.gridGroups = parseCount(argv[++i], options.gridGroups);
+        }
+        else if (std::strcmp(argv[i], "--draws") == 0 && i + 1 < argc) {
+            options.draws = parseCount(argv[++i], options.draws);
+        }
+        else if (std::strcmp(argv[i], "--batches") == 0 && i + 1 < argc) {
+            options.batches = parseCount(argv[++i], options.batches);
+        }
+        else if (std::strcmp(argv[i], "--assets") == 0 && i + 1 < argc) {
+            options.assetsPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            options.jsonPath = argv[++i];
+        }
+        else {
+            std::cout << "unknown argument: " << argv[i] << std::endl;
+        }
+    }
+
+    try {
+        std::vector<Result> results;
+
+        std::string gridPath = writeGridObj(options.gridSize, options.gridGroups);
+        std::string gridName = "grid " + std::to_string(options.gridSize) + "x" + std::to_string(options.gridSize);
+        benchMesh(options, gridName, gridPath, results);
+
+        // bundled assets are optional, large ones like sponza are not always checked out
+        for (const char* name : { "monkey", "balls", "fountain", "sponza" }) {
+            std::filesystem::path objPath = std::filesystem::path(options.assetsPath) / name / (std::string(name) + ".obj");
+            if (!std::filesystem::exists(objPath)) {
+                std::cout << "skipping missing asset: " << objPath.string() << std::endl;
+                continue;
+            }
+            benchMesh(options, name, objPath.string(), results);
+        }
+
+        benchCulling(options, results);
+        benchTransforms(options, results);
+        benchTransparentSort(options, gridPath, results);
+        benchDrawSort(options, results);
+
+        printResults(results);
+        if (!options.jsonPath.empty()) {
+            writeJson(options, results);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,6 +1,7 @@
 #define VMA_IMPLEMENTATION
 #include "application.hpp"
 #include "scene.hpp"
+#include "cpuprofiler.hpp"
 #include "../renderer/swapchain.hpp"
 #include "../renderer/pipeline.hpp"
 #include "../renderer/shadermanager.hpp"
@@ -8,12 +9,21 @@
 #include <stdexcept>
 #include <vector>
 #include <set>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
 
-Application::Application() {
-    window.initWindow();
-    window.setFramebufferResizeCallback(framebufferResizeCallback);
+Application::Application(const RenderSettings& settings, const BenchmarkSettings& benchmarkSettings,
+    const StressSceneSettings& stressSettings)
+    : renderSettings(settings), benchmarkSettings(benchmarkSettings), stressSettings(stressSettings) {
     windowUserData.app = this;
     windowUserData.camera = nullptr;
+    if (isHeadless()) {
+        return;
+    }
+
+    window.initWindow();
+    window.setFramebufferResizeCallback(framebufferResizeCallback);
     glfwSetWindowUserPointer(window.getWindow(), &windowUserData);
 }
 
@@ -23,7 +33,12 @@ Application::~Application() {
 
 void Application::run() {
     initVulkan();
-    mainLoop();
+    if (isHeadless()) {
+        runBenchmark();
+    }
+    else {
+        mainLoop();
+    }
 }
 
 void Application::mainLoop() {
@@ -33,8 +48,29 @@ void Application::mainLoop() {
         float currentFrameTime = static_cast<float>(glfwGetTime());
         float deltaTime = currentFrameTime - lastFrameTime;
 
-        camera->update(deltaTime);
+        // a playing path owns the camera, the recording sees the pose this frame rendered with
+        bool playing = cameraPath->isPlaying();
+        if (playing) {
+            cameraPath->applyPlayback(*camera);
+        }
+        else {
+            camera->update(deltaTime);
+        }
+
+        auto start = std::chrono::steady_clock::now();
         drawFrame();
+        auto end = std::chrono::steady_clock::now();
+
+        if (playing) {
+            cameraPath->endPlaybackFrame(std::chrono::duration<float, std::milli>(end - start).count(),
+                gpuProfiler->getLatestMs(GpuProfiler::FRAME));
+        }
+        else {
+            cameraPath->recordFrame(*camera, deltaTime);
+        }
+
+        // after present and before the next input is read, so a capped frame adds no latency
+        frameLimiter.wait(renderSettings.frameRateLimit);
     }
     vkDeviceWaitIdle(device);
 }
@@ -45,23 +81,113 @@ void Application::initVulkan() {
     pickPhysicalDevice();
     createLogicalDevice();
     createShaderManager();
+    createPipelineCache();
     createCamera();
     createCommandBuffer();
+    createGpuProfiler();
+    createGeometryPassStats();
+    createDynamicResolution();
     createSwapChain();
     createTextureManager();
     createMaterialManager();
     createGBuffer();
     createDirectionalLight();
+    createShadowMap();
     createPointLight();
+    createPointShadowMap();
+    createClusteredLighting();
+    createFrameGraph();
     createPipeline();
     createScene();
     createDebugDraw();
+    if (isHeadless()) {
+        return;
+    }
+    if (stressSettings.count > 0) {
+        scene->generateStressScene(stressSettings);
+    }
     createImGuiLayer();
 
     camera->setImGuiLayer(imguiLayer.get());
     lastFrameTime = static_cast<float>(glfwGetTime());
 }
 
+/*
+    Loads the benchmark scene, then flies the scripted camera path with the camera input and the
+    ui out of the loop. Every frame is rendered and submitted as usual, only presentation is
+    skipped. Per frame cpu time covers the whole drawFrame including the fence wait, the gpu time
+    is the profiler's FRAME zone, which is read back two frames late.
+*/
+void Application::runBenchmark() {
+    std::filesystem::path scenePath(benchmarkSettings.scenePath);
+    if (scenePath.extension() != ".obj") {
+        throw std::runtime_error("benchmark scene must be an .obj file: " + benchmarkSettings.scenePath);
+    }
+
+    scene->loadModel(scenePath.parent_path().string(), scenePath.stem().string());
+    if (scene->getModelCount() == 0) {
+        throw std::runtime_error("failed to load benchmark scene: " + benchmarkSettings.scenePath);
+    }
+    if (stressSettings.count > 0) {
+        scene->generateStressScene(stressSettings);
+    }
+
+    uint32_t totalDraws = 0;
+    for (size_t i = 0; i < scene->getModelCount(); i++) {
+        totalDraws += static_cast<uint32_t>(scene->getModel(i)->submeshAABBs.size());
+    }
+
+    // a recorded path replaces the scripted flight and sets the frame count
+    if (!benchmarkSettings.cameraPath.empty()) {
+        if (!cameraPath->load(benchmarkSettings.cameraPath)) {
+            throw std::runtime_error("failed to load benchmark camera path: " + benchmarkSettings.cameraPath);
+        }
+        benchmarkSettings.frames = static_cast<uint32_t>(cameraPath->getFrameCount());
+    }
+
+    Benchmark benchmark(benchmarkSettings);
+    benchmark.setSceneBounds(scene->getBounds());
+
+    std::cout << "benchmark: " << benchmarkSettings.warmupFrames << " warmup + "
+        << benchmarkSettings.frames << " frames" << std::endl;
+
+    for (uint32_t frame = 0; frame < benchmark.getTotalFrames(); frame++) {
+        glm::vec3 position;
+        float yaw, pitch;
+        if (cameraPath->getFrameCount() > 0) {
+            const CameraPath::Frame& pose = cameraPath->getFrame(benchmark.isMeasured(frame) ? frame - benchmarkSettings.warmupFrames : 0);
+            position = pose.position;
+            yaw = pose.yaw;
+            pitch = pose.pitch;
+        }
+        else {
+            benchmark.getCameraPose(frame, position, yaw, pitch);
+        }
+        camera->setPosition(position);
+        camera->setRotation(yaw, pitch);
+        camera->refresh();
+
+        uint32_t frameIndex = currentFrame;
+        auto start = std::chrono::steady_clock::now();
+        drawFrame();
+        auto end = std::chrono::steady_clock::now();
+
+        if (benchmark.isMeasured(frame)) {
+            Benchmark::Sample sample{};
+            sample.cpuMs = std::chrono::duration<float, std::milli>(end - start).count();
+            sample.gpuMs = gpuProfiler->getLatestMs(GpuProfiler::FRAME);
+            sample.visibleDraws = scene->getVisibleCount(frameIndex);
+            benchmark.addSample(sample);
+        }
+    }
+    vkDeviceWaitIdle(device);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    benchmark.writeReport(properties.deviceName, renderSettings, gpuProfiler.get(), commandBuffer.get(),
+        allocator, totalDraws);
+}
+
 void Application::createInstance() {
     VkApplicationInfo appInfo{};
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -69,15 +195,19 @@ void Application::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.1 for multiview, the point light shadow renders all six cube faces in one pass
+    appInfo.apiVersion = VK_API_VERSION_1_1;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
+    // headless needs no surface extensions, so glfw is never initialized
     uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    const char** glfwExtensions = nullptr;
+    if (!isHeadless()) {
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    }
 
     createInfo.enabledExtensionCount = glfwExtensionCount;
     createInfo.ppEnabledExtensionNames = glfwExtensions;
@@ -90,6 +220,9 @@ void Application::createInstance() {
 }
 
 void Application::createSurface() {
+    if (isHeadless()) {
+        return;
+    }
     glfwCreateWindowSurface(instance, window.getWindow(), nullptr, &surface);
 }
 
@@ -123,7 +256,30 @@ void Application::pickPhysicalDevice() {
 bool Application::isDeviceSuitable(VkPhysicalDevice device) {
     QueueFamilyIndices indices = findQueueFamilies(device);
 
-    return indices.isComplete();
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_1) {
+        return false;
+    }
+
+    // the bindless material textures, with room for the shadow and cluster samplers of the same stage
+    uint32_t requiredSamplers = MaterialManager::MAX_BINDLESS_TEXTURES + 16;
+    if (properties.limits.maxPerStageDescriptorSamplers < requiredSamplers ||
+        properties.limits.maxPerStageDescriptorSampledImages < requiredSamplers) {
+        return false;
+    }
+
+    VkPhysicalDeviceMultiviewFeatures multiviewFeatures{};
+    multiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &multiviewFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return indices.isComplete() && multiviewFeatures.multiview &&
+        features.features.multiDrawIndirect && features.features.drawIndirectFirstInstance &&
+        features.features.shaderSampledImageArrayDynamicIndexing;
 }
 
 QueueFamilyIndices Application::findQueueFamilies(VkPhysicalDevice device) {
@@ -141,8 +297,14 @@ QueueFamilyIndices Application::findQueueFamilies(VkPhysicalDevice device) {
             indices.graphicsFamily = i;
         }
 
+        // nothing is presented headless, the graphics queue stands in
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        if (surface != VK_NULL_HANDLE) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        }
+        else {
+            presentSupport = indices.graphicsFamily.has_value();
+        }
         if (presentSupport) {
             indices.presentFamily = i;
         }
@@ -157,6 +319,31 @@ QueueFamilyIndices Application::findQueueFamilies(VkPhysicalDevice device) {
     return indices;
 }
 
+VkFormat Application::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
+    for (VkFormat format : candidates) {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+
+        if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features) {
+            return format;
+        }
+        else if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features) {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("failed to find supported format");
+}
+
+// depth is also sampled by the lighting pass
+VkFormat Application::findDepthFormat() {
+    return findSupportedFormat(
+        { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+    );
+}
+
 void Application::createLogicalDevice() {
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
@@ -180,19 +367,37 @@ void Application::createLogicalDevice() {
     //specify device specific features
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // indirect draws are issued with drawCount > 1
+    deviceFeatures.multiDrawIndirect = VK_TRUE;
+    // instanced draws point firstInstance at their run of the instance list
+    deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+    // bindless material textures are indexed by the draw's material
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+
+    // optional, counts fragment shader invocations for the overdraw readout
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+
+    // the point shadow cube is rendered with one view per face
+    VkPhysicalDeviceMultiviewFeatures multiviewFeatures{};
+    multiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+    multiviewFeatures.multiview = VK_TRUE;
 
     // create the logical device
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &multiviewFeatures;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    std::vector<const char*> deviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
+    std::vector<const char*> deviceExtensions;
+    if (!isHeadless()) {
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
     createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.ppEnabledExtensionNames = deviceExtensions.empty() ? nullptr : deviceExtensions.data();
 
     if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
         throw std::runtime_error("failed to create logical device");
@@ -207,6 +412,7 @@ void Application::createLogicalDevice() {
     allocatorInfo.physicalDevice = physicalDevice;
     allocatorInfo.device = device;
     allocatorInfo.instance = instance;
+    allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_1;
     vmaCreateAllocator(&allocatorInfo, &allocator);
 }
 
@@ -214,14 +420,54 @@ void Application::createShaderManager() {
     shaderManager = std::make_unique<ShaderManager>(device);
 }
 
+void Application::createPipelineCache() {
+    pipelineCache = std::make_unique<PipelineCache>(device, physicalDevice, "pipeline_cache.bin");
+}
+
 void Application::createCamera() {
     camera = std::make_unique<Camera>(window.getWindow(), allocator);
     windowUserData.camera = camera.get();
+    cameraPath = std::make_unique<CameraPath>();
+    if (isHeadless()) {
+        camera->setViewportSize(benchmarkSettings.width, benchmarkSettings.height);
+        return;
+    }
     camera->setupInputCallbacks(window.getWindow());
 }
 
 void Application::createSwapChain() {
-    swapChain = std::make_unique<SwapChain>(physicalDevice, device, surface, window.getWindow());
+    if (isHeadless()) {
+        VkExtent2D extent = { benchmarkSettings.width, benchmarkSettings.height };
+        offscreenTarget = std::make_unique<OffscreenTarget>(device, allocator, extent,
+            static_cast<uint32_t>(commandBuffer->getMaxFramesInFlight()));
+        return;
+    }
+    swapChain = std::make_unique<SwapChain>(physicalDevice, device, surface, window.getWindow(),
+        renderSettings.presentMode);
+    reportPresentMode(nullptr);
+}
+
+void Application::reportPresentMode(const SwapChain* previous) {
+    VkPresentModeKHR mode = swapChain->getPresentMode();
+    VkPresentModeKHR requested = swapChain->getRequestedPresentMode();
+    renderSettings.activePresentMode = mode;
+
+    // every resize recreates the swap chain with the modes it already had
+    if (previous && previous->getPresentMode() == mode && previous->getRequestedPresentMode() == requested) {
+        return;
+    }
+
+    if (mode != requested) {
+        std::cout << "present mode " << SwapChain::getPresentModeName(requested) << " not supported, using "
+                  << SwapChain::getPresentModeName(mode) << std::endl;
+    }
+    else {
+        std::cout << "present mode: " << SwapChain::getPresentModeName(mode) << std::endl;
+    }
+}
+
+VkExtent2D Application::getOutputExtent() const {
+    return swapChain ? swapChain->getExtent() : offscreenTarget->getExtent();
 }
 
 void Application::createTextureManager() {
@@ -229,32 +475,292 @@ void Application::createTextureManager() {
 }
 
 void Application::createMaterialManager() {
-    materialManager = std::make_unique<MaterialManager>(device, textureManager.get());
+    materialManager = std::make_unique<MaterialManager>(device, allocator, commandBuffer.get(), textureManager.get());
 }
 
 void Application::createGBuffer() {
-    gbuffer = std::make_unique<GBuffer>(device, physicalDevice, allocator, swapChain->getExtent());
+    bool compact = renderSettings.compactGBuffer;
+    if (compact) {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, GBuffer::COMPACT_NORMAL_FORMAT, &props);
+        if (!(props.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)) {
+            std::cout << "compact g-buffer normals not supported, using the default layout" << std::endl;
+            compact = false;
+            renderSettings.compactGBuffer = false;
+        }
+    }
+
+    gbuffer = std::make_unique<GBuffer>(device, compact);
+    std::cout << "g-buffer layout: " << (compact ? "compact" : "default") << std::endl;
+}
+
+/*
+    Declares the frame: which images every pass reads and writes. The frame graph derives
+    render passes, layouts and dependencies from this, and owns the g-buffer and depth images.
+    With the g-buffer read as input attachments every pass lands in one render pass, so the
+    g-buffer and depth never leave tile memory on tilers.
+*/
+void Application::createFrameGraph() {
+    frameGraph = std::make_unique<FrameGraph>(device, allocator);
+
+    // headless frames are never presented and stay color attachments
+    VkFormat outputFormat = swapChain ? swapChain->getImageFormat() : offscreenTarget->getImageFormat();
+    backbufferImage = swapChain ?
+        frameGraph->importImage("backbuffer", outputFormat, swapChain->getImageViews(), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR) :
+        frameGraph->importImage("backbuffer", outputFormat, offscreenTarget->getImageViews(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    albedoImage = frameGraph->createImage("albedo", GBuffer::ALBEDO_FORMAT);
+    normalImage = frameGraph->createImage("normal", gbuffer->getNormalFormat());
+    // the compact layout keeps roughness in albedo alpha, cleared to 1.0 by the black clear
+    bool separateRoughness = !gbuffer->isCompact();
+    roughnessImage = separateRoughness ?
+        frameGraph->createImage("roughness", GBuffer::ROUGHNESS_FORMAT) : FrameGraph::INVALID_HANDLE;
+    depthImage = frameGraph->createImage("depth", findDepthFormat());
+    // with dynamic resolution the scene is lit into its own image and upscaled onto the backbuffer
+    sceneColorImage = dynamicResolution ?
+        frameGraph->createImage("scene color", outputFormat) : backbufferImage;
+
+    VkClearValue black{};
+    black.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+    VkClearValue roughnessClear{};
+    roughnessClear.color = { {1.0f, 0.0f, 0.0f, 0.0f} };  // default roughness 1.0
+    VkClearValue depthClear{};
+    depthClear.depthStencil = { 1.0f, 0 };
+
+    // the scene passes are recorded in parts on the recording threads. a zone's timestamps are
+    // written by its first and last part, which run first and last on the gpu
+    auto sortedPartCount = [this](uint32_t pass) {
+        return [this, pass]() { return commandBuffer->getPartCount(scene.get(), currentFrame, pass); };
+    };
+
+    // always declared so toggling it needs no rebuild, it only clears depth while disabled
+    FrameGraph::PassHandle prepass = frameGraph->addParallelPass("depth prepass",
+        [this, partCount = sortedPartCount(DrawSort::PASS_GEOMETRY)]() { return renderSettings.depthPrepass ? partCount() : 1u; },
+        [this](VkCommandBuffer cmd, uint32_t part, uint32_t partCount) {
+        if (part == 0) gpuProfiler->begin(cmd, currentFrame, GpuProfiler::PREPASS);
+        if (renderSettings.depthPrepass) {
+            commandBuffer->recordDepthPrepass(cmd, currentFrame, part, partCount, getRenderExtent(),
+                pipeline->getDepthPrepassPipeline(), pipeline->getPipelineLayout(), pipeline->getDescriptorSet(currentFrame),
+                scene.get());
+        }
+        if (part == partCount - 1) gpuProfiler->end(cmd, currentFrame, GpuProfiler::PREPASS);
+    });
+    frameGraph->writeDepth(prepass, depthImage, depthClear);
+
+    FrameGraph::PassHandle geometryPass = frameGraph->addParallelPass("geometry", sortedPartCount(DrawSort::PASS_GEOMETRY),
+        [this](VkCommandBuffer cmd, uint32_t part, uint32_t partCount) {
+        // each segment's material features pick the variant. after a prepass opaque depth is
+        // final, so the g-buffer only tests for EQUAL
+        auto selectPipeline = [this](uint32_t variant) {
+            uint32_t features = DrawSort::getPipelineFeatures(variant);
+            if (DrawSort::getPipelineKind(variant) == DrawSort::PIPELINE_CUTOUT) {
+                return pipeline->getGeometryCutoutPipeline(features);
+            }
+            return renderSettings.depthPrepass ?
+                pipeline->getGeometryEqualPipeline(features) : pipeline->getGeometryPipeline(features);
+        };
+
+        if (part == 0) gpuProfiler->begin(cmd, currentFrame, GpuProfiler::GEOMETRY);
+        geometryStats->beginQuery(cmd, currentFrame, part, partCount, getRenderExtent());
+        commandBuffer->recordGeometryPass(cmd, currentFrame, part, partCount, getRenderExtent(),
+            selectPipeline, pipeline->getPipelineLayout(),
+            pipeline->getDescriptorSet(currentFrame), materialManager.get(), scene.get());
+        geometryStats->endQuery(cmd, currentFrame, part);
+        if (part == partCount - 1) gpuProfiler->end(cmd, currentFrame, GpuProfiler::GEOMETRY);
+    });
+    frameGraph->writeColor(geometryPass, albedoImage, black);
+    frameGraph->writeColor(geometryPass, normalImage, black);
+    if (separateRoughness) {
+        frameGraph->writeColor(geometryPass, roughnessImage, roughnessClear);
+    }
+    frameGraph->writeDepth(geometryPass, depthImage);
+
+    FrameGraph::PassHandle lightingPass = frameGraph->addPass("lighting", [this](VkCommandBuffer cmd) {
+        gpuProfiler->begin(cmd, currentFrame, GpuProfiler::LIGHTING);
+        commandBuffer->recordLightingPass(cmd, getRenderExtent(),
+            pipeline->getLightingPipeline(getLightFeatures()), pipeline->getLightingPipelineLayout(),
+            pipeline->getDescriptorSet(currentFrame), gbuffer->getDescriptorSet(currentFrame),
+            directionalLight->getDescriptorSet(currentFrame), clusteredLighting->getDescriptorSet(currentFrame));
+        gpuProfiler->end(cmd, currentFrame, GpuProfiler::LIGHTING);
+    });
+    // declaration order is the input_attachment_index in lighting.frag
+    frameGraph->readAttachment(lightingPass, albedoImage);
+    frameGraph->readAttachment(lightingPass, normalImage);
+    frameGraph->readAttachment(lightingPass, depthImage);
+    if (separateRoughness) {
+        frameGraph->readAttachment(lightingPass, roughnessImage);
+    }
+    frameGraph->writeColor(lightingPass, sceneColorImage, black);
+
+    FrameGraph::PassHandle forwardPass = frameGraph->addParallelPass("forward", sortedPartCount(DrawSort::PASS_FORWARD),
+        [this](VkCommandBuffer cmd, uint32_t part, uint32_t partCount) {
+        uint32_t lightFeatures = getLightFeatures();
+        auto selectPipeline = [this, lightFeatures](uint32_t variant) {
+            return pipeline->getForwardPipeline(DrawSort::getPipelineFeatures(variant) | lightFeatures);
+        };
+
+        if (part == 0) gpuProfiler->begin(cmd, currentFrame, GpuProfiler::FORWARD);
+        commandBuffer->recordForwardPass(cmd, currentFrame, part, partCount, getRenderExtent(),
+            selectPipeline, pipeline->getForwardPipelineLayout(),
+            pipeline->getDescriptorSet(currentFrame), directionalLight->getDescriptorSet(currentFrame),
+            clusteredLighting->getDescriptorSet(currentFrame), materialManager.get(), scene.get());
+        if (part == partCount - 1) gpuProfiler->end(cmd, currentFrame, GpuProfiler::FORWARD);
+    });
+    frameGraph->writeColor(forwardPass, sceneColorImage);
+    frameGraph->readDepth(forwardPass, depthImage);
+
+    FrameGraph::PassHandle upscalePass = FrameGraph::INVALID_HANDLE;
+    if (dynamicResolution) {
+        upscalePass = frameGraph->addPass("upscale", [this](VkCommandBuffer cmd) {
+            gpuProfiler->begin(cmd, currentFrame, GpuProfiler::UPSCALE);
+            dynamicResolution->recordUpscale(cmd, currentFrame);
+            gpuProfiler->end(cmd, currentFrame, GpuProfiler::UPSCALE);
+        });
+        frameGraph->readTexture(upscalePass, sceneColorImage);
+        frameGraph->writeColor(upscalePass, backbufferImage);
+    }
+
+    // a single part, recorded on a worker alongside the scene passes
+    FrameGraph::PassHandle debugPass = frameGraph->addParallelPass("debug", [] { return 1u; },
+        [this](VkCommandBuffer cmd, uint32_t, uint32_t) {
+        gpuProfiler->begin(cmd, currentFrame, GpuProfiler::DEBUG);
+        commandBuffer->recordDebugPass(cmd, getOutputExtent(),
+            pipeline->getDebugPipeline(), pipeline->getDebugPipelineLayout(),
+            pipeline->getDescriptorSet(currentFrame), debugDraw.get());
+        gpuProfiler->end(cmd, currentFrame, GpuProfiler::DEBUG);
+    });
+    frameGraph->writeColor(debugPass, backbufferImage);
+    // depth only covers the render extent after upscaling, the lines are drawn on top instead
+    if (!dynamicResolution) {
+        frameGraph->readDepth(debugPass, depthImage);
+    }
+
+    FrameGraph::PassHandle imguiPass = frameGraph->addPass("imgui", [this](VkCommandBuffer cmd) {
+        gpuProfiler->begin(cmd, currentFrame, GpuProfiler::IMGUI);
+        commandBuffer->recordImGuiPass(cmd, imguiLayer.get());
+        gpuProfiler->end(cmd, currentFrame, GpuProfiler::IMGUI);
+    });
+    frameGraph->writeColor(imguiPass, backbufferImage);
+
+    frameGraph->compile(getOutputExtent());
+
+    passTargets.depthPrepass = frameGraph->getPassTarget(prepass);
+    passTargets.geometry = frameGraph->getPassTarget(geometryPass);
+    passTargets.lighting = frameGraph->getPassTarget(lightingPass);
+    passTargets.forward = frameGraph->getPassTarget(forwardPass);
+    passTargets.debug = frameGraph->getPassTarget(debugPass);
+    imguiPassTarget = frameGraph->getPassTarget(imguiPass);
+
+    if (dynamicResolution) {
+        upscalePassTarget = frameGraph->getPassTarget(upscalePass);
+    }
+
+    updateFrameGraphDescriptors();
+}
+
+void Application::updateFrameGraphDescriptors() {
+    if (dynamicResolution) {
+        dynamicResolution->setMaxExtent(getOutputExtent());
+        dynamicResolution->updateDescriptorSets(frameGraph->getImageView(sceneColorImage));
+    }
+
+    gbuffer->updateDescriptorSets(frameGraph->getImageView(albedoImage), frameGraph->getImageView(normalImage),
+        roughnessImage != FrameGraph::INVALID_HANDLE ? frameGraph->getImageView(roughnessImage) : VK_NULL_HANDLE,
+        frameGraph->getImageView(depthImage));
 }
 
 void Application::createDirectionalLight() {
     directionalLight = std::make_unique<DirectionalLight>(device, allocator);
 }
 
+void Application::createShadowMap() {
+    VkFormat shadowFormat = findSupportedFormat(
+        { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM },
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+    );
+
+    shadowMap = std::make_unique<CascadedShadowMap>(device, allocator, shadowFormat,
+        shaderManager.get(), materialManager.get(), commandBuffer.get());
+    directionalLight->setShadowMap(shadowMap->getArrayView(), shadowMap->getSampler());
+}
+
+void Application::createPointShadowMap() {
+    VkFormat shadowFormat = findSupportedFormat(
+        { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM },
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+    );
+
+    pointShadowMap = std::make_unique<PointShadowMap>(device, allocator, shadowFormat,
+        shaderManager.get(), materialManager.get(), commandBuffer.get());
+}
+
 void Application::createPointLight() {
-    pointLight = std::make_unique<PointLight>(device, allocator);
+    pointLight = std::make_unique<PointLight>();
 }
 
-void Application::createPipeline() {
-    pipeline = std::make_unique<Pipeline>(device, physicalDevice);
-    pipeline->initialize(swapChain->getExtent(), swapChain->getImageFormat(),
-        shaderManager.get(), "geometry_vert.spv", "geometry_frag.spv",
-        camera.get(), materialManager.get(), gbuffer.get(), swapChain->getImageViews(),
-        directionalLight.get(), pointLight.get());
+void Application::createClusteredLighting() {
+    clusteredLighting = std::make_unique<ClusteredLighting>(device, allocator, shaderManager.get());
+}
+
+void Application::createPipeline(const std::vector<uint64_t>& warmVariants) {
+    auto start = std::chrono::steady_clock::now();
+
+    pipeline = std::make_unique<Pipeline>(device, physicalDevice, pipelineCache->getCache());
+    pipeline->initialize(shaderManager.get(), "geometry_vert.spv", "geometry_frag.spv",
+        camera.get(), materialManager.get(), gbuffer.get(),
+        directionalLight.get(), clusteredLighting.get(), passTargets, warmVariants);
+
+    // warm means the cache came from disk, later creations in the same run also hit what
+    // earlier ones put into it
+    float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "pipelines created in " << elapsedMs << " ms ("
+              << (pipelineCache->isWarm() ? "warm" : "cold") << " pipeline cache)" << std::endl;
+
+    if (dynamicResolution) {
+        dynamicResolution->createPipeline(shaderManager.get(), upscalePassTarget);
+    }
 }
 
 void Application::createCommandBuffer() {
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
-    commandBuffer = std::make_unique<CommandBuffer>(device, indices.graphicsFamily.value(), graphicsQueue);
+    commandBuffer = std::make_unique<CommandBuffer>(device, indices.graphicsFamily.value(), graphicsQueue,
+        renderSettings.recordingThreads);
+}
+
+void Application::createDynamicResolution() {
+    if (!renderSettings.dynamicResolution) {
+        return;
+    }
+
+    dynamicResolution = std::make_unique<DynamicResolution>(device);
+}
+
+VkExtent2D Application::getRenderExtent() const {
+    return dynamicResolution ? dynamicResolution->getRenderExtent() : getOutputExtent();
+}
+
+uint32_t Application::getLightFeatures() const {
+    uint32_t features = 0;
+    if (directionalLight->isEnabled()) {
+        features |= ShaderFeatures::DIRECTIONAL_LIGHT;
+    }
+    // disabled point lights never reach the clusters
+    if (clusteredLighting->getLightCount(currentFrame) > 0) {
+        features |= ShaderFeatures::POINT_LIGHTS;
+    }
+    return features;
+}
+
+void Application::createGpuProfiler() {
+    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+    gpuProfiler = std::make_unique<GpuProfiler>(device, physicalDevice, indices.graphicsFamily.value());
+}
+
+void Application::createGeometryPassStats() {
+    geometryStats = std::make_unique<GeometryPassStats>(device, physicalDevice);
 }
 
 void Application::createImGuiLayer() {
@@ -262,9 +768,11 @@ void Application::createImGuiLayer() {
     imguiLayer = std::make_unique<ImGuiLayer>();
     imguiLayer->init(window.getWindow(), instance, physicalDevice, device,
         indices.graphicsFamily.value(), graphicsQueue,
-        pipeline->getImGuiRenderPass(),
+        imguiPassTarget.renderPass, imguiPassTarget.subpass,
         static_cast<uint32_t>(swapChain->getImageCount()),
-        scene.get(), directionalLight.get(), pointLight.get(), camera.get());
+        scene.get(), directionalLight.get(), pointLight.get(), camera.get(),
+        &renderSettings, geometryStats.get(), dynamicResolution.get(), gpuProfiler.get(), commandBuffer.get(),
+        cameraPath.get(), &stressSettings);
 }
 
 void Application::createScene() {
@@ -273,14 +781,32 @@ void Application::createScene() {
 }
 
 void Application::drawFrame() {
-    size_t maxFrames = commandBuffer->getMaxFramesInFlight();
+    CPU_PROFILE_FRAME();
+    CPU_PROFILE_ZONE("Application::drawFrame");
 
-    vkWaitForFences(device, 1, &commandBuffer->getInFlightFence(currentFrame), VK_TRUE, UINT64_MAX);
+    // read every frame so the ui can change it, slots above it simply stay idle
+    uint32_t framesInFlight = std::clamp(renderSettings.framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
 
-    uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(device, swapChain->getSwapChain(), UINT64_MAX,
-        commandBuffer->getImageAvailableSemaphore(currentFrame),
-        nullptr, &imageIndex);
+    {
+        CPU_PROFILE_ZONE("wait for fence");
+        vkWaitForFences(device, 1, &commandBuffer->getInFlightFence(currentFrame), VK_TRUE, UINT64_MAX);
+    }
+
+    // this frame's queries from its last use are finished now
+    gpuProfiler->collect(currentFrame);
+    geometryStats->collect(currentFrame);
+    if (dynamicResolution) {
+        dynamicResolution->update(renderSettings, gpuProfiler->getLatestMs(GpuProfiler::FRAME));
+    }
+
+    // headless there is one offscreen image per frame in flight, guarded by the fence above
+    uint32_t imageIndex = currentFrame;
+    VkResult result = VK_SUCCESS;
+    if (swapChain) {
+        result = vkAcquireNextImageKHR(device, swapChain->getSwapChain(), UINT64_MAX,
+            commandBuffer->getImageAvailableSemaphore(currentFrame),
+            nullptr, &imageIndex);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         recreateSwapChain();
@@ -291,88 +817,88 @@ void Application::drawFrame() {
     }
     vkResetFences(device, 1, &commandBuffer->getInFlightFence(currentFrame));
 
+    // fps and frame time, the ui runs first so scene edits made there are culled and drawn this frame
+    if (imguiLayer) {
+        float currentFrameTime = static_cast<float>(glfwGetTime());
+        float deltaTime = currentFrameTime - lastFrameTime;
+        lastFrameTime = currentFrameTime;
+        imguiLayer->beginFrame();
+        imguiLayer->endFrame(deltaTime);
+    }
+
+    // world transforms and bounds of whatever moved, before anything culls against them
+    scene->updateTransforms(currentFrame);
+
+    // the scene replaced its instance buffers since this frame's set 0 was written
+    if (instanceRevisions[currentFrame] != scene->getInstanceRevision()) {
+        pipeline->updateInstanceDescriptors(currentFrame, scene->getTransformBuffer(currentFrame),
+            scene->getVisibleInstanceBuffer(currentFrame));
+        instanceRevisions[currentFrame] = scene->getInstanceRevision();
+    }
+
     // update camera uniform buffer
     camera->updateUniformBuffer(allocator, currentFrame);
 
     // update light uniform buffers
-    directionalLight->updateUniformBuffer(allocator, currentFrame, camera->getPosition());
-    pointLight->updateUniformBuffer(allocator, currentFrame);
+    shadowMap->update(allocator, currentFrame, directionalLight.get(),
+        camera->getViewMatrix(), camera->getProjectionMatrix(),
+        Camera::NEAR_PLANE, Camera::FAR_PLANE, scene.get());
+    directionalLight->updateUniformBuffer(allocator, currentFrame, camera->getPosition(), shadowMap.get());
+    pointShadowMap->update(allocator, currentFrame, pointLight.get(),
+        camera->getViewMatrix(), camera->getProjectionMatrix(), getOutputExtent(), scene.get());
+    clusteredLighting->update(allocator, currentFrame, pointLight.get(),
+        camera->getViewMatrix(), camera->getProjectionMatrix(), getRenderExtent(),
+        Camera::NEAR_PLANE, Camera::FAR_PLANE, pointShadowMap.get());
 
     VkCommandBuffer cmdBuffer = commandBuffer->getCommandBuffer(currentFrame);
     vkResetCommandBuffer(cmdBuffer, 0);
 
-    // fps and frame time
-    float currentFrameTime = static_cast<float>(glfwGetTime());
-    float deltaTime = currentFrameTime - lastFrameTime;
-    lastFrameTime = currentFrameTime;
-    imguiLayer->beginFrame();
-    imguiLayer->endFrame(deltaTime);
-
     // clear and prepare debug draw for this frame
     debugDraw->clear();
 
     // draw AABB if enabled
-    if (imguiLayer->getShowAABBs()) {
+    if (imguiLayer && imguiLayer->getShowAABBs()) {
         const glm::vec3 aabbColor(0.0f, 1.0f, 0.0f); // green
-        for (size_t i = 0; i < scene->getModelCount(); ++i) {
-            const Scene::Model* model = scene->getModel(i);
-            if (model) {
-                for (const AABB& aabb : model->submeshAABBs) {
-                    debugDraw->drawAABB(aabb.min, aabb.max, aabbColor);
-                }
-            }
+        for (const AABB& aabb : scene->getTransforms().getAllWorldBounds()) {
+            debugDraw->drawAABB(aabb.min, aabb.max, aabbColor);
         }
     }
 
     debugDraw->upload();
 
-    glm::mat4 viewProj = camera->getViewProjectionMatrix();
     glm::mat4 cullingViewProj = camera->getCullingViewProjectionMatrix();
 
-    scene->updateCulling(cullingViewProj, currentFrame);
-
-    commandBuffer->recordFrame(cmdBuffer, imageIndex, currentFrame, swapChain->getExtent(),
-        pipeline->getGeometryRenderPass(),
-        pipeline->getGeometryFramebuffers(),
-        pipeline->getGeometryPipeline(), pipeline->getPipelineLayout(),
-        pipeline->getDescriptorSet(currentFrame), materialManager.get(), scene.get(),
-        pipeline->getLightingRenderPass(),
-        pipeline->getLightingFramebuffers(),
-        pipeline->getLightingPipeline(), pipeline->getLightingPipelineLayout(),
-        gbuffer->getDescriptorSet(currentFrame),
-        directionalLight->getDescriptorSet(currentFrame),
-        pointLight->getDescriptorSet(currentFrame),
-        pipeline->getForwardRenderPass(),
-        pipeline->getForwardFramebuffers(),
-        pipeline->getForwardPipeline(), pipeline->getForwardPipelineLayout(),
-        viewProj,
-        pipeline->getDebugRenderPass(),
-        pipeline->getDebugFramebuffers(),
-        pipeline->getDebugPipeline(), pipeline->getDebugPipelineLayout(),
-        debugDraw.get(),
-        pipeline->getImGuiRenderPass(),
-        pipeline->getImGuiFramebuffers(),
-        imguiLayer.get());
+    // opaque draws are sorted front to back from the real camera position
+    scene->updateCulling(cullingViewProj, camera->getPosition(), currentFrame);
+
+    commandBuffer->recordFrame(cmdBuffer, imageIndex, currentFrame, scene.get(),
+        shadowMap.get(), pointShadowMap.get(), clusteredLighting.get(), geometryStats.get(),
+        gpuProfiler.get(), frameGraph.get(), renderSettings.parallelRecording);
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
     VkSemaphore waitSemaphores[] = { commandBuffer->getImageAvailableSemaphore(currentFrame) };
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = swapChain ? 1 : 0;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &cmdBuffer;
 
     VkSemaphore signalSemaphores[] = { commandBuffer->getRenderFinishedSemaphore(currentFrame) };
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = swapChain ? 1 : 0;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
     if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, commandBuffer->getInFlightFence(currentFrame)) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
 
+    if (!swapChain) {
+        currentFrame = (currentFrame + 1) % framesInFlight;
+        return;
+    }
+
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
@@ -384,9 +910,13 @@ void Application::drawFrame() {
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = nullptr;
 
-    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    {
+        CPU_PROFILE_ZONE("present");
+        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+    bool presentModeChanged = swapChain->getRequestedPresentMode() != renderSettings.presentMode;
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized || presentModeChanged) {
         framebufferResized = false;
         recreateSwapChain();
     }
@@ -394,7 +924,7 @@ void Application::drawFrame() {
         throw std::runtime_error("failed to present swap chain image!");
     }
 
-    currentFrame = (currentFrame + 1) % maxFrames;
+    currentFrame = (currentFrame + 1) % framesInFlight;
 }
 
 void Application::cleanup() {
@@ -422,13 +952,34 @@ void Application::cleanup() {
     textureManager.reset();
 
     commandBuffer.reset();
+    geometryStats.reset();
+    dynamicResolution.reset();
+    gpuProfiler.reset();
     pipeline.reset();
+    frameGraph.reset();
+
+    if (pipelineCache) {
+        pipelineCache->save();
+        pipelineCache->cleanup();
+    }
+    pipelineCache.reset();
+
+    if (clusteredLighting) {
+        clusteredLighting->cleanup(allocator);
+    }
+    clusteredLighting.reset();
 
-    if (pointLight) {
-        pointLight->cleanup(allocator);
+    if (pointShadowMap) {
+        pointShadowMap->cleanup(allocator);
     }
+    pointShadowMap.reset();
     pointLight.reset();
 
+    if (shadowMap) {
+        shadowMap->cleanup(allocator);
+    }
+    shadowMap.reset();
+
     if (directionalLight) {
         directionalLight->cleanup(allocator);
     }
@@ -440,10 +991,12 @@ void Application::cleanup() {
     gbuffer.reset();
 
     swapChain.reset();
+    offscreenTarget.reset();
     if (camera) {
         camera->destroy(allocator);
     }
     camera.reset();
+    cameraPath.reset();
     if (shaderManager) {
         shaderManager->cleanup();
     }
@@ -475,16 +1028,38 @@ void Application::recreateSwapChain() {
 
     vkDeviceWaitIdle(device);
 
-    swapChain.reset();
-    pipeline.reset();
-
-    createSwapChain();
-
-    gbuffer->recreate(swapChain->getExtent(), VK_NULL_HANDLE);
+    // the new swap chain takes over from the old one, which goes once nothing refers to it
+    std::unique_ptr<SwapChain> oldSwapChain = std::move(swapChain);
+    swapChain = std::make_unique<SwapChain>(physicalDevice, device, surface, window.getWindow(),
+        renderSettings.presentMode, oldSwapChain->getSwapChain());
+    bool sameFormat = swapChain->getImageFormat() == oldSwapChain->getImageFormat();
+    bool sameImageCount = swapChain->getImageCount() == oldSwapChain->getImageCount();
+    reportPresentMode(oldSwapChain.get());
+    oldSwapChain.reset();
+
+    // render passes and pipelines only depend on formats, a resize recreates the sized images
+    // and framebuffers and keeps everything else
+    if (sameFormat) {
+        frameGraph->setImportedViews(backbufferImage, swapChain->getImageViews());
+        frameGraph->resize(getOutputExtent());
+        updateFrameGraphDescriptors();
+
+        // the ui sizes its buffers by the image count
+        if (!sameImageCount) {
+            imguiLayer->cleanup();
+            createImGuiLayer();
+            camera->setImGuiLayer(imguiLayer.get());
+        }
+        return;
+    }
 
-    createPipeline();
+    // the variants the old pipelines were asked for are rebuilt up front, from the cache
+    std::vector<uint64_t> warmVariants = pipeline->getVariantKeys();
+    pipeline.reset();
+    frameGraph.reset();
 
-    gbuffer->updateDescriptorSets(pipeline->getDepthImageView());
+    createFrameGraph();
+    createPipeline(warmVariants);
 
     if (imguiLayer) {
         imguiLayer->cleanup();
@@ -8,13 +8,26 @@
 #include "scene.hpp"
 #include "directionallight.hpp"
 #include "pointlight.hpp"
+#include "rendersettings.hpp"
+#include "benchmark.hpp"
+#include "camerapath.hpp"
+#include "framelimiter.hpp"
 #include "../renderer/swapchain.hpp"
+#include "../renderer/offscreentarget.hpp"
 #include "../renderer/pipeline.hpp"
+#include "../renderer/pipelinecache.hpp"
 #include "../renderer/commandbuffer.hpp"
 #include "../renderer/shadermanager.hpp"
 #include "../renderer/texturemanager.hpp"
 #include "../renderer/materialmanager.hpp"
 #include "../renderer/gbuffer.hpp"
+#include "../renderer/framegraph.hpp"
+#include "../renderer/clusteredlighting.hpp"
+#include "../renderer/cascadedshadowmap.hpp"
+#include "../renderer/pointshadowmap.hpp"
+#include "../renderer/geometrypassstats.hpp"
+#include "../renderer/dynamicresolution.hpp"
+#include "../renderer/gpuprofiler.hpp"
 #include "../ui/primitives/debugdraw.hpp"
 #include <Vulkan/vulkan.h>
 #include "vk_mem_alloc.h"
@@ -42,7 +55,9 @@ struct WindowUserData {
 
 class Application {
 public:
-    Application();
+    explicit Application(const RenderSettings& settings = RenderSettings(),
+        const BenchmarkSettings& benchmarkSettings = BenchmarkSettings(),
+        const StressSceneSettings& stressSettings = StressSceneSettings());
     ~Application();
 
     void run();
@@ -55,48 +70,93 @@ private:
     VkDevice device;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
     VmaAllocator allocator;
 
     std::unique_ptr<ShaderManager> shaderManager;
+    std::unique_ptr<PipelineCache> pipelineCache;  // saved to disk on cleanup
     std::unique_ptr<Camera> camera;
+    std::unique_ptr<CameraPath> cameraPath;
     std::unique_ptr<SwapChain> swapChain;
+    std::unique_ptr<OffscreenTarget> offscreenTarget;  // replaces the swap chain in the headless benchmark
     std::unique_ptr<TextureManager> textureManager;
     std::unique_ptr<MaterialManager> materialManager;
     std::unique_ptr<GBuffer> gbuffer;
+    std::unique_ptr<FrameGraph> frameGraph;
     std::unique_ptr<Pipeline> pipeline;
     std::unique_ptr<CommandBuffer> commandBuffer;
+    std::unique_ptr<GpuProfiler> gpuProfiler;
+    std::unique_ptr<GeometryPassStats> geometryStats;
+    std::unique_ptr<DynamicResolution> dynamicResolution;  // only with RenderSettings::dynamicResolution
     std::unique_ptr<Scene> scene;
     std::unique_ptr<DirectionalLight> directionalLight;
+    std::unique_ptr<CascadedShadowMap> shadowMap;
     std::unique_ptr<PointLight> pointLight;
+    std::unique_ptr<PointShadowMap> pointShadowMap;
+    std::unique_ptr<ClusteredLighting> clusteredLighting;
     std::unique_ptr<ImGuiLayer> imguiLayer;
     std::unique_ptr<DebugDraw> debugDraw;
 
+    // kept here rather than in the ui, the ui is rebuilt with the swap chain
+    RenderSettings renderSettings;
+    BenchmarkSettings benchmarkSettings;
+    StressSceneSettings stressSettings;
+
+    // where each pass ended up after the frame graph compiled
+    PipelinePassTargets passTargets;
+    FrameGraph::PassTarget imguiPassTarget;
+    FrameGraph::PassTarget upscalePassTarget;
+
+    // frame graph images other objects hold descriptors of, written again after a resize
+    FrameGraph::ResourceHandle backbufferImage = FrameGraph::INVALID_HANDLE;
+    FrameGraph::ResourceHandle albedoImage = FrameGraph::INVALID_HANDLE;
+    FrameGraph::ResourceHandle normalImage = FrameGraph::INVALID_HANDLE;
+    FrameGraph::ResourceHandle roughnessImage = FrameGraph::INVALID_HANDLE;  // only without the compact g-buffer
+    FrameGraph::ResourceHandle depthImage = FrameGraph::INVALID_HANDLE;
+    FrameGraph::ResourceHandle sceneColorImage = FrameGraph::INVALID_HANDLE;
+
+    FrameLimiter frameLimiter;
+
     uint32_t currentFrame = 0;
+    // scene instance buffers each frame's set 0 points at
+    uint64_t instanceRevisions[MAX_FRAMES_IN_FLIGHT] = {};
     bool framebufferResized = false;
 
     float lastFrameTime = 0.0f;
 
     void mainLoop();
+    void runBenchmark();
     void initVulkan();
     void createInstance();
     void createSurface();
     void pickPhysicalDevice();
     void createLogicalDevice();
     void createShaderManager();
+    void createPipelineCache();
     void createCamera();
     void createSwapChain();
     void createTextureManager();
     void createMaterialManager();
     void createGBuffer();
-    void createPipeline();
+    void createFrameGraph();
+    void updateFrameGraphDescriptors();
+    // warmVariants are created up front, see Pipeline::initialize
+    void createPipeline(const std::vector<uint64_t>& warmVariants = {});
     void createCommandBuffer();
+    void createGpuProfiler();
+    void createGeometryPassStats();
+    void createDynamicResolution();
     void createScene();
     void createDirectionalLight();
+    void createShadowMap();
     void createPointLight();
+    void createPointShadowMap();
+    void createClusteredLighting();
     void drawFrame();
     void cleanup();
     void recreateSwapChain();
+    // logs the swap chain's present mode unless it runs with the same modes as previous
+    void reportPresentMode(const SwapChain* previous);
     void createImGuiLayer();
     void createDebugDraw();
 
@@ -104,4 +164,15 @@ private:
 
     bool isDeviceSuitable(VkPhysicalDevice device);
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
+    VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+    VkFormat findDepthFormat();
+
+    // the benchmark runs without a window, surface or swap chain
+    bool isHeadless() const { return benchmarkSettings.enabled; }
+    // size of the swap chain images, or of the offscreen images when headless
+    VkExtent2D getOutputExtent() const;
+    // size the scene passes render at this frame, the output size without dynamic resolution
+    VkExtent2D getRenderExtent() const;
+    // ShaderFeatures light bits of the lights that contribute this frame
+    uint32_t getLightFeatures() const;
 };
\ No newline at end of file
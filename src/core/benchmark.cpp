@@ -0,0 +1,229 @@
+#include "benchmark.hpp"
+#include "rendersettings.hpp"
+#include "../renderer/gpuprofiler.hpp"
+#include "../renderer/commandbuffer.hpp"
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    // how far along the path the camera looks, in control point segments
+    constexpr float LOOK_AHEAD = 0.35f;
+
+    void writeStats(std::ofstream& file, const char* name, const FrameTimeStats& stats, size_t count) {
+        file << "  \"" << name << "\": { \"samples\": " << count
+             << ", \"min\": " << stats.min << ", \"avg\": " << stats.avg
+             << ", \"p95\": " << stats.p95 << ", \"p99\": " << stats.p99
+             << ", \"max\": " << stats.max << " },\n";
+    }
+
+    // windows paths are full of backslashes
+    std::string escapeJson(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t) {
+        float t2 = t * t;
+        float t3 = t2 * t;
+        return 0.5f * ((2.0f * p1) + (-p0 + p2) * t +
+            (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+            (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+    }
+}
+
+// nearest rank percentiles
+FrameTimeStats FrameTimeStats::compute(std::vector<float> values) {
+    FrameTimeStats stats;
+    if (values.empty()) {
+        return stats;
+    }
+
+    std::sort(values.begin(), values.end());
+    auto percentile = [&values](float p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * static_cast<float>(values.size())));
+        return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+    };
+
+    double sum = 0.0;
+    for (float value : values) {
+        sum += value;
+    }
+
+    stats.min = values.front();
+    stats.avg = static_cast<float>(sum / static_cast<double>(values.size()));
+    stats.p95 = percentile(0.95f);
+    stats.p99 = percentile(0.99f);
+    stats.max = values.back();
+    return stats;
+}
+
+Benchmark::Benchmark(const BenchmarkSettings& settings)
+    : settings(settings)
+    , sceneCenter(0.0f) {
+    samples.reserve(settings.frames);
+}
+
+void Benchmark::setSceneBounds(const AABB& bounds) {
+    glm::vec3 extents = bounds.getExtents();
+    if (extents.x <= 0.0f && extents.y <= 0.0f && extents.z <= 0.0f) {
+        throw std::runtime_error("benchmark scene has no geometry");
+    }
+
+    sceneCenter = bounds.getCenter();
+
+    // alternate between flying through the middle and along the edges, at three heights
+    const float radii[2] = { 0.7f, 0.3f };
+    const float heights[3] = { -0.6f, -0.3f, 0.1f };
+
+    controlPoints.clear();
+    for (uint32_t i = 0; i < CONTROL_POINTS; i++) {
+        float angle = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(CONTROL_POINTS);
+        float radius = radii[i % 2];
+        controlPoints.push_back(sceneCenter + glm::vec3(
+            std::cos(angle) * extents.x * radius,
+            extents.y * heights[i % 3],
+            std::sin(angle) * extents.z * radius));
+    }
+}
+
+glm::vec3 Benchmark::evaluatePath(float t) const {
+    // t is in control point segments, the path is closed
+    float segments = static_cast<float>(CONTROL_POINTS);
+    t = std::fmod(t, segments);
+    if (t < 0.0f) {
+        t += segments;
+    }
+
+    uint32_t segment = static_cast<uint32_t>(t);
+    float local = t - static_cast<float>(segment);
+
+    const glm::vec3& p0 = controlPoints[(segment + CONTROL_POINTS - 1) % CONTROL_POINTS];
+    const glm::vec3& p1 = controlPoints[segment % CONTROL_POINTS];
+    const glm::vec3& p2 = controlPoints[(segment + 1) % CONTROL_POINTS];
+    const glm::vec3& p3 = controlPoints[(segment + 2) % CONTROL_POINTS];
+    return catmullRom(p0, p1, p2, p3, local);
+}
+
+void Benchmark::getCameraPose(uint32_t frame, glm::vec3& position, float& yaw, float& pitch) const {
+    uint32_t measuredFrame = isMeasured(frame) ? frame - settings.warmupFrames : 0;
+    float t = static_cast<float>(measuredFrame) / static_cast<float>(std::max(settings.frames, 1u))
+        * static_cast<float>(CONTROL_POINTS);
+
+    position = evaluatePath(t);
+
+    // look ahead along the path, pulled toward the middle so the scene stays in view
+    glm::vec3 target = glm::mix(evaluatePath(t + LOOK_AHEAD), sceneCenter, 0.5f);
+    glm::vec3 direction = target - position;
+    if (glm::length(direction) < 1e-4f) {
+        direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    }
+    direction = glm::normalize(direction);
+
+    // inverse of Camera::updateCameraVectors
+    yaw = glm::degrees(std::atan2(direction.z, direction.x));
+    pitch = glm::clamp(glm::degrees(std::asin(direction.y)), -89.0f, 89.0f);
+}
+
+void Benchmark::writeReport(const std::string& deviceName, const RenderSettings& renderSettings,
+    const GpuProfiler* gpuProfiler, const CommandBuffer* commandBuffer, VmaAllocator allocator,
+    uint32_t totalDraws) const {
+
+    std::vector<float> cpuTimes;
+    std::vector<float> gpuTimes;
+    uint32_t minVisible = UINT32_MAX;
+    uint32_t maxVisible = 0;
+    double visibleSum = 0.0;
+
+    for (const Sample& sample : samples) {
+        cpuTimes.push_back(sample.cpuMs);
+        // the first samples arrive before any timestamps were read back
+        if (sample.gpuMs > 0.0f) {
+            gpuTimes.push_back(sample.gpuMs);
+        }
+        minVisible = std::min(minVisible, sample.visibleDraws);
+        maxVisible = std::max(maxVisible, sample.visibleDraws);
+        visibleSum += sample.visibleDraws;
+    }
+    if (samples.empty()) {
+        minVisible = 0;
+    }
+
+    VmaTotalStatistics memoryStats;
+    vmaCalculateStatistics(allocator, &memoryStats);
+
+    const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+    vmaGetMemoryProperties(allocator, &memoryProperties);
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(allocator, budgets);
+
+    std::ofstream file(settings.outputPath);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to write benchmark report: " + settings.outputPath);
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\n";
+    file << "  \"device\": \"" << escapeJson(deviceName) << "\",\n";
+    file << "  \"scene\": \"" << escapeJson(settings.scenePath) << "\",\n";
+    file << "  \"cameraPath\": \"" << escapeJson(settings.cameraPath) << "\",\n";
+    file << "  \"resolution\": [" << settings.width << ", " << settings.height << "],\n";
+    file << "  \"frames\": " << settings.frames << ",\n";
+    file << "  \"warmupFrames\": " << settings.warmupFrames << ",\n";
+    file << "  \"settings\": { \"depthPrepass\": " << (renderSettings.depthPrepass ? "true" : "false")
+         << ", \"compactGBuffer\": " << (renderSettings.compactGBuffer ? "true" : "false")
+         << ", \"dynamicResolution\": " << (renderSettings.dynamicResolution ? "true" : "false")
+         << ", \"framesInFlight\": " << renderSettings.framesInFlight
+         << ", \"parallelRecording\": " << (renderSettings.parallelRecording ? "true" : "false") << " },\n";
+
+    writeStats(file, "cpuFrameMs", FrameTimeStats::compute(cpuTimes), cpuTimes.size());
+    writeStats(file, "gpuFrameMs", FrameTimeStats::compute(gpuTimes), gpuTimes.size());
+
+    // running averages over the last frames of the run
+    file << "  \"gpuPassMs\": {";
+    for (uint32_t i = 0; gpuProfiler && i < GpuProfiler::ZONE_COUNT; i++) {
+        GpuProfiler::Zone zone = static_cast<GpuProfiler::Zone>(i);
+        file << (i == 0 ? " " : ", ") << "\"" << GpuProfiler::getZoneName(zone) << "\": " << gpuProfiler->getAverageMs(zone);
+    }
+    file << " },\n";
+
+    file << "  \"draws\": { \"total\": " << totalDraws
+         << ", \"visibleMin\": " << minVisible
+         << ", \"visibleAvg\": " << (samples.empty() ? 0.0 : visibleSum / static_cast<double>(samples.size()))
+         << ", \"visibleMax\": " << maxVisible << " },\n";
+
+    // binds and draws of the last recorded frame, per pass
+    file << "  \"passDraws\": {";
+    for (uint32_t i = 0; commandBuffer && i < CommandBuffer::DRAW_PASS_COUNT; i++) {
+        CommandBuffer::DrawPass pass = static_cast<CommandBuffer::DrawPass>(i);
+        const PassDrawStats& stats = commandBuffer->getPassStats(pass);
+        file << (i == 0 ? " " : ", ") << "\"" << CommandBuffer::getDrawPassName(pass) << "\": { "
+             << "\"pipelineBinds\": " << stats.pipelineBinds
+             << ", \"descriptorBinds\": " << stats.descriptorBinds
+             << ", \"drawCalls\": " << stats.drawCalls
+             << ", \"draws\": " << stats.draws << " }";
+    }
+    file << " },\n";
+
+    file << "  \"memory\": { \"allocationBytes\": " << memoryStats.total.statistics.allocationBytes
+         << ", \"blockBytes\": " << memoryStats.total.statistics.blockBytes
+         << ", \"allocations\": " << memoryStats.total.statistics.allocationCount
+         << ", \"heapUsageBytes\": [";
+    for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++) {
+        file << (i == 0 ? "" : ", ") << budgets[i].usage;
+    }
+    file << "] }\n";
+    file << "}\n";
+
+    std::cout << "benchmark report written: " << settings.outputPath << std::endl;
+}
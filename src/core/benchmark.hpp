@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "vk_mem_alloc.h"
+#include "../ui/primitives/aabb.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct RenderSettings;
+class GpuProfiler;
+class CommandBuffer;
+
+// startup only (--benchmark <scene.obj>), runs without a window or swap chain
+struct BenchmarkSettings {
+    bool enabled = false;
+    std::string scenePath;      // the .mtl and textures are looked up next to it
+    uint32_t frames = 1000;     // --frames, measured frames after the warmup
+    uint32_t warmupFrames = 60; // pipelines, caches and the dynamic resolution scale settle first
+    uint32_t width = 1600;
+    uint32_t height = 900;
+    std::string outputPath = "benchmark.json";  // --output
+    std::string cameraPath;     // --camera-path, a recorded path replaces the scripted flight
+};
+
+struct FrameTimeStats {
+    float min = 0.0f;
+    float avg = 0.0f;
+    float p95 = 0.0f;
+    float p99 = 0.0f;
+    float max = 0.0f;
+
+    static FrameTimeStats compute(std::vector<float> values);
+};
+
+/*
+    Deterministic camera flight and frame time collection for the headless benchmark.
+    The camera follows a closed Catmull-Rom spline through points derived from the scene bounds,
+    alternating between the middle and the edges of the scene at different heights, so every run
+    over the same scene sees exactly the same views. The report is JSON so runs can be diffed or
+    plotted across commits.
+*/
+class Benchmark {
+public:
+    struct Sample {
+        float cpuMs;        // wall time of the whole frame on the cpu
+        float gpuMs;        // gpu timestamps, 0 when not available yet
+        uint32_t visibleDraws;
+    };
+
+    explicit Benchmark(const BenchmarkSettings& settings);
+
+    Benchmark(const Benchmark&) = delete;
+    Benchmark& operator=(const Benchmark&) = delete;
+
+    // builds the camera path, throws when the scene has no geometry
+    void setSceneBounds(const AABB& bounds);
+
+    // warmup frames hold the first pose, the measured frames fly the path once
+    void getCameraPose(uint32_t frame, glm::vec3& position, float& yaw, float& pitch) const;
+
+    uint32_t getTotalFrames() const { return settings.warmupFrames + settings.frames; }
+    bool isMeasured(uint32_t frame) const { return frame >= settings.warmupFrames; }
+    void addSample(const Sample& sample) { samples.push_back(sample); }
+
+    void writeReport(const std::string& deviceName, const RenderSettings& renderSettings,
+        const GpuProfiler* gpuProfiler, const CommandBuffer* commandBuffer, VmaAllocator allocator,
+        uint32_t totalDraws) const;
+
+private:
+    static constexpr uint32_t CONTROL_POINTS = 8;
+
+    BenchmarkSettings settings;
+    glm::vec3 sceneCenter;
+    std::vector<glm::vec3> controlPoints;
+    std::vector<Sample> samples;
+
+    glm::vec3 evaluatePath(float t) const;
+};
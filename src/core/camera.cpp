@@ -27,7 +27,7 @@ Camera::Camera(GLFWwindow* window, VmaAllocator allocator)
     updateCameraVectors();
 
     VkDeviceSize bufferSize = sizeof(CameraUBO);
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         uniformBuffers[i].create(allocator, bufferSize,
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
             VMA_MEMORY_USAGE_CPU_TO_GPU);
@@ -67,7 +67,7 @@ void Camera::updateUniformBuffer(VmaAllocator allocator, uint32_t currentFrame)
 }
 
 void Camera::destroy(VmaAllocator allocator) {
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         uniformBuffers[i].destroy(allocator);
     }
 }
@@ -137,17 +137,22 @@ glm::mat4 Camera::getViewMatrix() const {
     return glm::lookAt(position, position + front, up);
 }
 
-glm::mat4 Camera::getProjectionMatrix() const {
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
+float Camera::getAspectRatio() const {
+    int width = static_cast<int>(viewportWidth);
+    int height = static_cast<int>(viewportHeight);
+    if (window) {
+        glfwGetFramebufferSize(window, &width, &height);
+    }
 
     if (height == 0) {
         height = 1;
     }
 
-    float aspect = static_cast<float>(width) / static_cast<float>(height);
+    return static_cast<float>(width) / static_cast<float>(height);
+}
 
-    return glm::perspective(glm::radians(fov), aspect, 0.1f, 10000.0f);
+glm::mat4 Camera::getProjectionMatrix() const {
+    return glm::perspective(glm::radians(fov), getAspectRatio(), NEAR_PLANE, FAR_PLANE);
 }
 
 glm::mat4 Camera::getViewProjectionMatrix() const {
@@ -159,12 +164,7 @@ glm::mat4 Camera::getCullingViewProjectionMatrix() const {
         return getViewProjectionMatrix();
     }
 
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-    if (height == 0) height = 1;
-    float aspect = static_cast<float>(width) / static_cast<float>(height);
-
-    glm::mat4 cullingProj = glm::perspective(glm::radians(debugCullingFov), aspect, 0.1f, 10000.0f);
+    glm::mat4 cullingProj = glm::perspective(glm::radians(debugCullingFov), getAspectRatio(), NEAR_PLANE, FAR_PLANE);
     return cullingProj * getViewMatrix();
 }
 
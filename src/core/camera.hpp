@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 #include "../renderer/gpubuffer.hpp"
 #include "vk_mem_alloc.h"
+#include "../renderer/framesinflight.hpp"
 
 // forward declaration
 class ImGuiLayer;
@@ -32,9 +33,17 @@ public:
 
     void setPosition(const glm::vec3& pos) { position = pos; }
     void setRotation(float yaw, float pitch) { this->yaw = yaw; this->pitch = pitch; }
+    // only used without a window, the headless benchmark renders at a fixed size
+    void setViewportSize(uint32_t width, uint32_t height) { viewportWidth = width; viewportHeight = height; }
     glm::vec3 getPosition() const { return position; }
+    float getYaw() const { return yaw; }
+    float getPitch() const { return pitch; }
+    // applies setPosition and setRotation without reading any input, for scripted cameras
+    void refresh() { updateCameraVectors(); }
 
     float* getSpeedPtr() { return &movementSpeed; }
+    glm::mat4 getViewMatrix() const;
+    glm::mat4 getProjectionMatrix() const;
     glm::mat4 getViewProjectionMatrix() const;
     glm::mat4 getCullingViewProjectionMatrix() const;
 
@@ -43,7 +52,8 @@ public:
     void setUseDebugCullingFov(bool use) { useDebugCullingFov = use; }
     bool getUseDebugCullingFov() const { return useDebugCullingFov; }
 
-    static const int MAX_FRAMES_IN_FLIGHT = 2;
+    static constexpr float NEAR_PLANE = 0.1f;
+    static constexpr float FAR_PLANE = 10000.0f;
 
     void setupInputCallbacks(GLFWwindow* window);
     bool isCursorCaptured() const { return cursorCaptured; }
@@ -66,6 +76,9 @@ private:
     float movementSpeed;
     float mouseSensitivity;
 
+    uint32_t viewportWidth = 1;
+    uint32_t viewportHeight = 1;
+
     float debugCullingFov = 45.0f;
     bool useDebugCullingFov = false;
 
@@ -78,8 +91,7 @@ private:
     void processKeyboard(float deltaTime);
     void processMouseMovement();
     void updateCameraVectors();
-    glm::mat4 getViewMatrix() const;
-    glm::mat4 getProjectionMatrix() const;
+    float getAspectRatio() const;
 
     bool cursorCaptured = false;
     void handleCursorCapture();
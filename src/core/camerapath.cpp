@@ -0,0 +1,170 @@
+#include "camerapath.hpp"
+#include "camera.hpp"
+#include <fstream>
+#include <iostream>
+
+void CameraPath::startRecording() {
+    stopPlayback();
+    frames.clear();
+    recording = true;
+    hasPreviousPose = false;
+    recordedTime = 0.0f;
+    nextSampleTime = 0.0f;
+    std::cout << "camera path recording started" << std::endl;
+}
+
+void CameraPath::recordFrame(const Camera& camera, float deltaTime) {
+    if (!recording) {
+        return;
+    }
+
+    Frame pose{ camera.getPosition(), camera.getYaw(), camera.getPitch() };
+
+    if (!hasPreviousPose) {
+        frames.push_back(pose);
+        previousPose = pose;
+        hasPreviousPose = true;
+        nextSampleTime = TIMESTEP;
+        return;
+    }
+
+    float previousTime = recordedTime;
+    recordedTime += deltaTime;
+
+    // every fixed step that fell inside this frame gets a pose blended between the two live ones
+    while (deltaTime > 0.0f && nextSampleTime <= recordedTime) {
+        float t = (nextSampleTime - previousTime) / deltaTime;
+        Frame sample{};
+        sample.position = glm::mix(previousPose.position, pose.position, t);
+        sample.yaw = glm::mix(previousPose.yaw, pose.yaw, t);
+        sample.pitch = glm::mix(previousPose.pitch, pose.pitch, t);
+        frames.push_back(sample);
+        nextSampleTime += TIMESTEP;
+    }
+
+    previousPose = pose;
+}
+
+bool CameraPath::save(const std::string& path) const {
+    if (frames.empty()) {
+        std::cout << "camera path is empty, nothing to save" << std::endl;
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "failed to write camera path: " << path << std::endl;
+        return false;
+    }
+
+    uint32_t header[3] = { FILE_MAGIC, FILE_VERSION, static_cast<uint32_t>(frames.size()) };
+    float timestep = TIMESTEP;
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&timestep), sizeof(timestep));
+    file.write(reinterpret_cast<const char*>(frames.data()), frames.size() * sizeof(Frame));
+
+    std::cout << "camera path saved: " << path << " (" << frames.size() << " frames)" << std::endl;
+    return true;
+}
+
+bool CameraPath::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "failed to open camera path: " << path << std::endl;
+        return false;
+    }
+
+    uint32_t header[3] = {};
+    float timestep = 0.0f;
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    file.read(reinterpret_cast<char*>(&timestep), sizeof(timestep));
+    if (!file || header[0] != FILE_MAGIC || header[1] != FILE_VERSION || header[2] == 0) {
+        std::cout << "not a camera path file: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<Frame> loaded(header[2]);
+    file.read(reinterpret_cast<char*>(loaded.data()), loaded.size() * sizeof(Frame));
+    if (!file) {
+        std::cout << "camera path is truncated: " << path << std::endl;
+        return false;
+    }
+
+    stopRecording();
+    stopPlayback();
+    frames = std::move(loaded);
+    std::cout << "camera path loaded: " << path << " (" << frames.size() << " frames)" << std::endl;
+    return true;
+}
+
+void CameraPath::startPlayback(bool loop) {
+    if (frames.empty()) {
+        return;
+    }
+
+    recording = false;
+    playing = true;
+    looping = loop;
+    playbackFrame = 0;
+    completedPasses = 0;
+    cpuTimes.clear();
+    gpuTimes.clear();
+    cpuTimes.reserve(frames.size());
+    gpuTimes.reserve(frames.size());
+}
+
+void CameraPath::stopPlayback() {
+    playing = false;
+    playbackFrame = 0;
+}
+
+void CameraPath::applyPlayback(Camera& camera) const {
+    if (!playing) {
+        return;
+    }
+
+    const Frame& frame = frames[playbackFrame];
+    camera.setPosition(frame.position);
+    camera.setRotation(frame.yaw, frame.pitch);
+    // rebuilds the camera vectors without reading input
+    camera.refresh();
+}
+
+void CameraPath::endPlaybackFrame(float cpuMs, float gpuMs) {
+    if (!playing) {
+        return;
+    }
+
+    cpuTimes.push_back(cpuMs);
+    // gpu timestamps are read back late and are 0 until the first ones arrive
+    if (gpuMs > 0.0f) {
+        gpuTimes.push_back(gpuMs);
+    }
+
+    playbackFrame++;
+    if (playbackFrame < frames.size()) {
+        return;
+    }
+
+    finishPass();
+    if (looping) {
+        playbackFrame = 0;
+    }
+    else {
+        stopPlayback();
+    }
+}
+
+void CameraPath::finishPass() {
+    completedPasses++;
+    cpuStats = FrameTimeStats::compute(cpuTimes);
+    gpuStats = FrameTimeStats::compute(gpuTimes);
+    statsFrames = cpuTimes.size();
+
+    std::cout << "camera path pass " << completedPasses << ": cpu avg " << cpuStats.avg
+        << " ms, p95 " << cpuStats.p95 << " ms, p99 " << cpuStats.p99
+        << " ms | gpu avg " << gpuStats.avg << " ms, p95 " << gpuStats.p95 << " ms" << std::endl;
+
+    cpuTimes.clear();
+    gpuTimes.clear();
+}
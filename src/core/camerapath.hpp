@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "benchmark.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Camera;
+
+/*
+    Records the free camera and plays it back frame for frame. While recording, the live poses
+    are resampled onto a fixed timestep, so a path recorded at 40 fps and one recorded at 200 fps
+    both hold one pose per 1/60 s. Playback then applies one pose per rendered frame whatever the
+    wall clock says, which makes every run over the same scene render exactly the same views.
+    Frame times gathered during playback are summarized at the end of every pass.
+
+    The file is a small header followed by five floats per frame:
+    position xyz, yaw and pitch in degrees.
+*/
+class CameraPath {
+public:
+    struct Frame {
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+    };
+
+    static constexpr float TIMESTEP = 1.0f / 60.0f;
+
+    CameraPath() = default;
+
+    CameraPath(const CameraPath&) = delete;
+    CameraPath& operator=(const CameraPath&) = delete;
+
+    // drops any previous recording, the first pose is taken on the next recordFrame
+    void startRecording();
+    void stopRecording() { recording = false; }
+    bool isRecording() const { return recording; }
+    // deltaTime is the wall time since the previous call
+    void recordFrame(const Camera& camera, float deltaTime);
+
+    // both print and return false on failure, the ui keeps running
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    void startPlayback(bool loop);
+    void stopPlayback();
+    bool isPlaying() const { return playing; }
+    void applyPlayback(Camera& camera) const;
+    // call once per played frame after it was drawn, advances to the next pose
+    void endPlaybackFrame(float cpuMs, float gpuMs);
+
+    size_t getFrameCount() const { return frames.size(); }
+    const Frame& getFrame(size_t index) const { return frames[index]; }
+    uint32_t getPlaybackFrame() const { return playbackFrame; }
+    uint32_t getCompletedPasses() const { return completedPasses; }
+
+    // summary of the last finished pass, empty until one finished
+    bool hasStats() const { return statsFrames > 0; }
+    const FrameTimeStats& getCpuStats() const { return cpuStats; }
+    const FrameTimeStats& getGpuStats() const { return gpuStats; }
+
+private:
+    static constexpr uint32_t FILE_MAGIC = 0x50434147; // "GACP"
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    std::vector<Frame> frames;
+
+    bool recording = false;
+    bool hasPreviousPose = false;
+    Frame previousPose{};
+    float recordedTime = 0.0f;
+    float nextSampleTime = 0.0f;
+
+    bool playing = false;
+    bool looping = false;
+    uint32_t playbackFrame = 0;
+    uint32_t completedPasses = 0;
+    std::vector<float> cpuTimes;
+    std::vector<float> gpuTimes;
+
+    FrameTimeStats cpuStats;
+    FrameTimeStats gpuStats;
+    size_t statsFrames = 0;
+
+    void finishPass();
+};
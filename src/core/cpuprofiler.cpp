@@ -0,0 +1,150 @@
+#include "cpuprofiler.hpp"
+
+#ifdef ENABLE_CPU_PROFILER
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+CpuProfiler& CpuProfiler::getInstance() {
+    static CpuProfiler instance;
+    return instance;
+}
+
+CpuProfiler::CpuProfiler()
+    : capturing(false)
+    , generation(0)
+    , requestedFrames(0)
+    , framesRemaining(0)
+    , captureCount(0)
+    , captureStartNs(0) {
+}
+
+CpuProfiler::~CpuProfiler() {
+    for (ThreadBuffer* buffer : buffers) {
+        delete buffer;
+    }
+}
+
+void CpuProfiler::requestCapture(uint32_t frameCount) {
+    if (capturing || frameCount == 0) {
+        return;
+    }
+    requestedFrames = frameCount;
+}
+
+void CpuProfiler::beginFrame() {
+    mainThreadId = std::this_thread::get_id();
+
+    if (capturing.load(std::memory_order_relaxed)) {
+        framesRemaining--;
+        if (framesRemaining == 0) {
+            capturing.store(false, std::memory_order_relaxed);
+            writeTrace();
+        }
+    }
+
+    if (!capturing.load(std::memory_order_relaxed) && requestedFrames > 0) {
+        framesRemaining = requestedFrames;
+        requestedFrames = 0;
+        captureStartNs = now();
+        // threads clear their buffers the next time they record
+        generation.fetch_add(1, std::memory_order_release);
+        capturing.store(true, std::memory_order_relaxed);
+        std::cout << "cpu capture started (" << framesRemaining << " frames)" << std::endl;
+    }
+}
+
+uint64_t CpuProfiler::now() const {
+    auto sinceEpoch = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(sinceEpoch).count()) + 1;
+}
+
+CpuProfiler::ThreadBuffer* CpuProfiler::getThreadBuffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffer = new ThreadBuffer();
+        buffer->threadIndex = static_cast<uint32_t>(buffers.size());
+        buffer->threadId = std::this_thread::get_id();
+        buffer->generation.store(0, std::memory_order_relaxed);
+        buffer->count.store(0, std::memory_order_relaxed);
+        buffer->dropped = 0;
+        buffer->events.resize(EVENTS_PER_THREAD);
+        buffers.push_back(buffer);
+    }
+    return buffer;
+}
+
+void CpuProfiler::record(const char* name, uint64_t startNs, uint64_t endNs) {
+    ThreadBuffer* buffer = getThreadBuffer();
+
+    uint32_t currentGeneration = generation.load(std::memory_order_acquire);
+    if (buffer->generation.load(std::memory_order_relaxed) != currentGeneration) {
+        buffer->count.store(0, std::memory_order_relaxed);
+        buffer->dropped = 0;
+        buffer->generation.store(currentGeneration, std::memory_order_release);
+    }
+
+    uint32_t index = buffer->count.load(std::memory_order_relaxed);
+    if (index >= EVENTS_PER_THREAD) {
+        buffer->dropped++;
+        return;
+    }
+
+    buffer->events[index] = { name, startNs, endNs - startNs };
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::writeTrace() {
+    captureCount++;
+    std::string path = "cpu_trace_" + std::to_string(captureCount) + ".json";
+
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cout << "failed to write cpu trace: " << path << std::endl;
+        return;
+    }
+
+    uint32_t currentGeneration = generation.load(std::memory_order_acquire);
+    size_t eventCount = 0;
+
+    // ts and dur are microseconds in the trace event format
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    bool first = true;
+    for (ThreadBuffer* buffer : buffers) {
+        file << (first ? "" : ",\n");
+        first = false;
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->threadIndex
+             << ",\"args\":{\"name\":\"" << (buffer->threadId == mainThreadId ? "main" : "thread " + std::to_string(buffer->threadIndex)) << "\"}}";
+
+        // buffers that recorded nothing during this capture still hold an older one
+        if (buffer->generation.load(std::memory_order_acquire) != currentGeneration) {
+            continue;
+        }
+
+        uint32_t count = buffer->count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; i++) {
+            const Event& event = buffer->events[i];
+            file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadIndex
+                 << ",\"ts\":" << static_cast<double>(event.startNs - captureStartNs) / 1000.0
+                 << ",\"dur\":" << static_cast<double>(event.durationNs) / 1000.0 << "}";
+        }
+        eventCount += count;
+
+        if (buffer->dropped > 0) {
+            std::cout << "cpu trace: thread " << buffer->threadIndex << " dropped " << buffer->dropped << " zones" << std::endl;
+        }
+    }
+
+    file << "\n]}\n";
+
+    lastTracePath = path;
+    std::cout << "cpu trace written: " << path << " (" << eventCount << " zones)" << std::endl;
+}
+
+#endif
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+    Scoped CPU zones captured over a number of frames and written as a Chrome trace event file,
+    which chrome://tracing and ui.perfetto.dev both open.
+    Every thread records into its own fixed size buffer and only ever appends, publishing the new
+    count with a release store, so recording takes no lock. Buffers are read on the main thread
+    between frames once the capture finished, a thread only clears its own buffer when it sees
+    that a new capture started.
+    Without ENABLE_CPU_PROFILER, which only the Debug and Profile configurations define, the
+    macros below expand to nothing and the zones cost nothing.
+*/
+
+#ifdef ENABLE_CPU_PROFILER
+
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+
+// name has to be a string literal, only the pointer is stored
+#define CPU_PROFILE_ZONE(name) CpuProfileZone CPU_PROFILE_CONCAT(cpuProfileZone, __LINE__)(name)
+#define CPU_PROFILE_FRAME() CpuProfiler::getInstance().beginFrame()
+
+class CpuProfiler {
+public:
+    static constexpr uint32_t EVENTS_PER_THREAD = 1 << 16;
+
+    struct Event {
+        const char* name;
+        uint64_t startNs;
+        uint64_t durationNs;
+    };
+
+    static CpuProfiler& getInstance();
+
+    // starts with the next frame, ignored while a capture is running
+    void requestCapture(uint32_t frameCount);
+
+    // once per frame on the main thread, starts and finishes captures
+    void beginFrame();
+
+    bool isCapturing() const { return capturing.load(std::memory_order_relaxed); }
+    uint32_t getFramesRemaining() const { return framesRemaining; }
+    const std::string& getLastTracePath() const { return lastTracePath; }
+
+    // nanoseconds of the steady clock, never zero
+    uint64_t now() const;
+    void record(const char* name, uint64_t startNs, uint64_t endNs);
+
+private:
+    struct ThreadBuffer {
+        uint32_t threadIndex;
+        std::thread::id threadId;
+        std::atomic<uint32_t> generation;
+        std::atomic<uint32_t> count;
+        uint32_t dropped;
+        std::vector<Event> events;
+    };
+
+    CpuProfiler();
+    ~CpuProfiler();
+
+    CpuProfiler(const CpuProfiler&) = delete;
+    CpuProfiler& operator=(const CpuProfiler&) = delete;
+
+    ThreadBuffer* getThreadBuffer();
+    void writeTrace();
+
+    std::atomic<bool> capturing;
+    std::atomic<uint32_t> generation;
+    uint32_t requestedFrames;
+    uint32_t framesRemaining;
+    uint32_t captureCount;
+    uint64_t captureStartNs;
+    std::string lastTracePath;
+    std::thread::id mainThreadId;
+
+    // only locked when a thread records for the first time and when writing the trace
+    std::mutex buffersMutex;
+    std::vector<ThreadBuffer*> buffers;
+};
+
+class CpuProfileZone {
+public:
+    explicit CpuProfileZone(const char* name)
+        : name(name)
+        , startNs(CpuProfiler::getInstance().isCapturing() ? CpuProfiler::getInstance().now() : 0) {
+    }
+
+    ~CpuProfileZone() {
+        if (startNs != 0) {
+            CpuProfiler& profiler = CpuProfiler::getInstance();
+            profiler.record(name, startNs, profiler.now());
+        }
+    }
+
+    CpuProfileZone(const CpuProfileZone&) = delete;
+    CpuProfileZone& operator=(const CpuProfileZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t startNs;
+};
+
+#else
+
+#define CPU_PROFILE_ZONE(name)
+#define CPU_PROFILE_FRAME()
+
+#endif
@@ -1,4 +1,5 @@
 #include "directionallight.hpp"
+#include "../renderer/cascadedshadowmap.hpp"
 #include <stdexcept>
 #include <iostream>
 
@@ -11,6 +12,12 @@ DirectionalLight::DirectionalLight(VkDevice device, VmaAllocator allocator)
     , ambientIntensity(0.1f)
     , specularPower(32.0f)
     , enabled(false)
+    , castShadows(true)
+    , cascadeCount(3)
+    , splitLambda(0.75f)
+    , shadowDistance(3000.0f)
+    , pcfRadius(1)
+    , shadowBias(0.0005f)
     , descriptorSetLayout(VK_NULL_HANDLE)
     , descriptorPool(VK_NULL_HANDLE)
 {
@@ -64,10 +71,19 @@ void DirectionalLight::createDescriptorSetLayout() {
     uboLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     uboLayoutBinding.pImmutableSamplers = nullptr;
 
+    VkDescriptorSetLayoutBinding shadowMapBinding{};
+    shadowMapBinding.binding = 1;
+    shadowMapBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    shadowMapBinding.descriptorCount = 1;
+    shadowMapBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shadowMapBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding bindings[] = { uboLayoutBinding, shadowMapBinding };
+
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = 1;
-    layoutInfo.pBindings = &uboLayoutBinding;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
 
     if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create light descriptor set layout");
@@ -75,14 +91,16 @@ void DirectionalLight::createDescriptorSetLayout() {
 }
 
 void DirectionalLight::createDescriptorPool() {
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
     poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
 
     if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
@@ -123,7 +141,28 @@ void DirectionalLight::createDescriptorSets() {
     }
 }
 
-void DirectionalLight::updateUniformBuffer(VmaAllocator allocator, uint32_t currentFrame, const glm::vec3& cameraPos) {
+void DirectionalLight::setShadowMap(VkImageView shadowMapView, VkSampler shadowSampler) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = shadowMapView;
+        imageInfo.sampler = shadowSampler;
+
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = descriptorSets[i];
+        descriptorWrite.dstBinding = 1;
+        descriptorWrite.dstArrayElement = 0;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pImageInfo = &imageInfo;
+
+        vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+    }
+}
+
+void DirectionalLight::updateUniformBuffer(VmaAllocator allocator, uint32_t currentFrame, const glm::vec3& cameraPos,
+    const CascadedShadowMap* shadowMap) {
     LightingUBO ubo{};
     ubo.direction = direction;
     ubo.intensity = enabled ? intensity : 0.0f;
@@ -134,6 +173,17 @@ void DirectionalLight::updateUniformBuffer(VmaAllocator allocator, uint32_t curr
     ubo.cameraPosition = cameraPos;
     ubo.padding = 0.0f;
 
+    ubo.cascadeCount = (shadowMap && shadowMap->isActive()) ? shadowMap->getCascadeCount() : 0;
+    for (uint32_t i = 0; i < ubo.cascadeCount; i++) {
+        const CascadedShadowMap::Cascade& cascade = shadowMap->getCascade(i);
+        ubo.cascadeViewProj[i] = cascade.viewProj;
+        ubo.cascadeSplits[i] = cascade.splitDepth;
+        ubo.cascadeTexelSizes[i] = cascade.texelSize;
+    }
+    ubo.pcfRadius = pcfRadius;
+    ubo.shadowBias = shadowBias;
+    ubo.shadowPadding = 0.0f;
+
     void* data;
     vmaMapMemory(allocator, uniformBuffers[currentFrame].getAllocation(), &data);
     memcpy(data, &ubo, sizeof(ubo));
@@ -4,6 +4,9 @@
 #include <vulkan/vulkan.h>
 #include "../renderer/gpubuffer.hpp"
 #include "vk_mem_alloc.h"
+#include "../renderer/framesinflight.hpp"
+
+class CascadedShadowMap;
 
 struct LightingUBO {
     alignas(16) glm::vec3 direction;
@@ -14,11 +17,20 @@ struct LightingUBO {
     alignas(4) float specularPower;
     alignas(16) glm::vec3 cameraPosition;
     alignas(4) float padding;
+
+    // cascaded shadow map, cascadeCount is 0 when shadows are off
+    alignas(16) glm::mat4 cascadeViewProj[4];    // DirectionalLight::MAX_SHADOW_CASCADES
+    alignas(16) glm::vec4 cascadeSplits;
+    alignas(16) glm::vec4 cascadeTexelSizes;
+    alignas(4) uint32_t cascadeCount;
+    alignas(4) int32_t pcfRadius;
+    alignas(4) float shadowBias;
+    alignas(4) float shadowPadding;
 };
 
 class DirectionalLight {
 public:
-    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+    static constexpr uint32_t MAX_SHADOW_CASCADES = 4;
 
     DirectionalLight(VkDevice device, VmaAllocator allocator);
     ~DirectionalLight();
@@ -27,7 +39,11 @@ public:
     DirectionalLight& operator=(const DirectionalLight&) = delete;
 
     void cleanup(VmaAllocator allocator);
-    void updateUniformBuffer(VmaAllocator allocator, uint32_t currentFrame, const glm::vec3& cameraPos);
+    void updateUniformBuffer(VmaAllocator allocator, uint32_t currentFrame, const glm::vec3& cameraPos,
+        const CascadedShadowMap* shadowMap);
+
+    // binds the cascade array (binding 1) to every frame's descriptor set
+    void setShadowMap(VkImageView shadowMapView, VkSampler shadowSampler);
 
     void setDirection(const glm::vec3& dir) { direction = glm::normalize(dir); }
     void setColor(const glm::vec3& col) { color = col; }
@@ -36,6 +52,7 @@ public:
     void setAmbientIntensity(float i) { ambientIntensity = i; }
     void setSpecularPower(float p) { specularPower = p; }
     void setEnabled(bool e) { enabled = e; }
+    void setCastShadows(bool c) { castShadows = c; }
 
     glm::vec3 getDirection() const { return direction; }
     glm::vec3 getColor() const { return color; }
@@ -45,6 +62,13 @@ public:
     float getSpecularPower() const { return specularPower; }
     bool isEnabled() const { return enabled; }
 
+    bool getCastShadows() const { return castShadows; }
+    int getCascadeCount() const { return cascadeCount; }
+    float getSplitLambda() const { return splitLambda; }
+    float getShadowDistance() const { return shadowDistance; }
+    int getPcfRadius() const { return pcfRadius; }
+    float getShadowBias() const { return shadowBias; }
+
     float* getDirectionPtr() { return &direction.x; }
     float* getColorPtr() { return &color.x; }
     float* getIntensityPtr() { return &intensity; }
@@ -52,6 +76,13 @@ public:
     float* getAmbientIntensityPtr() { return &ambientIntensity; }
     float* getSpecularPowerPtr() { return &specularPower; }
 
+    bool* getCastShadowsPtr() { return &castShadows; }
+    int* getCascadeCountPtr() { return &cascadeCount; }
+    float* getSplitLambdaPtr() { return &splitLambda; }
+    float* getShadowDistancePtr() { return &shadowDistance; }
+    int* getPcfRadiusPtr() { return &pcfRadius; }
+    float* getShadowBiasPtr() { return &shadowBias; }
+
     VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
     VkDescriptorSet getDescriptorSet(uint32_t frame) const { return descriptorSets[frame]; }
     VkBuffer getBuffer(uint32_t frame) const { return uniformBuffers[frame].getBuffer(); }
@@ -67,6 +98,14 @@ private:
     float specularPower;
     bool enabled;
 
+    // shadow settings
+    bool castShadows;
+    int cascadeCount;       // 2 to MAX_SHADOW_CASCADES
+    float splitLambda;      // 0 = uniform splits, 1 = logarithmic splits
+    float shadowDistance;   // view depth the last cascade ends at
+    int pcfRadius;          // filter taps per side are 2 * radius + 1
+    float shadowBias;
+
     GPUBuffer uniformBuffers[MAX_FRAMES_IN_FLIGHT];
     VkDescriptorSetLayout descriptorSetLayout;
     VkDescriptorPool descriptorPool;
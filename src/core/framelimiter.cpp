@@ -0,0 +1,55 @@
+#include "framelimiter.hpp"
+#include <cmath>
+#include <thread>
+
+void FrameLimiter::wait(float framesPerSecond) {
+    if (framesPerSecond <= 0.0f) {
+        scheduled = false;
+        return;
+    }
+
+    auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond));
+    Clock::time_point now = Clock::now();
+
+    if (!scheduled) {
+        deadline = now;
+        scheduled = true;
+        return;
+    }
+
+    deadline += period;
+    if (now >= deadline) {
+        // late, the schedule restarts here rather than shortening the next frames
+        deadline = now;
+        return;
+    }
+
+    sleepUntil(deadline);
+}
+
+void FrameLimiter::sleepUntil(Clock::time_point target) {
+    using Seconds = std::chrono::duration<double>;
+
+    // sleep while even a slow sleep would wake up before the target
+    for (;;) {
+        double remaining = Seconds(target - Clock::now()).count();
+        if (remaining <= sleepEstimate) {
+            break;
+        }
+
+        Clock::time_point start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        double observed = Seconds(Clock::now() - start).count();
+
+        // Welford's running variance, the estimate is the mean plus one standard deviation
+        sleepCount++;
+        double delta = observed - sleepMean;
+        sleepMean += delta / static_cast<double>(sleepCount);
+        sleepM2 += delta * (observed - sleepMean);
+        sleepEstimate = sleepMean + std::sqrt(sleepM2 / static_cast<double>(sleepCount - 1));
+    }
+
+    while (Clock::now() < target) {
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/*
+    Caps the frame rate on the cpu. Each frame is given a deadline one period after the previous
+    one. The limiter sleeps in 1 ms steps while the remaining time is longer than such a sleep has
+    been observed to take, then spins for the rest, so the deadline is met to within
+    microseconds however coarse the system timer is. A frame that ends past its deadline starts
+    a new schedule instead of letting the next frames rush to catch up.
+*/
+class FrameLimiter {
+public:
+    FrameLimiter() = default;
+
+    FrameLimiter(const FrameLimiter&) = delete;
+    FrameLimiter& operator=(const FrameLimiter&) = delete;
+
+    // blocks until the current frame's deadline, does nothing while framesPerSecond is 0 or less
+    void wait(float framesPerSecond);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point deadline{};
+    bool scheduled = false;
+
+    // running mean and variance of how long a 1 ms sleep really takes, in seconds
+    double sleepEstimate = 0.005;
+    double sleepMean = 0.005;
+    double sleepM2 = 0.0;
+    uint64_t sleepCount = 1;
+
+    void sleepUntil(Clock::time_point target);
+};
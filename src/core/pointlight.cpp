@@ -1,132 +1,75 @@
 #include "pointlight.hpp"
-#include <stdexcept>
-#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <random>
 
-PointLight::PointLight(VkDevice device, VmaAllocator allocator)
-    : device(device)
-    , position(0.0f, 0.0f, 0.0f)
+PointLight::PointLight()
+    : position(0.0f, 0.0f, 0.0f)
     , color(1.0f, 1.0f, 1.0f)
     , intensity(10000.0f)
     , enabled(false)
-    , descriptorSetLayout(VK_NULL_HANDLE)
-    , descriptorPool(VK_NULL_HANDLE)
+    , castShadows(true)
 {
-    createUniformBuffers(allocator);
-    createDescriptorSetLayout();
-    createDescriptorPool();
-    createDescriptorSets();
 }
 
 PointLight::~PointLight() {
 }
 
-void PointLight::cleanup(VmaAllocator allocator) {
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        uniformBuffers[i].destroy(allocator);
-    }
-
-    if (descriptorPool != VK_NULL_HANDLE) {
-        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
-        descriptorPool = VK_NULL_HANDLE;
-    }
-
-    if (descriptorSetLayout != VK_NULL_HANDLE) {
-        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
-        descriptorSetLayout = VK_NULL_HANDLE;
-    }
+float PointLight::computeRange(float intensity) {
+    return std::sqrt(std::max(intensity, 0.0f) / MIN_ILLUMINANCE);
 }
 
-void PointLight::createUniformBuffers(VmaAllocator allocator) {
-    VkDeviceSize bufferSize = sizeof(PointLightUBO);
-
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        uniformBuffers[i].create(
-            allocator,
-            bufferSize,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VMA_MEMORY_USAGE_CPU_TO_GPU,
-            nullptr,
-            nullptr
-        );
+void PointLight::addLight(const glm::vec3& lightPosition, const glm::vec3& lightColor, float lightIntensity) {
+    if (lights.size() + 1 >= MAX_LIGHTS) {
+        return;
     }
-}
-
-void PointLight::createDescriptorSetLayout() {
-    VkDescriptorSetLayoutBinding uboLayoutBinding{};
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    uboLayoutBinding.pImmutableSamplers = nullptr;
 
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = 1;
-    layoutInfo.pBindings = &uboLayoutBinding;
-
-    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create point light descriptor set layout");
-    }
+    PointLightData light{};
+    light.position = lightPosition;
+    light.range = computeRange(lightIntensity);
+    light.color = lightColor;
+    light.intensity = lightIntensity;
+    lights.push_back(light);
 }
 
-void PointLight::createDescriptorPool() {
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
+void PointLight::scatterLights(uint32_t count, const glm::vec3& center, const glm::vec3& halfExtent, float lightIntensity, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> hue(0.0f, 6.0f);
 
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes = &poolSize;
-    poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
-
-    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create point light descriptor pool");
-    }
-}
+    lights.clear();
+    // one slot stays reserved for the primary light
+    count = std::min(count, MAX_LIGHTS - 1);
+    lights.reserve(count);
 
-void PointLight::createDescriptorSets() {
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+    for (uint32_t i = 0; i < count; ++i) {
+        glm::vec3 offset(unit(rng), unit(rng), unit(rng));
 
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
-    allocInfo.pSetLayouts = layouts.data();
+        // fully saturated color from a random hue
+        float h = hue(rng);
+        glm::vec3 lightColor(
+            std::clamp(std::abs(h - 3.0f) - 1.0f, 0.0f, 1.0f),
+            std::clamp(2.0f - std::abs(h - 2.0f), 0.0f, 1.0f),
+            std::clamp(2.0f - std::abs(h - 4.0f), 0.0f, 1.0f));
 
-    descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate point light descriptor sets");
+        addLight(center + offset * halfExtent, lightColor, lightIntensity);
     }
+}
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = uniformBuffers[i].getBuffer();
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(PointLightUBO);
-
-        VkWriteDescriptorSet descriptorWrite{};
-        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrite.dstSet = descriptorSets[i];
-        descriptorWrite.dstBinding = 0;
-        descriptorWrite.dstArrayElement = 0;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pBufferInfo = &bufferInfo;
+uint32_t PointLight::gatherLights(PointLightData* out, uint32_t maxCount) const {
+    uint32_t count = 0;
 
-        vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+    if (enabled && intensity > 0.0f && count < maxCount) {
+        PointLightData& primary = out[count++];
+        primary.position = position;
+        primary.range = computeRange(intensity);
+        primary.color = color;
+        primary.intensity = intensity;
     }
-}
 
-void PointLight::updateUniformBuffer(VmaAllocator allocator, uint32_t currentFrame) {
-    PointLightUBO ubo{};
-    ubo.position = position;
-    ubo.intensity = enabled ? intensity : 0.0f;
-    ubo.color = color;
-    ubo.padding = 0.0f;
+    uint32_t scattered = std::min(static_cast<uint32_t>(lights.size()), maxCount - count);
+    std::copy(lights.begin(), lights.begin() + scattered, out + count);
+    count += scattered;
 
-    void* data;
-    vmaMapMemory(allocator, uniformBuffers[currentFrame].getAllocation(), &data);
-    memcpy(data, &ubo, sizeof(ubo));
-    vmaUnmapMemory(allocator, uniformBuffers[currentFrame].getAllocation());
+    return count;
 }
@@ -1,63 +1,66 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <vulkan/vulkan.h>
-#include "../renderer/gpubuffer.hpp"
-#include "vk_mem_alloc.h"
+#include <cstdint>
+#include <vector>
 
-struct PointLightUBO {
+// std430 layout, matches PointLightData in shaders/clusters.glsl
+struct PointLightData {
     alignas(16) glm::vec3 position;
-    alignas(4) float intensity;
+    alignas(4) float range;
     alignas(16) glm::vec3 color;
-    alignas(4) float padding;
+    alignas(4) float intensity;
 };
 
+// CPU side point lights: the editable primary light plus any number of scattered lights.
+// ClusteredLighting uploads them every frame with gatherLights().
 class PointLight {
 public:
-    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+    static constexpr uint32_t MAX_LIGHTS = 4096;
+    // a light stops contributing once its inverse square falloff drops below this
+    static constexpr float MIN_ILLUMINANCE = 0.01f;
 
-    PointLight(VkDevice device, VmaAllocator allocator);
+    PointLight();
     ~PointLight();
 
     PointLight(const PointLight&) = delete;
     PointLight& operator=(const PointLight&) = delete;
 
-    void cleanup(VmaAllocator allocator);
-    void updateUniformBuffer(VmaAllocator allocator, uint32_t currentFrame);
-
     void setPosition(const glm::vec3& pos) { position = pos; }
     void setColor(const glm::vec3& col) { color = col; }
     void setIntensity(float i) { intensity = i; }
     void setEnabled(bool e) { enabled = e; }
+    void setCastShadows(bool cast) { castShadows = cast; }
 
     glm::vec3 getPosition() const { return position; }
     glm::vec3 getColor() const { return color; }
     float getIntensity() const { return intensity; }
     bool isEnabled() const { return enabled; }
+    // only the primary light casts a shadow, see PointShadowMap
+    bool getCastShadows() const { return castShadows; }
 
     float* getPositionPtr() { return &position.x; }
     float* getColorPtr() { return &color.x; }
     float* getIntensityPtr() { return &intensity; }
+    bool* getCastShadowsPtr() { return &castShadows; }
 
-    VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
-    VkDescriptorSet getDescriptorSet(uint32_t frame) const { return descriptorSets[frame]; }
-    VkBuffer getBuffer(uint32_t frame) const { return uniformBuffers[frame].getBuffer(); }
+    // scattered lights, placed randomly inside a box around center
+    void addLight(const glm::vec3& position, const glm::vec3& color, float intensity);
+    void scatterLights(uint32_t count, const glm::vec3& center, const glm::vec3& halfExtent, float intensity, uint32_t seed);
+    void clearLights() { lights.clear(); }
+    size_t getScatteredLightCount() const { return lights.size(); }
 
-private:
-    VkDevice device;
+    // writes every active light into out, returns how many were written
+    uint32_t gatherLights(PointLightData* out, uint32_t maxCount) const;
 
+    static float computeRange(float intensity);
+
+private:
     glm::vec3 position;
     glm::vec3 color;
     float intensity;
     bool enabled;
+    bool castShadows;
 
-    GPUBuffer uniformBuffers[MAX_FRAMES_IN_FLIGHT];
-    VkDescriptorSetLayout descriptorSetLayout;
-    VkDescriptorPool descriptorPool;
-    std::vector<VkDescriptorSet> descriptorSets;
-
-    void createUniformBuffers(VmaAllocator allocator);
-    void createDescriptorSetLayout();
-    void createDescriptorPool();
-    void createDescriptorSets();
+    std::vector<PointLightData> lights;
 };
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include <cstdint>
+
+// renderer options, owned by Application and edited from the ui unless marked startup only
+struct RenderSettings {
+    // depth only pass before the g-buffer, the g-buffer then shades each pixel once with EQUAL depth testing
+    bool depthPrepass = false;
+
+    // startup only (--compact-gbuffer): roughness in albedo alpha and octahedral RG16 normals,
+    // one attachment and one input attachment read fewer than the default layout
+    bool compactGBuffer = false;
+
+    // startup only (--dynamic-resolution): the scene passes render below the swap chain size and are upscaled
+    bool dynamicResolution = false;
+    // gpu frame time the dynamic resolution scale aims for, and how far it may drop
+    float targetFrameMs = 16.6f;
+    float minResolutionScale = 0.5f;
+
+    // frames the cpu may record ahead of the gpu, 1 to MAX_FRAMES_IN_FLIGHT (--frames-in-flight).
+    // fewer means less input latency, more keeps both busy when either one stalls
+    uint32_t framesInFlight = 2;
+    // --present-mode, falls back to FIFO when the surface does not support it. changing it
+    // recreates the swap chain
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    // set by the renderer: the mode the swap chain runs with, FIFO when presentMode is unsupported
+    VkPresentModeKHR activePresentMode = VK_PRESENT_MODE_MAX_ENUM_KHR;
+    // cpu side frame limit in frames per second, 0 is off (--fps-limit)
+    float frameRateLimit = 0.0f;
+
+    // the scene and debug passes are recorded into secondary command buffers on worker threads,
+    // off records every pass on the main thread (--serial-recording)
+    bool parallelRecording = true;
+    // startup only (--recording-threads), 0 starts one per hardware thread besides the main one
+    uint32_t recordingThreads = 0;
+};
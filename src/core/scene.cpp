@@ -1,7 +1,11 @@
 #include "scene.hpp"
+#include "cpuprofiler.hpp"
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
 
 Scene::Scene(VmaAllocator allocator, CommandBuffer* commandBuffer,
              MaterialManager* materialManager, TextureManager* textureManager)
@@ -10,13 +14,17 @@ Scene::Scene(VmaAllocator allocator, CommandBuffer* commandBuffer,
     , materialManager(materialManager)
     , textureManager(textureManager)
 {
+    createInstanceBuffers(0, 0);
 }
 
 Scene::~Scene() {
     clear();
+    destroyInstanceBuffers();
 }
 
 void Scene::loadModel(const std::string& assetFolderPath, const std::string& modelName) {
+    CPU_PROFILE_ZONE("Scene::loadModel");
+
     std::string objPath = assetFolderPath + "/" + modelName + ".obj";
     std::string mtlPath = assetFolderPath + "/" + modelName + ".mtl";
     std::string textureBasePath = assetFolderPath + "/";
@@ -33,7 +41,7 @@ void Scene::loadModel(const std::string& assetFolderPath, const std::string& mod
 
     // create and load mesh
     Model model;
-    model.mesh = std::make_unique<Mesh>();
+    model.mesh = std::make_shared<Mesh>();
     model.name = modelName;
     model.folderPath = assetFolderPath;
 
@@ -52,6 +60,7 @@ void Scene::loadModel(const std::string& assetFolderPath, const std::string& mod
             model.submeshAABBs.push_back(aabb);
         }
 
+        transforms.addNode(glm::mat4(1.0f), model.submeshAABBs);
         models.push_back(std::move(model));
         std::cout << "Successfully loaded model: " << modelName << " (Total models: " << models.size() << ")" << std::endl;
 
@@ -63,71 +72,32 @@ void Scene::loadModel(const std::string& assetFolderPath, const std::string& mod
     }
 }
 
-void Scene::drawAll(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
-                    MaterialManager* materialManager) const {
-    for (const auto& [material, batch] : opaqueBatches) {
-        if (material && material->descriptorSet != VK_NULL_HANDLE) {
-            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                pipelineLayout, 1, 1, &material->descriptorSet, 0, nullptr);
-
-            // push material constants
-            struct MaterialPushConstants {
-                glm::vec4 diffuseColor;
-                uint32_t hasTexture;
-                uint32_t hasNormalMap;
-                float dissolve;
-                float padding;
-            } pushConstants;
-
-            pushConstants.diffuseColor = material->diffuseColor;
-            pushConstants.hasTexture = material->hasTexture ? 1u : 0u;
-            pushConstants.hasNormalMap = material->hasNormalMap ? 1u : 0u;
-            pushConstants.dissolve = material->dissolve;
-            pushConstants.padding = 0.0f;
-
-            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
-                0, sizeof(MaterialPushConstants), &pushConstants);
-        }
-
-        for (const auto& cmd : batch.drawCommands) {
-            if (cmd.mesh) {
-                cmd.mesh->bind(commandBuffer);
-                cmd.mesh->draw(commandBuffer, cmd.submeshIndex);
-            }
-        }
-    }
-}
-
 void Scene::clear() {
-    for (auto& [material, batch] : opaqueBatches) {
-        batch.cleanup(allocator);
-    }
-    opaqueBatches.clear();
-
-    for (auto& [material, batch] : transparentBatches) {
-        batch.cleanup(allocator);
-    }
-    transparentBatches.clear();
+    waitForFramesInFlight();
+    destroyMaterialBatches();
 
     unifiedVertexBuffer.destroy(allocator);
+    unifiedPositionBuffer.destroy(allocator);
     unifiedIndexBuffer.destroy(allocator);
 
     for (auto& model : models) {
-        if (model.mesh) {
-            model.mesh->destroy(allocator);
-        }
+        releaseMesh(model);
     }
     models.clear();
+    transforms.clear();
+    generatedModelCount = 0;
+    bounds = AABB();
+    geometryRevision++;
+    createInstanceBuffers(0, 0);
     std::cout << "Scene cleared" << std::endl;
 }
 
 bool Scene::removeModel(const std::string& modelName) {
-    for (auto it = models.begin(); it != models.end(); ++it) {
-        if (it->name == modelName) {
-            if (it->mesh) {
-                it->mesh->destroy(allocator);
-            }
-            models.erase(it);
+    for (size_t i = 0; i < models.size(); ++i) {
+        if (models[i].name == modelName) {
+            std::vector<uint8_t> removed(models.size(), 0);
+            removed[i] = 1;
+            eraseModels(removed);
             std::cout << "Removed model: " << modelName << " (Remaining models: " << models.size() << ")" << std::endl;
 
             buildMaterialBatches();
@@ -138,6 +108,173 @@ bool Scene::removeModel(const std::string& modelName) {
     return false;
 }
 
+std::string Scene::placeInstance(const std::string& modelName, const glm::mat4& transform) {
+    auto source = std::find_if(models.begin(), models.end(),
+        [&](const Model& model) { return model.name == modelName; });
+    if (source == models.end() || !source->mesh) {
+        throw std::runtime_error("model not loaded: " + modelName);
+    }
+
+    Model instance;
+    instance.mesh = source->mesh;
+    instance.folderPath = source->folderPath;
+    instance.submeshAABBs = source->submeshAABBs;
+    instance.materialNames = source->materialNames;
+
+    // the mesh's use count includes the new instance
+    long number = source->mesh.use_count();
+    do {
+        instance.name = modelName + " #" + std::to_string(number++);
+    } while (isModelLoaded(instance.name));
+
+    std::string name = instance.name;
+    transforms.addNode(transform, instance.submeshAABBs);
+    models.push_back(std::move(instance));
+    std::cout << "Placed instance: " << name << std::endl;
+
+    buildMaterialBatches();
+    return name;
+}
+
+/*
+    Instances of every loaded model, or of a generated sphere, spread over a grid or scattered at
+    random. Each copy is a model of its own that shares its source's mesh, so the unified buffers
+    hold every source once and the copies of one submesh become a single instanced draw.
+*/
+void Scene::generateStressScene(const StressSceneSettings& settings) {
+    CPU_PROFILE_ZONE("Scene::generateStressScene");
+    auto start = std::chrono::steady_clock::now();
+
+    // the copies' meshes are released before the rebuild, which waits too late for them
+    waitForFramesInFlight();
+    removeGeneratedModels();
+
+    std::vector<const Model*> sources;
+    if (settings.source == StressSceneSettings::LOADED_MODELS) {
+        for (const Model& model : models) {
+            if (model.mesh) {
+                sources.push_back(&model);
+            }
+        }
+    }
+
+    Model sphere;
+    if (sources.empty()) {
+        std::vector<Vertex> sphereVertices;
+        std::vector<uint32_t> sphereIndices;
+        StressScene::buildSphere(settings.sphereSegments, sphereVertices, sphereIndices);
+        uint32_t sphereIndexCount = static_cast<uint32_t>(sphereIndices.size());
+        sphere.mesh = std::make_shared<Mesh>();
+        sphere.mesh->loadFromData(std::move(sphereVertices), std::move(sphereIndices),
+            { SubMesh(0, sphereIndexCount) }, { "" });
+        sphere.submeshAABBs.push_back(AABB::computeFromVertices(sphere.mesh->getVertices()));
+        sources.push_back(&sphere);
+    }
+
+    float cellSize = 0.0f;
+    for (const Model* source : sources) {
+        AABB sourceBounds = AABB::computeFromVertices(source->mesh->getVertices());
+        glm::vec3 size = sourceBounds.max - sourceBounds.min;
+        cellSize = std::max(cellSize, std::max(size.x, std::max(size.y, size.z)));
+    }
+
+    std::vector<std::string> materialNames;
+    if (settings.randomMaterials) {
+        for (size_t i = 0; i < materialManager->getMaterialCount(); i++) {
+            if (const MaterialManager::Material* material = materialManager->getMaterial(static_cast<uint32_t>(i))) {
+                materialNames.push_back(material->name);
+            }
+        }
+    }
+
+    std::vector<glm::mat4> placements = StressScene::buildTransforms(settings, std::max(cellSize, 1.0f));
+    std::mt19937 rng(settings.seed);
+
+    // sources point into models, so take copies of what the instances need before it grows
+    std::vector<Model> instances;
+    instances.reserve(settings.count);
+    uint64_t instancedIndices = 0;
+    for (uint32_t i = 0; i < settings.count; i++) {
+        const Model* source = sources[i % sources.size()];
+
+        Model model;
+        model.mesh = source->mesh;
+        model.name = "stress";
+        model.submeshAABBs = source->submeshAABBs;
+        model.generated = true;
+        if (!materialNames.empty()) {
+            for (uint32_t s = 0; s < source->mesh->getSubmeshCount(); s++) {
+                model.materialNames.push_back(materialNames[rng() % materialNames.size()]);
+            }
+        }
+        else {
+            model.materialNames = source->materialNames;
+        }
+
+        instancedIndices += source->mesh->getTotalIndexCount();
+        instances.push_back(std::move(model));
+    }
+
+    models.reserve(models.size() + instances.size());
+    for (uint32_t i = 0; i < settings.count; i++) {
+        transforms.addNode(placements[i], instances[i].submeshAABBs);
+        models.push_back(std::move(instances[i]));
+    }
+    generatedModelCount = settings.count;
+
+    auto generated = std::chrono::steady_clock::now();
+    buildMaterialBatches();
+    auto batched = std::chrono::steady_clock::now();
+
+    std::cout << "stress scene: " << settings.count << " instances of " << sources.size() << " source meshes, "
+              << instancedIndices << " indices drawn | generated in "
+              << std::chrono::duration<float, std::milli>(generated - start).count() << " ms, batched and uploaded in "
+              << std::chrono::duration<float, std::milli>(batched - generated).count() << " ms" << std::endl;
+}
+
+void Scene::clearStressScene() {
+    if (generatedModelCount == 0) {
+        return;
+    }
+
+    waitForFramesInFlight();
+    removeGeneratedModels();
+    buildMaterialBatches();
+}
+
+void Scene::removeGeneratedModels() {
+    std::vector<uint8_t> removed(models.size(), 0);
+    for (size_t i = 0; i < models.size(); i++) {
+        removed[i] = models[i].generated ? 1 : 0;
+    }
+    eraseModels(removed);
+    generatedModelCount = 0;
+}
+
+void Scene::eraseModels(const std::vector<uint8_t>& removed) {
+    size_t kept = 0;
+    for (size_t i = 0; i < models.size(); i++) {
+        if (removed[i]) {
+            releaseMesh(models[i]);
+        }
+        else {
+            if (kept != i) {
+                models[kept] = std::move(models[i]);
+            }
+            kept++;
+        }
+    }
+    models.resize(kept);
+    transforms.removeNodes(removed);
+}
+
+void Scene::releaseMesh(Model& model) {
+    if (model.mesh && model.mesh.use_count() == 1) {
+        model.mesh->destroy(allocator);
+    }
+    model.mesh.reset();
+}
+
 bool Scene::isModelLoaded(const std::string& modelName) const {
     for (const auto& model : models) {
         if (model.name == modelName) {
@@ -154,21 +291,82 @@ const Scene::Model* Scene::getModel(size_t index) const {
     return &models[index];
 }
 
-void Scene::buildMaterialBatches() {
-    for (auto& [material, batch] : opaqueBatches) {
-        batch.cleanup(allocator);
+void Scene::setModelTransform(size_t index, const glm::mat4& transform) {
+    if (index >= models.size()) {
+        throw std::runtime_error("model index out of range");
+    }
+    transforms.setLocalTransform(static_cast<uint32_t>(index), transform);
+}
+
+void Scene::setModelParent(size_t index, uint32_t parent) {
+    if (index >= models.size()) {
+        throw std::runtime_error("model index out of range");
+    }
+    transforms.setParent(static_cast<uint32_t>(index), parent);
+}
+
+/*
+    Only models that moved, or sit below one that moved, are recomputed. Anything that changed
+    bumps the geometry revision as well, so the shadow caches render their casters again.
+*/
+void Scene::updateTransforms(uint32_t frameIndex) {
+    CPU_PROFILE_ZONE("Scene::updateTransforms");
+
+    if (transforms.update(true) > 0) {
+        computeBounds();
+        transformRevision++;
+        geometryRevision++;
+    }
+
+    if (uploadedTransformRevision[frameIndex] != transformRevision) {
+        uploadTransforms(frameIndex);
     }
-    opaqueBatches.clear();
+}
 
-    for (auto& [material, batch] : transparentBatches) {
-        batch.cleanup(allocator);
+void Scene::computeBounds() {
+    bounds = AABB();
+    bool firstBounds = true;
+    for (const AABB& worldAABB : transforms.getAllWorldBounds()) {
+        bounds.min = firstBounds ? worldAABB.min : glm::min(bounds.min, worldAABB.min);
+        bounds.max = firstBounds ? worldAABB.max : glm::max(bounds.max, worldAABB.max);
+        firstBounds = false;
     }
-    transparentBatches.clear();
+}
+
+void Scene::destroyMaterialBatches() {
+    for (auto* batches : { &opaqueBatches, &cutoutBatches, &transparentBatches }) {
+        for (auto& [material, batch] : *batches) {
+            batch.cleanup();
+        }
+        batches->clear();
+    }
+
+    indirectArena.cleanup(allocator);
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        drawSegments[i].clear();
+    }
+}
+
+void Scene::waitForFramesInFlight() {
+    VmaAllocatorInfo allocatorInfo{};
+    vmaGetAllocatorInfo(allocator, &allocatorInfo);
+    vkDeviceWaitIdle(allocatorInfo.device);
+}
+
+void Scene::buildMaterialBatches() {
+    waitForFramesInFlight();
+    destroyMaterialBatches();
 
     unifiedVertexBuffer.destroy(allocator);
+    unifiedPositionBuffer.destroy(allocator);
     unifiedIndexBuffer.destroy(allocator);
 
+    geometryRevision++;
+    transforms.update(true);
+    computeBounds();
+
     if (models.empty()) {
+        createInstanceBuffers(0, 0);
         std::cout << "No models to batch" << std::endl;
         return;
     }
@@ -178,24 +376,30 @@ void Scene::buildMaterialBatches() {
         uint32_t globalIndexOffset;
     };
     std::unordered_map<const Mesh*, MeshOffsets> meshOffsets;
+    std::vector<const Mesh*> uniqueMeshes;
 
     uint32_t totalVertices = 0;
     uint32_t totalIndices = 0;
 
+    // instances share their mesh, its geometry goes into the unified buffers once
     for (const auto& model : models) {
         if (!model.mesh) continue;
 
-        meshOffsets[model.mesh.get()] = { totalVertices, totalIndices };
+        auto [it, inserted] = meshOffsets.emplace(model.mesh.get(), MeshOffsets{ totalVertices, totalIndices });
+        if (!inserted) continue;
+
+        uniqueMeshes.push_back(model.mesh.get());
         totalVertices += model.mesh->getVertexCount();
         totalIndices += model.mesh->getTotalIndexCount();
     }
 
     if (totalVertices == 0 || totalIndices == 0) {
+        createInstanceBuffers(0, 0);
         std::cout << "No geometry to batch" << std::endl;
         return;
     }
 
-    buildUnifiedBuffers();
+    buildUnifiedBuffers(uniqueMeshes);
 
     uint32_t modelIndex = 0;
     for (const auto& model : models) {
@@ -207,11 +411,14 @@ void Scene::buildMaterialBatches() {
         const MeshOffsets& offsets = meshOffsets[model.mesh.get()];
 
         for (uint32_t i = 0; i < model.mesh->getSubmeshCount(); ++i) {
-            const std::string& materialName = model.mesh->getMaterialName(i);
+            const std::string& materialName = i < model.materialNames.size() ?
+                model.materialNames[i] : model.mesh->getMaterialName(i);
             const MaterialManager::Material* material = materialManager->getMaterialByName(materialName);
 
             bool isTransparent = material && material->hasAlpha;
-            auto& targetBatches = isTransparent ? transparentBatches : opaqueBatches;
+            bool isCutout = material && material->alphaCutout;
+            auto& targetBatches = isTransparent ? transparentBatches :
+                (isCutout ? cutoutBatches : opaqueBatches);
 
             auto it = targetBatches.find(material);
             if (it == targetBatches.end()) {
@@ -221,34 +428,41 @@ void Scene::buildMaterialBatches() {
                 it = insertIt;
             }
 
-            it->second.addDrawWithOffsets(model.mesh.get(), i, model.transform,
-                offsets.globalVertexOffset, offsets.globalIndexOffset, modelIndex);
+            it->second.addInstance(model.mesh.get(), i, modelIndex,
+                offsets.globalVertexOffset, offsets.globalIndexOffset);
         }
         modelIndex++;
     }
 
-    for (auto& [material, batch] : opaqueBatches) {
-        batch.allocateBuffers(allocator);
+    uint32_t instanceCapacity = 0;
+    uint32_t commandCount = 0;
+    for (const auto* batches : { &opaqueBatches, &cutoutBatches, &transparentBatches }) {
+        for (const auto& [material, batch] : *batches) {
+            instanceCapacity += batch.instanceCount;
+            commandCount += static_cast<uint32_t>(batch.drawCommands.size());
+        }
     }
 
-    for (auto& [material, batch] : transparentBatches) {
-        batch.allocateBuffers(allocator);
-    }
+    // every command can be visible at once, so the sorted list's range holds all of them
+    drawRange = indirectArena.addRange(commandCount);
+    indirectArena.allocateBuffers(allocator);
+
+    createInstanceBuffers(static_cast<uint32_t>(models.size()), instanceCapacity);
 
-    std::cout << "Built " << opaqueBatches.size() << " opaque batches and "
+    std::cout << "Built " << opaqueBatches.size() << " opaque batches, "
+              << cutoutBatches.size() << " cutout batches and "
               << transparentBatches.size() << " transparent batches with unified buffers ("
-              << totalVertices << " vertices, " << totalIndices << " indices)" << std::endl;
+              << totalVertices << " vertices, " << totalIndices << " indices, "
+              << commandCount << " draws for " << instanceCapacity << " instances)" << std::endl;
 }
 
-void Scene::buildUnifiedBuffers() {
+void Scene::buildUnifiedBuffers(const std::vector<const Mesh*>& meshes) {
     std::vector<Vertex> allVertices;
     std::vector<uint32_t> allIndices;
 
-    for (const auto& model : models) {
-        if (!model.mesh) continue;
-
-        const auto& meshVertices = model.mesh->getVertices();
-        const auto& meshIndices = model.mesh->getIndices();
+    for (const Mesh* mesh : meshes) {
+        const auto& meshVertices = mesh->getVertices();
+        const auto& meshIndices = mesh->getIndices();
 
         allVertices.insert(allVertices.end(), meshVertices.begin(), meshVertices.end());
         allIndices.insert(allIndices.end(), meshIndices.begin(), meshIndices.end());
@@ -264,6 +478,19 @@ void Scene::buildUnifiedBuffers() {
         VMA_MEMORY_USAGE_GPU_ONLY,
         allVertices.data(), commandBuffer);
 
+    // positions alone for depth only passes, copied bit for bit so both streams give the same depth
+    std::vector<glm::vec3> allPositions;
+    allPositions.reserve(allVertices.size());
+    for (const Vertex& vertex : allVertices) {
+        allPositions.push_back(vertex.pos);
+    }
+
+    VkDeviceSize positionBufferSize = sizeof(glm::vec3) * allPositions.size();
+    unifiedPositionBuffer.create(allocator, positionBufferSize,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY,
+        allPositions.data(), commandBuffer);
+
     VkDeviceSize indexBufferSize = sizeof(uint32_t) * allIndices.size();
     unifiedIndexBuffer.create(allocator, indexBufferSize,
         VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
@@ -274,6 +501,49 @@ void Scene::buildUnifiedBuffers() {
               << allIndices.size() << " indices" << std::endl;
 }
 
+void Scene::createInstanceBuffers(uint32_t transformCapacity, uint32_t instanceCapacity) {
+    destroyInstanceBuffers();
+
+    // both are rewritten by the cpu, the transforms only after something moved and the
+    // instances every frame, and read once per vertex shader invocation
+    VkDeviceSize transformSize = sizeof(glm::mat4) * std::max(transformCapacity, 1u);
+    VkDeviceSize instanceSize = sizeof(VisibleInstance) * std::max(instanceCapacity, 1u);
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        transformBuffers[i].create(allocator, transformSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU,
+            nullptr, nullptr);
+        visibleInstanceBuffers[i].create(allocator, instanceSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU,
+            nullptr, nullptr);
+        lastVisibleInstanceCount[i] = 0;
+
+        // new buffers are not in flight yet
+        uploadTransforms(i);
+    }
+
+    instanceRevision++;
+}
+
+void Scene::uploadTransforms(uint32_t frameIndex) {
+    const std::vector<glm::mat4>& worldTransforms = transforms.getWorldTransforms();
+    if (!worldTransforms.empty()) {
+        void* data;
+        vmaMapMemory(allocator, transformBuffers[frameIndex].getAllocation(), &data);
+        memcpy(data, worldTransforms.data(), worldTransforms.size() * sizeof(glm::mat4));
+        vmaUnmapMemory(allocator, transformBuffers[frameIndex].getAllocation());
+    }
+    uploadedTransformRevision[frameIndex] = transformRevision;
+}
+
+void Scene::destroyInstanceBuffers() {
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        transformBuffers[i].destroy(allocator);
+        visibleInstanceBuffers[i].destroy(allocator);
+    }
+}
+
 void Scene::bindUnifiedBuffers(VkCommandBuffer cmd) const {
     if (unifiedVertexBuffer.getBuffer() == VK_NULL_HANDLE) {
         return;
@@ -285,132 +555,87 @@ void Scene::bindUnifiedBuffers(VkCommandBuffer cmd) const {
     vkCmdBindIndexBuffer(cmd, unifiedIndexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
 }
 
-std::vector<std::pair<const MaterialManager::Material*, const MaterialBatch*>>
-Scene::getSortedTransparentBatches(const glm::mat4& viewProj) const {
-    std::vector<std::pair<const MaterialManager::Material*, const MaterialBatch*>> sortedBatches;
-
-    for (const auto& [material, batch] : transparentBatches) {
-        sortedBatches.emplace_back(material, &batch);
+void Scene::bindUnifiedPositionBuffers(VkCommandBuffer cmd) const {
+    if (unifiedPositionBuffer.getBuffer() == VK_NULL_HANDLE) {
+        return;
     }
 
-    std::sort(sortedBatches.begin(), sortedBatches.end(),
-        [this, &viewProj](const auto& a, const auto& b) {
-            auto computeBatchDepth = [this, &viewProj](const MaterialBatch* batch) -> float {
-                if (batch->drawCommands.empty()) return 0.0f;
-
-                const auto& cmd = batch->drawCommands[0];
-                if (!cmd.mesh) return 0.0f;
-
-                // center of the submesh
-                const auto& verts = cmd.mesh->getVertices();
-                const auto& submesh = cmd.mesh->getSubmesh(cmd.submeshIndex);
-
-                if (verts.empty()) return 0.0f;
-
-                glm::vec3 center(0.0f);
-                uint32_t sampleCount = 0;
-                uint32_t step = std::max(1u, submesh.indexCount / 10);
-
-                const auto& indices = cmd.mesh->getIndices();
-                for (uint32_t i = submesh.indexOffset; i < submesh.indexOffset + submesh.indexCount; i += step) {
-                    if (i < indices.size()) {
-                        uint32_t idx = indices[i];
-                        if (idx < verts.size()) {
-                            center += verts[idx].pos;
-                            sampleCount++;
-                        }
-                    }
-                }
-
-                if (sampleCount > 0) {
-                    center /= static_cast<float>(sampleCount);
-                }
-
-                glm::vec4 clipPos = viewProj * glm::vec4(center, 1.0f);
-                return clipPos.z / clipPos.w;
-            };
-
-            float depthA = computeBatchDepth(a.second);
-            float depthB = computeBatchDepth(b.second);
-
-            return depthA > depthB;
-        });
-
-    return sortedBatches;
+    VkBuffer vertexBuffers[] = { unifiedPositionBuffer.getBuffer() };
+    VkDeviceSize offsets[] = { 0 };
+    vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(cmd, unifiedIndexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
 }
 
 /*
-    Per-frame frustum culling: extracts frustum from viewProj, tests each submesh AABB
-    against it, and updates material batch visible commands with only the visible draws.
+    Per-frame frustum culling: extracts frustum from cullingViewProj, tests the cached world AABB of
+    every instance of every submesh against it, and keeps one draw per submesh that still has
+    instances, keyed by pass, pipeline variant, material and depth (see DrawSort). The surviving
+    instances of all batches go into this frame's instance list, which the camera passes read
+    through set 0, each tagged with the material index the fragment shader looks its parameters
+    up with. Every draw carries the pipeline variant of its material's shader features. The
+    draws are radix sorted by key and cut into segments of one pass and pipeline variant, so
+    batches come out in material order instead of hash order, opaque and cutout draws of a material
+    front to back by their nearest instance so early depth testing rejects as much of the hidden
+    surface as possible, and transparent batches back to front, the order they have to blend in.
 */
-void Scene::updateCulling(const glm::mat4& viewProj, uint32_t frameIndex) {
-    frustum.extractFromViewProj(viewProj);
-
-    std::unordered_map<const MaterialManager::Material*, std::vector<VkDrawIndexedIndirectCommand>> opaqueVisible;
-    std::unordered_map<const MaterialManager::Material*, std::vector<VkDrawIndexedIndirectCommand>> transparentVisible;
-
-    uint32_t totalVisible = 0;
-    uint32_t totalTested = 0;
-
-    for (auto& [material, batch] : opaqueBatches) {
-        auto& visibleCmds = opaqueVisible[material];
-        visibleCmds.reserve(batch.drawCommands.size());
-
-        for (const auto& cmd : batch.drawCommands) {
-            totalTested++;
-
-            if (cmd.modelIndex >= models.size()) continue;
-            const Model& model = models[cmd.modelIndex];
-            if (cmd.submeshIndex >= model.submeshAABBs.size()) continue;
-
-            const AABB& localAABB = model.submeshAABBs[cmd.submeshIndex];
-            bool visible = frustum.testAABB(localAABB, model.transform);
-
-            if (visible) {
-                visibleCmds.push_back(cmd.indirectCommand);
-                totalVisible++;
-            }
+void Scene::updateCulling(const glm::mat4& cullingViewProj, const glm::vec3& cameraPosition, uint32_t frameIndex) {
+    CPU_PROFILE_ZONE("Scene::updateCulling");
+
+    frustum.extractFromViewProj(cullingViewProj);
+
+    culledDraws.clear();
+    culledInstances.clear();
+
+    auto cullBatches = [&](const std::unordered_map<const MaterialManager::Material*, MaterialBatch>& batches,
+        uint32_t kind) {
+        for (const auto& [material, batch] : batches) {
+            uint32_t materialIndex = MaterialManager::getShaderIndex(material);
+            uint32_t pipeline = DrawSort::makePipeline(kind, MaterialManager::getShaderFeatures(material));
+            cullDraws(frustum, batch.drawCommands, transforms, cameraPosition,
+                DrawSort::make(DrawSort::PASS_GEOMETRY, pipeline, materialIndex, 0), pipeline, false,
+                materialIndex, culledDraws, culledInstances, cullScratch);
         }
-    }
-
-    for (auto& [material, batch] : transparentBatches) {
-        auto& visibleCmds = transparentVisible[material];
-        visibleCmds.reserve(batch.drawCommands.size());
+    };
 
-        for (const auto& cmd : batch.drawCommands) {
-            totalTested++;
+    cullBatches(opaqueBatches, DrawSort::PIPELINE_DEFAULT);
+    cullBatches(cutoutBatches, DrawSort::PIPELINE_CUTOUT);
 
-            if (cmd.modelIndex >= models.size()) continue;
-            const Model& model = models[cmd.modelIndex];
-            if (cmd.submeshIndex >= model.submeshAABBs.size()) continue;
+    for (const auto& [material, batch] : transparentBatches) {
+        uint32_t materialIndex = MaterialManager::getShaderIndex(material);
+        // blending order wins over the variant, which is not part of the key here
+        uint32_t pipeline = DrawSort::makePipeline(DrawSort::PIPELINE_DEFAULT, MaterialManager::getShaderFeatures(material));
+        cullDraws(frustum, batch.drawCommands, transforms, cameraPosition,
+            DrawSort::makeBlended(DrawSort::PASS_FORWARD, DrawSort::PIPELINE_DEFAULT, 0, materialIndex), pipeline,
+            true, materialIndex, culledDraws, culledInstances, cullScratch);
+    }
 
-            const AABB& localAABB = model.submeshAABBs[cmd.submeshIndex];
-            bool visible = frustum.testAABB(localAABB, model.transform);
+    DrawSort::radixSort(culledDraws, sortScratch);
 
-            if (visible) {
-                visibleCmds.push_back(cmd.indirectCommand);
-                totalVisible++;
-            }
+    std::vector<DrawSegment>& segments = drawSegments[frameIndex];
+    segments.clear();
+    culledCmds.clear();
+    for (const SortedDraw& draw : culledDraws) {
+        uint32_t pass = DrawSort::getPass(draw.key);
+        if (segments.empty() || segments.back().pass != pass || segments.back().pipeline != draw.pipeline) {
+            segments.push_back({ pass, draw.pipeline, static_cast<uint32_t>(culledCmds.size()), 0 });
         }
+        segments.back().count++;
+        culledCmds.push_back(draw.command);
     }
-
-    for (auto& [material, batch] : opaqueBatches) {
-        batch.updateVisibleCommands(frameIndex, opaqueVisible[material]);
+    indirectArena.updateRange(frameIndex, drawRange, culledCmds);
+
+    // host writes are visible to the gpu once the frame is submitted
+    if (!culledInstances.empty()) {
+        void* data;
+        vmaMapMemory(allocator, visibleInstanceBuffers[frameIndex].getAllocation(), &data);
+        memcpy(data, culledInstances.data(), culledInstances.size() * sizeof(VisibleInstance));
+        vmaUnmapMemory(allocator, visibleInstanceBuffers[frameIndex].getAllocation());
     }
 
-    for (auto& [material, batch] : transparentBatches) {
-        batch.updateVisibleCommands(frameIndex, transparentVisible[material]);
-    }
-
-    lastVisibleCount[frameIndex] = totalVisible;
+    lastVisibleCount[frameIndex] = static_cast<uint32_t>(culledCmds.size());
+    lastVisibleInstanceCount[frameIndex] = static_cast<uint32_t>(culledInstances.size());
 }
 
 void Scene::recordIndirectBufferCopies(VkCommandBuffer cmd, uint32_t frameIndex) {
-    for (auto& [material, batch] : opaqueBatches) {
-        batch.recordBufferCopy(cmd, frameIndex);
-    }
-
-    for (auto& [material, batch] : transparentBatches) {
-        batch.recordBufferCopy(cmd, frameIndex);
-    }
+    indirectArena.recordBufferCopy(cmd, frameIndex);
 }
@@ -5,9 +5,12 @@
 #include "../renderer/texturemanager.hpp"
 #include "../renderer/commandbuffer.hpp"
 #include "../renderer/indirectdrawing.hpp"
+#include "../renderer/drawsort.hpp"
 #include "../renderer/gpubuffer.hpp"
 #include "../renderer/frustum.hpp"
 #include "../ui/primitives/aabb.hpp"
+#include "stressscene.hpp"
+#include "transformhierarchy.hpp"
 #include "vk_mem_alloc.h"
 #include <vector>
 #include <memory>
@@ -16,12 +19,20 @@
 
 class Scene {
 public:
+    // one placement of a mesh, models placing the same mesh share its geometry and draw instanced.
+    // its transform and world bounds live in the hierarchy, at the model's index
     struct Model {
-        std::unique_ptr<Mesh> mesh;
+        std::shared_ptr<Mesh> mesh;
         std::string name;
         std::string folderPath;
-        std::vector<AABB> submeshAABBs;
-        glm::mat4 transform = glm::mat4(1.0f);
+        std::vector<AABB> submeshAABBs;             // in mesh space
+        std::vector<std::string> materialNames;     // per submesh, empty keeps the mesh's own
+        bool generated = false;     // stress scene copy, listed and removed as a group
+    };
+
+    // instance ordering for cullDraws, kept between calls to reuse its memory
+    struct CullScratch {
+        std::vector<std::pair<float, uint32_t>> instances;  // distance and model index of each surviving instance
     };
 
     Scene(VmaAllocator allocator, CommandBuffer* commandBuffer,
@@ -34,10 +45,6 @@ public:
     // load a model from an asset folder
     void loadModel(const std::string& assetFolderPath, const std::string& modelName);
 
-    // draw all models in the scene
-    void drawAll(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
-                 MaterialManager* materialManager) const;
-
     // clear all models from the scene
     void clear();
 
@@ -47,9 +54,29 @@ public:
     // check if a model is loaded
     bool isModelLoaded(const std::string& modelName) const;
 
+    // places the mesh of a loaded model once more without copying its geometry, returns the new
+    // model's name. throws when no model has that name
+    std::string placeInstance(const std::string& modelName, const glm::mat4& transform);
+
+    // replaces any previous stress copies with settings.count new instances
+    void generateStressScene(const StressSceneSettings& settings);
+    void clearStressScene();
+    size_t getGeneratedModelCount() const { return generatedModelCount; }
+
     size_t getModelCount() const { return models.size(); }
     const Model* getModel(size_t index) const;
 
+    // world matrices and cached world bounds by model index, as of the last updateTransforms
+    const TransformHierarchy& getTransforms() const { return transforms; }
+    // relative to the parent model, or to the world. applied by the next updateTransforms
+    void setModelTransform(size_t index, const glm::mat4& transform);
+    // parents a model to another one without moving it, TransformHierarchy::NO_PARENT detaches it.
+    // throws when either index is out of range or the parent is below the model
+    void setModelParent(size_t index, uint32_t parent);
+    // recomputes the world transforms and bounds of moved models and copies the matrices into
+    // this frame's transform buffer, before updateCulling and the shadow updates
+    void updateTransforms(uint32_t frameIndex);
+
     const std::unordered_map<const MaterialManager::Material*, MaterialBatch>& getMaterialBatches() const {
         return opaqueBatches;
     }
@@ -58,22 +85,56 @@ public:
         return opaqueBatches;
     }
 
+    // alpha tested materials, drawn in the geometry pass after all opaques
+    const std::unordered_map<const MaterialManager::Material*, MaterialBatch>& getCutoutBatches() const {
+        return cutoutBatches;
+    }
+
     const std::unordered_map<const MaterialManager::Material*, MaterialBatch>& getTransparentBatches() const {
         return transparentBatches;
     }
 
     bool hasTransparentObjects() const { return !transparentBatches.empty(); }
 
-    // get transparent batches sorted back-to-front by depth
-    std::vector<std::pair<const MaterialManager::Material*, const MaterialBatch*>>
-        getSortedTransparentBatches(const glm::mat4& viewProj) const;
+    // the visible draws of every batch, sorted by DrawSort key by updateCulling and written into
+    // this frame's indirect arena. each segment is a run of one pass and pipeline variant that
+    // the camera passes draw with one multi-draw, at getDraws().offset + firstCommand commands
+    IndirectDraws getDraws(uint32_t frameIndex) const { return indirectArena.getDraws(frameIndex, drawRange); }
+    const std::vector<DrawSegment>& getDrawSegments(uint32_t frameIndex) const { return drawSegments[frameIndex]; }
 
     void bindUnifiedBuffers(VkCommandBuffer commandBuffer) const;
+    // position only vertex stream with the same indices, for depth only passes
+    void bindUnifiedPositionBuffers(VkCommandBuffer commandBuffer) const;
     bool hasUnifiedBuffers() const { return unifiedVertexBuffer.getBuffer() != VK_NULL_HANDLE; }
 
-    void updateCulling(const glm::mat4& viewProj, uint32_t frameIndex);
+    // culls against cullingViewProj, draws are sorted by their distance to cameraPosition
+    void updateCulling(const glm::mat4& cullingViewProj, const glm::vec3& cameraPosition, uint32_t frameIndex);
     void recordIndirectBufferCopies(VkCommandBuffer cmd, uint32_t frameIndex);
     uint32_t getVisibleCount(uint32_t frameIndex) const { return lastVisibleCount[frameIndex]; }
+    uint32_t getVisibleInstanceCount(uint32_t frameIndex) const { return lastVisibleInstanceCount[frameIndex]; }
+
+    // model matrix of every model by index, and the instance list updateCulling writes for the
+    // camera passes, one of each per frame. both are replaced whenever the batches are rebuilt,
+    // which bumps the revision
+    VkBuffer getTransformBuffer(uint32_t frameIndex) const { return transformBuffers[frameIndex].getBuffer(); }
+    VkBuffer getVisibleInstanceBuffer(uint32_t frameIndex) const { return visibleInstanceBuffers[frameIndex].getBuffer(); }
+    uint64_t getInstanceRevision() const { return instanceRevision; }
+
+    // the cpu side of updateCulling, static so it can be benchmarked without a device. the
+    // surviving draws are appended to visibleDraws with key, their instances to visibleInstances
+    // tagged with materialIndex, and each draw's firstInstance points at its run there. key has
+    // its depth bits clear: opaque draws (DrawSort::make) get their instances front to back and
+    // the nearest one's distance in the key, blended draws (DrawSort::makeBlended) their instances
+    // back to front and the farthest one's. pipeline is the DrawSort variant the draws are
+    // recorded with
+    static void cullDraws(const Frustum& frustum, const std::vector<IndirectDrawCommand>& drawCommands,
+        const TransformHierarchy& transforms, const glm::vec3& cameraPosition, uint64_t key, uint32_t pipeline,
+        bool blended, uint32_t materialIndex, std::vector<SortedDraw>& visibleDraws,
+        std::vector<VisibleInstance>& visibleInstances, CullScratch& scratch);
+
+    // world bounds of every model, and a counter bumped whenever the geometry changes
+    const AABB& getBounds() const { return bounds; }
+    uint64_t getGeometryRevision() const { return geometryRevision; }
 
 private:
     VmaAllocator allocator;
@@ -82,15 +143,56 @@ private:
     TextureManager* textureManager;
 
     std::vector<Model> models;
+    TransformHierarchy transforms;
     std::unordered_map<const MaterialManager::Material*, MaterialBatch> opaqueBatches;
+    std::unordered_map<const MaterialManager::Material*, MaterialBatch> cutoutBatches;
     std::unordered_map<const MaterialManager::Material*, MaterialBatch> transparentBatches;
+    IndirectArena indirectArena;
+    uint32_t drawRange = 0;
 
     GPUBuffer unifiedVertexBuffer;
+    GPUBuffer unifiedPositionBuffer;
     GPUBuffer unifiedIndexBuffer;
 
-    Frustum frustum;
-    uint32_t lastVisibleCount[MAX_FRAMES_IN_FLIGHT] = {0, 0};
+    GPUBuffer transformBuffers[MAX_FRAMES_IN_FLIGHT];
+    GPUBuffer visibleInstanceBuffers[MAX_FRAMES_IN_FLIGHT];
+    uint64_t instanceRevision = 0;
+    // bumped whenever a world transform changes, each frame's buffer is copied again once behind
+    uint64_t transformRevision = 0;
+    uint64_t uploadedTransformRevision[MAX_FRAMES_IN_FLIGHT] = {};
 
+    Frustum frustum;
+    uint32_t lastVisibleCount[MAX_FRAMES_IN_FLIGHT] = {};
+    uint32_t lastVisibleInstanceCount[MAX_FRAMES_IN_FLIGHT] = {};
+    std::vector<SortedDraw> culledDraws;
+    std::vector<SortedDraw> sortScratch;
+    std::vector<VkDrawIndexedIndirectCommand> culledCmds;
+    std::vector<VisibleInstance> culledInstances;
+    std::vector<DrawSegment> drawSegments[MAX_FRAMES_IN_FLIGHT];
+    CullScratch cullScratch;
+
+    AABB bounds;
+    uint64_t geometryRevision = 0;
+    size_t generatedModelCount = 0;
+
+    // drops the stress copies without rebuilding the batches
+    void removeGeneratedModels();
+    // erases the flagged models and their transform nodes
+    void eraseModels(const std::vector<uint8_t>& removed);
+    // scene bounds from the world bounds of every submesh
+    void computeBounds();
+    // destroys the mesh once no other model places it
+    void releaseMesh(Model& model);
+
+    // the buffers a rebuild destroys are still read by the other frames in flight, only the
+    // current frame's fence has been waited on when the ui changes the scene
+    void waitForFramesInFlight();
     void buildMaterialBatches();
-    void buildUnifiedBuffers();
+    // releases the batches and the indirect arena built from them
+    void destroyMaterialBatches();
+    void buildUnifiedBuffers(const std::vector<const Mesh*>& meshes);
+    // at least one element each, so the descriptors always point at a live buffer
+    void createInstanceBuffers(uint32_t transformCapacity, uint32_t instanceCapacity);
+    void uploadTransforms(uint32_t frameIndex);
+    void destroyInstanceBuffers();
 };
@@ -0,0 +1,62 @@
+#include "scene.hpp"
+#include <algorithm>
+#include <limits>
+
+// Scene::cullDraws touches no device state, so it is kept out of scene.cpp for the microbenchmarks
+
+void Scene::cullDraws(const Frustum& frustum, const std::vector<IndirectDrawCommand>& drawCommands,
+    const TransformHierarchy& transforms, const glm::vec3& cameraPosition, uint64_t key, uint32_t pipeline,
+    bool blended, uint32_t materialIndex, std::vector<SortedDraw>& visibleDraws,
+    std::vector<VisibleInstance>& visibleInstances, CullScratch& scratch) {
+
+    for (const auto& cmd : drawCommands) {
+        scratch.instances.clear();
+        float nearest = std::numeric_limits<float>::max();
+        float farthest = 0.0f;
+
+        for (uint32_t modelIndex : cmd.instances) {
+            if (modelIndex >= transforms.size()) continue;
+            if (cmd.submeshIndex >= transforms.getBoundsCount(modelIndex)) continue;
+
+            // world bounds are cached by the hierarchy, nothing is transformed here
+            const AABB& worldAABB = transforms.getWorldBounds(modelIndex, cmd.submeshIndex);
+            if (!frustum.testAABB(worldAABB)) continue;
+
+            glm::vec3 toCenter = worldAABB.getCenter() - cameraPosition;
+            float distance = glm::dot(toCenter, toCenter);
+            nearest = std::min(nearest, distance);
+            farthest = std::max(farthest, distance);
+            scratch.instances.emplace_back(distance, modelIndex);
+        }
+
+        uint32_t count = static_cast<uint32_t>(scratch.instances.size());
+        if (count == 0) continue;
+
+        // instances of one draw rasterize in order, so they are sorted as well: blended ones
+        // have to be drawn back to front, opaque ones front to back for early depth testing
+        if (blended) {
+            std::sort(scratch.instances.begin(), scratch.instances.end(),
+                [](const auto& a, const auto& b) { return a.first > b.first; });
+        }
+        else {
+            std::sort(scratch.instances.begin(), scratch.instances.end(),
+                [](const auto& a, const auto& b) { return a.first < b.first; });
+        }
+
+        SortedDraw draw{};
+        // once the list is sorted an opaque draw goes by its nearest instance, a blended one by
+        // its farthest, whose depth bits sit above the material (see DrawSort)
+        draw.key = blended ?
+            key | (static_cast<uint64_t>(~DrawSort::orderedDepth(farthest)) << DrawSort::MATERIAL_BITS) :
+            key | DrawSort::orderedDepth(nearest);
+        draw.command = cmd.indirectCommand;
+        draw.command.instanceCount = count;
+        draw.command.firstInstance = static_cast<uint32_t>(visibleInstances.size());
+        draw.pipeline = pipeline;
+        visibleDraws.push_back(draw);
+
+        for (const auto& [distance, modelIndex] : scratch.instances) {
+            visibleInstances.push_back({ modelIndex, materialIndex });
+        }
+    }
+}
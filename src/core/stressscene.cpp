@@ -0,0 +1,90 @@
+#include "stressscene.hpp"
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+void StressScene::buildSphere(uint32_t segments, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    segments = std::max(segments, 4u);
+    uint32_t rings = segments / 2;
+
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(static_cast<size_t>(segments + 1) * (rings + 1));
+    indices.reserve(static_cast<size_t>(segments) * rings * 6);
+
+    // the seam column is duplicated so the texture coordinates wrap
+    for (uint32_t ring = 0; ring <= rings; ring++) {
+        float v = static_cast<float>(ring) / static_cast<float>(rings);
+        float theta = v * glm::pi<float>();
+
+        for (uint32_t segment = 0; segment <= segments; segment++) {
+            float u = static_cast<float>(segment) / static_cast<float>(segments);
+            float phi = u * glm::two_pi<float>();
+
+            Vertex vertex{};
+            vertex.normal = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            vertex.pos = vertex.normal;
+            vertex.color = glm::vec3(1.0f);
+            vertex.texCoord = glm::vec2(u, v);
+            // direction of increasing u, undefined at the poles so any perpendicular works there
+            vertex.tangent = glm::vec4(-std::sin(phi), 0.0f, std::cos(phi), 1.0f);
+            vertices.push_back(vertex);
+        }
+    }
+
+    uint32_t stride = segments + 1;
+    for (uint32_t ring = 0; ring < rings; ring++) {
+        for (uint32_t segment = 0; segment < segments; segment++) {
+            uint32_t a = ring * stride + segment;
+            uint32_t b = a + stride;
+
+            indices.push_back(a);
+            indices.push_back(a + 1);
+            indices.push_back(b);
+
+            indices.push_back(a + 1);
+            indices.push_back(b + 1);
+            indices.push_back(b);
+        }
+    }
+}
+
+std::vector<glm::mat4> StressScene::buildTransforms(const StressSceneSettings& settings, float cellSize) {
+    std::vector<glm::mat4> transforms;
+    transforms.reserve(settings.count);
+
+    std::mt19937 rng(settings.seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    float cell = cellSize * settings.spacing;
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(settings.count))));
+    float halfWidth = static_cast<float>(side) * cell * 0.5f;
+    float minScale = std::min(settings.minScale, settings.maxScale);
+    float maxScale = std::max(settings.minScale, settings.maxScale);
+
+    for (uint32_t i = 0; i < settings.count; i++) {
+        glm::vec3 position;
+        if (settings.layout == StressSceneSettings::GRID) {
+            position.x = (static_cast<float>(i % side) + 0.5f) * cell - halfWidth;
+            position.y = 0.0f;
+            position.z = (static_cast<float>(i / side) + 0.5f) * cell - halfWidth;
+        }
+        else {
+            position.x = (unit(rng) * 2.0f - 1.0f) * halfWidth;
+            position.y = unit(rng) * cell * 4.0f;
+            position.z = (unit(rng) * 2.0f - 1.0f) * halfWidth;
+        }
+
+        float yaw = unit(rng) * glm::two_pi<float>();
+        float scale = minScale + unit(rng) * (maxScale - minScale);
+
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+        transform = glm::rotate(transform, yaw, glm::vec3(0.0f, 1.0f, 0.0f));
+        transform = glm::scale(transform, glm::vec3(scale));
+        transforms.push_back(transform);
+    }
+
+    return transforms;
+}
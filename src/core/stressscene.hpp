@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "../renderer/vertex.hpp"
+#include <cstdint>
+#include <vector>
+
+// startup (--stress N) or the Scene Settings window
+struct StressSceneSettings {
+    enum Layout {
+        GRID = 0,   // a square grid on the ground plane
+        RANDOM      // scattered over the same area, at random heights
+    };
+
+    enum Source {
+        LOADED_MODELS = 0,  // round robin over the loaded models, a sphere when there are none
+        SPHERE              // a generated high polygon sphere
+    };
+
+    uint32_t count = 0;             // copies to place, 0 generates nothing
+    Layout layout = GRID;
+    Source source = LOADED_MODELS;
+    float spacing = 1.5f;           // distance between copies, in multiples of the largest source size
+    float minScale = 0.5f;
+    float maxScale = 1.5f;
+    bool randomMaterials = true;    // each copy draws with materials picked from all loaded ones
+    uint32_t sphereSegments = 128;  // around the sphere, with half as many rings
+    uint32_t seed = 1;
+};
+
+/*
+    Geometry and layout for the stress scene. The copies themselves are placed by
+    Scene::generateStressScene as instances of the source meshes.
+*/
+class StressScene {
+public:
+    // uv sphere of radius 1 with segments * segments / 2 quads
+    static void buildSphere(uint32_t segments, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    // one transform per copy, cellSize is the size of the largest source
+    static std::vector<glm::mat4> buildTransforms(const StressSceneSettings& settings, float cellSize);
+};
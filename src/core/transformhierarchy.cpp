@@ -0,0 +1,230 @@
+#include "transformhierarchy.hpp"
+#include <algorithm>
+#include <execution>
+#include <stdexcept>
+
+uint32_t TransformHierarchy::addNode(const glm::mat4& localTransform, const std::vector<AABB>& bounds, uint32_t parent) {
+    if (parent != NO_PARENT && parent >= size()) {
+        throw std::runtime_error("transform parent out of range");
+    }
+
+    uint32_t node = static_cast<uint32_t>(size());
+    localTransforms.push_back(localTransform);
+    worldTransforms.push_back(localTransform);
+    parents.push_back(parent);
+    dirty.push_back(1);
+    boundsOffsets.push_back(static_cast<uint32_t>(localBounds.size()));
+    boundsCounts.push_back(static_cast<uint32_t>(bounds.size()));
+    localBounds.insert(localBounds.end(), bounds.begin(), bounds.end());
+    worldBounds.insert(worldBounds.end(), bounds.begin(), bounds.end());
+
+    orderValid = false;
+    pending = true;
+    return node;
+}
+
+void TransformHierarchy::removeNodes(const std::vector<uint8_t>& removed) {
+    size_t count = size();
+    std::vector<uint32_t> remap(count, NO_PARENT);
+    uint32_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i >= removed.size() || !removed[i]) {
+            remap[i] = kept++;
+        }
+    }
+    if (kept == count) {
+        return;
+    }
+
+    // orphans are re-parented against the old arrays, before anything moves
+    for (size_t i = 0; i < count; i++) {
+        uint32_t parent = parents[i];
+        if (remap[i] == NO_PARENT || parent == NO_PARENT || remap[parent] != NO_PARENT) continue;
+
+        uint32_t ancestor = parent;
+        while (ancestor != NO_PARENT && remap[ancestor] == NO_PARENT) {
+            ancestor = parents[ancestor];
+        }
+
+        glm::mat4 world = computeWorldTransform(static_cast<uint32_t>(i));
+        localTransforms[i] = ancestor == NO_PARENT ? world : glm::inverse(computeWorldTransform(ancestor)) * world;
+        parents[i] = ancestor;
+        dirty[i] = 1;
+    }
+
+    std::vector<AABB> keptLocalBounds;
+    std::vector<AABB> keptWorldBounds;
+    keptLocalBounds.reserve(localBounds.size());
+    keptWorldBounds.reserve(worldBounds.size());
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t target = remap[i];
+        if (target == NO_PARENT) continue;
+
+        uint32_t offset = boundsOffsets[i];
+        uint32_t boundsCount = boundsCounts[i];
+        localTransforms[target] = localTransforms[i];
+        worldTransforms[target] = worldTransforms[i];
+        parents[target] = parents[i] == NO_PARENT ? NO_PARENT : remap[parents[i]];
+        dirty[target] = dirty[i];
+        boundsOffsets[target] = static_cast<uint32_t>(keptLocalBounds.size());
+        boundsCounts[target] = boundsCount;
+        keptLocalBounds.insert(keptLocalBounds.end(), localBounds.begin() + offset, localBounds.begin() + offset + boundsCount);
+        keptWorldBounds.insert(keptWorldBounds.end(), worldBounds.begin() + offset, worldBounds.begin() + offset + boundsCount);
+    }
+
+    localTransforms.resize(kept);
+    worldTransforms.resize(kept);
+    parents.resize(kept);
+    dirty.resize(kept);
+    boundsOffsets.resize(kept);
+    boundsCounts.resize(kept);
+    localBounds = std::move(keptLocalBounds);
+    worldBounds = std::move(keptWorldBounds);
+
+    orderValid = false;
+    pending = true;
+}
+
+void TransformHierarchy::clear() {
+    localTransforms.clear();
+    worldTransforms.clear();
+    parents.clear();
+    dirty.clear();
+    boundsOffsets.clear();
+    boundsCounts.clear();
+    localBounds.clear();
+    worldBounds.clear();
+    order.clear();
+    levelStarts.clear();
+    orderValid = true;
+    pending = false;
+}
+
+void TransformHierarchy::setLocalTransform(uint32_t node, const glm::mat4& localTransform) {
+    localTransforms[node] = localTransform;
+    dirty[node] = 1;
+    pending = true;
+}
+
+void TransformHierarchy::setParent(uint32_t node, uint32_t parent) {
+    if (node >= size() || (parent != NO_PARENT && parent >= size())) {
+        throw std::runtime_error("transform node out of range");
+    }
+    if (parents[node] == parent) {
+        return;
+    }
+
+    for (uint32_t ancestor = parent; ancestor != NO_PARENT; ancestor = parents[ancestor]) {
+        if (ancestor == node) {
+            throw std::runtime_error("transform parent would create a cycle");
+        }
+    }
+
+    glm::mat4 world = computeWorldTransform(node);
+    localTransforms[node] = parent == NO_PARENT ? world : glm::inverse(computeWorldTransform(parent)) * world;
+    parents[node] = parent;
+    dirty[node] = 1;
+
+    orderValid = false;
+    pending = true;
+}
+
+uint32_t TransformHierarchy::update(bool parallel) {
+    if (!pending) {
+        return 0;
+    }
+    if (!orderValid) {
+        rebuildOrder();
+    }
+
+    // a node picks up its parent's dirty flag, the parent's level is finished by then
+    for (size_t level = 0; level + 1 < levelStarts.size(); level++) {
+        auto begin = order.begin() + levelStarts[level];
+        auto end = order.begin() + levelStarts[level + 1];
+
+        if (parallel && static_cast<size_t>(end - begin) >= PARALLEL_LEVEL_SIZE) {
+            std::for_each(std::execution::par, begin, end, [this](uint32_t node) { updateNode(node); });
+        }
+        else {
+            for (auto it = begin; it != end; ++it) {
+                updateNode(*it);
+            }
+        }
+    }
+
+    uint32_t changed = 0;
+    for (uint8_t& flag : dirty) {
+        changed += flag;
+        flag = 0;
+    }
+    pending = false;
+    return changed;
+}
+
+void TransformHierarchy::updateNode(uint32_t node) {
+    uint32_t parent = parents[node];
+    if (parent != NO_PARENT && dirty[parent]) {
+        dirty[node] = 1;
+    }
+    if (!dirty[node]) {
+        return;
+    }
+
+    glm::mat4& world = worldTransforms[node];
+    world = parent == NO_PARENT ? localTransforms[node] : worldTransforms[parent] * localTransforms[node];
+
+    uint32_t offset = boundsOffsets[node];
+    for (uint32_t i = 0; i < boundsCounts[node]; i++) {
+        worldBounds[offset + i] = localBounds[offset + i].transform(world);
+    }
+}
+
+glm::mat4 TransformHierarchy::computeWorldTransform(uint32_t node) const {
+    glm::mat4 world = localTransforms[node];
+    for (uint32_t ancestor = parents[node]; ancestor != NO_PARENT; ancestor = parents[ancestor]) {
+        world = localTransforms[ancestor] * world;
+    }
+    return world;
+}
+
+void TransformHierarchy::rebuildOrder() {
+    size_t count = size();
+    constexpr uint32_t UNKNOWN = UINT32_MAX;
+    std::vector<uint32_t> depths(count, UNKNOWN);
+    std::vector<uint32_t> chain;
+    uint32_t levelCount = 0;
+
+    // each chain is walked up to the first node whose depth is already known
+    for (uint32_t i = 0; i < count; i++) {
+        chain.clear();
+        uint32_t node = i;
+        while (node != NO_PARENT && depths[node] == UNKNOWN) {
+            chain.push_back(node);
+            node = parents[node];
+        }
+
+        uint32_t depth = node == NO_PARENT ? 0 : depths[node] + 1;
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            depths[*it] = depth++;
+        }
+        levelCount = std::max(levelCount, depth);
+    }
+
+    // counting sort keeps index order within a level
+    levelStarts.assign(levelCount + 1, 0);
+    for (uint32_t depth : depths) {
+        levelStarts[depth + 1]++;
+    }
+    for (uint32_t level = 0; level < levelCount; level++) {
+        levelStarts[level + 1] += levelStarts[level];
+    }
+
+    std::vector<uint32_t> cursor(levelStarts.begin(), levelStarts.end() - 1);
+    order.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        order[cursor[depths[i]]++] = i;
+    }
+
+    orderValid = true;
+}
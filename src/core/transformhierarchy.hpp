@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "../ui/primitives/aabb.hpp"
+#include <cstdint>
+#include <vector>
+
+/*
+    Parent/child transforms of the scene's models, node i belongs to model i. Every property is
+    an array of its own so the update walks contiguous memory: local and world matrices, parent
+    indices, dirty flags, and the mesh space bounds of every node's submeshes next to their
+    cached world space boxes. Setting a transform or a parent only marks the node, update()
+    recomputes the world matrix and world bounds of marked nodes and of everything below them.
+    Nodes are visited level by level, so a parent is always done before its children and the
+    nodes of one level are independent of each other.
+*/
+class TransformHierarchy {
+public:
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+    // levels smaller than this are not worth handing to other threads
+    static constexpr size_t PARALLEL_LEVEL_SIZE = 4096;
+
+    TransformHierarchy() = default;
+
+    // returns the new node's index, bounds are per submesh in mesh space
+    uint32_t addNode(const glm::mat4& localTransform, const std::vector<AABB>& bounds, uint32_t parent = NO_PARENT);
+    // removes the nodes flagged in removed and compacts the arrays in order. children of a removed
+    // node move up to its parent and keep their world transform
+    void removeNodes(const std::vector<uint8_t>& removed);
+    void clear();
+
+    // relative to the parent, or to the world for roots
+    void setLocalTransform(uint32_t node, const glm::mat4& localTransform);
+    // keeps the node where it is in the world, throws when parent is the node or one of its descendants
+    void setParent(uint32_t node, uint32_t parent);
+
+    // recomputes what changed since the last update, returns how many nodes got a new world
+    // transform. with parallel set, large levels are split across threads
+    uint32_t update(bool parallel);
+
+    size_t size() const { return parents.size(); }
+    uint32_t getParent(uint32_t node) const { return parents[node]; }
+    const glm::mat4& getLocalTransform(uint32_t node) const { return localTransforms[node]; }
+
+    // world values are as of the last update
+    const glm::mat4& getWorldTransform(uint32_t node) const { return worldTransforms[node]; }
+    const std::vector<glm::mat4>& getWorldTransforms() const { return worldTransforms; }
+    uint32_t getBoundsCount(uint32_t node) const { return boundsCounts[node]; }
+    const AABB& getWorldBounds(uint32_t node, uint32_t submesh) const { return worldBounds[boundsOffsets[node] + submesh]; }
+
+    // world boxes of all submeshes of all nodes, node by node
+    const std::vector<AABB>& getAllWorldBounds() const { return worldBounds; }
+
+private:
+    std::vector<glm::mat4> localTransforms;
+    std::vector<glm::mat4> worldTransforms;
+    std::vector<uint32_t> parents;
+    std::vector<uint8_t> dirty;
+    std::vector<uint32_t> boundsOffsets;
+    std::vector<uint32_t> boundsCounts;
+    std::vector<AABB> localBounds;
+    std::vector<AABB> worldBounds;
+
+    // node indices sorted by depth, levelStarts[d] is where depth d begins. rebuilt on the next
+    // update after the parents changed
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> levelStarts;
+    bool orderValid = true;
+    // something was marked since the last update
+    bool pending = false;
+
+    // walks the local transforms up to the root, for changes made between updates
+    glm::mat4 computeWorldTransform(uint32_t node) const;
+    void rebuildOrder();
+    void updateNode(uint32_t node);
+};
@@ -1,13 +1,96 @@
 #include "core/application.hpp"
 #include "ui/consolecapture.hpp"
+#include "core/cpuprofiler.hpp"
 #include <iostream>
 #include <exception>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
 
-int main() {
-    ConsoleCapture::getInstance().startCapture();
+int main(int argc, char** argv) {
+    RenderSettings settings;
+    BenchmarkSettings benchmarkSettings;
+    StressSceneSettings stressSettings;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--compact-gbuffer") == 0) {
+            settings.compactGBuffer = true;
+        }
+        else if (std::strcmp(argv[i], "--dynamic-resolution") == 0) {
+            settings.dynamicResolution = true;
+        }
+        else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+            int frames = std::atoi(argv[++i]);
+            settings.framesInFlight = static_cast<uint32_t>(std::clamp(frames, 1, static_cast<int>(MAX_FRAMES_IN_FLIGHT)));
+        }
+        else if (std::strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc) {
+            i++;
+            if (std::strcmp(argv[i], "fifo") == 0) settings.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+            else if (std::strcmp(argv[i], "fifo-relaxed") == 0) settings.presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+            else if (std::strcmp(argv[i], "mailbox") == 0) settings.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+            else if (std::strcmp(argv[i], "immediate") == 0) settings.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            else std::cout << "unknown present mode: " << argv[i] << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--fps-limit") == 0 && i + 1 < argc) {
+            float limit = static_cast<float>(std::atof(argv[++i]));
+            settings.frameRateLimit = limit > 0.0f ? limit : 0.0f;
+        }
+        else if (std::strcmp(argv[i], "--serial-recording") == 0) {
+            settings.parallelRecording = false;
+        }
+        else if (std::strcmp(argv[i], "--recording-threads") == 0 && i + 1 < argc) {
+            int threads = std::atoi(argv[++i]);
+            settings.recordingThreads = threads > 0 ? static_cast<uint32_t>(threads) : 0;
+        }
+        else if (std::strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+            benchmarkSettings.enabled = true;
+            benchmarkSettings.scenePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            int frames = std::atoi(argv[++i]);
+            benchmarkSettings.frames = frames > 0 ? static_cast<uint32_t>(frames) : benchmarkSettings.frames;
+        }
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            benchmarkSettings.outputPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--camera-path") == 0 && i + 1 < argc) {
+            benchmarkSettings.cameraPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--stress") == 0 && i + 1 < argc) {
+            // copies of the benchmark scene, or of a generated sphere when nothing is loaded
+            int count = std::atoi(argv[++i]);
+            stressSettings.count = count > 0 ? static_cast<uint32_t>(count) : 0;
+        }
+        else if (std::strcmp(argv[i], "--stress-layout") == 0 && i + 1 < argc) {
+            i++;
+            stressSettings.layout = std::strcmp(argv[i], "random") == 0 ? StressSceneSettings::RANDOM : StressSceneSettings::GRID;
+        }
+        else if (std::strcmp(argv[i], "--stress-sphere") == 0 && i + 1 < argc) {
+            int segments = std::atoi(argv[++i]);
+            stressSettings.source = StressSceneSettings::SPHERE;
+            stressSettings.sphereSegments = segments > 0 ? static_cast<uint32_t>(segments) : stressSettings.sphereSegments;
+        }
+        else if (std::strcmp(argv[i], "--cpu-capture") == 0 && i + 1 < argc) {
+            // captures the first N frames into a chrome trace file
+            int frames = std::atoi(argv[++i]);
+#ifdef ENABLE_CPU_PROFILER
+            CpuProfiler::getInstance().requestCapture(frames > 0 ? static_cast<uint32_t>(frames) : 0);
+#else
+            std::cout << "--cpu-capture ignored, built without ENABLE_CPU_PROFILER" << std::endl;
+            (void)frames;
+#endif
+        }
+        else {
+            std::cout << "unknown argument: " << argv[i] << std::endl;
+        }
+    }
+
+    // the benchmark has no ui to show the console in
+    if (!benchmarkSettings.enabled) {
+        ConsoleCapture::getInstance().startCapture();
+    }
 
     try {
-        Application app;
+        Application app(settings, benchmarkSettings, stressSettings);
         app.run();
     }
     catch (const std::exception& e) {
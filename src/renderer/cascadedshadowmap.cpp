@@ -0,0 +1,663 @@
+#include "cascadedshadowmap.hpp"
+#include "shadermanager.hpp"
+#include "commandbuffer.hpp"
+#include "vertex.hpp"
+#include "../core/scene.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+CascadedShadowMap::CascadedShadowMap(VkDevice device, VmaAllocator allocator, VkFormat depthFormat,
+    ShaderManager* shaderManager, MaterialManager* materialManager, CommandBuffer* commandBuffer)
+    : device(device)
+    , depthFormat(depthFormat)
+    , image(VK_NULL_HANDLE)
+    , imageAllocation(VK_NULL_HANDLE)
+    , arrayView(VK_NULL_HANDLE)
+    , layerViews{}
+    , sampler(VK_NULL_HANDLE)
+    , renderPass(VK_NULL_HANDLE)
+    , framebuffers{}
+    , pipelineLayout(VK_NULL_HANDLE)
+    , pipeline(VK_NULL_HANDLE)
+    , cutoutPipeline(VK_NULL_HANDLE)
+    , instanceList(device)
+    , cascadeCount(0)
+    , renderedRevision{}
+    , renderedValid{}
+{
+    createImage(allocator, commandBuffer);
+    createSampler();
+    createRenderPass();
+    createFramebuffers();
+    createPipelines(shaderManager, materialManager);
+
+    std::cout << "cascaded shadow map created (" << MAX_CASCADES << " x " << RESOLUTION << "x" << RESOLUTION << ")" << std::endl;
+}
+
+CascadedShadowMap::~CascadedShadowMap() {
+}
+
+void CascadedShadowMap::cleanup(VmaAllocator allocator) {
+    if (pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, pipeline, nullptr);
+        pipeline = VK_NULL_HANDLE;
+    }
+
+    if (cutoutPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, cutoutPipeline, nullptr);
+        cutoutPipeline = VK_NULL_HANDLE;
+    }
+
+    if (pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        pipelineLayout = VK_NULL_HANDLE;
+    }
+
+    for (uint32_t i = 0; i < MAX_CASCADES; i++) {
+        if (framebuffers[i] != VK_NULL_HANDLE) {
+            vkDestroyFramebuffer(device, framebuffers[i], nullptr);
+            framebuffers[i] = VK_NULL_HANDLE;
+        }
+        if (layerViews[i] != VK_NULL_HANDLE) {
+            vkDestroyImageView(device, layerViews[i], nullptr);
+            layerViews[i] = VK_NULL_HANDLE;
+        }
+    }
+
+    if (renderPass != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(device, renderPass, nullptr);
+        renderPass = VK_NULL_HANDLE;
+    }
+
+    if (sampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, sampler, nullptr);
+        sampler = VK_NULL_HANDLE;
+    }
+
+    if (arrayView != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, arrayView, nullptr);
+        arrayView = VK_NULL_HANDLE;
+    }
+
+    if (image != VK_NULL_HANDLE) {
+        vmaDestroyImage(allocator, image, imageAllocation);
+        image = VK_NULL_HANDLE;
+        imageAllocation = VK_NULL_HANDLE;
+    }
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        indirectBuffers[i].destroy(allocator);
+        drawLists[i].clear();
+    }
+    instanceList.cleanup(allocator);
+}
+
+void CascadedShadowMap::createImage(VmaAllocator allocator, CommandBuffer* commandBuffer) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = { RESOLUTION, RESOLUTION, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = MAX_CASCADES;
+    imageInfo.format = depthFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    if (vmaCreateImage(allocator, &imageInfo, &allocInfo, &image, &imageAllocation, nullptr) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow map image");
+    }
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    viewInfo.format = depthFormat;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = MAX_CASCADES;
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &arrayView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow map view");
+    }
+
+    for (uint32_t i = 0; i < MAX_CASCADES; i++) {
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.subresourceRange.baseArrayLayer = i;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &layerViews[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow map layer view");
+        }
+    }
+
+    // every layer starts out readable, cascades that are never rendered are simply unused
+    VkCommandBuffer cmd = commandBuffer->beginSingleTimeCommands();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = MAX_CASCADES;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    commandBuffer->endSingleTimeCommands(cmd);
+}
+
+void CascadedShadowMap::createSampler() {
+    // hardware depth comparison, bilinear filtering gives 2x2 pcf per tap
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.0f;
+    samplerInfo.compareEnable = VK_TRUE;
+    samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow map sampler");
+    }
+}
+
+void CascadedShadowMap::createRenderPass() {
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkAttachmentReference depthRef{};
+    depthRef.attachment = 0;
+    depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 0;
+    subpass.pDepthStencilAttachment = &depthRef;
+
+    VkSubpassDependency dependencies[2]{};
+
+    // wait for earlier frames to finish sampling the layer before overwriting it
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // make the depth visible to the lighting pass
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &depthAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 2;
+    renderPassInfo.pDependencies = dependencies;
+
+    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow render pass");
+    }
+}
+
+void CascadedShadowMap::createFramebuffers() {
+    for (uint32_t i = 0; i < MAX_CASCADES; i++) {
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &layerViews[i];
+        framebufferInfo.width = RESOLUTION;
+        framebufferInfo.height = RESOLUTION;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow framebuffer");
+        }
+    }
+}
+
+void CascadedShadowMap::createPipelines(ShaderManager* shaderManager, MaterialManager* materialManager) {
+    VkPipelineShaderStageCreateInfo shaderStages[2]{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = shaderManager->getShaderModule("shadow_vert.spv");
+    shaderStages[0].pName = "main";
+
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = shaderManager->getShaderModule("shadow_cutout_frag.spv");
+    shaderStages[1].pName = "main";
+
+    // position and texture coordinate only, the rest of the vertex is skipped
+    auto bindingDescription = Vertex::getBindingDescription();
+
+    VkVertexInputAttributeDescription attributeDescriptions[2]{};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[0].offset = offsetof(Vertex, pos);
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[1].offset = offsetof(Vertex, texCoord);
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = 2;
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // not flipped, shadow map uvs are ndc * 0.5 + 0.5
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(RESOLUTION);
+    viewport.height = static_cast<float>(RESOLUTION);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = { RESOLUTION, RESOLUTION };
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.pViewports = &viewport;
+    viewportState.scissorCount = 1;
+    viewportState.pScissors = &scissor;
+
+    // two sided with slope scaled bias against acne
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_TRUE;
+    rasterizer.depthBiasConstantFactor = 1.25f;
+    rasterizer.depthBiasClamp = 0.0f;
+    rasterizer.depthBiasSlopeFactor = 1.75f;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 0;
+
+    // set 0 for the material (cutout alpha), set 1 for the instances, push constant for the cascade matrix
+    VkDescriptorSetLayout setLayouts[] = { materialManager->getDescriptorSetLayout(), instanceList.getDescriptorSetLayout() };
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(glm::mat4);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow pipeline layout");
+    }
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = nullptr;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = nullptr;
+    pipelineInfo.basePipelineIndex = -1;
+
+    if (vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineInfo, nullptr, &cutoutPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow cutout pipeline");
+    }
+
+    // opaque casters write depth only, no fragment shader
+    pipelineInfo.stageCount = 1;
+
+    if (vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow pipeline");
+    }
+
+    std::cout << "shadow pipelines created" << std::endl;
+}
+
+void CascadedShadowMap::invalidate() {
+    for (uint32_t i = 0; i < MAX_CASCADES; i++) {
+        renderedValid[i] = false;
+    }
+}
+
+void CascadedShadowMap::fitCascades(const DirectionalLight* light, const glm::mat4& view, const glm::mat4& proj,
+    float nearPlane, float farPlane, const Scene* scene) {
+    // camera frustum corners on the near and far plane, in world space
+    glm::mat4 invViewProj = glm::inverse(proj * view);
+    glm::vec3 nearCorners[4];
+    glm::vec3 farCorners[4];
+    for (int i = 0; i < 4; i++) {
+        glm::vec2 ndc((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f);
+        glm::vec4 nearPoint = invViewProj * glm::vec4(ndc, 0.0f, 1.0f);
+        glm::vec4 farPoint = invViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+        nearCorners[i] = glm::vec3(nearPoint) / nearPoint.w;
+        farCorners[i] = glm::vec3(farPoint) / farPoint.w;
+    }
+
+    // the light looks along its direction from the world origin, only the projection moves
+    glm::vec3 lightDir = glm::normalize(light->getDirection());
+    glm::vec3 up = std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+
+    // depth range covers every caster in the scene, it only changes with the geometry
+    AABB bounds = scene->getBounds();
+    float minZ = std::numeric_limits<float>::max();
+    float maxZ = -std::numeric_limits<float>::max();
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner((i & 1) ? bounds.max.x : bounds.min.x,
+            (i & 2) ? bounds.max.y : bounds.min.y,
+            (i & 4) ? bounds.max.z : bounds.min.z);
+        float z = (lightView * glm::vec4(corner, 1.0f)).z;
+        minZ = std::min(minZ, z);
+        maxZ = std::max(maxZ, z);
+    }
+    float zNear = -maxZ - 1.0f;
+    float zFar = -minZ + 1.0f;
+
+    float shadowDistance = std::min(light->getShadowDistance(), farPlane);
+    float lambda = light->getSplitLambda();
+    float splitStart = nearPlane;
+
+    for (uint32_t c = 0; c < cascadeCount; c++) {
+        // practical split scheme
+        float fraction = static_cast<float>(c + 1) / static_cast<float>(cascadeCount);
+        float logSplit = nearPlane * std::pow(shadowDistance / nearPlane, fraction);
+        float uniformSplit = nearPlane + (shadowDistance - nearPlane) * fraction;
+        float splitEnd = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+
+        // the 8 corners of this slice, interpolated along the frustum edges
+        float t0 = (splitStart - nearPlane) / (farPlane - nearPlane);
+        float t1 = (splitEnd - nearPlane) / (farPlane - nearPlane);
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int i = 0; i < 4; i++) {
+            corners[i] = glm::mix(nearCorners[i], farCorners[i], t0);
+            corners[i + 4] = glm::mix(nearCorners[i], farCorners[i], t1);
+            center += corners[i] + corners[i + 4];
+        }
+        center /= 8.0f;
+
+        // bounding sphere keeps the cascade size constant while the camera rotates
+        float radius = 0.0f;
+        for (int i = 0; i < 8; i++) {
+            radius = std::max(radius, glm::length(corners[i] - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // snap the center to whole texels so the projection only moves in texel steps
+        float texelSize = 2.0f * radius / static_cast<float>(RESOLUTION);
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+        lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+        glm::mat4 lightProj = glm::ortho(lightCenter.x - radius, lightCenter.x + radius,
+            lightCenter.y - radius, lightCenter.y + radius, zNear, zFar);
+
+        cascades[c].viewProj = lightProj * lightView;
+        cascades[c].splitDepth = splitEnd;
+        cascades[c].texelSize = texelSize;
+
+        splitStart = splitEnd;
+    }
+}
+
+void CascadedShadowMap::update(VmaAllocator allocator, uint32_t currentFrame, const DirectionalLight* light,
+    const glm::mat4& view, const glm::mat4& proj, float nearPlane, float farPlane, const Scene* scene) {
+    drawLists[currentFrame].clear();
+
+    if (!light->isEnabled() || !light->getCastShadows() || !scene || !scene->hasUnifiedBuffers()) {
+        cascadeCount = 0;
+        return;
+    }
+
+    uint32_t count = static_cast<uint32_t>(std::clamp(light->getCascadeCount(), 1, static_cast<int>(MAX_CASCADES)));
+    if (count != cascadeCount) {
+        cascadeCount = count;
+        invalidate();
+    }
+
+    fitCascades(light, view, proj, nearPlane, farPlane, scene);
+
+    // only cascades whose projection or casters changed are rendered again
+    commandScratch.clear();
+    instanceScratch.clear();
+    for (uint32_t c = 0; c < cascadeCount; c++) {
+        bool cached = renderedValid[c] &&
+            renderedRevision[c] == scene->getGeometryRevision() &&
+            renderedViewProj[c] == cascades[c].viewProj;
+        if (cached) {
+            continue;
+        }
+
+        collectCasters(currentFrame, c, scene);
+
+        renderedViewProj[c] = cascades[c].viewProj;
+        renderedRevision[c] = scene->getGeometryRevision();
+        renderedValid[c] = true;
+    }
+
+    if (commandScratch.empty()) {
+        return;
+    }
+
+    VkDeviceSize requiredSize = commandScratch.size() * sizeof(VkDrawIndexedIndirectCommand);
+    if (indirectBuffers[currentFrame].getSize() < requiredSize) {
+        // this frame's previous use already finished, the in flight fence waited for it
+        indirectBuffers[currentFrame].destroy(allocator);
+        indirectBuffers[currentFrame].create(allocator, requiredSize * 2,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU,
+            nullptr, nullptr);
+    }
+
+    void* data;
+    vmaMapMemory(allocator, indirectBuffers[currentFrame].getAllocation(), &data);
+    memcpy(data, commandScratch.data(), requiredSize);
+    vmaUnmapMemory(allocator, indirectBuffers[currentFrame].getAllocation());
+
+    instanceList.upload(allocator, currentFrame, instanceScratch,
+        scene->getTransformBuffer(currentFrame), scene->getInstanceRevision());
+}
+
+void CascadedShadowMap::collectCasters(uint32_t currentFrame, uint32_t cascade, const Scene* scene) {
+    Frustum frustum;
+    frustum.extractFromViewProj(cascades[cascade].viewProj);
+
+    // one draw per submesh with the instances inside the cascade
+    const TransformHierarchy& transforms = scene->getTransforms();
+    auto appendVisible = [&](const MaterialBatch& batch) {
+        uint32_t first = static_cast<uint32_t>(commandScratch.size());
+        for (const auto& cmd : batch.drawCommands) {
+            uint32_t firstInstance = static_cast<uint32_t>(instanceScratch.size());
+            for (uint32_t modelIndex : cmd.instances) {
+                if (modelIndex >= transforms.size() || cmd.submeshIndex >= transforms.getBoundsCount(modelIndex)) continue;
+
+                if (frustum.testAABB(transforms.getWorldBounds(modelIndex, cmd.submeshIndex))) {
+                    instanceScratch.push_back(modelIndex);
+                }
+            }
+
+            uint32_t instanceCount = static_cast<uint32_t>(instanceScratch.size()) - firstInstance;
+            if (instanceCount > 0) {
+                VkDrawIndexedIndirectCommand draw = cmd.indirectCommand;
+                draw.instanceCount = instanceCount;
+                draw.firstInstance = firstInstance;
+                commandScratch.push_back(draw);
+            }
+        }
+        return DrawRange{ batch.material, first, static_cast<uint32_t>(commandScratch.size()) - first };
+    };
+
+    CascadeDrawList drawList{};
+    drawList.cascade = cascade;
+
+    // every opaque material shares the depth only pipeline, so they become one draw range
+    drawList.opaque.material = nullptr;
+    drawList.opaque.firstCommand = static_cast<uint32_t>(commandScratch.size());
+    for (const auto& [material, batch] : scene->getOpaqueBatches()) {
+        appendVisible(batch);
+    }
+    drawList.opaque.commandCount = static_cast<uint32_t>(commandScratch.size()) - drawList.opaque.firstCommand;
+
+    for (const auto& [material, batch] : scene->getCutoutBatches()) {
+        if (!material || material->descriptorSet == VK_NULL_HANDLE) continue;
+
+        DrawRange range = appendVisible(batch);
+        if (range.commandCount > 0) {
+            drawList.cutouts.push_back(range);
+        }
+    }
+
+    drawLists[currentFrame].push_back(std::move(drawList));
+}
+
+void CascadedShadowMap::recordShadowPasses(VkCommandBuffer commandBuffer, uint32_t currentFrame, const Scene* scene, PassDrawStats& stats) {
+    if (drawLists[currentFrame].empty() || !scene || !scene->hasUnifiedBuffers()) {
+        return;
+    }
+
+    VkBuffer indirectBuffer = indirectBuffers[currentFrame].getBuffer();
+    const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    for (const CascadeDrawList& drawList : drawLists[currentFrame]) {
+        VkClearValue clearValue{};
+        clearValue.depthStencil = { 1.0f, 0 };
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = renderPass;
+        renderPassInfo.framebuffer = framebuffers[drawList.cascade];
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = { RESOLUTION, RESOLUTION };
+        renderPassInfo.clearValueCount = 1;
+        renderPassInfo.pClearValues = &clearValue;
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        scene->bindUnifiedBuffers(commandBuffer);
+
+        VkDescriptorSet instanceSet = instanceList.getDescriptorSet(currentFrame);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout, 1, 1, &instanceSet, 0, nullptr);
+        stats.descriptorBinds++;
+
+        const glm::mat4& viewProj = cascades[drawList.cascade].viewProj;
+
+        if (drawList.opaque.commandCount > 0) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                0, sizeof(glm::mat4), &viewProj);
+            vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer,
+                drawList.opaque.firstCommand * stride, drawList.opaque.commandCount, stride);
+            stats.pipelineBinds++;
+            stats.drawCalls++;
+            stats.draws += drawList.opaque.commandCount;
+        }
+
+        if (!drawList.cutouts.empty()) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, cutoutPipeline);
+            stats.pipelineBinds++;
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                0, sizeof(glm::mat4), &viewProj);
+
+            for (const DrawRange& range : drawList.cutouts) {
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    pipelineLayout, 0, 1, &range.material->descriptorSet, 0, nullptr);
+                vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer,
+                    range.firstCommand * stride, range.commandCount, stride);
+                stats.descriptorBinds++;
+                stats.drawCalls++;
+                stats.draws += range.commandCount;
+            }
+        }
+
+        vkCmdEndRenderPass(commandBuffer);
+    }
+}
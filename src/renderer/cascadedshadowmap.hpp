@@ -0,0 +1,118 @@
+#pragma once
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <Vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include "gpubuffer.hpp"
+#include "instancelist.hpp"
+#include "materialmanager.hpp"
+#include "drawsort.hpp"
+#include "../core/directionallight.hpp"
+#include "vk_mem_alloc.h"
+#include <vector>
+#include "framesinflight.hpp"
+
+class Scene;
+class ShaderManager;
+class CommandBuffer;
+
+/*
+    Cascaded shadow maps for the directional light. The camera range up to the light's shadow
+    distance is split into cascades (practical split: a blend of logarithmic and uniform) and each
+    cascade is rendered into one layer of a depth array texture.
+    Every cascade is fitted to a bounding sphere and its origin snapped to whole texels, so its
+    projection only changes when the camera moves by at least a texel. A cascade is kept from
+    earlier frames and only re-rendered when that projection or the static geometry changes.
+*/
+class CascadedShadowMap {
+public:
+    static constexpr uint32_t MAX_CASCADES = DirectionalLight::MAX_SHADOW_CASCADES;
+    static constexpr uint32_t RESOLUTION = 2048;
+
+    struct Cascade {
+        glm::mat4 viewProj = glm::mat4(1.0f);
+        float splitDepth = 0.0f;    // view depth where this cascade ends
+        float texelSize = 0.0f;     // world units covered by one shadow map texel
+    };
+
+    CascadedShadowMap(VkDevice device, VmaAllocator allocator, VkFormat depthFormat,
+        ShaderManager* shaderManager, MaterialManager* materialManager, CommandBuffer* commandBuffer);
+    ~CascadedShadowMap();
+
+    CascadedShadowMap(const CascadedShadowMap&) = delete;
+    CascadedShadowMap& operator=(const CascadedShadowMap&) = delete;
+
+    void cleanup(VmaAllocator allocator);
+
+    // fits the cascades to the camera, then culls casters for the cascades that need re-rendering
+    void update(VmaAllocator allocator, uint32_t currentFrame, const DirectionalLight* light,
+        const glm::mat4& view, const glm::mat4& proj, float nearPlane, float farPlane, const Scene* scene);
+
+    // renders the cascades update() marked for this frame, the rest keep last frame's contents
+    void recordShadowPasses(VkCommandBuffer commandBuffer, uint32_t currentFrame, const Scene* scene, PassDrawStats& stats);
+
+    // forces every cascade to re-render on the next update
+    void invalidate();
+
+    bool isActive() const { return cascadeCount > 0; }
+    uint32_t getCascadeCount() const { return cascadeCount; }
+    const Cascade& getCascade(uint32_t index) const { return cascades[index]; }
+    uint32_t getRenderedCascadeCount(uint32_t frame) const { return static_cast<uint32_t>(drawLists[frame].size()); }
+
+    VkImageView getArrayView() const { return arrayView; }
+    VkSampler getSampler() const { return sampler; }
+
+private:
+    // a range of draws in this frame's indirect buffer
+    struct DrawRange {
+        const MaterialManager::Material* material;
+        uint32_t firstCommand;
+        uint32_t commandCount;
+    };
+
+    // casters of one cascade that is re-rendered this frame
+    struct CascadeDrawList {
+        uint32_t cascade;
+        DrawRange opaque;
+        std::vector<DrawRange> cutouts;
+    };
+
+    VkDevice device;
+    VkFormat depthFormat;
+
+    VkImage image;
+    VmaAllocation imageAllocation;
+    VkImageView arrayView;
+    VkImageView layerViews[MAX_CASCADES];
+    VkSampler sampler;
+
+    VkRenderPass renderPass;
+    VkFramebuffer framebuffers[MAX_CASCADES];
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+    VkPipeline cutoutPipeline;
+
+    GPUBuffer indirectBuffers[MAX_FRAMES_IN_FLIGHT];
+    InstanceList instanceList;
+    std::vector<CascadeDrawList> drawLists[MAX_FRAMES_IN_FLIGHT];
+    std::vector<VkDrawIndexedIndirectCommand> commandScratch;
+    std::vector<uint32_t> instanceScratch;
+
+    uint32_t cascadeCount;
+    Cascade cascades[MAX_CASCADES];
+
+    // what each layer currently holds
+    glm::mat4 renderedViewProj[MAX_CASCADES];
+    uint64_t renderedRevision[MAX_CASCADES];
+    bool renderedValid[MAX_CASCADES];
+
+    void createImage(VmaAllocator allocator, CommandBuffer* commandBuffer);
+    void createSampler();
+    void createRenderPass();
+    void createFramebuffers();
+    void createPipelines(ShaderManager* shaderManager, MaterialManager* materialManager);
+
+    void fitCascades(const DirectionalLight* light, const glm::mat4& view, const glm::mat4& proj,
+        float nearPlane, float farPlane, const Scene* scene);
+    void collectCasters(uint32_t currentFrame, uint32_t cascade, const Scene* scene);
+};
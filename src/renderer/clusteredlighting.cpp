@@ -0,0 +1,311 @@
+#include "clusteredlighting.hpp"
+#include "shadermanager.hpp"
+#include "pointshadowmap.hpp"
+#include "../core/pointlight.hpp"
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+ClusteredLighting::ClusteredLighting(VkDevice device, VmaAllocator allocator, ShaderManager* shaderManager)
+    : device(device)
+    , lightCounts{}
+    , boundShadowViews{}
+    , descriptorSetLayout(VK_NULL_HANDLE)
+    , descriptorPool(VK_NULL_HANDLE)
+    , pipelineLayout(VK_NULL_HANDLE)
+    , pipeline(VK_NULL_HANDLE)
+{
+    createBuffers(allocator);
+    createDescriptorSetLayout();
+    createDescriptorPool();
+    createDescriptorSets();
+    createPipeline(shaderManager);
+}
+
+ClusteredLighting::~ClusteredLighting() {
+}
+
+void ClusteredLighting::cleanup(VmaAllocator allocator) {
+    if (pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, pipeline, nullptr);
+        pipeline = VK_NULL_HANDLE;
+    }
+
+    if (pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        pipelineLayout = VK_NULL_HANDLE;
+    }
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        paramBuffers[i].destroy(allocator);
+        lightBuffers[i].destroy(allocator);
+        clusterBuffers[i].destroy(allocator);
+    }
+
+    if (descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        descriptorPool = VK_NULL_HANDLE;
+    }
+
+    if (descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        descriptorSetLayout = VK_NULL_HANDLE;
+    }
+}
+
+void ClusteredLighting::createBuffers(VmaAllocator allocator) {
+    // per cluster light count followed by a fixed slot of MAX_LIGHTS_PER_CLUSTER indices per cluster
+    VkDeviceSize clusterBufferSize = sizeof(uint32_t) * CLUSTER_COUNT * (1 + MAX_LIGHTS_PER_CLUSTER);
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        paramBuffers[i].create(
+            allocator,
+            sizeof(ClusterParamsUBO),
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU,
+            nullptr,
+            nullptr
+        );
+
+        lightBuffers[i].create(
+            allocator,
+            sizeof(PointLightData) * PointLight::MAX_LIGHTS,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU,
+            nullptr,
+            nullptr
+        );
+
+        clusterBuffers[i].create(
+            allocator,
+            clusterBufferSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            nullptr,
+            nullptr
+        );
+    }
+}
+
+void ClusteredLighting::createDescriptorSetLayout() {
+    VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutBinding paramsBinding{};
+    paramsBinding.binding = 0;
+    paramsBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    paramsBinding.descriptorCount = 1;
+    paramsBinding.stageFlags = stages;
+    paramsBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding lightsBinding{};
+    lightsBinding.binding = 1;
+    lightsBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    lightsBinding.descriptorCount = 1;
+    lightsBinding.stageFlags = stages;
+    lightsBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding clustersBinding{};
+    clustersBinding.binding = 2;
+    clustersBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    clustersBinding.descriptorCount = 1;
+    clustersBinding.stageFlags = stages;
+    clustersBinding.pImmutableSamplers = nullptr;
+
+    // the primary light's shadow cube, only read by the lighting shaders
+    VkDescriptorSetLayoutBinding shadowBinding{};
+    shadowBinding.binding = 3;
+    shadowBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    shadowBinding.descriptorCount = 1;
+    shadowBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shadowBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding bindings[] = { paramsBinding, lightsBinding, clustersBinding, shadowBinding };
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 4;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cluster descriptor set layout");
+    }
+}
+
+void ClusteredLighting::createDescriptorPool() {
+    VkDescriptorPoolSize poolSizes[3]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = 2 * MAX_FRAMES_IN_FLIGHT;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[2].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+    poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cluster descriptor pool");
+    }
+}
+
+void ClusteredLighting::createDescriptorSets() {
+    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+    allocInfo.pSetLayouts = layouts.data();
+
+    descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate cluster descriptor sets");
+    }
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        VkDescriptorBufferInfo paramsInfo{};
+        paramsInfo.buffer = paramBuffers[i].getBuffer();
+        paramsInfo.offset = 0;
+        paramsInfo.range = sizeof(ClusterParamsUBO);
+
+        VkDescriptorBufferInfo lightsInfo{};
+        lightsInfo.buffer = lightBuffers[i].getBuffer();
+        lightsInfo.offset = 0;
+        lightsInfo.range = VK_WHOLE_SIZE;
+
+        VkDescriptorBufferInfo clustersInfo{};
+        clustersInfo.buffer = clusterBuffers[i].getBuffer();
+        clustersInfo.offset = 0;
+        clustersInfo.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet descriptorWrites[3]{};
+
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = descriptorSets[i];
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].dstArrayElement = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pBufferInfo = &paramsInfo;
+
+        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[1].dstSet = descriptorSets[i];
+        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].dstArrayElement = 0;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[1].descriptorCount = 1;
+        descriptorWrites[1].pBufferInfo = &lightsInfo;
+
+        descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[2].dstSet = descriptorSets[i];
+        descriptorWrites[2].dstBinding = 2;
+        descriptorWrites[2].dstArrayElement = 0;
+        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[2].descriptorCount = 1;
+        descriptorWrites[2].pBufferInfo = &clustersInfo;
+
+        vkUpdateDescriptorSets(device, 3, descriptorWrites, 0, nullptr);
+    }
+}
+
+void ClusteredLighting::createPipeline(ShaderManager* shaderManager) {
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cluster build pipeline layout");
+    }
+
+    VkPipelineShaderStageCreateInfo stageInfo{};
+    stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stageInfo.module = shaderManager->getShaderModule("cluster_build_comp.spv");
+    stageInfo.pName = "main";
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = stageInfo;
+    pipelineInfo.layout = pipelineLayout;
+
+    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cluster build pipeline");
+    }
+}
+
+void ClusteredLighting::update(VmaAllocator allocator, uint32_t currentFrame, const PointLight* lights,
+    const glm::mat4& view, const glm::mat4& proj, VkExtent2D extent, float nearPlane, float farPlane,
+    const PointShadowMap* pointShadowMap) {
+    // the shadow map switches cubes when its resolution tier changes, this frame's set is
+    // no longer in use so it can be rewritten here
+    if (boundShadowViews[currentFrame] != pointShadowMap->getCubeView()) {
+        VkDescriptorImageInfo shadowInfo{};
+        shadowInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        shadowInfo.imageView = pointShadowMap->getCubeView();
+        shadowInfo.sampler = pointShadowMap->getSampler();
+
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = descriptorSets[currentFrame];
+        descriptorWrite.dstBinding = 3;
+        descriptorWrite.dstArrayElement = 0;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pImageInfo = &shadowInfo;
+
+        vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+        boundShadowViews[currentFrame] = pointShadowMap->getCubeView();
+    }
+
+    void* data;
+    vmaMapMemory(allocator, lightBuffers[currentFrame].getAllocation(), &data);
+    lightCounts[currentFrame] = lights->gatherLights(static_cast<PointLightData*>(data), PointLight::MAX_LIGHTS);
+    vmaUnmapMemory(allocator, lightBuffers[currentFrame].getAllocation());
+
+    // slice = log(viewDepth) * scale - bias gives exponentially growing slices from near to far
+    float logRatio = std::log(farPlane / nearPlane);
+
+    ClusterParamsUBO params{};
+    params.view = view;
+    params.invProj = glm::inverse(proj);
+    params.gridSize = glm::uvec4(GRID_X, GRID_Y, GRID_Z, lightCounts[currentFrame]);
+    params.screen = glm::vec4(
+        std::ceil(static_cast<float>(extent.width) / GRID_X),
+        std::ceil(static_cast<float>(extent.height) / GRID_Y),
+        static_cast<float>(extent.width),
+        static_cast<float>(extent.height));
+    params.depth = glm::vec4(nearPlane, farPlane, GRID_Z / logRatio, GRID_Z * std::log(nearPlane) / logRatio);
+
+    // gatherLights() puts the primary light first, so it is the one the cube belongs to
+    bool primaryShadow = pointShadowMap->isActive() && lights->isEnabled() && lightCounts[currentFrame] > 0;
+    params.pointShadow = glm::vec4(primaryShadow ? 1.0f : 0.0f,
+        PointShadowMap::NEAR_PLANE, pointShadowMap->getFarPlane(), 0.0005f);
+
+    vmaMapMemory(allocator, paramBuffers[currentFrame].getAllocation(), &data);
+    memcpy(data, &params, sizeof(params));
+    vmaUnmapMemory(allocator, paramBuffers[currentFrame].getAllocation());
+}
+
+void ClusteredLighting::recordClusterBuild(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+    // the previous use of this frame's cluster buffer was the fragment reads two frames ago,
+    // which the in flight fence already waited for
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+        0, 1, &descriptorSets[currentFrame], 0, nullptr);
+
+    uint32_t groupCount = (CLUSTER_COUNT + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+    vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include "gpubuffer.hpp"
+#include "vk_mem_alloc.h"
+#include <vector>
+#include "framesinflight.hpp"
+
+class ShaderManager;
+class PointLight;
+class PointShadowMap;
+
+// std140 layout, matches ClusterParams in shaders/clusters.glsl
+struct ClusterParamsUBO {
+    alignas(16) glm::mat4 view;
+    alignas(16) glm::mat4 invProj;
+    alignas(16) glm::uvec4 gridSize;    // xyz: cluster grid, w: light count
+    alignas(16) glm::vec4 screen;       // xy: tile size in pixels, zw: screen size in pixels
+    alignas(16) glm::vec4 depth;        // x: near, y: far, z: slice scale, w: slice bias
+    alignas(16) glm::vec4 pointShadow;  // x: 1 when pointLights[0] casts a shadow, y: near, z: far, w: depth bias
+};
+
+/*
+    Clustered point lighting. The view frustum is split into a GRID_X * GRID_Y grid of screen
+    tiles and GRID_Z exponential depth slices. Every frame a compute pass tests each light's
+    range sphere against every cluster's view space bounds and writes the indices of the lights
+    touching it, so the lighting and forward passes only loop over the lights of their pixel's cluster.
+    The descriptor set is shared by the compute pass and the fragment shaders (set 3), it also
+    carries the primary light's shadow cube.
+*/
+class ClusteredLighting {
+public:
+    static constexpr uint32_t GRID_X = 16;
+    static constexpr uint32_t GRID_Y = 9;
+    static constexpr uint32_t GRID_Z = 24;
+    static constexpr uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+    static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+    static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+    ClusteredLighting(VkDevice device, VmaAllocator allocator, ShaderManager* shaderManager);
+    ~ClusteredLighting();
+
+    ClusteredLighting(const ClusteredLighting&) = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    void cleanup(VmaAllocator allocator);
+
+    // uploads the lights and the cluster parameters for this frame, and points the shadow
+    // binding at whichever cube the shadow map currently uses
+    void update(VmaAllocator allocator, uint32_t currentFrame, const PointLight* lights,
+        const glm::mat4& view, const glm::mat4& proj, VkExtent2D extent, float nearPlane, float farPlane,
+        const PointShadowMap* pointShadowMap);
+
+    // bins the lights into clusters, the results are visible to fragment shaders afterwards
+    void recordClusterBuild(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+    VkDescriptorSet getDescriptorSet(uint32_t frame) const { return descriptorSets[frame]; }
+    uint32_t getLightCount(uint32_t frame) const { return lightCounts[frame]; }
+
+private:
+    VkDevice device;
+
+    GPUBuffer paramBuffers[MAX_FRAMES_IN_FLIGHT];
+    GPUBuffer lightBuffers[MAX_FRAMES_IN_FLIGHT];
+    GPUBuffer clusterBuffers[MAX_FRAMES_IN_FLIGHT];
+    uint32_t lightCounts[MAX_FRAMES_IN_FLIGHT];
+    VkImageView boundShadowViews[MAX_FRAMES_IN_FLIGHT];
+
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorPool descriptorPool;
+    std::vector<VkDescriptorSet> descriptorSets;
+
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+
+    void createBuffers(VmaAllocator allocator);
+    void createDescriptorSetLayout();
+    void createDescriptorPool();
+    void createDescriptorSets();
+    void createPipeline(ShaderManager* shaderManager);
+};
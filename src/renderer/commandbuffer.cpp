@@ -4,21 +4,76 @@
 #include "../core/scene.hpp"
 #include "materialmanager.hpp"
 #include "indirectdrawing.hpp"
+#include "framegraph.hpp"
+#include "clusteredlighting.hpp"
+#include "cascadedshadowmap.hpp"
+#include "pointshadowmap.hpp"
+#include "geometrypassstats.hpp"
+#include "gpuprofiler.hpp"
+#include "parallelrecorder.hpp"
+#include "../core/cpuprofiler.hpp"
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 
-CommandBuffer::CommandBuffer(VkDevice device, uint32_t graphicsQueueFamily, VkQueue graphicsQueue)
-    : device(device), commandPool(VK_NULL_HANDLE), graphicsQueue(graphicsQueue) {
+static const char* DRAW_PASS_NAMES[CommandBuffer::DRAW_PASS_COUNT] = {
+    "prepass",
+    "geometry",
+    "forward",
+    "shadows",
+};
+
+// every part of the g-buffer pass runs its own statistics query
+static_assert(ParallelRecorder::MAX_WORKERS <= GeometryPassStats::MAX_PARTS, "a part per recording thread needs a query each");
+
+// a pass's segments and the commands they cover, both one contiguous run of the sorted list
+struct PassCommands {
+    size_t firstSegment = 0;
+    size_t endSegment = 0;
+    uint32_t firstCommand = 0;
+    uint32_t endCommand = 0;
+};
+
+// segments past the commands the arena kept are left out, and the last one is cut to them
+static PassCommands findPassCommands(const Scene* scene, uint32_t frameIndex, uint32_t pass) {
+    IndirectDraws draws = scene->getDraws(frameIndex);
+    const std::vector<DrawSegment>& segments = scene->getDrawSegments(frameIndex);
+
+    PassCommands range;
+    while (range.firstSegment < segments.size() && segments[range.firstSegment].pass != pass) range.firstSegment++;
+    range.endSegment = range.firstSegment;
+    while (range.endSegment < segments.size() && segments[range.endSegment].pass == pass &&
+        segments[range.endSegment].firstCommand < draws.count) {
+        range.endSegment++;
+    }
+
+    if (range.endSegment > range.firstSegment) {
+        const DrawSegment& last = segments[range.endSegment - 1];
+        range.firstCommand = segments[range.firstSegment].firstCommand;
+        range.endCommand = std::min(last.firstCommand + last.count, draws.count);
+    }
+    return range;
+}
+
+const char* CommandBuffer::getDrawPassName(DrawPass pass) {
+    return DRAW_PASS_NAMES[pass];
+}
+
+CommandBuffer::CommandBuffer(VkDevice device, uint32_t graphicsQueueFamily, VkQueue graphicsQueue, uint32_t recordingThreads)
+    : device(device), commandPool(VK_NULL_HANDLE), graphicsQueue(graphicsQueue), passStats{} {
 
     createCommandPool(graphicsQueueFamily);
     createCommandBuffers();
     createSyncObjects();
+    recorder = std::make_unique<ParallelRecorder>(device, graphicsQueueFamily, recordingThreads);
 
     std::cout << "command buffer created" << std::endl;
 }
 
 //destructor
 CommandBuffer::~CommandBuffer() {
+    recorder.reset();
+
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
@@ -77,31 +132,75 @@ void CommandBuffer::createSyncObjects() {
 
 }
 
-void CommandBuffer::recordGeometryPass(VkCommandBuffer commandBuffer, uint32_t imageIndex,
-    uint32_t frameIndex, VkRenderPass renderPass, const std::vector<VkFramebuffer>& framebuffers,
-    VkExtent2D extent, VkPipeline pipeline, VkPipelineLayout pipelineLayout,
-    VkDescriptorSet descriptorSet, MaterialManager* materialManager, Scene* scene) {
+void CommandBuffer::addPassStats(DrawPass pass, const PassDrawStats& stats) {
+    std::lock_guard<std::mutex> lock(passStatsMutex);
+    passStats[pass].pipelineBinds += stats.pipelineBinds;
+    passStats[pass].descriptorBinds += stats.descriptorBinds;
+    passStats[pass].drawCalls += stats.drawCalls;
+    passStats[pass].draws += stats.draws;
+}
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = framebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = extent;
+uint32_t CommandBuffer::getPartCount(const Scene* scene, uint32_t frameIndex, uint32_t pass) const {
+    if (!scene || !scene->hasUnifiedBuffers()) {
+        return 1;
+    }
 
-    std::array<VkClearValue, 4> clearValues{};
-    clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };  // albedo
-    clearValues[1].color = { {0.0f, 0.0f, 0.0f, 1.0f} };  // normal
-    clearValues[2].color = { {1.0f, 0.0f, 0.0f, 0.0f} };  // roughness (default 1.0)
-    clearValues[3].depthStencil = { 1.0f, 0 };
+    // segments only break on a new pipeline variant, so a pass has a handful of them however
+    // many draws it holds. the parts split its commands instead
+    PassCommands range = findPassCommands(scene, frameIndex, pass);
+    uint32_t parts = (range.endCommand - range.firstCommand) / MIN_COMMANDS_PER_PART;
+    return std::clamp(parts, 1u, recorder->getWorkerCount());
+}
 
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassInfo.pClearValues = clearValues.data();
+void CommandBuffer::recordDepthPrepass(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t part, uint32_t partCount,
+    VkExtent2D extent, VkPipeline pipeline, VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet, Scene* scene) {
+
+    if (!scene || !scene->hasUnifiedBuffers()) {
+        return;
+    }
+
+    // every part is its own command buffer and starts without any state bound
+    PassDrawStats stats;
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
         pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    stats.descriptorBinds++;
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = static_cast<float>(extent.height);
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = -static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    scene->bindUnifiedPositionBuffers(commandBuffer);
+
+    // the geometry pass's default variants only, all with the one depth pipeline: cutouts need
+    // their alpha texture to know their depth and are drawn with depth writes in the g-buffer
+    // pass instead
+    recordSortedDraws(commandBuffer, frameIndex, scene, DrawSort::PASS_GEOMETRY, part, partCount,
+        [pipeline](uint32_t variant) {
+            return DrawSort::getPipelineKind(variant) == DrawSort::PIPELINE_DEFAULT ? pipeline : VK_NULL_HANDLE;
+        }, stats);
+    addPassStats(DRAW_PASS_PREPASS, stats);
+}
+
+void CommandBuffer::recordGeometryPass(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t part, uint32_t partCount,
+    VkExtent2D extent, const PipelineSelector& selectPipeline, VkPipelineLayout pipelineLayout,
+    VkDescriptorSet descriptorSet, MaterialManager* materialManager, Scene* scene) {
+
+    PassDrawStats stats;
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    stats.descriptorBinds++;
 
     VkViewport viewport{};
     viewport.x = 0.0f;
@@ -121,68 +220,23 @@ void CommandBuffer::recordGeometryPass(VkCommandBuffer commandBuffer, uint32_t i
         // bind unified vertex/index buffers once for all draws
         scene->bindUnifiedBuffers(commandBuffer);
 
-        const auto& materialBatches = scene->getMaterialBatches();
-
-        for (const auto& [material, batch] : materialBatches) {
-            if (material && material->descriptorSet != VK_NULL_HANDLE) {
-                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    pipelineLayout, 1, 1, &material->descriptorSet, 0, nullptr);
-
-                // push constants
-                struct MaterialPushConstants {
-                    glm::vec4 diffuseColor;
-                    uint32_t hasTexture;
-                    uint32_t hasNormalMap;
-                    float dissolve;
-                    float roughness;
-                } pushConstants;
-
-                pushConstants.diffuseColor = material->diffuseColor;
-                pushConstants.hasTexture = material->hasTexture ? 1u : 0u;
-                pushConstants.hasNormalMap = material->hasNormalMap ? 1u : 0u;
-                pushConstants.dissolve = material->dissolve;
-                pushConstants.roughness = material->roughness;
-
-                vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
-                    0, sizeof(MaterialPushConstants), &pushConstants);
-            }
-
-            uint32_t visibleCount = batch.getVisibleCount(frameIndex);
-            if (visibleCount > 0) {
-                vkCmdDrawIndexedIndirect(
-                    commandBuffer,
-                    batch.getIndirectBuffer(frameIndex),
-                    0,
-                    visibleCount,
-                    sizeof(VkDrawIndexedIndirectCommand)
-                );
-            }
-        }
-    }
+        // every material at once, each draw finds its own through its instances
+        VkDescriptorSet materialSet = materialManager->getBindlessDescriptorSet();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout, 1, 1, &materialSet, 0, nullptr);
+        stats.descriptorBinds++;
 
-    vkCmdEndRenderPass(commandBuffer);
+        // the key puts alpha tested materials after the opaques so those keep early-z
+        recordSortedDraws(commandBuffer, frameIndex, scene, DrawSort::PASS_GEOMETRY, part, partCount, selectPipeline, stats);
+    }
+    addPassStats(DRAW_PASS_GEOMETRY, stats);
 }
 
-void CommandBuffer::recordLightingPass(VkCommandBuffer commandBuffer, uint32_t imageIndex,
-    VkRenderPass renderPass, const std::vector<VkFramebuffer>& framebuffers,
+void CommandBuffer::recordLightingPass(VkCommandBuffer commandBuffer,
     VkExtent2D extent, VkPipeline pipeline, VkPipelineLayout pipelineLayout,
     VkDescriptorSet cameraDescriptorSet, VkDescriptorSet gbufferDescriptorSet,
-    VkDescriptorSet lightDescriptorSet, VkDescriptorSet pointLightDescriptorSet) {
-
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = framebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = extent;
-
-    VkClearValue clearValue{};
-    clearValue.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+    VkDescriptorSet lightDescriptorSet, VkDescriptorSet clusterDescriptorSet) {
 
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearValue;
-
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -192,7 +246,7 @@ void CommandBuffer::recordLightingPass(VkCommandBuffer commandBuffer, uint32_t i
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
         pipelineLayout, 2, 1, &lightDescriptorSet, 0, nullptr);
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout, 3, 1, &pointLightDescriptorSet, 0, nullptr);
+        pipelineLayout, 3, 1, &clusterDescriptorSet, 0, nullptr);
 
     VkViewport viewport{};
     viewport.x = 0.0f;
@@ -209,43 +263,34 @@ void CommandBuffer::recordLightingPass(VkCommandBuffer commandBuffer, uint32_t i
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
     vkCmdDraw(commandBuffer, 3, 1, 0, 0);
-
-    vkCmdEndRenderPass(commandBuffer);
 }
 
-void CommandBuffer::recordForwardPass(VkCommandBuffer commandBuffer, uint32_t imageIndex,
-    uint32_t frameIndex, VkRenderPass renderPass, const std::vector<VkFramebuffer>& framebuffers,
-    VkExtent2D extent, VkPipeline pipeline, VkPipelineLayout pipelineLayout,
+void CommandBuffer::recordForwardPass(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t part, uint32_t partCount,
+    VkExtent2D extent, const PipelineSelector& selectPipeline, VkPipelineLayout pipelineLayout,
     VkDescriptorSet cameraDescriptorSet, VkDescriptorSet lightDescriptorSet,
-    VkDescriptorSet pointLightDescriptorSet, Scene* scene, const glm::mat4& viewProj) {
-
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = framebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = extent;
-
-    renderPassInfo.clearValueCount = 0;
-    renderPassInfo.pClearValues = nullptr;
-
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    VkDescriptorSet clusterDescriptorSet, MaterialManager* materialManager, Scene* scene) {
 
     // only if we have transparent objects
     if (scene && scene->hasTransparentObjects() && scene->hasUnifiedBuffers()) {
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        PassDrawStats stats;
 
         // bind camera descriptor set
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
             pipelineLayout, 0, 1, &cameraDescriptorSet, 0, nullptr);
 
+        // bind the bindless material set
+        VkDescriptorSet materialSet = materialManager->getBindlessDescriptorSet();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout, 1, 1, &materialSet, 0, nullptr);
+
         // bind light descriptor set
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
             pipelineLayout, 2, 1, &lightDescriptorSet, 0, nullptr);
 
         // bind point light descriptor set
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout, 3, 1, &pointLightDescriptorSet, 0, nullptr);
+            pipelineLayout, 3, 1, &clusterDescriptorSet, 0, nullptr);
+        stats.descriptorBinds += 4;
 
         VkViewport viewport{};
         viewport.x = 0.0f;
@@ -264,65 +309,59 @@ void CommandBuffer::recordForwardPass(VkCommandBuffer commandBuffer, uint32_t im
         // bind unified vertex/index buffers
         scene->bindUnifiedBuffers(commandBuffer);
 
-        // get sorted transparent batches
-        auto sortedBatches = scene->getSortedTransparentBatches(viewProj);
-
-        for (const auto& [material, batch] : sortedBatches) {
-            if (material && material->descriptorSet != VK_NULL_HANDLE) {
-                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    pipelineLayout, 1, 1, &material->descriptorSet, 0, nullptr);
-
-                struct MaterialPushConstants {
-                    glm::vec4 diffuseColor;
-                    uint32_t hasTexture;
-                    uint32_t hasNormalMap;
-                    float dissolve;
-                    float roughness;
-                } pushConstants;
-
-                pushConstants.diffuseColor = material->diffuseColor;
-                pushConstants.hasTexture = material->hasTexture ? 1u : 0u;
-                pushConstants.hasNormalMap = material->hasNormalMap ? 1u : 0u;
-                pushConstants.dissolve = material->dissolve;
-                pushConstants.roughness = material->roughness;
-
-                vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
-                    0, sizeof(MaterialPushConstants), &pushConstants);
-
-                uint32_t visibleCount = batch->getVisibleCount(frameIndex);
-                if (visibleCount > 0) {
-                    vkCmdDrawIndexedIndirect(
-                        commandBuffer,
-                        batch->getIndirectBuffer(frameIndex),
-                        0,
-                        visibleCount,
-                        sizeof(VkDrawIndexedIndirectCommand)
-                    );
-                }
-            }
-        }
+        // already in back to front order, one draw for every transparent submesh. the order
+        // decides, so neighbouring batches of different variants rebind. the parts are
+        // consecutive slices and executed in order, which keeps it
+        recordSortedDraws(commandBuffer, frameIndex, scene, DrawSort::PASS_FORWARD, part, partCount, selectPipeline, stats);
+        addPassStats(DRAW_PASS_FORWARD, stats);
     }
+}
+
+void CommandBuffer::recordSortedDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, const Scene* scene,
+    uint32_t pass, uint32_t part, uint32_t partCount, const PipelineSelector& selectPipeline, PassDrawStats& stats) {
+
+    IndirectDraws draws = scene->getDraws(frameIndex);
+    const std::vector<DrawSegment>& segments = scene->getDrawSegments(frameIndex);
+    const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+
+    // the part's slice of the pass's commands. a segment across a slice boundary is drawn by both
+    // parts, each multi-draw cut to the commands on its side
+    PassCommands range = findPassCommands(scene, frameIndex, pass);
+    uint64_t commands = range.endCommand - range.firstCommand;
+    uint32_t partFirst = range.firstCommand + static_cast<uint32_t>(commands * part / partCount);
+    uint32_t partEnd = range.firstCommand + static_cast<uint32_t>(commands * (part + 1) / partCount);
+
+    for (size_t i = range.firstSegment; i < range.endSegment; i++) {
+        const DrawSegment& segment = segments[i];
+
+        // segments are in command order, anything the arena dropped is not drawn
+        if (segment.firstCommand >= partEnd) break;
+        uint32_t first = std::max(segment.firstCommand, partFirst);
+        uint32_t end = std::min({ segment.firstCommand + segment.count, partEnd, draws.count });
+        if (first >= end) continue;
+        uint32_t count = end - first;
+
+        VkPipeline segmentPipeline = selectPipeline(segment.pipeline);
+        if (segmentPipeline == VK_NULL_HANDLE) continue;
+
+        if (segmentPipeline != boundPipeline) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, segmentPipeline);
+            boundPipeline = segmentPipeline;
+            stats.pipelineBinds++;
+        }
 
-    vkCmdEndRenderPass(commandBuffer);
+        vkCmdDrawIndexedIndirect(commandBuffer, draws.buffer, draws.offset + first * stride,
+            count, stride);
+        stats.drawCalls++;
+        stats.draws += count;
+    }
 }
 
-void CommandBuffer::recordDebugPass(VkCommandBuffer commandBuffer, uint32_t imageIndex,
-    VkRenderPass renderPass, const std::vector<VkFramebuffer>& framebuffers,
+void CommandBuffer::recordDebugPass(VkCommandBuffer commandBuffer,
     VkExtent2D extent, VkPipeline pipeline, VkPipelineLayout pipelineLayout,
     VkDescriptorSet cameraDescriptorSet, DebugDraw* debugDraw) {
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = framebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = extent;
-
-    renderPassInfo.clearValueCount = 0;
-    renderPassInfo.pClearValues = nullptr;
-
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
     if (debugDraw && debugDraw->hasLines()) {
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
@@ -346,50 +385,19 @@ void CommandBuffer::recordDebugPass(VkCommandBuffer commandBuffer, uint32_t imag
         debugDraw->bind(commandBuffer);
         debugDraw->draw(commandBuffer);
     }
-
-    vkCmdEndRenderPass(commandBuffer);
 }
 
-void CommandBuffer::recordImGuiPass(VkCommandBuffer commandBuffer, uint32_t imageIndex,
-    VkRenderPass renderPass, const std::vector<VkFramebuffer>& framebuffers,
-    VkExtent2D extent, ImGuiLayer* imguiLayer) {
-
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = framebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = extent;
-
-    renderPassInfo.clearValueCount = 0;
-    renderPassInfo.pClearValues = nullptr;
-
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
+void CommandBuffer::recordImGuiPass(VkCommandBuffer commandBuffer, ImGuiLayer* imguiLayer) {
     if (imguiLayer) {
         imguiLayer->render(commandBuffer);
     }
-
-    vkCmdEndRenderPass(commandBuffer);
 }
 
 void CommandBuffer::recordFrame(VkCommandBuffer commandBuffer, uint32_t imageIndex,
-    uint32_t frameIndex, VkExtent2D extent,
-    VkRenderPass geometryRenderPass, const std::vector<VkFramebuffer>& geometryFramebuffers,
-    VkPipeline geometryPipeline, VkPipelineLayout geometryPipelineLayout,
-    VkDescriptorSet cameraDescriptorSet, MaterialManager* materialManager, Scene* scene,
-    VkRenderPass lightingRenderPass, const std::vector<VkFramebuffer>& lightingFramebuffers,
-    VkPipeline lightingPipeline, VkPipelineLayout lightingPipelineLayout,
-    VkDescriptorSet gbufferDescriptorSet, VkDescriptorSet lightDescriptorSet,
-    VkDescriptorSet pointLightDescriptorSet,
-    VkRenderPass forwardRenderPass, const std::vector<VkFramebuffer>& forwardFramebuffers,
-    VkPipeline forwardPipeline, VkPipelineLayout forwardPipelineLayout,
-    const glm::mat4& viewProj,
-    VkRenderPass debugRenderPass, const std::vector<VkFramebuffer>& debugFramebuffers,
-    VkPipeline debugPipeline, VkPipelineLayout debugPipelineLayout,
-    DebugDraw* debugDraw,
-    VkRenderPass imguiRenderPass, const std::vector<VkFramebuffer>& imguiFramebuffers,
-    ImGuiLayer* imguiLayer) {
+    uint32_t frameIndex, Scene* scene, CascadedShadowMap* shadowMap, PointShadowMap* pointShadowMap,
+        ClusteredLighting* clusteredLighting, GeometryPassStats* geometryStats,
+        GpuProfiler* gpuProfiler, FrameGraph* frameGraph, bool parallelRecording) {
+    CPU_PROFILE_ZONE("CommandBuffer::recordFrame");
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -400,27 +408,55 @@ void CommandBuffer::recordFrame(VkCommandBuffer commandBuffer, uint32_t imageInd
         throw std::runtime_error("failed to begin recording command buffer!");
     }
 
+    for (PassDrawStats& stats : passStats) {
+        stats = PassDrawStats{};
+    }
+
+    // this frame's fence was waited on, its secondaries from the last time round are done
+    if (parallelRecording) {
+        recorder->beginFrame(frameIndex);
+    }
+
+    // timestamp queries have to be reset outside the render pass
+    gpuProfiler->reset(commandBuffer, frameIndex);
+    gpuProfiler->begin(commandBuffer, frameIndex, GpuProfiler::FRAME);
+
+    gpuProfiler->begin(commandBuffer, frameIndex, GpuProfiler::COPIES);
     if (scene) {
         scene->recordIndirectBufferCopies(commandBuffer, frameIndex);
     }
+    gpuProfiler->end(commandBuffer, frameIndex, GpuProfiler::COPIES);
+
+    gpuProfiler->begin(commandBuffer, frameIndex, GpuProfiler::SHADOWS);
+
+    // cascades that are still valid keep their contents from earlier frames
+    if (shadowMap) {
+        shadowMap->recordShadowPasses(commandBuffer, frameIndex, scene, passStats[DRAW_PASS_SHADOWS]);
+    }
 
-    recordGeometryPass(commandBuffer, imageIndex, frameIndex, geometryRenderPass, geometryFramebuffers,
-        extent, geometryPipeline, geometryPipelineLayout, cameraDescriptorSet,
-        materialManager, scene);
+    // the cube is only re-rendered when the light or the geometry in its range changed
+    if (pointShadowMap) {
+        pointShadowMap->recordShadowPass(commandBuffer, frameIndex, scene, passStats[DRAW_PASS_SHADOWS]);
+    }
 
-    recordLightingPass(commandBuffer, imageIndex, lightingRenderPass, lightingFramebuffers,
-        extent, lightingPipeline, lightingPipelineLayout, cameraDescriptorSet,
-        gbufferDescriptorSet, lightDescriptorSet, pointLightDescriptorSet);
+    gpuProfiler->end(commandBuffer, frameIndex, GpuProfiler::SHADOWS);
 
-    recordForwardPass(commandBuffer, imageIndex, frameIndex, forwardRenderPass, forwardFramebuffers,
-        extent, forwardPipeline, forwardPipelineLayout, cameraDescriptorSet,
-        lightDescriptorSet, pointLightDescriptorSet, scene, viewProj);
+    gpuProfiler->begin(commandBuffer, frameIndex, GpuProfiler::CLUSTERS);
+    if (clusteredLighting) {
+        clusteredLighting->recordClusterBuild(commandBuffer, frameIndex);
+    }
+    gpuProfiler->end(commandBuffer, frameIndex, GpuProfiler::CLUSTERS);
+
+    // queries have to be reset outside the render pass
+    if (geometryStats) {
+        geometryStats->reset(commandBuffer, frameIndex);
+    }
 
-    recordDebugPass(commandBuffer, imageIndex, debugRenderPass, debugFramebuffers,
-        extent, debugPipeline, debugPipelineLayout, cameraDescriptorSet, debugDraw);
+    // render passes, subpasses and the barriers between them come from the frame graph. its
+    // parallel passes are recorded on the worker threads and executed from this primary
+    frameGraph->execute(commandBuffer, imageIndex, frameIndex, parallelRecording ? recorder.get() : nullptr);
 
-    recordImGuiPass(commandBuffer, imageIndex, imguiRenderPass, imguiFramebuffers,
-        extent, imguiLayer);
+    gpuProfiler->end(commandBuffer, frameIndex, GpuProfiler::FRAME);
 
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer!");
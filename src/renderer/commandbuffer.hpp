@@ -2,64 +2,85 @@
 
 #include <Vulkan/vulkan.h>
 #include <glm/glm.hpp>
+#include "drawsort.hpp"
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
+#include "framesinflight.hpp"
 
 class Scene;
 class ImGuiLayer;
 class MaterialManager;
 class DebugDraw;
+class FrameGraph;
+class ClusteredLighting;
+class CascadedShadowMap;
+class PointShadowMap;
+class GeometryPassStats;
+class GpuProfiler;
+class ParallelRecorder;
 
 class CommandBuffer {
 public:
-    CommandBuffer(VkDevice device, uint32_t graphicsQueueFamily, VkQueue graphicsQueue);
+    // passes whose binds and draws are counted, see getPassStats
+    enum DrawPass {
+        DRAW_PASS_PREPASS = 0,
+        DRAW_PASS_GEOMETRY,
+        DRAW_PASS_FORWARD,
+        DRAW_PASS_SHADOWS,  // cascades and the point light cube together
+        DRAW_PASS_COUNT
+    };
+
+    static const char* getDrawPassName(DrawPass pass);
+
+    // the pipeline a segment's DrawSort variant is drawn with, VK_NULL_HANDLE skips its draws
+    using PipelineSelector = std::function<VkPipeline(uint32_t pipeline)>;
+
+    // a pass is only split once each part gets this many indirect commands, fewer do not pay for
+    // a secondary and the state it binds again
+    static constexpr uint32_t MIN_COMMANDS_PER_PART = 1024;
+
+    // recordingThreads 0 picks the thread count from the cpu, see ParallelRecorder
+    CommandBuffer(VkDevice device, uint32_t graphicsQueueFamily, VkQueue graphicsQueue, uint32_t recordingThreads = 0);
     ~CommandBuffer();
 
     CommandBuffer(const CommandBuffer&) = delete;
     CommandBuffer& operator=(const CommandBuffer&) = delete;
 
-    void recordGeometryPass(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t frameIndex,
-        VkRenderPass renderPass, const std::vector<VkFramebuffer>& framebuffers,
-        VkExtent2D extent, VkPipeline pipeline, VkPipelineLayout pipelineLayout,
+    // parts the scene's commands of a DrawSort pass are recorded in, at most one per recording thread
+    uint32_t getPartCount(const Scene* scene, uint32_t frameIndex, uint32_t pass) const;
+
+    // pass bodies, recorded inside the render pass/subpass the frame graph begins for them. the
+    // passes with sorted draws record part of partCount consecutive slices of their commands and
+    // may be called from several threads at once
+    void recordDepthPrepass(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t part, uint32_t partCount,
+        VkExtent2D extent, VkPipeline pipeline, VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet, Scene* scene);
+
+    void recordGeometryPass(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t part, uint32_t partCount,
+        VkExtent2D extent, const PipelineSelector& selectPipeline, VkPipelineLayout pipelineLayout,
         VkDescriptorSet descriptorSet, MaterialManager* materialManager, Scene* scene);
 
-    void recordLightingPass(VkCommandBuffer commandBuffer, uint32_t imageIndex,
-        VkRenderPass renderPass, const std::vector<VkFramebuffer>& framebuffers,
+    void recordLightingPass(VkCommandBuffer commandBuffer,
         VkExtent2D extent, VkPipeline pipeline, VkPipelineLayout pipelineLayout,
         VkDescriptorSet cameraDescriptorSet, VkDescriptorSet gbufferDescriptorSet,
-        VkDescriptorSet lightDescriptorSet, VkDescriptorSet pointLightDescriptorSet);
+        VkDescriptorSet lightDescriptorSet, VkDescriptorSet clusterDescriptorSet);
 
-    void recordForwardPass(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t frameIndex,
-        VkRenderPass renderPass, const std::vector<VkFramebuffer>& framebuffers,
-        VkExtent2D extent, VkPipeline pipeline, VkPipelineLayout pipelineLayout,
+    void recordForwardPass(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t part, uint32_t partCount,
+        VkExtent2D extent, const PipelineSelector& selectPipeline, VkPipelineLayout pipelineLayout,
         VkDescriptorSet cameraDescriptorSet, VkDescriptorSet lightDescriptorSet,
-        VkDescriptorSet pointLightDescriptorSet, Scene* scene, const glm::mat4& viewProj);
+        VkDescriptorSet clusterDescriptorSet, MaterialManager* materialManager, Scene* scene);
 
-    void recordDebugPass(VkCommandBuffer commandBuffer, uint32_t imageIndex,
-        VkRenderPass renderPass, const std::vector<VkFramebuffer>& framebuffers,
+    void recordDebugPass(VkCommandBuffer commandBuffer,
         VkExtent2D extent, VkPipeline pipeline, VkPipelineLayout pipelineLayout,
         VkDescriptorSet cameraDescriptorSet, DebugDraw* debugDraw);
 
-    void recordImGuiPass(VkCommandBuffer commandBuffer, uint32_t imageIndex,
-        VkRenderPass renderPass, const std::vector<VkFramebuffer>& framebuffers,
-        VkExtent2D extent, ImGuiLayer* imguiLayer);
+    void recordImGuiPass(VkCommandBuffer commandBuffer, ImGuiLayer* imguiLayer);
 
     void recordFrame(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t frameIndex,
-        VkExtent2D extent,
-        VkRenderPass geometryRenderPass, const std::vector<VkFramebuffer>& geometryFramebuffers,
-        VkPipeline geometryPipeline, VkPipelineLayout geometryPipelineLayout,
-        VkDescriptorSet cameraDescriptorSet, MaterialManager* materialManager, Scene* scene,
-        VkRenderPass lightingRenderPass, const std::vector<VkFramebuffer>& lightingFramebuffers,
-        VkPipeline lightingPipeline, VkPipelineLayout lightingPipelineLayout,
-        VkDescriptorSet gbufferDescriptorSet, VkDescriptorSet lightDescriptorSet,
-        VkDescriptorSet pointLightDescriptorSet,
-        VkRenderPass forwardRenderPass, const std::vector<VkFramebuffer>& forwardFramebuffers,
-        VkPipeline forwardPipeline, VkPipelineLayout forwardPipelineLayout,
-        const glm::mat4& viewProj,
-        VkRenderPass debugRenderPass, const std::vector<VkFramebuffer>& debugFramebuffers,
-        VkPipeline debugPipeline, VkPipelineLayout debugPipelineLayout,
-        DebugDraw* debugDraw,
-        VkRenderPass imguiRenderPass, const std::vector<VkFramebuffer>& imguiFramebuffers,
-        ImGuiLayer* imguiLayer);
+        Scene* scene, CascadedShadowMap* shadowMap, PointShadowMap* pointShadowMap,
+        ClusteredLighting* clusteredLighting, GeometryPassStats* geometryStats,
+        GpuProfiler* gpuProfiler, FrameGraph* frameGraph, bool parallelRecording);
 
     VkCommandBuffer getCommandBuffer(size_t index) const { return commandBuffers[index]; }
     const VkFence& getInFlightFence(size_t index) const { return inFlightFences[index]; }
@@ -68,6 +89,9 @@ public:
 
     size_t getMaxFramesInFlight() const { return MAX_FRAMES_IN_FLIGHT; }
 
+    // counts of the last recorded frame, reset when recordFrame begins
+    const PassDrawStats& getPassStats(DrawPass pass) const { return passStats[pass]; }
+
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 
@@ -81,9 +105,20 @@ private:
     std::vector<VkSemaphore> renderFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
 
-    const int MAX_FRAMES_IN_FLIGHT = 2;
+    std::unique_ptr<ParallelRecorder> recorder;
+
+    PassDrawStats passStats[DRAW_PASS_COUNT];
+    // parts of a pass add their counts from their own threads
+    std::mutex passStatsMutex;
 
     void createCommandPool(uint32_t graphicsQueueFamily);
     void createCommandBuffers();
     void createSyncObjects();
+
+    void addPassStats(DrawPass pass, const PassDrawStats& stats);
+
+    // records the part's command slice of the scene's sorted draws of one pass, binding a pipeline
+    // only when the one selected for a segment differs from the one bound. nothing is bound on entry
+    void recordSortedDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, const Scene* scene,
+        uint32_t pass, uint32_t part, uint32_t partCount, const PipelineSelector& selectPipeline, PassDrawStats& stats);
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "drawsort.hpp"
+#include "shaderfeatures.hpp"
+#include <algorithm>
+#include <bit>
+
+static_assert(ShaderFeatures::MATERIAL_MASK == (1u << DrawSort::PIPELINE_FEATURE_BITS) - 1,
+    "pipeline variants hold exactly the material feature bits");
+static_assert(DrawSort::PIPELINE_COUNT <= 16, "pipeline variants have four key bits");
+
+uint32_t DrawSort::makePipeline(uint32_t kind, uint32_t materialFeatures) {
+    return (kind << PIPELINE_FEATURE_BITS) | (materialFeatures & ShaderFeatures::MATERIAL_MASK);
+}
+
+uint64_t DrawSort::make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t depth) {
+    return (static_cast<uint64_t>(pass & 0xf) << 60)
+        | (static_cast<uint64_t>(pipeline & 0xf) << 56)
+        | (static_cast<uint64_t>(std::min(material, MAX_MATERIAL)) << 32)
+        | depth;
+}
+
+uint64_t DrawSort::makeBlended(uint32_t pass, uint32_t pipeline, uint32_t depth, uint32_t material) {
+    return (static_cast<uint64_t>(pass & 0xf) << 60)
+        | (static_cast<uint64_t>(pipeline & 0xf) << 56)
+        | (static_cast<uint64_t>(depth) << MATERIAL_BITS)
+        | std::min(material, MAX_MATERIAL);
+}
+
+uint32_t DrawSort::orderedDepth(float depth) {
+    uint32_t bits = std::bit_cast<uint32_t>(depth);
+    // negative floats grow with their magnitude, flipping all their bits reverses that
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+void DrawSort::radixSort(std::vector<SortedDraw>& draws, std::vector<SortedDraw>& scratch) {
+    uint32_t count = static_cast<uint32_t>(draws.size());
+    if (count < 2) {
+        return;
+    }
+    scratch.resize(count);
+
+    // the histograms of all eight bytes in one read of the keys
+    uint32_t histograms[8][256] = {};
+    for (const SortedDraw& draw : draws) {
+        for (uint32_t byte = 0; byte < 8; byte++) {
+            histograms[byte][(draw.key >> (byte * 8)) & 0xff]++;
+        }
+    }
+
+    SortedDraw* source = draws.data();
+    SortedDraw* target = scratch.data();
+    for (uint32_t byte = 0; byte < 8; byte++) {
+        uint32_t shift = byte * 8;
+        uint32_t* histogram = histograms[byte];
+        if (histogram[(source[0].key >> shift) & 0xff] == count) continue;
+
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < 256; digit++) {
+            uint32_t digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            const SortedDraw& draw = source[i];
+            target[histogram[(draw.key >> shift) & 0xff]++] = draw;
+        }
+        std::swap(source, target);
+    }
+
+    // an odd number of passes leaves the result in the scratch vector
+    if (source != draws.data()) {
+        draws.swap(scratch);
+    }
+}
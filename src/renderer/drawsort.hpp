@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+// one visible draw, the key that places it in the submission order and the pipeline variant it
+// is drawn with. blended keys order by depth before the variant, so it is kept next to the key
+struct SortedDraw {
+    uint64_t key;
+    VkDrawIndexedIndirectCommand command;
+    uint32_t pipeline;      // DrawSort::makePipeline
+};
+
+// consecutive sorted draws that share a pass and a pipeline variant, recorded as one multi-draw
+struct DrawSegment {
+    uint32_t pass;
+    uint32_t pipeline;
+    uint32_t firstCommand;
+    uint32_t count;
+};
+
+// state changes and draws one pass recorded, so the effect of the sort can be measured
+struct PassDrawStats {
+    uint32_t pipelineBinds = 0;
+    uint32_t descriptorBinds = 0;
+    uint32_t drawCalls = 0;     // vkCmdDrawIndexedIndirect calls
+    uint32_t draws = 0;         // indirect commands those calls execute
+};
+
+/*
+    64 bit sort keys for draw submission. From the top the key holds the pass, the pipeline
+    variant, then the state bound least often first: opaque keys continue with the material and
+    the depth, blended keys with the depth and then the material, since blending order wins over
+    state. Sorting a draw list by key makes every pass a contiguous run, every pipeline variant a
+    contiguous run within it and every material a run within that, so a recorder only binds when
+    the bits of the state it is about change from one draw to the next.
+
+        63..60 pass    59..56 pipeline    55..32 material    31..0 depth       (make)
+        63..60 pass    59..56 pipeline    55..24 depth       23..0 material    (makeBlended)
+*/
+class DrawSort {
+public:
+    enum Pass {
+        PASS_GEOMETRY = 0,  // the depth prepass draws the default variant of the same list
+        PASS_FORWARD,
+        PASS_COUNT
+    };
+
+    // the kind of pipeline, the top bits of a variant
+    enum Pipeline {
+        PIPELINE_DEFAULT = 0,
+        PIPELINE_CUTOUT,    // alpha tested, after the default kind so opaques keep early-z
+        PIPELINE_KIND_COUNT
+    };
+
+    // variants are the kind above the material's ShaderFeatures bits
+    static constexpr uint32_t PIPELINE_FEATURE_BITS = 2;
+    static constexpr uint32_t PIPELINE_COUNT = PIPELINE_KIND_COUNT << PIPELINE_FEATURE_BITS;
+
+    static uint32_t makePipeline(uint32_t kind, uint32_t materialFeatures);
+    static uint32_t getPipelineKind(uint32_t pipeline) { return pipeline >> PIPELINE_FEATURE_BITS; }
+    static uint32_t getPipelineFeatures(uint32_t pipeline) { return pipeline & ((1u << PIPELINE_FEATURE_BITS) - 1); }
+
+    static constexpr uint32_t MATERIAL_BITS = 24;
+    static constexpr uint32_t MAX_MATERIAL = (1u << MATERIAL_BITS) - 1;
+
+    // depth is an orderedDepth value, smaller sorts first
+    static uint64_t make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t depth);
+    static uint64_t makeBlended(uint32_t pass, uint32_t pipeline, uint32_t depth, uint32_t material);
+
+    static uint32_t getPass(uint64_t key) { return static_cast<uint32_t>(key >> 60); }
+
+    // maps a float to an integer with the same order, negative values included. back to front
+    // sorts by the complement
+    static uint32_t orderedDepth(float depth);
+
+    // stable LSD radix sort on the key, one byte per pass. bytes every key shares are skipped,
+    // which with few passes and pipelines is most of the top ones
+    static void radixSort(std::vector<SortedDraw>& draws, std::vector<SortedDraw>& scratch);
+};
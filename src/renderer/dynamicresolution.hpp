@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include <cstdint>
+#include "framegraph.hpp"
+#include "framesinflight.hpp"
+
+class ShaderManager;
+struct RenderSettings;
+
+/*
+    Dynamic resolution for the scene passes. The frame graph images are allocated at the swap chain
+    size and never reallocated, the depth prepass, g-buffer, lighting and forward passes only render
+    into the top left render extent through their viewport and scissor. The upscale pass then
+    stretches that region over the backbuffer with bilinear filtering, so debug lines and the ui
+    are still drawn at full resolution.
+    The scale follows the GPU frame time measured by GpuProfiler. Those results arrive two frames
+    late, so the scale only moves a small step per frame to avoid oscillating.
+*/
+class DynamicResolution {
+public:
+    explicit DynamicResolution(VkDevice device);
+    ~DynamicResolution();
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    // the size the frame graph images were allocated at, called whenever it is recompiled
+    void setMaxExtent(VkExtent2D extent);
+
+    // moves the scale toward the settings' target frame time, gpuFrameMs is 0 when nothing was measured
+    void update(const RenderSettings& settings, float gpuFrameMs);
+
+    // called whenever the frame graph recreates its images
+    void updateDescriptorSets(VkImageView sceneColorView);
+    void createPipeline(ShaderManager* shaderManager, const FrameGraph::PassTarget& passTarget);
+
+    // inside the upscale pass, samples the render extent of the scene color image
+    void recordUpscale(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+    float getScale() const { return scale; }
+    float getGpuMs() const { return gpuMs; }
+    VkExtent2D getRenderExtent() const { return renderExtent; }
+    VkExtent2D getMaxExtent() const { return maxExtent; }
+
+private:
+    VkDevice device;
+
+    float gpuMs;
+    float scale;
+    VkExtent2D maxExtent;
+    VkExtent2D renderExtent;
+
+    VkSampler sampler;
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSets[MAX_FRAMES_IN_FLIGHT];
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+
+    void createSampler();
+    void createDescriptorSets();
+    void updateRenderExtent();
+};
@@ -0,0 +1,930 @@
+#include "framegraph.hpp"
+#include "parallelrecorder.hpp"
+#include "../core/cpuprofiler.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+FrameGraph::FrameGraph(VkDevice device, VmaAllocator allocator)
+    : device(device), allocator(allocator), extent{}, compiled(false) {
+}
+
+FrameGraph::~FrameGraph() {
+    destroy();
+}
+
+FrameGraph::ResourceHandle FrameGraph::importImage(const std::string& name, VkFormat format,
+    const std::vector<VkImageView>& views, VkImageLayout finalLayout) {
+    Resource resource;
+    resource.name = name;
+    resource.format = format;
+    resource.imported = true;
+    resource.importedViews = views;
+    resource.finalLayout = finalLayout;
+    resources.push_back(resource);
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+FrameGraph::ResourceHandle FrameGraph::createImage(const std::string& name, VkFormat format) {
+    Resource resource;
+    resource.name = name;
+    resource.format = format;
+    resources.push_back(resource);
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+FrameGraph::PassHandle FrameGraph::addPass(const std::string& name, ExecuteCallback execute) {
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    passes.push_back(std::move(pass));
+    return static_cast<PassHandle>(passes.size() - 1);
+}
+
+FrameGraph::PassHandle FrameGraph::addParallelPass(const std::string& name, PartCountCallback partCount, PartCallback recordPart) {
+    Pass pass;
+    pass.name = name;
+    pass.partCount = std::move(partCount);
+    pass.recordPart = std::move(recordPart);
+    passes.push_back(std::move(pass));
+    return static_cast<PassHandle>(passes.size() - 1);
+}
+
+void FrameGraph::writeColor(PassHandle pass, ResourceHandle resource, std::optional<VkClearValue> clear) {
+    addUse(pass, resource, Access::ColorWrite, clear);
+}
+
+void FrameGraph::writeDepth(PassHandle pass, ResourceHandle resource, std::optional<VkClearValue> clear) {
+    addUse(pass, resource, Access::DepthWrite, clear);
+}
+
+void FrameGraph::readDepth(PassHandle pass, ResourceHandle resource) {
+    addUse(pass, resource, Access::DepthRead, std::nullopt);
+}
+
+void FrameGraph::readTexture(PassHandle pass, ResourceHandle resource) {
+    addUse(pass, resource, Access::Sampled, std::nullopt);
+}
+
+void FrameGraph::readAttachment(PassHandle pass, ResourceHandle resource) {
+    addUse(pass, resource, Access::InputAttachment, std::nullopt);
+}
+
+void FrameGraph::setSideEffect(PassHandle pass) {
+    passes[pass].sideEffect = true;
+}
+
+void FrameGraph::addUse(PassHandle pass, ResourceHandle resource, Access access, std::optional<VkClearValue> clear) {
+    if (compiled) {
+        throw std::runtime_error("frame graph: cannot declare resource uses after compile");
+    }
+    for (const auto& use : passes[pass].uses) {
+        if (use.resource == resource) {
+            throw std::runtime_error("frame graph: pass '" + passes[pass].name + "' uses '" +
+                resources[resource].name + "' more than once");
+        }
+    }
+    passes[pass].uses.push_back({ resource, access, clear });
+}
+
+void FrameGraph::compile(VkExtent2D extent) {
+    this->extent = extent;
+
+    cullPasses();
+    buildGroups();
+    computeLifetimes();
+    createTransientImages();
+    buildRenderPasses();
+
+    compiled = true;
+
+    uint32_t culledCount = 0;
+    for (const auto& pass : passes) {
+        if (pass.culled) culledCount++;
+    }
+
+    VkDeviceSize aliasedBytes = 0;
+    VkDeviceSize unaliasedBytes = 0;
+    uint32_t lazyCount = 0;
+    for (const auto& block : memoryBlocks) {
+        if (!block.lazy) aliasedBytes += block.requirements.size;
+    }
+    for (const auto& resource : resources) {
+        if (resource.lazy) {
+            lazyCount++;
+        }
+        else if (resource.image != VK_NULL_HANDLE) {
+            unaliasedBytes += resource.memoryRequirements.size;
+        }
+    }
+
+    std::cout << "frame graph compiled: " << passes.size() << " passes (" << culledCount << " culled), "
+              << groups.size() << " render passes, transient memory "
+              << aliasedBytes / (1024 * 1024) << " MB (" << unaliasedBytes / (1024 * 1024)
+              << " MB without aliasing), " << lazyCount << " lazily allocated images" << std::endl;
+
+    for (const auto& group : groups) {
+        std::string names;
+        for (PassHandle handle : group.passes) {
+            if (!names.empty()) names += " + ";
+            names += passes[handle].name;
+        }
+        std::cout << "  render pass: " << names << std::endl;
+    }
+}
+
+/*
+    Walks the passes backwards. A pass stays if it has side effects, writes an imported image,
+    or writes a resource whose current contents a later live pass reads or loads.
+*/
+void FrameGraph::cullPasses() {
+    std::vector<bool> contentsNeeded(resources.size(), false);
+
+    for (size_t i = passes.size(); i-- > 0;) {
+        Pass& pass = passes[i];
+
+        bool live = pass.sideEffect;
+        for (const auto& use : pass.uses) {
+            if (isWrite(use.access) &&
+                (resources[use.resource].imported || contentsNeeded[use.resource])) {
+                live = true;
+            }
+        }
+
+        pass.culled = !live;
+        if (!live) continue;
+
+        for (const auto& use : pass.uses) {
+            // a cleared write does not depend on what was there before
+            contentsNeeded[use.resource] = !(isWrite(use.access) && use.clear.has_value());
+        }
+    }
+}
+
+void FrameGraph::buildGroups() {
+    for (PassHandle handle = 0; handle < passes.size(); ++handle) {
+        Pass& pass = passes[handle];
+        if (pass.culled) continue;
+
+        if (groups.empty() || !canMerge(groups.back(), pass)) {
+            groups.emplace_back();
+        }
+
+        PassGroup& group = groups.back();
+        pass.group = static_cast<uint32_t>(groups.size() - 1);
+        pass.subpass = static_cast<uint32_t>(group.passes.size());
+        group.passes.push_back(handle);
+    }
+}
+
+// passes can share a render pass as long as no image is both an attachment and a sampled texture in it
+bool FrameGraph::canMerge(const PassGroup& group, const Pass& pass) const {
+    if (group.passes.size() >= 32) {
+        return false;
+    }
+
+    for (const auto& use : pass.uses) {
+        for (PassHandle other : group.passes) {
+            for (const auto& otherUse : passes[other].uses) {
+                if (otherUse.resource == use.resource && isAttachment(use.access) != isAttachment(otherUse.access)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+void FrameGraph::computeLifetimes() {
+    for (PassHandle handle = 0; handle < passes.size(); ++handle) {
+        const Pass& pass = passes[handle];
+        if (pass.culled) continue;
+
+        for (const auto& use : pass.uses) {
+            Resource& resource = resources[use.resource];
+            resource.firstPass = std::min(resource.firstPass, handle);
+            resource.lastPass = std::max(resource.lastPass, handle);
+            resource.allStages |= getStages(use.access);
+            if (isWrite(use.access)) {
+                resource.allWriteAccess |= getAccessFlags(use.access);
+            }
+            resource.usage |= getUsage(use.access);
+        }
+    }
+
+    // images that live and die inside one render pass never need their contents in memory
+    for (auto& resource : resources) {
+        if (resource.imported || resource.firstPass == INVALID_HANDLE) continue;
+        bool attachmentOnly = (resource.usage & VK_IMAGE_USAGE_SAMPLED_BIT) == 0;
+        bool singleGroup = passes[resource.firstPass].group == passes[resource.lastPass].group;
+        if (attachmentOnly && singleGroup) {
+            resource.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+            resource.lazy = true;
+        }
+    }
+}
+
+/*
+    Creates every live transient image, then packs them into memory blocks. Images are placed
+    largest first into the first block whose occupants have disjoint lifetimes and a compatible
+    memory type, so intermediates that are never alive at the same time share memory. The packing
+    is only done by compile(): the render passes wait on each block's previous occupant and treat
+    lazy images differently, so resize() keeps the blocks and only allocates them at the new size.
+*/
+void FrameGraph::createTransientImages() {
+    std::vector<ResourceHandle> transients;
+
+    for (ResourceHandle handle = 0; handle < resources.size(); ++handle) {
+        Resource& resource = resources[handle];
+        if (resource.imported || resource.firstPass == INVALID_HANDLE) continue;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = extent.width;
+        imageInfo.extent.height = extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = resource.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = resource.usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create frame graph image: " + resource.name);
+        }
+        vkGetImageMemoryRequirements(device, resource.image, &resource.memoryRequirements);
+
+        transients.push_back(handle);
+    }
+
+    if (memoryBlocks.empty()) {
+        packMemoryBlocks(transients);
+    }
+    else {
+        reallocateMemoryBlocks();
+    }
+
+    for (ResourceHandle handle : transients) {
+        Resource& resource = resources[handle];
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = resource.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = resource.format;
+        viewInfo.subresourceRange.aspectMask = isDepthFormat(resource.format) ?
+            VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create frame graph image view: " + resource.name);
+        }
+    }
+}
+
+void FrameGraph::packMemoryBlocks(std::vector<ResourceHandle>& transients) {
+    std::sort(transients.begin(), transients.end(), [this](ResourceHandle a, ResourceHandle b) {
+        return resources[a].memoryRequirements.size > resources[b].memoryRequirements.size;
+    });
+
+    for (ResourceHandle handle : transients) {
+        Resource& resource = resources[handle];
+        if (resource.lazy && allocateLazily(handle)) continue;
+        resource.lazy = false;
+
+        for (uint32_t b = 0; b < memoryBlocks.size() && resource.memoryBlock == INVALID_HANDLE; ++b) {
+            MemoryBlock& block = memoryBlocks[b];
+            if (block.lazy) continue;
+            if ((block.requirements.memoryTypeBits & resource.memoryRequirements.memoryTypeBits) == 0) {
+                continue;
+            }
+
+            bool overlaps = false;
+            for (ResourceHandle other : block.occupants) {
+                const Resource& occupant = resources[other];
+                if (resource.firstPass <= occupant.lastPass && occupant.firstPass <= resource.lastPass) {
+                    overlaps = true;
+                    break;
+                }
+            }
+            if (overlaps) continue;
+
+            block.requirements.size = std::max(block.requirements.size, resource.memoryRequirements.size);
+            block.requirements.alignment = std::max(block.requirements.alignment, resource.memoryRequirements.alignment);
+            block.requirements.memoryTypeBits &= resource.memoryRequirements.memoryTypeBits;
+            block.occupants.push_back(handle);
+            resource.memoryBlock = b;
+        }
+
+        if (resource.memoryBlock == INVALID_HANDLE) {
+            MemoryBlock block;
+            block.requirements = resource.memoryRequirements;
+            block.occupants.push_back(handle);
+            memoryBlocks.push_back(block);
+            resource.memoryBlock = static_cast<uint32_t>(memoryBlocks.size() - 1);
+        }
+    }
+
+    for (auto& block : memoryBlocks) {
+        if (block.lazy) continue;
+        std::sort(block.occupants.begin(), block.occupants.end(), [this](ResourceHandle a, ResourceHandle b) {
+            return resources[a].firstPass < resources[b].firstPass;
+        });
+
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        if (vmaAllocateMemory(allocator, &block.requirements, &allocInfo, &block.allocation, nullptr) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate frame graph memory");
+        }
+
+        for (ResourceHandle handle : block.occupants) {
+            if (vmaBindImageMemory2(allocator, block.allocation, 0, resources[handle].image, nullptr) != VK_SUCCESS) {
+                throw std::runtime_error("failed to bind frame graph image: " + resources[handle].name);
+            }
+        }
+    }
+}
+
+// the blocks compile() packed, sized for the images created at the new extent
+void FrameGraph::reallocateMemoryBlocks() {
+    for (auto& block : memoryBlocks) {
+        block.requirements = resources[block.occupants.front()].memoryRequirements;
+        for (ResourceHandle handle : block.occupants) {
+            const VkMemoryRequirements& requirements = resources[handle].memoryRequirements;
+            block.requirements.size = std::max(block.requirements.size, requirements.size);
+            block.requirements.alignment = std::max(block.requirements.alignment, requirements.alignment);
+            block.requirements.memoryTypeBits &= requirements.memoryTypeBits;
+        }
+
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = block.lazy ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY;
+
+        if (vmaAllocateMemory(allocator, &block.requirements, &allocInfo, &block.allocation, nullptr) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate frame graph memory");
+        }
+
+        for (ResourceHandle handle : block.occupants) {
+            if (vmaBindImageMemory2(allocator, block.allocation, 0, resources[handle].image, nullptr) != VK_SUCCESS) {
+                throw std::runtime_error("failed to bind frame graph image: " + resources[handle].name);
+            }
+        }
+    }
+}
+
+// gives the image its own lazily allocated memory, false if the device has no such memory type
+bool FrameGraph::allocateLazily(ResourceHandle handle) {
+    Resource& resource = resources[handle];
+
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+
+    uint32_t memoryTypeIndex = 0;
+    if (vmaFindMemoryTypeIndex(allocator, resource.memoryRequirements.memoryTypeBits, &allocInfo, &memoryTypeIndex) != VK_SUCCESS) {
+        return false;
+    }
+
+    MemoryBlock block;
+    block.requirements = resource.memoryRequirements;
+    block.occupants.push_back(handle);
+    block.lazy = true;
+
+    if (vmaAllocateMemory(allocator, &block.requirements, &allocInfo, &block.allocation, nullptr) != VK_SUCCESS) {
+        return false;
+    }
+    if (vmaBindImageMemory2(allocator, block.allocation, 0, resource.image, nullptr) != VK_SUCCESS) {
+        vmaFreeMemory(allocator, block.allocation);
+        throw std::runtime_error("failed to bind frame graph image: " + resource.name);
+    }
+
+    memoryBlocks.push_back(block);
+    resource.memoryBlock = static_cast<uint32_t>(memoryBlocks.size() - 1);
+    return true;
+}
+
+/*
+    Walks the groups in order while tracking, per resource, the current layout and which stages
+    last wrote and read it. Every use only waits on what actually touched the resource before it:
+    subpass dependencies inside a group, EXTERNAL dependencies across groups. Layout changes are
+    folded into attachment initial layouts and subpass references, so no explicit barriers are recorded.
+*/
+void FrameGraph::buildRenderPasses() {
+    std::vector<ResourceState> states(resources.size());
+
+    // start of frame: the previous frame (or the previous owner of aliased memory) may still use the memory
+    for (ResourceHandle handle = 0; handle < resources.size(); ++handle) {
+        const Resource& resource = resources[handle];
+        ResourceState& state = states[handle];
+
+        if (resource.imported) {
+            // swapchain images are handed over by the acquire semaphore at color output
+            state.writeStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        }
+        else if (resource.memoryBlock != INVALID_HANDLE) {
+            const auto& occupants = memoryBlocks[resource.memoryBlock].occupants;
+            auto it = std::find(occupants.begin(), occupants.end(), handle);
+            ResourceHandle previous = (it == occupants.begin()) ? occupants.back() : *(it - 1);
+            state.writeStages = resources[previous].allStages;
+            state.writeAccess = resources[previous].allWriteAccess;
+        }
+    }
+
+    for (uint32_t g = 0; g < groups.size(); ++g) {
+        PassGroup& group = groups[g];
+        uint32_t subpassCount = static_cast<uint32_t>(group.passes.size());
+        PassHandle lastPassInGroup = group.passes.back();
+
+        std::vector<VkAttachmentDescription> attachmentDescs;
+        std::vector<uint32_t> attachmentIndex(resources.size(), INVALID_HANDLE);
+        std::vector<uint32_t> firstSubpass;
+        std::vector<uint32_t> lastSubpass;
+        std::vector<Access> lastAccess;
+
+        std::vector<std::vector<VkAttachmentReference>> colorRefs(subpassCount);
+        std::vector<std::vector<VkAttachmentReference>> inputRefs(subpassCount);
+        std::vector<VkAttachmentReference> depthRefs(subpassCount, { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+        std::vector<std::vector<uint32_t>> preserveRefs(subpassCount);
+
+        std::vector<VkSubpassDependency> dependencies;
+        auto addDependency = [&dependencies](uint32_t src, uint32_t dst, VkPipelineStageFlags srcStages,
+            VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess, bool byRegion) {
+            for (auto& dep : dependencies) {
+                if (dep.srcSubpass == src && dep.dstSubpass == dst) {
+                    dep.srcStageMask |= srcStages;
+                    dep.srcAccessMask |= srcAccess;
+                    dep.dstStageMask |= dstStages;
+                    dep.dstAccessMask |= dstAccess;
+                    if (!byRegion) dep.dependencyFlags = 0;
+                    return;
+                }
+            }
+            VkSubpassDependency dep{};
+            dep.srcSubpass = src;
+            dep.dstSubpass = dst;
+            dep.srcStageMask = srcStages;
+            dep.srcAccessMask = srcAccess;
+            dep.dstStageMask = dstStages;
+            dep.dstAccessMask = dstAccess;
+            dep.dependencyFlags = byRegion ? VK_DEPENDENCY_BY_REGION_BIT : 0;
+            dependencies.push_back(dep);
+        };
+
+        for (uint32_t s = 0; s < subpassCount; ++s) {
+            const Pass& pass = passes[group.passes[s]];
+
+            for (const auto& use : pass.uses) {
+                const Resource& resource = resources[use.resource];
+                ResourceState& state = states[use.resource];
+
+                VkImageLayout layout = getLayout(use.access, resource.format);
+                VkPipelineStageFlags stages = getStages(use.access);
+                VkAccessFlags access = getAccessFlags(use.access);
+                bool write = isWrite(use.access);
+                VkImageLayout currentLayout = state.layout;
+
+                if (isAttachment(use.access)) {
+                    uint32_t index = attachmentIndex[use.resource];
+                    if (index == INVALID_HANDLE) {
+                        index = static_cast<uint32_t>(attachmentDescs.size());
+                        attachmentIndex[use.resource] = index;
+
+                        VkAttachmentDescription desc{};
+                        desc.format = resource.format;
+                        desc.samples = VK_SAMPLE_COUNT_1_BIT;
+                        if (use.clear.has_value()) {
+                            desc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+                        }
+                        else {
+                            desc.loadOp = state.hasContent ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                        }
+                        desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                        desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                        // discarded contents can start from UNDEFINED
+                        desc.initialLayout = (desc.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+                        currentLayout = desc.initialLayout;
+
+                        attachmentDescs.push_back(desc);
+                        group.attachments.push_back(use.resource);
+                        group.clearValues.push_back(use.clear.value_or(VkClearValue{}));
+                        firstSubpass.push_back(s);
+                        lastSubpass.push_back(s);
+                        lastAccess.push_back(use.access);
+                    }
+                    lastSubpass[index] = s;
+                    lastAccess[index] = use.access;
+
+                    if (use.access == Access::ColorWrite) {
+                        colorRefs[s].push_back({ index, layout });
+                    }
+                    else if (use.access == Access::InputAttachment) {
+                        inputRefs[s].push_back({ index, layout });
+                    }
+                    else {
+                        depthRefs[s] = { index, layout };
+                    }
+                }
+
+                // which earlier accesses this use has to wait for
+                bool layoutChange = currentLayout != layout;
+                VkPipelineStageFlags srcWriteStages = 0;
+                VkPipelineStageFlags srcReadStages = 0;
+                if (layoutChange || write) {
+                    srcWriteStages = state.writeStages;
+                    srcReadStages = state.readStages;
+                }
+                else if (state.writeStages != 0 && (state.readStages & stages) != stages) {
+                    srcWriteStages = state.writeStages;
+                }
+
+                bool byRegion = isAttachment(use.access);
+                bool emitted = false;
+
+                if (srcWriteStages != 0) {
+                    uint32_t src = (state.writeGroup == g) ? state.writeSubpass : VK_SUBPASS_EXTERNAL;
+                    if (src != s) {
+                        addDependency(src, s, srcWriteStages, state.writeAccess, stages, access,
+                            byRegion && src != VK_SUBPASS_EXTERNAL);
+                        emitted = true;
+                    }
+                }
+
+                if (srcReadStages != 0) {
+                    if (state.readGroup != g || state.readExternal) {
+                        addDependency(VK_SUBPASS_EXTERNAL, s, srcReadStages, 0, stages, access, false);
+                        emitted = true;
+                    }
+                    if (state.readGroup == g) {
+                        for (uint32_t r = 0; r < s; ++r) {
+                            if (state.readSubpassMask & (1u << r)) {
+                                addDependency(r, s, srcReadStages, 0, stages, access, byRegion);
+                                emitted = true;
+                            }
+                        }
+                    }
+                }
+
+                if (layoutChange && !emitted) {
+                    addDependency(VK_SUBPASS_EXTERNAL, s, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, stages, access, false);
+                }
+
+                // update tracked state, a layout transition counts as a write
+                if (layoutChange || write) {
+                    state.writeStages = stages;
+                    state.writeAccess = write ? access : 0;
+                    state.writeGroup = g;
+                    state.writeSubpass = s;
+                    state.readStages = write ? 0 : stages;
+                    state.readGroup = g;
+                    state.readSubpassMask = write ? 0 : (1u << s);
+                    state.readExternal = false;
+                }
+                else {
+                    if (state.readGroup != g) {
+                        state.readExternal = state.readStages != 0;
+                        state.readSubpassMask = 0;
+                        state.readGroup = g;
+                    }
+                    state.readStages |= stages;
+                    state.readSubpassMask |= (1u << s);
+                }
+                state.layout = layout;
+                if (write) {
+                    state.hasContent = true;
+                }
+            }
+        }
+
+        // store ops, final layouts and attachments that must survive subpasses that do not use them
+        for (uint32_t a = 0; a < attachmentDescs.size(); ++a) {
+            ResourceHandle handle = group.attachments[a];
+            const Resource& resource = resources[handle];
+            ResourceState& state = states[handle];
+
+            bool usedLater = resource.lastPass > lastPassInGroup;
+            attachmentDescs[a].storeOp = (resource.imported || usedLater) ?
+                VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachmentDescs[a].finalLayout = state.layout;
+
+            if (resource.imported && !usedLater && resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+                attachmentDescs[a].finalLayout = resource.finalLayout;
+                addDependency(lastSubpass[a], VK_SUBPASS_EXTERNAL, getStages(lastAccess[a]),
+                    isWrite(lastAccess[a]) ? getAccessFlags(lastAccess[a]) : 0,
+                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, false);
+                state.layout = resource.finalLayout;
+            }
+
+            for (uint32_t s = firstSubpass[a] + 1; s < lastSubpass[a]; ++s) {
+                bool referenced = depthRefs[s].attachment == a;
+                for (const auto& ref : colorRefs[s]) {
+                    if (ref.attachment == a) referenced = true;
+                }
+                for (const auto& ref : inputRefs[s]) {
+                    if (ref.attachment == a) referenced = true;
+                }
+                if (!referenced) {
+                    preserveRefs[s].push_back(a);
+                }
+            }
+        }
+
+        std::vector<VkSubpassDescription> subpasses(subpassCount);
+        for (uint32_t s = 0; s < subpassCount; ++s) {
+            subpasses[s].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            subpasses[s].inputAttachmentCount = static_cast<uint32_t>(inputRefs[s].size());
+            subpasses[s].pInputAttachments = inputRefs[s].empty() ? nullptr : inputRefs[s].data();
+            subpasses[s].colorAttachmentCount = static_cast<uint32_t>(colorRefs[s].size());
+            subpasses[s].pColorAttachments = colorRefs[s].empty() ? nullptr : colorRefs[s].data();
+            subpasses[s].pDepthStencilAttachment =
+                depthRefs[s].attachment != VK_ATTACHMENT_UNUSED ? &depthRefs[s] : nullptr;
+            subpasses[s].preserveAttachmentCount = static_cast<uint32_t>(preserveRefs[s].size());
+            subpasses[s].pPreserveAttachments = preserveRefs[s].empty() ? nullptr : preserveRefs[s].data();
+        }
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentDescs.size());
+        renderPassInfo.pAttachments = attachmentDescs.data();
+        renderPassInfo.subpassCount = subpassCount;
+        renderPassInfo.pSubpasses = subpasses.data();
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &group.renderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create frame graph render pass for " + passes[group.passes[0]].name);
+        }
+
+        createFramebuffers(group);
+    }
+}
+
+void FrameGraph::createFramebuffers(PassGroup& group) {
+    // one framebuffer per swapchain image if an imported image with several views is attached
+    size_t framebufferCount = 1;
+    for (ResourceHandle handle : group.attachments) {
+        if (resources[handle].imported) {
+            framebufferCount = std::max(framebufferCount, resources[handle].importedViews.size());
+        }
+    }
+
+    group.framebuffers.resize(framebufferCount, VK_NULL_HANDLE);
+
+    for (size_t i = 0; i < framebufferCount; ++i) {
+        std::vector<VkImageView> views;
+        views.reserve(group.attachments.size());
+        for (ResourceHandle handle : group.attachments) {
+            const Resource& resource = resources[handle];
+            if (resource.imported) {
+                views.push_back(resource.importedViews[i % resource.importedViews.size()]);
+            }
+            else {
+                views.push_back(resource.view);
+            }
+        }
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = group.renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+        framebufferInfo.pAttachments = views.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &group.framebuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create frame graph framebuffer");
+        }
+    }
+}
+
+void FrameGraph::execute(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t frameIndex, ParallelRecorder* recorder) {
+    // a secondary only needs its render pass, subpass and framebuffer, all known up front, so
+    // every part of every parallel pass is in flight on the workers at the same time
+    std::vector<std::vector<VkCommandBuffer>> secondaries(passes.size());
+    if (recorder) {
+        for (const auto& group : groups) {
+            for (PassHandle handle : group.passes) {
+                const Pass& pass = passes[handle];
+                if (!pass.recordPart) continue;
+
+                uint32_t partCount = std::max(pass.partCount ? pass.partCount() : 1u, 1u);
+                secondaries[handle].resize(partCount, VK_NULL_HANDLE);
+
+                VkCommandBufferInheritanceInfo inheritance{};
+                inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+                inheritance.renderPass = group.renderPass;
+                inheritance.subpass = pass.subpass;
+                inheritance.framebuffer = group.framebuffers[imageIndex % group.framebuffers.size()];
+
+                for (uint32_t part = 0; part < partCount; part++) {
+                    // each job writes its own element, the vectors are not resized while they run
+                    recorder->submit([this, recorder, frameIndex, inheritance, handle, part, partCount, &secondaries](uint32_t worker) {
+                        CPU_PROFILE_ZONE("FrameGraph::recordPart");
+                        VkCommandBuffer secondary = recorder->beginSecondary(frameIndex, worker, inheritance);
+                        passes[handle].recordPart(secondary, part, partCount);
+                        recorder->endSecondary(secondary);
+                        secondaries[handle][part] = secondary;
+                    });
+                }
+            }
+        }
+        recorder->wait();
+    }
+
+    for (const auto& group : groups) {
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = group.renderPass;
+        renderPassInfo.framebuffer = group.framebuffers[imageIndex % group.framebuffers.size()];
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = extent;
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(group.clearValues.size());
+        renderPassInfo.pClearValues = group.clearValues.data();
+
+        for (size_t s = 0; s < group.passes.size(); ++s) {
+            PassHandle handle = group.passes[s];
+            const Pass& pass = passes[handle];
+            const std::vector<VkCommandBuffer>& passSecondaries = secondaries[handle];
+
+            // a subpass holds either inline commands or secondaries, never both
+            VkSubpassContents contents = passSecondaries.empty() ?
+                VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+            if (s == 0) {
+                vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+            }
+            else {
+                vkCmdNextSubpass(commandBuffer, contents);
+            }
+
+            if (!passSecondaries.empty()) {
+                vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(passSecondaries.size()), passSecondaries.data());
+            }
+            else if (pass.recordPart) {
+                pass.recordPart(commandBuffer, 0, 1);
+            }
+            else if (pass.execute) {
+                pass.execute(commandBuffer);
+            }
+        }
+
+        vkCmdEndRenderPass(commandBuffer);
+    }
+}
+
+FrameGraph::PassTarget FrameGraph::getPassTarget(PassHandle pass) const {
+    const Pass& p = passes[pass];
+    if (p.culled || p.group == INVALID_HANDLE) {
+        return {};
+    }
+    return { groups[p.group].renderPass, p.subpass };
+}
+
+void FrameGraph::resize(VkExtent2D extent) {
+    if (!compiled) {
+        throw std::runtime_error("frame graph resized before it was compiled");
+    }
+
+    destroySizeDependent();
+    this->extent = extent;
+
+    createTransientImages();
+    for (auto& group : groups) {
+        createFramebuffers(group);
+    }
+
+    std::cout << "frame graph resized to " << extent.width << "x" << extent.height << std::endl;
+}
+
+void FrameGraph::setImportedViews(ResourceHandle resource, const std::vector<VkImageView>& views) {
+    if (!resources[resource].imported) {
+        throw std::runtime_error("not an imported frame graph image: " + resources[resource].name);
+    }
+    resources[resource].importedViews = views;
+}
+
+void FrameGraph::destroySizeDependent() {
+    for (auto& group : groups) {
+        for (auto framebuffer : group.framebuffers) {
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+        }
+        group.framebuffers.clear();
+    }
+
+    for (auto& resource : resources) {
+        if (resource.view != VK_NULL_HANDLE) {
+            vkDestroyImageView(device, resource.view, nullptr);
+            resource.view = VK_NULL_HANDLE;
+        }
+        if (resource.image != VK_NULL_HANDLE) {
+            vkDestroyImage(device, resource.image, nullptr);
+            resource.image = VK_NULL_HANDLE;
+        }
+    }
+
+    // the blocks and their occupants stay for resize()
+    for (auto& block : memoryBlocks) {
+        if (block.allocation != VK_NULL_HANDLE) {
+            vmaFreeMemory(allocator, block.allocation);
+            block.allocation = VK_NULL_HANDLE;
+        }
+    }
+}
+
+void FrameGraph::destroy() {
+    destroySizeDependent();
+
+    for (auto& resource : resources) {
+        resource.memoryBlock = INVALID_HANDLE;
+    }
+    memoryBlocks.clear();
+
+    for (auto& group : groups) {
+        if (group.renderPass != VK_NULL_HANDLE) {
+            vkDestroyRenderPass(device, group.renderPass, nullptr);
+        }
+    }
+    groups.clear();
+
+    compiled = false;
+}
+
+bool FrameGraph::isAttachment(Access access) const {
+    return access != Access::Sampled;
+}
+
+bool FrameGraph::isDepthFormat(VkFormat format) const {
+    return format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
+        format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D16_UNORM;
+}
+
+VkImageLayout FrameGraph::getLayout(Access access, VkFormat format) const {
+    switch (access) {
+    case Access::ColorWrite:
+        return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    case Access::DepthWrite:
+        return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    case Access::DepthRead:
+        return VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    case Access::InputAttachment:
+    case Access::Sampled:
+        // read-only depth layout is valid for sampling and avoids a transition before depth testing
+        return isDepthFormat(format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+    return VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+VkPipelineStageFlags FrameGraph::getStages(Access access) const {
+    switch (access) {
+    case Access::ColorWrite:
+        return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    case Access::DepthWrite:
+    case Access::DepthRead:
+        return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    case Access::InputAttachment:
+    case Access::Sampled:
+        return VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+    return VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+}
+
+VkAccessFlags FrameGraph::getAccessFlags(Access access) const {
+    switch (access) {
+    case Access::ColorWrite:
+        return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    case Access::DepthWrite:
+        return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    case Access::DepthRead:
+        return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    case Access::InputAttachment:
+        return VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+    case Access::Sampled:
+        return VK_ACCESS_SHADER_READ_BIT;
+    }
+    return 0;
+}
+
+bool FrameGraph::isWrite(Access access) const {
+    return access == Access::ColorWrite || access == Access::DepthWrite;
+}
+
+VkImageUsageFlags FrameGraph::getUsage(Access access) const {
+    switch (access) {
+    case Access::ColorWrite:
+        return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    case Access::DepthWrite:
+    case Access::DepthRead:
+        return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    case Access::InputAttachment:
+        return VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    case Access::Sampled:
+        return VK_IMAGE_USAGE_SAMPLED_BIT;
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include "vk_mem_alloc.h"
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+class ParallelRecorder;
+
+/*
+    FrameGraph describes one frame as an ordered list of passes that declare which images
+    they read and write. compile() then:
+      - culls passes whose results never reach an imported (presented) image
+      - merges consecutive compatible passes into one VkRenderPass with several subpasses
+      - derives load/store ops, layouts and the minimal subpass dependencies from the declared accesses
+      - creates the transient images and aliases their memory when lifetimes do not overlap
+      - backs images that never leave a render pass with lazily allocated memory where available
+    Passes are recorded with execute(), which begins/ends render passes around the pass callbacks.
+    Parallel passes are split into parts that are recorded into secondary command buffers on the
+    recorder's threads, all of them before the primary is walked, and executed in part order.
+    resize() recreates only what depends on the extent, the transient images, their memory and the
+    framebuffers; the render passes, the memory aliasing they were built for and every pipeline
+    created against them are kept.
+*/
+class FrameGraph {
+public:
+    using ResourceHandle = uint32_t;
+    using PassHandle = uint32_t;
+    static constexpr uint32_t INVALID_HANDLE = UINT32_MAX;
+
+    // render pass and subpass a pass is recorded in, pipelines are created against this
+    struct PassTarget {
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        uint32_t subpass = 0;
+    };
+
+    using ExecuteCallback = std::function<void(VkCommandBuffer)>;
+    // records one of partCount consecutive slices of a parallel pass, possibly on a worker thread
+    using PartCallback = std::function<void(VkCommandBuffer, uint32_t part, uint32_t partCount)>;
+    // asked on the recording thread before the parts are handed out, at least 1
+    using PartCountCallback = std::function<uint32_t()>;
+
+    FrameGraph(VkDevice device, VmaAllocator allocator);
+    ~FrameGraph();
+
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+
+    // declare resources
+    ResourceHandle importImage(const std::string& name, VkFormat format,
+        const std::vector<VkImageView>& views, VkImageLayout finalLayout);
+    ResourceHandle createImage(const std::string& name, VkFormat format);
+
+    // declare passes, in execution order
+    PassHandle addPass(const std::string& name, ExecuteCallback execute);
+    PassHandle addParallelPass(const std::string& name, PartCountCallback partCount, PartCallback recordPart);
+    void writeColor(PassHandle pass, ResourceHandle resource, std::optional<VkClearValue> clear = std::nullopt);
+    void writeDepth(PassHandle pass, ResourceHandle resource, std::optional<VkClearValue> clear = std::nullopt);
+    void readDepth(PassHandle pass, ResourceHandle resource);      // read-only depth attachment
+    void readTexture(PassHandle pass, ResourceHandle resource);    // sampled in the fragment shader
+    void readAttachment(PassHandle pass, ResourceHandle resource); // input attachment, subpassLoad at the same pixel
+    void setSideEffect(PassHandle pass);                           // never culled
+
+    void compile(VkExtent2D extent);
+    // after compile(). imported views may be replaced before it, e.g. by a recreated swapchain's
+    void resize(VkExtent2D extent);
+    void setImportedViews(ResourceHandle resource, const std::vector<VkImageView>& views);
+    // without a recorder parallel passes are recorded inline as a single part
+    void execute(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t frameIndex, ParallelRecorder* recorder);
+
+    PassTarget getPassTarget(PassHandle pass) const;
+    bool isCulled(PassHandle pass) const { return passes[pass].culled; }
+    VkImageView getImageView(ResourceHandle resource) const { return resources[resource].view; }
+    VkExtent2D getExtent() const { return extent; }
+
+private:
+    enum class Access {
+        ColorWrite,
+        DepthWrite,
+        DepthRead,
+        InputAttachment,
+        Sampled
+    };
+
+    struct ResourceUse {
+        ResourceHandle resource;
+        Access access;
+        std::optional<VkClearValue> clear;
+    };
+
+    struct Pass {
+        std::string name;
+        ExecuteCallback execute;
+        PartCountCallback partCount;    // parallel passes only
+        PartCallback recordPart;
+        std::vector<ResourceUse> uses;
+        bool sideEffect = false;
+        bool culled = false;
+        uint32_t group = INVALID_HANDLE;
+        uint32_t subpass = 0;
+    };
+
+    struct Resource {
+        std::string name;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        bool imported = false;
+        std::vector<VkImageView> importedViews;
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // transient image, created by compile()
+        VkImageUsageFlags usage = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkMemoryRequirements memoryRequirements{};
+        uint32_t memoryBlock = INVALID_HANDLE;
+        bool lazy = false;          // only used inside one render pass, never stored to memory
+
+        // lifetime in pass indices and every stage/access it is used with
+        uint32_t firstPass = INVALID_HANDLE;
+        uint32_t lastPass = 0;
+        VkPipelineStageFlags allStages = 0;
+        VkAccessFlags allWriteAccess = 0;
+    };
+
+    // one allocation shared by transient images with disjoint lifetimes
+    struct MemoryBlock {
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VkMemoryRequirements requirements{};
+        std::vector<ResourceHandle> occupants;   // sorted by lifetime
+        bool lazy = false;                       // lazily allocated, not shared
+    };
+
+    // a group of merged passes, recorded as one render pass
+    struct PassGroup {
+        std::vector<PassHandle> passes;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<ResourceHandle> attachments;
+        std::vector<VkClearValue> clearValues;
+    };
+
+    // synchronization state of a resource while walking the compiled passes
+    struct ResourceState {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        uint32_t writeGroup = INVALID_HANDLE;
+        uint32_t writeSubpass = 0;
+        VkPipelineStageFlags readStages = 0;
+        uint32_t readGroup = INVALID_HANDLE;
+        uint32_t readSubpassMask = 0;
+        bool readExternal = false;
+        bool hasContent = false;
+    };
+
+    VkDevice device;
+    VmaAllocator allocator;
+    VkExtent2D extent;
+    bool compiled;
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<PassGroup> groups;
+    std::vector<MemoryBlock> memoryBlocks;
+
+    void addUse(PassHandle pass, ResourceHandle resource, Access access, std::optional<VkClearValue> clear);
+
+    void cullPasses();
+    void buildGroups();
+    void computeLifetimes();
+    void createTransientImages();
+    void packMemoryBlocks(std::vector<ResourceHandle>& transients);
+    void reallocateMemoryBlocks();
+    bool allocateLazily(ResourceHandle handle);
+    void buildRenderPasses();
+    void createFramebuffers(PassGroup& group);
+    void destroySizeDependent();
+    void destroy();
+
+    bool canMerge(const PassGroup& group, const Pass& pass) const;
+    bool isAttachment(Access access) const;
+    bool isDepthFormat(VkFormat format) const;
+    VkImageLayout getLayout(Access access, VkFormat format) const;
+    VkPipelineStageFlags getStages(Access access) const;
+    VkAccessFlags getAccessFlags(Access access) const;
+    bool isWrite(Access access) const;
+    VkImageUsageFlags getUsage(Access access) const;
+};
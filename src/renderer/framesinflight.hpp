@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// per frame resources are created for this many frames. RenderSettings::framesInFlight picks how
+// many of them the frame loop cycles through, fewer trade cpu and gpu overlap for latency
+inline constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
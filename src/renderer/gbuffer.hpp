@@ -1,59 +1,43 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
-#include "vk_mem_alloc.h"
 #include <vector>
+#include "framesinflight.hpp"
 
+// g-buffer images belong to the frame graph, this owns the input attachment descriptors the lighting subpass reads
+// the compact layout stores roughness in albedo alpha and octahedral normals in RG16, see shaders/gbuffer.glsl
 class GBuffer {
 public:
     static constexpr VkFormat ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
     static constexpr VkFormat NORMAL_FORMAT = VK_FORMAT_A2R10G10B10_UNORM_PACK32;
     static constexpr VkFormat ROUGHNESS_FORMAT = VK_FORMAT_R8_UNORM;
-    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+    static constexpr VkFormat COMPACT_NORMAL_FORMAT = VK_FORMAT_R16G16_UNORM;
 
 private:
     VkDevice device;
-    VmaAllocator allocator;
-    VkExtent2D extent;
+    bool compact;
+    uint32_t bindingCount;
 
-    VkImage albedoImage;
-    VmaAllocation albedoAllocation;
-    VkImageView albedoImageView;
-
-    VkImage normalImage;
-    VmaAllocation normalAllocation;
-    VkImageView normalImageView;
-
-    VkImage roughnessImage;
-    VmaAllocation roughnessAllocation;
-    VkImageView roughnessImageView;
-
-    VkSampler sampler;
     VkDescriptorSetLayout descriptorSetLayout;
     VkDescriptorPool descriptorPool;
     std::vector<VkDescriptorSet> descriptorSets;
 
 public:
-    GBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VmaAllocator allocator, VkExtent2D extent);
+    GBuffer(VkDevice device, bool compact);
     ~GBuffer();
 
     void cleanup();
-    void recreate(VkExtent2D newExtent, VkImageView depthImageView);
-    void updateDescriptorSets(VkImageView depthImageView);
+    // called whenever the frame graph recreates its images, roughnessImageView is ignored in the compact layout
+    void updateDescriptorSets(VkImageView albedoImageView, VkImageView normalImageView,
+        VkImageView roughnessImageView, VkImageView depthImageView);
+
+    bool isCompact() const { return compact; }
+    VkFormat getNormalFormat() const { return compact ? COMPACT_NORMAL_FORMAT : NORMAL_FORMAT; }
 
-    VkImageView getAlbedoImageView() const { return albedoImageView; }
-    VkImageView getNormalImageView() const { return normalImageView; }
-    VkImageView getRoughnessImageView() const { return roughnessImageView; }
-    VkSampler getSampler() const { return sampler; }
     VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
     VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const { return descriptorSets[frameIndex]; }
-    VkExtent2D getExtent() const { return extent; }
 
 private:
-    void createResources();
-    void createImage(VkFormat format, VkImage& image, VmaAllocation& allocation);
-    void createImageView(VkImage image, VkFormat format, VkImageView& imageView);
-    void createSampler();
     void createDescriptorSetLayout();
     void createDescriptorPool();
     void createDescriptorSets();
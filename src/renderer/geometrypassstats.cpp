@@ -0,0 +1,98 @@
+#include "geometrypassstats.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    // weight of the newest sample in the running average
+    constexpr float SMOOTHING = 0.1f;
+}
+
+GeometryPassStats::GeometryPassStats(VkDevice device, VkPhysicalDevice physicalDevice)
+    : device(device)
+    , statisticsPools{}
+    , recordedParts{}
+    , recordedExtents{}
+    , statisticsSupported(false)
+    , shadedFragments(0)
+    , overdraw(0.0f)
+{
+    // the logical device enables pipeline statistics whenever the gpu supports them
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    statisticsSupported = features.pipelineStatisticsQuery == VK_TRUE;
+
+    if (statisticsSupported) {
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            VkQueryPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            poolInfo.queryCount = MAX_PARTS;
+            poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+            if (vkCreateQueryPool(device, &poolInfo, nullptr, &statisticsPools[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create geometry statistics query pool");
+            }
+        }
+    }
+
+    std::cout << "geometry pass stats created (overdraw: " << (statisticsSupported ? "yes" : "no") << ")" << std::endl;
+}
+
+GeometryPassStats::~GeometryPassStats() {
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (statisticsPools[i] != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device, statisticsPools[i], nullptr);
+        }
+    }
+}
+
+void GeometryPassStats::collect(uint32_t currentFrame) {
+    uint32_t parts = recordedParts[currentFrame];
+    if (!statisticsSupported || parts == 0) {
+        return;
+    }
+
+    uint64_t partFragments[MAX_PARTS] = {};
+    VkResult result = vkGetQueryPoolResults(device, statisticsPools[currentFrame], 0, parts,
+        sizeof(partFragments), partFragments, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if (result == VK_SUCCESS) {
+        uint64_t fragments = 0;
+        for (uint32_t part = 0; part < parts; part++) {
+            fragments += partFragments[part];
+        }
+        uint64_t pixels = static_cast<uint64_t>(recordedExtents[currentFrame].width) * recordedExtents[currentFrame].height;
+        shadedFragments = fragments;
+        float sample = pixels > 0 ? static_cast<float>(fragments) / static_cast<float>(pixels) : 0.0f;
+        overdraw += (sample - overdraw) * SMOOTHING;
+    }
+}
+
+void GeometryPassStats::reset(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+    if (!statisticsSupported) {
+        return;
+    }
+
+    vkCmdResetQueryPool(commandBuffer, statisticsPools[currentFrame], 0, MAX_PARTS);
+}
+
+void GeometryPassStats::beginQuery(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t part,
+    uint32_t partCount, VkExtent2D extent) {
+    if (!statisticsSupported || part >= MAX_PARTS) {
+        return;
+    }
+
+    vkCmdBeginQuery(commandBuffer, statisticsPools[currentFrame], part, 0);
+    // the parts may be recorded concurrently, only the first one writes the frame's state
+    if (part == 0) {
+        recordedParts[currentFrame] = std::min(partCount, MAX_PARTS);
+        recordedExtents[currentFrame] = extent;
+    }
+}
+
+void GeometryPassStats::endQuery(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t part) {
+    if (statisticsSupported && part < MAX_PARTS) {
+        vkCmdEndQuery(commandBuffer, statisticsPools[currentFrame], part);
+    }
+}
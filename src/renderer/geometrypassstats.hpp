@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include <cstdint>
+#include "framesinflight.hpp"
+
+/*
+    How many fragments the g-buffer pass shaded. Overdraw is shaded fragments per rendered pixel,
+    close to 1 with the depth prepass on. The pass timings themselves come from GpuProfiler.
+    Each frame in flight has its own query pool. Results are read after that frame's fence
+    has been waited on, so reading never stalls. A pass recorded in parts on several threads
+    runs one query per part, a query cannot span secondary command buffers, and the parts are
+    summed.
+*/
+class GeometryPassStats {
+public:
+    static constexpr uint32_t MAX_PARTS = 8;
+
+    GeometryPassStats(VkDevice device, VkPhysicalDevice physicalDevice);
+    ~GeometryPassStats();
+
+    GeometryPassStats(const GeometryPassStats&) = delete;
+    GeometryPassStats& operator=(const GeometryPassStats&) = delete;
+
+    // reads this frame's results from its previous use, call after its fence was waited on
+    void collect(uint32_t currentFrame);
+
+    // outside any render pass, before the passes are recorded
+    void reset(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+    // inside the g-buffer subpass, around one part of the pass. extent is the area the pass renders
+    void beginQuery(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t part, uint32_t partCount, VkExtent2D extent);
+    void endQuery(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t part);
+
+    bool hasOverdraw() const { return statisticsSupported; }
+    uint64_t getShadedFragments() const { return shadedFragments; }
+    float getOverdraw() const { return overdraw; }
+
+private:
+    VkDevice device;
+    VkQueryPool statisticsPools[MAX_FRAMES_IN_FLIGHT];
+    uint32_t recordedParts[MAX_FRAMES_IN_FLIGHT];  // 0 until the frame recorded the pass
+    VkExtent2D recordedExtents[MAX_FRAMES_IN_FLIGHT];
+
+    bool statisticsSupported;
+
+    // smoothed so the numbers are readable in the ui
+    uint64_t shadedFragments;
+    float overdraw;
+};
@@ -8,14 +8,31 @@
 class GPUBuffer {
 
 public:
-	GPUBuffer();
-	~GPUBuffer();
+	// defined here so code that only holds buffers, like the cpu side of Mesh, links without vulkan
+	GPUBuffer() : buffer(nullptr), allocation(nullptr), size(0) {}
+	~GPUBuffer() {}
 
 	GPUBuffer(const GPUBuffer&) = delete;
 	GPUBuffer& operator=(const GPUBuffer&) = delete;
 
-	GPUBuffer(GPUBuffer&& other) noexcept;
-	GPUBuffer& operator=(GPUBuffer&& other) noexcept;
+	GPUBuffer(GPUBuffer&& other) noexcept
+		: device(other.device), buffer(other.buffer), allocation(other.allocation), size(other.size) {
+		other.buffer = VK_NULL_HANDLE;
+		other.allocation = VK_NULL_HANDLE;
+		other.size = 0;
+	}
+	GPUBuffer& operator=(GPUBuffer&& other) noexcept {
+		if (this != &other) {
+			device = other.device;
+			buffer = other.buffer;
+			allocation = other.allocation;
+			size = other.size;
+			other.buffer = VK_NULL_HANDLE;
+			other.allocation = VK_NULL_HANDLE;
+			other.size = 0;
+		}
+		return *this;
+	}
 
 	void create(VmaAllocator allocator, VkDeviceSize size, VkBufferUsageFlags usage,
 		VmaMemoryUsage memoryUsage, const void* data = nullptr,
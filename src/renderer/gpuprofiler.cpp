@@ -0,0 +1,129 @@
+#include "gpuprofiler.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    // each zone writes a begin and an end timestamp
+    constexpr uint32_t TIMESTAMP_COUNT = GpuProfiler::ZONE_COUNT * 2;
+    // weight of the newest sample in the running averages
+    constexpr float SMOOTHING = 0.1f;
+
+    const char* ZONE_NAMES[GpuProfiler::ZONE_COUNT] = {
+        "Frame",
+        "Copies",
+        "Shadows",
+        "Clusters",
+        "Prepass",
+        "Geometry",
+        "Lighting",
+        "Forward",
+        "Upscale",
+        "Debug",
+        "ImGui"
+    };
+}
+
+const char* GpuProfiler::getZoneName(Zone zone) {
+    return ZONE_NAMES[zone];
+}
+
+GpuProfiler::GpuProfiler(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsQueueFamily)
+    : device(device)
+    , queryPools{}
+    , recorded{}
+    , supported(false)
+    , timestampPeriod(1.0f)
+    , latestMs{}
+    , averageMs{}
+    , history{}
+    , historyOffset(0)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    timestampPeriod = properties.limits.timestampPeriod;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    supported = queueFamilies[graphicsQueueFamily].timestampValidBits > 0;
+
+    if (supported) {
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            VkQueryPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            poolInfo.queryCount = TIMESTAMP_COUNT;
+
+            if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPools[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create profiler query pool");
+            }
+        }
+    }
+
+    std::cout << "gpu profiler created (timestamps: " << (supported ? "yes" : "no") << ")" << std::endl;
+}
+
+GpuProfiler::~GpuProfiler() {
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (queryPools[i] != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device, queryPools[i], nullptr);
+        }
+    }
+}
+
+void GpuProfiler::collect(uint32_t currentFrame) {
+    if (!supported || !recorded[currentFrame]) {
+        return;
+    }
+
+    // value and availability per query, zones that were skipped this frame stay unavailable
+    uint64_t results[TIMESTAMP_COUNT * 2];
+    VkResult result = vkGetQueryPoolResults(device, queryPools[currentFrame], 0, TIMESTAMP_COUNT,
+        sizeof(results), results, sizeof(uint64_t) * 2,
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        return;
+    }
+
+    for (uint32_t zone = 0; zone < ZONE_COUNT; zone++) {
+        const uint64_t* beginQuery = &results[zone * 4];
+        const uint64_t* endQuery = &results[zone * 4 + 2];
+
+        float ms = 0.0f;
+        if (beginQuery[1] != 0 && endQuery[1] != 0 && endQuery[0] >= beginQuery[0]) {
+            ms = static_cast<float>(endQuery[0] - beginQuery[0]) * timestampPeriod / 1000000.0f;
+        }
+
+        latestMs[zone] = ms;
+        averageMs[zone] += (ms - averageMs[zone]) * SMOOTHING;
+        history[zone][historyOffset] = ms;
+    }
+
+    historyOffset = (historyOffset + 1) % HISTORY_SIZE;
+}
+
+void GpuProfiler::reset(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+    if (!supported) {
+        return;
+    }
+
+    vkCmdResetQueryPool(commandBuffer, queryPools[currentFrame], 0, TIMESTAMP_COUNT);
+    recorded[currentFrame] = true;
+}
+
+void GpuProfiler::begin(VkCommandBuffer commandBuffer, uint32_t currentFrame, Zone zone) {
+    if (supported) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            queryPools[currentFrame], zone * 2);
+    }
+}
+
+void GpuProfiler::end(VkCommandBuffer commandBuffer, uint32_t currentFrame, Zone zone) {
+    if (supported) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            queryPools[currentFrame], zone * 2 + 1);
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include <cstdint>
+#include "framesinflight.hpp"
+
+/*
+    GPU timings of every pass in the frame, measured with a begin and an end timestamp per zone.
+    Each frame in flight has its own query pool, reset at the start of its command buffer. Results
+    are read with availability after that frame's fence has been waited on, so reading never stalls
+    and zones that were not recorded this frame (disabled passes) simply read as zero.
+    Zones inside a render pass are only approximate on tiled GPUs, FRAME brackets the whole
+    command buffer and is the number the frame rate actually depends on.
+*/
+class GpuProfiler {
+public:
+    static constexpr uint32_t HISTORY_SIZE = 240;
+
+    enum Zone {
+        FRAME = 0,
+        COPIES,     // indirect draw buffer uploads
+        SHADOWS,    // cascades and the point light cube
+        CLUSTERS,   // light binning compute pass
+        PREPASS,
+        GEOMETRY,
+        LIGHTING,
+        FORWARD,
+        UPSCALE,
+        DEBUG,
+        IMGUI,
+        ZONE_COUNT
+    };
+
+    static const char* getZoneName(Zone zone);
+
+    GpuProfiler(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsQueueFamily);
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // reads this frame's results from its previous use, call after its fence was waited on
+    void collect(uint32_t currentFrame);
+
+    // first thing in the command buffer, outside any render pass
+    void reset(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+    void begin(VkCommandBuffer commandBuffer, uint32_t currentFrame, Zone zone);
+    void end(VkCommandBuffer commandBuffer, uint32_t currentFrame, Zone zone);
+
+    bool isSupported() const { return supported; }
+    float getLatestMs(Zone zone) const { return latestMs[zone]; }
+    float getAverageMs(Zone zone) const { return averageMs[zone]; }
+
+    // ring buffer of the last HISTORY_SIZE samples, the oldest is at getHistoryOffset()
+    const float* getHistory(Zone zone) const { return history[zone]; }
+    uint32_t getHistoryOffset() const { return historyOffset; }
+
+private:
+    VkDevice device;
+
+    VkQueryPool queryPools[MAX_FRAMES_IN_FLIGHT];
+    bool recorded[MAX_FRAMES_IN_FLIGHT];
+    bool supported;
+    float timestampPeriod;
+
+    float latestMs[ZONE_COUNT];
+    float averageMs[ZONE_COUNT];
+    float history[ZONE_COUNT][HISTORY_SIZE];
+    uint32_t historyOffset;
+};
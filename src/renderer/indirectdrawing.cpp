@@ -1,39 +1,32 @@
 #include "indirectdrawing.hpp"
-#include "mesh.hpp"
 #include <iostream>
 #include <stdexcept>
 #include <cstring>
 
-void MaterialBatch::addDraw(const Mesh* mesh, uint32_t submeshIndex, const glm::mat4& transform) {
-	addDrawWithOffsets(mesh, submeshIndex, transform, 0, 0, 0);
+IndirectArena::IndirectArena()
+	: stagingData{}
+	, totalCommands(0)
+	, allocator(nullptr)
+{
 }
 
-void MaterialBatch::addDrawWithOffsets(const Mesh* mesh, uint32_t submeshIndex, const glm::mat4& transform,
-	uint32_t globalVertexOffset, uint32_t globalIndexOffset, uint32_t modelIndex) {
-	const SubMesh& submesh = mesh->getSubmesh(submeshIndex);
-
-	IndirectDrawCommand cmd{};
-	cmd.indirectCommand.indexCount = submesh.indexCount;
-	cmd.indirectCommand.instanceCount = 1;
-	cmd.indirectCommand.firstIndex = submesh.indexOffset + globalIndexOffset;
-	cmd.indirectCommand.vertexOffset = static_cast<int32_t>(globalVertexOffset);
-	cmd.indirectCommand.firstInstance = 0;
-	cmd.mesh = mesh;
-	cmd.submeshIndex = submeshIndex;
-	cmd.modelIndex = modelIndex;
-	cmd.instanceData.modelMatrix = transform;
-
-	drawCommands.push_back(cmd);
+uint32_t IndirectArena::addRange(uint32_t maxCommands) {
+	Range range{};
+	range.firstCommand = totalCommands;
+	range.maxCommands = maxCommands;
+	ranges.push_back(range);
+
+	totalCommands += maxCommands;
+	return static_cast<uint32_t>(ranges.size() - 1);
 }
 
-void MaterialBatch::allocateBuffers(VmaAllocator alloc) {
-	if (drawCommands.empty()) {
+void IndirectArena::allocateBuffers(VmaAllocator alloc) {
+	if (totalCommands == 0) {
 		return;
 	}
 
 	this->allocator = alloc;
-	maxCommands = static_cast<uint32_t>(drawCommands.size());
-	VkDeviceSize bufferSize = maxCommands * sizeof(VkDrawIndexedIndirectCommand);
+	VkDeviceSize bufferSize = totalCommands * sizeof(VkDrawIndexedIndirectCommand);
 
 	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
 		stagingBuffers[i].create(alloc, bufferSize,
@@ -46,46 +39,58 @@ void MaterialBatch::allocateBuffers(VmaAllocator alloc) {
 			VMA_MEMORY_USAGE_GPU_ONLY,
 			nullptr, nullptr);
 
-		visibleCount[i] = 0;
+		// mapped for as long as the arena lives, culling writes into it every frame
+		void* mappedData;
+		if (vmaMapMemory(alloc, stagingBuffers[i].getAllocation(), &mappedData) != VK_SUCCESS) {
+			throw std::runtime_error("failed to map indirect staging buffer");
+		}
+		stagingData[i] = static_cast<VkDrawIndexedIndirectCommand*>(mappedData);
 	}
-
-	buffersAllocated = true;
 }
 
-void MaterialBatch::updateVisibleCommands(uint32_t frameIndex, const std::vector<VkDrawIndexedIndirectCommand>& commands) {
-	if (!buffersAllocated) {
-		visibleCount[frameIndex] = 0;
+void IndirectArena::updateRange(uint32_t frameIndex, uint32_t rangeIndex, const std::vector<VkDrawIndexedIndirectCommand>& commands) {
+	if (rangeIndex >= ranges.size()) {
 		return;
 	}
 
-	if (commands.empty()) {
-		visibleCount[frameIndex] = 0;
+	Range& range = ranges[rangeIndex];
+	if (stagingData[frameIndex] == nullptr) {
+		range.drawCount[frameIndex] = 0;
 		return;
 	}
 
 	uint32_t count = static_cast<uint32_t>(commands.size());
-	if (count > maxCommands) {
-		count = maxCommands;
+	if (count > range.maxCommands) {
+		count = range.maxCommands;
 	}
 
-	void* mappedData;
-	if (vmaMapMemory(allocator, stagingBuffers[frameIndex].getAllocation(), &mappedData) == VK_SUCCESS) {
-		std::memcpy(mappedData, commands.data(), count * sizeof(VkDrawIndexedIndirectCommand));
-		vmaUnmapMemory(allocator, stagingBuffers[frameIndex].getAllocation());
+	if (count > 0) {
+		std::memcpy(stagingData[frameIndex] + range.firstCommand, commands.data(),
+			count * sizeof(VkDrawIndexedIndirectCommand));
 	}
-
-	visibleCount[frameIndex] = count;
+	range.drawCount[frameIndex] = count;
 }
 
-void MaterialBatch::recordBufferCopy(VkCommandBuffer cmd, uint32_t frameIndex) {
-	if (!buffersAllocated || visibleCount[frameIndex] == 0) {
+void IndirectArena::recordBufferCopy(VkCommandBuffer cmd, uint32_t frameIndex) {
+	if (stagingData[frameIndex] == nullptr) {
+		return;
+	}
+
+	// ranges are laid out in order, so the last one with draws ends the copy
+	uint32_t endCommand = 0;
+	for (const Range& range : ranges) {
+		if (range.drawCount[frameIndex] > 0) {
+			endCommand = range.firstCommand + range.drawCount[frameIndex];
+		}
+	}
+	if (endCommand == 0) {
 		return;
 	}
 
 	VkBufferCopy copyRegion{};
 	copyRegion.srcOffset = 0;
 	copyRegion.dstOffset = 0;
-	copyRegion.size = visibleCount[frameIndex] * sizeof(VkDrawIndexedIndirectCommand);
+	copyRegion.size = endCommand * sizeof(VkDrawIndexedIndirectCommand);
 
 	vkCmdCopyBuffer(cmd,
 		stagingBuffers[frameIndex].getBuffer(),
@@ -111,13 +116,25 @@ void MaterialBatch::recordBufferCopy(VkCommandBuffer cmd, uint32_t frameIndex) {
 		0, nullptr);
 }
 
-void MaterialBatch::cleanup(VmaAllocator allocator) {
+IndirectDraws IndirectArena::getDraws(uint32_t frameIndex, uint32_t rangeIndex) const {
+	IndirectDraws draws{};
+	draws.buffer = indirectBuffers[frameIndex].getBuffer();
+	if (rangeIndex < ranges.size()) {
+		draws.offset = ranges[rangeIndex].firstCommand * sizeof(VkDrawIndexedIndirectCommand);
+		draws.count = draws.buffer != VK_NULL_HANDLE ? ranges[rangeIndex].drawCount[frameIndex] : 0;
+	}
+	return draws;
+}
+
+void IndirectArena::cleanup(VmaAllocator allocator) {
 	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+		if (stagingData[i] != nullptr) {
+			vmaUnmapMemory(allocator, stagingBuffers[i].getAllocation());
+			stagingData[i] = nullptr;
+		}
 		indirectBuffers[i].destroy(allocator);
 		stagingBuffers[i].destroy(allocator);
-		visibleCount[i] = 0;
 	}
-	drawCommands.clear();
-	buffersAllocated = false;
-	maxCommands = 0;
-}
+	ranges.clear();
+	totalCommands = 0;
+}
\ No newline at end of file
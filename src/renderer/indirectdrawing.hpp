@@ -2,49 +2,44 @@
 
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
+#include <map>
+#include <utility>
 #include <vector>
 #include "vk_mem_alloc.h"
 #include "gpubuffer.hpp"
 #include "materialmanager.hpp"
+#include "framesinflight.hpp"
 
 class Mesh;
 class CommandBuffer;
 
-static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
-
-struct InstanceData {
-	glm::mat4 modelMatrix;
-};
-
+/*
+	One submesh drawn at every model that places it. instanceCount and firstInstance are
+	filled in by culling: the surviving model indices are written to a per frame instance
+	list and firstInstance points at this command's run in it, so the vertex shader finds
+	its model matrix as transforms[instances[gl_InstanceIndex]].
+*/
 struct IndirectDrawCommand {
 	VkDrawIndexedIndirectCommand indirectCommand;
 	const Mesh* mesh;
 	uint32_t submeshIndex;
-	uint32_t modelIndex;
-	InstanceData instanceData;
+	std::vector<uint32_t> instances;	// model index of every placement
 };
 
 /*
-	MaterialBatch manages double-buffered GPU indirect draw buffers with staging.
-	The drawCommands list holds all possible submesh draws for this material.
-	Per frame, visible commands are copied to staging then transferred to GPU buffers.
+	The submeshes drawn with one material. The drawCommands list holds one command per submesh
+	with this material, however many models place it. Culling reads the batches and packs the
+	visible commands of all of them into the arena range of their kind.
 */
 struct MaterialBatch {
 	const MaterialManager::Material* material;
 	std::vector<IndirectDrawCommand> drawCommands;
+	uint32_t instanceCount;
 
-	GPUBuffer indirectBuffers[MAX_FRAMES_IN_FLIGHT];
-	GPUBuffer stagingBuffers[MAX_FRAMES_IN_FLIGHT];
-	uint32_t visibleCount[MAX_FRAMES_IN_FLIGHT];
-	uint32_t maxCommands;
-	bool buffersAllocated;
-	VmaAllocator allocator;
+	// command index of each (mesh, submesh) while the batch is built
+	std::map<std::pair<const Mesh*, uint32_t>, uint32_t> commandLookup;
 
-	MaterialBatch() : material(nullptr), maxCommands(0), buffersAllocated(false), allocator(nullptr) {
-		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-			visibleCount[i] = 0;
-		}
-	}
+	MaterialBatch() : material(nullptr), instanceCount(0) {}
 	~MaterialBatch() = default;
 
 	MaterialBatch(const MaterialBatch&) = delete;
@@ -53,16 +48,65 @@ struct MaterialBatch {
 	MaterialBatch(MaterialBatch&&) noexcept = default;
 	MaterialBatch& operator=(MaterialBatch&&) noexcept = default;
 
-	void addDraw(const Mesh* mesh, uint32_t submeshIndex, const glm::mat4& transform);
-	void addDrawWithOffsets(const Mesh* mesh, uint32_t submeshIndex, const glm::mat4& transform,
-		uint32_t globalVertexOffset, uint32_t globalIndexOffset, uint32_t modelIndex = 0);
+	// adds modelIndex as an instance of the submesh, the first one creates its command
+	void addInstance(const Mesh* mesh, uint32_t submeshIndex, uint32_t modelIndex,
+		uint32_t globalVertexOffset = 0, uint32_t globalIndexOffset = 0);
+
+	void cleanup();
+};
+
+// one entry of the camera instance list: the model placed, and the material its draw uses
+struct VisibleInstance {
+	uint32_t modelIndex;
+	uint32_t materialIndex;		// into the bindless material buffer, see MaterialManager::getShaderIndex
+};
+
+// where one range's draws sit in a frame's arena buffer, ready for vkCmdDrawIndexedIndirect
+struct IndirectDraws {
+	VkBuffer buffer;
+	VkDeviceSize offset;
+	uint32_t count;
+};
+
+/*
+	IndirectArena holds the indirect draw commands of every draw list in one buffer per frame in
+	flight. Each list gets a fixed range of commands when the batches are built, culling fills
+	the ranges in the persistently mapped staging buffer, and one copy plus one barrier moves
+	everything written this frame to the device buffer. The copy spans from the first command to
+	the end of the last range with draws, unused tails of earlier ranges ride along.
+*/
+class IndirectArena {
+public:
+	IndirectArena();
+	~IndirectArena() = default;
+
+	IndirectArena(const IndirectArena&) = delete;
+	IndirectArena& operator=(const IndirectArena&) = delete;
 
+	// reserves maxCommands after the previous range and returns the range's index. ranges are
+	// added first, then allocateBuffers sizes the buffers for all of them
+	uint32_t addRange(uint32_t maxCommands);
 	void allocateBuffers(VmaAllocator allocator);
-	void updateVisibleCommands(uint32_t frameIndex, const std::vector<VkDrawIndexedIndirectCommand>& commands);
+
+	// writes this frame's commands of a range, anything past its capacity is dropped
+	void updateRange(uint32_t frameIndex, uint32_t range, const std::vector<VkDrawIndexedIndirectCommand>& commands);
 	void recordBufferCopy(VkCommandBuffer cmd, uint32_t frameIndex);
 
-	VkBuffer getIndirectBuffer(uint32_t frameIndex) const { return indirectBuffers[frameIndex].getBuffer(); }
-	uint32_t getVisibleCount(uint32_t frameIndex) const { return visibleCount[frameIndex]; }
+	IndirectDraws getDraws(uint32_t frameIndex, uint32_t range) const;
 
 	void cleanup(VmaAllocator allocator);
+
+private:
+	struct Range {
+		uint32_t firstCommand;
+		uint32_t maxCommands;
+		uint32_t drawCount[MAX_FRAMES_IN_FLIGHT];
+	};
+
+	GPUBuffer indirectBuffers[MAX_FRAMES_IN_FLIGHT];
+	GPUBuffer stagingBuffers[MAX_FRAMES_IN_FLIGHT];
+	VkDrawIndexedIndirectCommand* stagingData[MAX_FRAMES_IN_FLIGHT];
+	std::vector<Range> ranges;
+	uint32_t totalCommands;
+	VmaAllocator allocator;
 };
@@ -0,0 +1,136 @@
+#include "instancelist.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+InstanceList::InstanceList(VkDevice device)
+    : device(device)
+    , descriptorSetLayout(VK_NULL_HANDLE)
+    , descriptorPool(VK_NULL_HANDLE)
+    , descriptorSets{}
+    , writtenRevision{}
+    , written{}
+{
+    createDescriptorSetLayout();
+    createDescriptorSets();
+}
+
+InstanceList::~InstanceList() {
+}
+
+void InstanceList::cleanup(VmaAllocator allocator) {
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        instanceBuffers[i].destroy(allocator);
+        written[i] = false;
+    }
+
+    if (descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        descriptorPool = VK_NULL_HANDLE;
+    }
+
+    if (descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        descriptorSetLayout = VK_NULL_HANDLE;
+    }
+}
+
+void InstanceList::createDescriptorSetLayout() {
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    for (uint32_t i = 0; i < 2; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create instance list descriptor set layout");
+    }
+}
+
+void InstanceList::createDescriptorSets() {
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT * 2;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create instance list descriptor pool");
+    }
+
+    VkDescriptorSetLayout layouts[MAX_FRAMES_IN_FLIGHT];
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        layouts[i] = descriptorSetLayout;
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+    allocInfo.pSetLayouts = layouts;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate instance list descriptor sets");
+    }
+}
+
+void InstanceList::upload(VmaAllocator allocator, uint32_t frame, const std::vector<uint32_t>& instances,
+    VkBuffer transformBuffer, uint64_t transformRevision) {
+    bool rewrite = !written[frame] || writtenRevision[frame] != transformRevision;
+
+    VkDeviceSize requiredSize = std::max<size_t>(instances.size(), 1) * sizeof(uint32_t);
+    if (instanceBuffers[frame].getSize() < requiredSize) {
+        instanceBuffers[frame].destroy(allocator);
+        instanceBuffers[frame].create(allocator, requiredSize * 2,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU,
+            nullptr, nullptr);
+        rewrite = true;
+    }
+
+    if (!instances.empty()) {
+        void* data;
+        vmaMapMemory(allocator, instanceBuffers[frame].getAllocation(), &data);
+        memcpy(data, instances.data(), instances.size() * sizeof(uint32_t));
+        vmaUnmapMemory(allocator, instanceBuffers[frame].getAllocation());
+    }
+
+    if (rewrite) {
+        writeDescriptorSet(frame, transformBuffer);
+        writtenRevision[frame] = transformRevision;
+        written[frame] = true;
+    }
+}
+
+void InstanceList::writeDescriptorSet(uint32_t frame, VkBuffer transformBuffer) {
+    VkDescriptorBufferInfo bufferInfos[2]{};
+    bufferInfos[0].buffer = transformBuffer;
+    bufferInfos[0].offset = 0;
+    bufferInfos[0].range = VK_WHOLE_SIZE;
+    bufferInfos[1].buffer = instanceBuffers[frame].getBuffer();
+    bufferInfos[1].offset = 0;
+    bufferInfos[1].range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet descriptorWrites[2]{};
+    for (uint32_t i = 0; i < 2; i++) {
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = descriptorSets[frame];
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+    }
+
+    vkUpdateDescriptorSets(device, 2, descriptorWrites, 0, nullptr);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include "gpubuffer.hpp"
+#include "vk_mem_alloc.h"
+#include <cstdint>
+#include <vector>
+#include "framesinflight.hpp"
+
+/*
+    Instance list of a pass that culls the scene on its own, like the shadow maps. The pass
+    writes the model indices that survived into this frame's list and points each command's
+    firstInstance at its run, the vertex shader then reads transforms[instances[gl_InstanceIndex]].
+    One descriptor set per frame holds binding 0, the scene's model matrices, and binding 1,
+    the list itself.
+*/
+class InstanceList {
+public:
+    explicit InstanceList(VkDevice device);
+    ~InstanceList();
+
+    InstanceList(const InstanceList&) = delete;
+    InstanceList& operator=(const InstanceList&) = delete;
+
+    void cleanup(VmaAllocator allocator);
+
+    // writes this frame's instances, the frame's previous submission must have finished.
+    // the set is rewritten when the list grows or the scene replaced its transform buffer
+    void upload(VmaAllocator allocator, uint32_t frame, const std::vector<uint32_t>& instances,
+        VkBuffer transformBuffer, uint64_t transformRevision);
+
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+    VkDescriptorSet getDescriptorSet(uint32_t frame) const { return descriptorSets[frame]; }
+
+private:
+    VkDevice device;
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSets[MAX_FRAMES_IN_FLIGHT];
+
+    GPUBuffer instanceBuffers[MAX_FRAMES_IN_FLIGHT];
+    uint64_t writtenRevision[MAX_FRAMES_IN_FLIGHT];
+    bool written[MAX_FRAMES_IN_FLIGHT];
+
+    void createDescriptorSetLayout();
+    void createDescriptorSets();
+    void writeDescriptorSet(uint32_t frame, VkBuffer transformBuffer);
+};
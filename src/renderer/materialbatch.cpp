@@ -0,0 +1,33 @@
+#include "indirectdrawing.hpp"
+#include "mesh.hpp"
+
+// MaterialBatch is plain cpu data, it lives apart from IndirectArena so it builds without vulkan
+
+void MaterialBatch::addInstance(const Mesh* mesh, uint32_t submeshIndex, uint32_t modelIndex,
+	uint32_t globalVertexOffset, uint32_t globalIndexOffset) {
+	auto [it, inserted] = commandLookup.emplace(std::make_pair(mesh, submeshIndex),
+		static_cast<uint32_t>(drawCommands.size()));
+
+	if (inserted) {
+		const SubMesh& submesh = mesh->getSubmesh(submeshIndex);
+
+		IndirectDrawCommand cmd{};
+		cmd.indirectCommand.indexCount = submesh.indexCount;
+		cmd.indirectCommand.instanceCount = 0;
+		cmd.indirectCommand.firstIndex = submesh.indexOffset + globalIndexOffset;
+		cmd.indirectCommand.vertexOffset = static_cast<int32_t>(globalVertexOffset);
+		cmd.indirectCommand.firstInstance = 0;
+		cmd.mesh = mesh;
+		cmd.submeshIndex = submeshIndex;
+		drawCommands.push_back(std::move(cmd));
+	}
+
+	drawCommands[it->second].instances.push_back(modelIndex);
+	instanceCount++;
+}
+
+void MaterialBatch::cleanup() {
+	drawCommands.clear();
+	commandLookup.clear();
+	instanceCount = 0;
+}
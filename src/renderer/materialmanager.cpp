@@ -4,14 +4,23 @@
 #include <sstream>
 #include <stdexcept>
 #include <array>
+#include <unordered_map>
 
-MaterialManager::MaterialManager(VkDevice device, TextureManager* textureManager)
+MaterialManager::MaterialManager(VkDevice device, VmaAllocator allocator, CommandBuffer* commandBuffer,
+                                 TextureManager* textureManager)
     : device(device)
+    , allocator(allocator)
+    , commandBuffer(commandBuffer)
     , textureManager(textureManager)
     , descriptorSetLayout(VK_NULL_HANDLE)
     , descriptorPool(VK_NULL_HANDLE)
+    , bindlessDescriptorSetLayout(VK_NULL_HANDLE)
+    , bindlessDescriptorPool(VK_NULL_HANDLE)
+    , bindlessDescriptorSet(VK_NULL_HANDLE)
 {
     createDescriptorSetLayout();
+    createBindlessDescriptorSet();
+    updateBindlessDescriptorSet();
 }
 
 MaterialManager::~MaterialManager() {
@@ -28,6 +37,19 @@ void MaterialManager::cleanup() {
         descriptorSetLayout = VK_NULL_HANDLE;
     }
 
+    materialBuffer.destroy(allocator);
+
+    if (bindlessDescriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, bindlessDescriptorPool, nullptr);
+        bindlessDescriptorPool = VK_NULL_HANDLE;
+        bindlessDescriptorSet = VK_NULL_HANDLE;
+    }
+
+    if (bindlessDescriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, bindlessDescriptorSetLayout, nullptr);
+        bindlessDescriptorSetLayout = VK_NULL_HANDLE;
+    }
+
     materials.clear();
     materialNameToIndex.clear();
 }
@@ -91,6 +113,9 @@ void MaterialManager::loadMaterialsFromFile(const std::string& mtlFilePath, cons
 
     // recreate descriptor pool and sets to accommodate all materials
     if (newMaterialsCount > 0) {
+        // the previous sets and material buffer may still be read by a frame in flight
+        vkDeviceWaitIdle(device);
+
         // destroy old descriptor pool if it exists
         if (descriptorPool != VK_NULL_HANDLE) {
             vkDestroyDescriptorPool(device, descriptorPool, nullptr);
@@ -100,6 +125,7 @@ void MaterialManager::loadMaterialsFromFile(const std::string& mtlFilePath, cons
         // recreate pool and sets for all materials
         createDescriptorPool();
         createDescriptorSets();
+        updateBindlessDescriptorSet();
 
         std::cout << "Loaded " << newMaterialsCount << " new materials from " << mtlFilePath
                   << " (Total: " << materials.size() << ")" << std::endl;
@@ -143,15 +169,19 @@ void MaterialManager::parseMtlFile(const std::string& mtlFilePath, const std::st
                 currentMaterial.hasNormalMap = true;
             }
 
-            // determine if material has alpha (texture alpha or dissolve < 1.0)
+            // binary texture alpha is alpha tested, anything else with alpha is blended
+            bool textureAlpha = currentMaterial.hasTexture && currentMaterial.diffuseTexture->hasAlpha;
+            bool textureCutout = textureAlpha && currentMaterial.diffuseTexture->alphaCutout;
+            currentMaterial.alphaCutout = (currentMaterial.dissolve >= 1.0f) && textureCutout;
             currentMaterial.hasAlpha = (currentMaterial.dissolve < 1.0f) ||
-                (currentMaterial.hasTexture && currentMaterial.diffuseTexture->hasAlpha);
+                (textureAlpha && !textureCutout);
 
             // clamp roughness to valid range
             if (currentMaterial.roughness < 0.0f) currentMaterial.roughness = 0.0f;
             if (currentMaterial.roughness > 1.0f) currentMaterial.roughness = 1.0f;
 
-            materialNameToIndex[currentMaterial.name] = static_cast<uint32_t>(materials.size());
+            currentMaterial.index = static_cast<uint32_t>(materials.size());
+            materialNameToIndex[currentMaterial.name] = currentMaterial.index;
             materials.push_back(currentMaterial);
             hasMaterial = false;
         }
@@ -171,6 +201,7 @@ void MaterialManager::parseMtlFile(const std::string& mtlFilePath, const std::st
 
             currentMaterial = Material();
             currentMaterial.name = materialName;
+            currentMaterial.index = 0;
             currentMaterial.diffuseTexture = nullptr;
             currentMaterial.normalTexture = nullptr;
             currentMaterial.descriptorSet = VK_NULL_HANDLE;
@@ -180,6 +211,7 @@ void MaterialManager::parseMtlFile(const std::string& mtlFilePath, const std::st
             currentMaterial.hasTexture = false;
             currentMaterial.hasNormalMap = false;
             currentMaterial.hasAlpha = false;
+            currentMaterial.alphaCutout = false;
             hasMaterial = true;
 
         }
@@ -326,3 +358,142 @@ void MaterialManager::createDescriptorSets() {
 
     std::cout << "Created and updated " << materials.size() << " descriptor sets" << std::endl;
 }
+
+void MaterialManager::createBindlessDescriptorSet() {
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+
+    // Binding 0: parameters of every material
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[0].pImmutableSamplers = nullptr;
+
+    // Binding 1: every texture the materials use
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = MAX_BINDLESS_TEXTURES;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &bindlessDescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bindless material descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = MAX_BINDLESS_TEXTURES;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &bindlessDescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bindless material descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = bindlessDescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &bindlessDescriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &bindlessDescriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate bindless material descriptor set!");
+    }
+}
+
+void MaterialManager::updateBindlessDescriptorSet() {
+    const TextureManager::Texture* defaultTexture = textureManager->getDefaultTexture();
+
+    // slot 0 is the default texture, every other texture gets a slot the first time a material uses it
+    std::vector<const TextureManager::Texture*> textures = { defaultTexture };
+    std::unordered_map<const TextureManager::Texture*, uint32_t> textureSlots = { { defaultTexture, 0 } };
+
+    auto getTextureSlot = [&](const TextureManager::Texture* texture) -> uint32_t {
+        if (texture == nullptr) {
+            return 0;
+        }
+
+        auto [it, inserted] = textureSlots.emplace(texture, static_cast<uint32_t>(textures.size()));
+        if (inserted) {
+            if (textures.size() >= MAX_BINDLESS_TEXTURES) {
+                throw std::runtime_error("Too many material textures for the bindless texture array!");
+            }
+            textures.push_back(texture);
+        }
+        return it->second;
+    };
+
+    // index 0 is the fallback for submeshes without a material, magenta like an unset Kd
+    std::vector<GPUMaterial> gpuMaterials(materials.size() + 1);
+    gpuMaterials[0] = {};
+    gpuMaterials[0].diffuseColor = glm::vec4(1.0f, 0.0f, 1.0f, 1.0f);
+    gpuMaterials[0].dissolve = 1.0f;
+    gpuMaterials[0].roughness = 1.0f;
+
+    for (const Material& material : materials) {
+        GPUMaterial& gpuMaterial = gpuMaterials[getShaderIndex(&material)];
+        gpuMaterial = {};
+        gpuMaterial.diffuseColor = material.diffuseColor;
+        gpuMaterial.hasTexture = material.hasTexture ? 1u : 0u;
+        gpuMaterial.hasNormalMap = material.hasNormalMap ? 1u : 0u;
+        gpuMaterial.dissolve = material.dissolve;
+        gpuMaterial.roughness = material.roughness;
+        gpuMaterial.diffuseTexture = getTextureSlot(material.diffuseTexture);
+        gpuMaterial.normalTexture = getTextureSlot(material.normalTexture);
+    }
+
+    // uploaded through staging, the copy has finished once create returns
+    materialBuffer.destroy(allocator);
+    materialBuffer.create(allocator, sizeof(GPUMaterial) * gpuMaterials.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY,
+        gpuMaterials.data(), commandBuffer);
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = materialBuffer.getBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    // unused slots point at the default texture so the whole array is always valid
+    std::vector<VkDescriptorImageInfo> imageInfos(MAX_BINDLESS_TEXTURES);
+    for (uint32_t i = 0; i < MAX_BINDLESS_TEXTURES; ++i) {
+        const TextureManager::Texture* texture = i < textures.size() ? textures[i] : defaultTexture;
+        imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfos[i].imageView = texture->imageView;
+        imageInfos[i].sampler = textureManager->getSampler();
+    }
+
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet = bindlessDescriptorSet;
+    descriptorWrites[0].dstBinding = 0;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstSet = bindlessDescriptorSet;
+    descriptorWrites[1].dstBinding = 1;
+    descriptorWrites[1].dstArrayElement = 0;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrites[1].descriptorCount = MAX_BINDLESS_TEXTURES;
+    descriptorWrites[1].pImageInfo = imageInfos.data();
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+    std::cout << "Updated bindless material set: " << gpuMaterials.size() << " materials, "
+              << textures.size() << " textures" << std::endl;
+}
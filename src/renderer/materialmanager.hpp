@@ -1,16 +1,31 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include "vk_mem_alloc.h"
 #include "texturemanager.hpp"
+#include "gpubuffer.hpp"
+#include "shaderfeatures.hpp"
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <glm/glm.hpp>
 
+/*
+    Loads MTL materials and owns their descriptors. Every material keeps a set of its own with its
+    two textures, for the shadow passes that bind them one at a time. The camera passes bind a
+    single bindless set instead: binding 0 holds the parameters of all materials in a storage
+    buffer and binding 1 an array of every texture they use, so a whole list of draws with
+    different materials is one multi-draw. A draw finds its material through the material index
+    the scene writes next to each instance.
+*/
 class MaterialManager {
 public:
+    // must match MAX_MATERIAL_TEXTURES in materials.glsl
+    static constexpr uint32_t MAX_BINDLESS_TEXTURES = 512;
+
     struct Material {
         std::string name;
+        uint32_t index;         // position in the material list
         const TextureManager::Texture* diffuseTexture;
         const TextureManager::Texture* normalTexture;
         VkDescriptorSet descriptorSet;
@@ -19,10 +34,24 @@ public:
         float roughness;        // MTL 'Pr' value (0.0 = smooth/mirror, 1.0 = rough/matte)
         bool hasTexture;
         bool hasNormalMap;
-        bool hasAlpha;          // true if texture has alpha or dissolve < 1.0
+        bool hasAlpha;          // true if translucent texture alpha or dissolve < 1.0 (blended forward pass)
+        bool alphaCutout;       // true if texture alpha is binary (alpha tested in geometry pass)
     };
 
-    MaterialManager(VkDevice device, TextureManager* textureManager);
+    // material parameters as materials.glsl reads them, std430 layout
+    struct GPUMaterial {
+        glm::vec4 diffuseColor;
+        uint32_t hasTexture;
+        uint32_t hasNormalMap;
+        float dissolve;
+        float roughness;
+        uint32_t diffuseTexture;    // slots in the bindless texture array
+        uint32_t normalTexture;
+        uint32_t padding[2];
+    };
+
+    MaterialManager(VkDevice device, VmaAllocator allocator, CommandBuffer* commandBuffer,
+                    TextureManager* textureManager);
     ~MaterialManager();
 
     MaterialManager(const MaterialManager&) = delete;
@@ -32,19 +61,39 @@ public:
     const Material* getMaterial(uint32_t index) const;
     const Material* getMaterialByName(const std::string& name) const;
     VkDescriptorSetLayout getDescriptorSetLayout() const;
+    VkDescriptorSetLayout getBindlessDescriptorSetLayout() const { return bindlessDescriptorSetLayout; }
+    VkDescriptorSet getBindlessDescriptorSet() const { return bindlessDescriptorSet; }
+    // index into the bindless material buffer, 0 is the fallback used when material is null
+    static uint32_t getShaderIndex(const Material* material) { return material ? material->index + 1 : 0; }
+    // the ShaderFeatures material bits the material's pipeline variant is built with
+    static uint32_t getShaderFeatures(const Material* material) {
+        if (!material) return 0;
+        return (material->hasTexture ? ShaderFeatures::DIFFUSE_TEXTURE : 0)
+            | (material->hasNormalMap ? ShaderFeatures::NORMAL_MAP : 0);
+    }
     size_t getMaterialCount() const;
     void cleanup();
 
 private:
     VkDevice device;
+    VmaAllocator allocator;
+    CommandBuffer* commandBuffer;
     TextureManager* textureManager;
     VkDescriptorSetLayout descriptorSetLayout;
     VkDescriptorPool descriptorPool;
     std::vector<Material> materials;
     std::unordered_map<std::string, uint32_t> materialNameToIndex;
 
+    VkDescriptorSetLayout bindlessDescriptorSetLayout;
+    VkDescriptorPool bindlessDescriptorPool;
+    VkDescriptorSet bindlessDescriptorSet;
+    GPUBuffer materialBuffer;
+
     void createDescriptorSetLayout();
     void createDescriptorPool();
     void createDescriptorSets();
+    void createBindlessDescriptorSet();
+    // uploads the parameters of every material and rewrites both bindless bindings
+    void updateBindlessDescriptorSet();
     void parseMtlFile(const std::string& mtlFilePath, const std::string& textureBasePath);
 };
@@ -1,5 +1,5 @@
 #include "mesh.hpp"
-#include "commandbuffer.hpp"
+#include "../core/cpuprofiler.hpp"
 #include <iostream>
 #include <stdexcept>
 #include <unordered_map>
@@ -7,107 +7,118 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
-namespace {
-    void calculateTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
-        // start tangents at zero
-        std::vector<glm::vec3> tangents(vertices.size(), glm::vec3(0.0f));
-        std::vector<glm::vec3> bitangents(vertices.size(), glm::vec3(0.0f));
+Mesh::Mesh() : totalIndexCount(0) {
+}
 
-        // calculate tangent and bitangent for each triangle
-        for (size_t i = 0; i < indices.size(); i += 3) {
-            uint32_t i0 = indices[i + 0];
-            uint32_t i1 = indices[i + 1];
-            uint32_t i2 = indices[i + 2];
+Mesh::~Mesh() {
+}
 
-            const glm::vec3& p0 = vertices[i0].pos;
-            const glm::vec3& p1 = vertices[i1].pos;
-            const glm::vec3& p2 = vertices[i2].pos;
+void Mesh::calculateTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+    // start tangents at zero
+    std::vector<glm::vec3> tangents(vertices.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> bitangents(vertices.size(), glm::vec3(0.0f));
 
-            const glm::vec2& uv0 = vertices[i0].texCoord;
-            const glm::vec2& uv1 = vertices[i1].texCoord;
-            const glm::vec2& uv2 = vertices[i2].texCoord;
+    // calculate tangent and bitangent for each triangle
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        uint32_t i0 = indices[i + 0];
+        uint32_t i1 = indices[i + 1];
+        uint32_t i2 = indices[i + 2];
 
-            glm::vec3 edge1 = p1 - p0;
-            glm::vec3 edge2 = p2 - p0;
+        const glm::vec3& p0 = vertices[i0].pos;
+        const glm::vec3& p1 = vertices[i1].pos;
+        const glm::vec3& p2 = vertices[i2].pos;
 
-            glm::vec2 deltaUV1 = uv1 - uv0;
-            glm::vec2 deltaUV2 = uv2 - uv0;
+        const glm::vec2& uv0 = vertices[i0].texCoord;
+        const glm::vec2& uv1 = vertices[i1].texCoord;
+        const glm::vec2& uv2 = vertices[i2].texCoord;
 
-            float denom = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
-            float f = (std::abs(denom) > 1e-6f) ? 1.0f / denom : 0.0f;
+        glm::vec3 edge1 = p1 - p0;
+        glm::vec3 edge2 = p2 - p0;
 
-            glm::vec3 tangent;
-            tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-            tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-            tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
+        glm::vec2 deltaUV1 = uv1 - uv0;
+        glm::vec2 deltaUV2 = uv2 - uv0;
 
-            glm::vec3 bitangent;
-            bitangent.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
-            bitangent.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
-            bitangent.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
+        float denom = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+        float f = (std::abs(denom) > 1e-6f) ? 1.0f / denom : 0.0f;
 
-            tangents[i0] += tangent;
-            tangents[i1] += tangent;
-            tangents[i2] += tangent;
+        glm::vec3 tangent;
+        tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
+        tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
+        tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
 
-            bitangents[i0] += bitangent;
-            bitangents[i1] += bitangent;
-            bitangents[i2] += bitangent;
-        }
+        glm::vec3 bitangent;
+        bitangent.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
+        bitangent.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
+        bitangent.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
 
-        // orthonormalize
-        for (size_t i = 0; i < vertices.size(); ++i) {
-            const glm::vec3& n = vertices[i].normal;
-            glm::vec3 t = tangents[i];
-            glm::vec3 b = bitangents[i];
+        tangents[i0] += tangent;
+        tangents[i1] += tangent;
+        tangents[i2] += tangent;
 
-            t = glm::normalize(t - n * glm::dot(n, t));
+        bitangents[i0] += bitangent;
+        bitangents[i1] += bitangent;
+        bitangents[i2] += bitangent;
+    }
 
-            float w = (glm::dot(glm::cross(n, t), b) < 0.0f) ? -1.0f : 1.0f;
+    // orthonormalize
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const glm::vec3& n = vertices[i].normal;
+        glm::vec3 t = tangents[i];
+        glm::vec3 b = bitangents[i];
 
-            vertices[i].tangent = glm::vec4(t, w);
-        }
+        t = glm::normalize(t - n * glm::dot(n, t));
+
+        float w = (glm::dot(glm::cross(n, t), b) < 0.0f) ? -1.0f : 1.0f;
+
+        vertices[i].tangent = glm::vec4(t, w);
     }
 }
 
-Mesh::Mesh() : totalIndexCount(0) {
-}
+void Mesh::weldVertices(const std::vector<Vertex>& rawVertices, const std::vector<uint32_t>& rawIndices,
+    std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices) {
+    std::unordered_map<Vertex, uint32_t> uniqueVertices;
 
-Mesh::~Mesh() {
+    for (uint32_t rawIndex : rawIndices) {
+        const Vertex& vertex = rawVertices[rawIndex];
+
+        if (uniqueVertices.count(vertex) == 0) {
+            uniqueVertices[vertex] = static_cast<uint32_t>(outVertices.size());
+            outVertices.push_back(vertex);
+        }
+
+        outIndices.push_back(uniqueVertices[vertex]);
+    }
 }
 
-void Mesh::loadFromFile(const std::string& filepath, VmaAllocator allocator, CommandBuffer* commandBuffer) {
+void Mesh::loadCpuData(const std::string& filepath) {
     // clear any existing data
     vertices.clear();
     indices.clear();
+    submeshes.clear();
+    materialNames.clear();
 
     processObjFile(filepath, vertices, indices);
 
     totalIndexCount = static_cast<uint32_t>(indices.size());
+}
+
+void Mesh::loadFromData(std::vector<Vertex> vertices, std::vector<uint32_t> indices,
+    std::vector<SubMesh> submeshes, std::vector<std::string> materialNames) {
+    if (submeshes.empty() || submeshes.size() != materialNames.size()) {
+        throw std::runtime_error("mesh data needs one material name per submesh");
+    }
 
-    // vertx -> gpu
-    VkDeviceSize vertexBufferSize = sizeof(Vertex) * vertices.size();
-    vertexBuffer.create(allocator, vertexBufferSize,
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VMA_MEMORY_USAGE_GPU_ONLY,
-        vertices.data(), commandBuffer);
-
-    // index -> gpu
-    VkDeviceSize indexBufferSize = sizeof(uint32_t) * indices.size();
-    indexBuffer.create(allocator, indexBufferSize,
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VMA_MEMORY_USAGE_GPU_ONLY,
-        indices.data(), commandBuffer);
-
-    std::cout << "mesh loaded from " << filepath << ": "
-        << vertices.size() << " vertices, "
-        << indices.size() << " indices, "
-        << submeshes.size() << " submeshes" << std::endl;
+    this->vertices = std::move(vertices);
+    this->indices = std::move(indices);
+    this->submeshes = std::move(submeshes);
+    this->materialNames = std::move(materialNames);
+    totalIndexCount = static_cast<uint32_t>(this->indices.size());
 }
 
 void Mesh::processObjFile(const std::string& filepath,
     std::vector<Vertex>& outVertices,
     std::vector<uint32_t>& outIndices) {
+    CPU_PROFILE_ZONE("Mesh::processObjFile");
 
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
@@ -196,25 +207,13 @@ void Mesh::processObjFile(const std::string& filepath,
     // calculate tangents on raw vertices
     calculateTangents(rawVertices, rawIndices);
 
-    // second pass deduplicate vertices
-    std::unordered_map<Vertex, uint32_t> uniqueVertices;
+    // second pass deduplicate vertices, welding keeps every index in place so the submesh ranges stay valid
+    weldVertices(rawVertices, rawIndices, outVertices, outIndices);
     size_t shapeIndex = 0;
 
     for (const auto& range : submeshRanges) {
-        uint32_t submeshStartIndex = static_cast<uint32_t>(outIndices.size());
-
-        for (uint32_t i = range.first; i < range.first + range.second; ++i) {
-            const Vertex& vertex = rawVertices[rawIndices[i]];
-
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(outVertices.size());
-                outVertices.push_back(vertex);
-            }
-
-            outIndices.push_back(uniqueVertices[vertex]);
-        }
-
-        uint32_t submeshIndexCount = static_cast<uint32_t>(outIndices.size()) - submeshStartIndex;
+        uint32_t submeshStartIndex = range.first;
+        uint32_t submeshIndexCount = range.second;
 
         int materialId = 0;
         if (shapeIndex < shapes.size() && !shapes[shapeIndex].mesh.material_ids.empty()) {
@@ -230,38 +229,6 @@ void Mesh::processObjFile(const std::string& filepath,
     }
 }
 
-void Mesh::destroy(VmaAllocator allocator) {
-    vertexBuffer.destroy(allocator);
-    indexBuffer.destroy(allocator);
-    submeshes.clear();
-    materialNames.clear();
-    vertices.clear();
-    indices.clear();
-    totalIndexCount = 0;
-}
-
-void Mesh::bind(VkCommandBuffer commandBuffer) const {
-    VkBuffer vertexBuffers[] = { vertexBuffer.getBuffer() };
-    VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(commandBuffer, indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
-}
-
-void Mesh::draw(VkCommandBuffer commandBuffer, uint32_t submeshIndex) const {
-    if (submeshIndex >= submeshes.size()) {
-        throw std::runtime_error("Invalid submesh index");
-    }
-
-    const SubMesh& submesh = submeshes[submeshIndex];
-    vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.indexOffset, 0, 0);
-}
-
-void Mesh::drawAll(VkCommandBuffer commandBuffer) const {
-    for (uint32_t i = 0; i < submeshes.size(); ++i) {
-        draw(commandBuffer, i);
-    }
-}
-
 const std::string& Mesh::getMaterialName(uint32_t submeshIndex) const {
     if (submeshIndex >= materialNames.size()) {
         throw std::runtime_error("Invalid submesh index for getMaterialName");
@@ -26,6 +26,12 @@ public:
     Mesh& operator=(const Mesh&) = delete;
 
     void loadFromFile(const std::string& filepath, VmaAllocator allocator, CommandBuffer* commandBuffer);
+    // parses, computes tangents and welds without touching the gpu, loadFromFile uploads the result
+    void loadCpuData(const std::string& filepath);
+    // geometry built on the cpu, like generated or pre-transformed copies. it reaches the gpu
+    // only through the scene's unified buffers, so bind and draw are not available for it
+    void loadFromData(std::vector<Vertex> vertices, std::vector<uint32_t> indices,
+        std::vector<SubMesh> submeshes, std::vector<std::string> materialNames);
     void destroy(VmaAllocator allocator);
 
     void bind(VkCommandBuffer commandBuffer) const;
@@ -43,6 +49,13 @@ public:
     const std::vector<uint32_t>& getIndices() const { return indices; }
     uint32_t getVertexCount() const { return static_cast<uint32_t>(vertices.size()); }
 
+    // loader stages, public so the microbenchmarks can time them on their own
+    // tangents are accumulated per triangle, so they are computed before welding
+    static void calculateTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    // merges identical vertices, outIndices has one entry per raw index in the same order
+    static void weldVertices(const std::vector<Vertex>& rawVertices, const std::vector<uint32_t>& rawIndices,
+        std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices);
+
 private:
     GPUBuffer vertexBuffer;
     GPUBuffer indexBuffer;
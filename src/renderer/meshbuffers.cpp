@@ -0,0 +1,61 @@
+#include "mesh.hpp"
+#include "commandbuffer.hpp"
+#include <iostream>
+#include <stdexcept>
+
+// the gpu side of Mesh, kept apart from mesh.cpp so the microbenchmarks load meshes without vulkan
+
+void Mesh::loadFromFile(const std::string& filepath, VmaAllocator allocator, CommandBuffer* commandBuffer) {
+    loadCpuData(filepath);
+
+    // vertx -> gpu
+    VkDeviceSize vertexBufferSize = sizeof(Vertex) * vertices.size();
+    vertexBuffer.create(allocator, vertexBufferSize,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY,
+        vertices.data(), commandBuffer);
+
+    // index -> gpu
+    VkDeviceSize indexBufferSize = sizeof(uint32_t) * indices.size();
+    indexBuffer.create(allocator, indexBufferSize,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY,
+        indices.data(), commandBuffer);
+
+    std::cout << "mesh loaded from " << filepath << ": "
+        << vertices.size() << " vertices, "
+        << indices.size() << " indices, "
+        << submeshes.size() << " submeshes" << std::endl;
+}
+
+void Mesh::destroy(VmaAllocator allocator) {
+    vertexBuffer.destroy(allocator);
+    indexBuffer.destroy(allocator);
+    submeshes.clear();
+    materialNames.clear();
+    vertices.clear();
+    indices.clear();
+    totalIndexCount = 0;
+}
+
+void Mesh::bind(VkCommandBuffer commandBuffer) const {
+    VkBuffer vertexBuffers[] = { vertexBuffer.getBuffer() };
+    VkDeviceSize offsets[] = { 0 };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void Mesh::draw(VkCommandBuffer commandBuffer, uint32_t submeshIndex) const {
+    if (submeshIndex >= submeshes.size()) {
+        throw std::runtime_error("Invalid submesh index");
+    }
+
+    const SubMesh& submesh = submeshes[submeshIndex];
+    vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.indexOffset, 0, 0);
+}
+
+void Mesh::drawAll(VkCommandBuffer commandBuffer) const {
+    for (uint32_t i = 0; i < submeshes.size(); ++i) {
+        draw(commandBuffer, i);
+    }
+}
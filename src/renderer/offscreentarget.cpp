@@ -0,0 +1,64 @@
+#include "offscreentarget.hpp"
+#include <stdexcept>
+#include <iostream>
+
+OffscreenTarget::OffscreenTarget(VkDevice device, VmaAllocator allocator, VkExtent2D extent, uint32_t imageCount)
+    : device(device)
+    , allocator(allocator)
+    , extent(extent)
+{
+    images.resize(imageCount, VK_NULL_HANDLE);
+    allocations.resize(imageCount, VK_NULL_HANDLE);
+    imageViews.resize(imageCount, VK_NULL_HANDLE);
+
+    for (uint32_t i = 0; i < imageCount; i++) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = { extent.width, extent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = FORMAT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // transfer source so a frame can still be read back for inspection
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        if (vmaCreateImage(allocator, &imageInfo, &allocInfo, &images[i], &allocations[i], nullptr) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen image");
+        }
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = images[i];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = FORMAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &imageViews[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen image view");
+        }
+    }
+
+    std::cout << "offscreen target created: " << extent.width << "x" << extent.height << std::endl;
+}
+
+OffscreenTarget::~OffscreenTarget() {
+    for (size_t i = 0; i < images.size(); i++) {
+        if (imageViews[i] != VK_NULL_HANDLE) {
+            vkDestroyImageView(device, imageViews[i], nullptr);
+        }
+        if (images[i] != VK_NULL_HANDLE) {
+            vmaDestroyImage(allocator, images[i], allocations[i]);
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include "vk_mem_alloc.h"
+#include <vector>
+
+/*
+    Stands in for the swap chain when there is no window. Owns one color image per frame in
+    flight, imported into the frame graph as the backbuffer, so a frame renders exactly like it
+    would for presentation and is then simply never shown.
+*/
+class OffscreenTarget {
+public:
+    static constexpr VkFormat FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+    OffscreenTarget(VkDevice device, VmaAllocator allocator, VkExtent2D extent, uint32_t imageCount);
+    ~OffscreenTarget();
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    VkFormat getImageFormat() const { return FORMAT; }
+    VkExtent2D getExtent() const { return extent; }
+    const std::vector<VkImageView>& getImageViews() const { return imageViews; }
+    size_t getImageCount() const { return images.size(); }
+
+private:
+    VkDevice device;
+    VmaAllocator allocator;
+    VkExtent2D extent;
+
+    std::vector<VkImage> images;
+    std::vector<VmaAllocation> allocations;
+    std::vector<VkImageView> imageViews;
+};
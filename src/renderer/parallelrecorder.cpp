@@ -0,0 +1,156 @@
+#include "parallelrecorder.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+ParallelRecorder::ParallelRecorder(VkDevice device, uint32_t queueFamily, uint32_t workerCount)
+    : device(device)
+    , runningJobs(0)
+    , stopping(false)
+{
+    if (workerCount == 0) {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+    workerCount = std::clamp(workerCount, 1u, MAX_WORKERS);
+
+    // transient, the buffers are re-recorded every time their frame comes around
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+        for (uint32_t worker = 0; worker < workerCount; worker++) {
+            if (vkCreateCommandPool(device, &poolInfo, nullptr, &pools[frame][worker].pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create recording thread command pool");
+            }
+        }
+    }
+
+    workers.reserve(workerCount);
+    for (uint32_t worker = 0; worker < workerCount; worker++) {
+        workers.emplace_back(&ParallelRecorder::workerLoop, this, worker);
+    }
+
+    std::cout << "parallel recorder created (" << workerCount << " recording threads)" << std::endl;
+}
+
+ParallelRecorder::~ParallelRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAdded.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // destroying a pool frees its command buffers
+    for (auto& framePools : pools) {
+        for (WorkerPool& pool : framePools) {
+            if (pool.pool != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(device, pool.pool, nullptr);
+            }
+        }
+    }
+}
+
+void ParallelRecorder::beginFrame(uint32_t frameIndex) {
+    for (uint32_t worker = 0; worker < getWorkerCount(); worker++) {
+        WorkerPool& pool = pools[frameIndex][worker];
+        if (pool.used > 0) {
+            vkResetCommandPool(device, pool.pool, 0);
+            pool.used = 0;
+        }
+    }
+}
+
+void ParallelRecorder::submit(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobAdded.notify_one();
+}
+
+void ParallelRecorder::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    jobsFinished.wait(lock, [this] { return jobs.empty() && runningJobs == 0; });
+
+    if (error) {
+        std::exception_ptr thrown = error;
+        error = nullptr;
+        std::rethrow_exception(thrown);
+    }
+}
+
+void ParallelRecorder::workerLoop(uint32_t worker) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAdded.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            runningJobs++;
+        }
+
+        std::exception_ptr thrown;
+        try {
+            job(worker);
+        }
+        catch (...) {
+            thrown = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (thrown && !error) {
+                error = thrown;
+            }
+            runningJobs--;
+        }
+        jobsFinished.notify_all();
+    }
+}
+
+VkCommandBuffer ParallelRecorder::beginSecondary(uint32_t frameIndex, uint32_t worker,
+    const VkCommandBufferInheritanceInfo& inheritance) {
+
+    // only this worker touches its pool, no lock needed
+    WorkerPool& pool = pools[frameIndex][worker];
+    if (pool.used == pool.commandBuffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = pool.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate secondary command buffer");
+        }
+        pool.commandBuffers.push_back(commandBuffer);
+    }
+    VkCommandBuffer commandBuffer = pool.commandBuffers[pool.used++];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin secondary command buffer");
+    }
+    return commandBuffer;
+}
+
+void ParallelRecorder::endSecondary(VkCommandBuffer commandBuffer) {
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record secondary command buffer");
+    }
+}
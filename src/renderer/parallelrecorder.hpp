@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "framesinflight.hpp"
+
+/*
+    Worker threads that record secondary command buffers. Each worker has its own command pool
+    per frame in flight, so no pool is ever used by two threads, and beginFrame() resets all of a
+    frame's pools at once instead of freeing buffers one by one. Jobs are taken in submission
+    order by whichever worker is free; the order the secondaries are executed in is up to the
+    caller. wait() blocks until every submitted job finished and rethrows the first exception
+    one of them threw.
+*/
+class ParallelRecorder {
+public:
+    static constexpr uint32_t MAX_WORKERS = 8;
+
+    using Job = std::function<void(uint32_t worker)>;
+
+    // workerCount 0 starts one worker per hardware thread besides the calling one
+    ParallelRecorder(VkDevice device, uint32_t queueFamily, uint32_t workerCount = 0);
+    ~ParallelRecorder();
+
+    ParallelRecorder(const ParallelRecorder&) = delete;
+    ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+
+    uint32_t getWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+
+    // makes the frame's secondaries reusable, call after its fence was waited on and before
+    // jobs record into it
+    void beginFrame(uint32_t frameIndex);
+
+    void submit(Job job);
+    void wait();
+
+    // from inside a job: a secondary of the worker's pool, begun to continue the render pass
+    // and subpass the inheritance info names
+    VkCommandBuffer beginSecondary(uint32_t frameIndex, uint32_t worker, const VkCommandBufferInheritanceInfo& inheritance);
+    void endSecondary(VkCommandBuffer commandBuffer);
+
+private:
+    struct WorkerPool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> commandBuffers;    // allocated so far, reused every frame
+        uint32_t used = 0;
+    };
+
+    VkDevice device;
+    std::vector<std::thread> workers;
+    WorkerPool pools[MAX_FRAMES_IN_FLIGHT][MAX_WORKERS];
+
+    std::mutex mutex;
+    std::condition_variable jobAdded;
+    std::condition_variable jobsFinished;
+    std::deque<Job> jobs;
+    uint32_t runningJobs;
+    bool stopping;
+    std::exception_ptr error;
+
+    void workerLoop(uint32_t worker);
+};
@@ -3,58 +3,164 @@
 #include "vertex.hpp"
 #include "../core/camera.hpp"
 #include "../core/directionallight.hpp"
-#include "../core/pointlight.hpp"
+#include "clusteredlighting.hpp"
 #include "materialmanager.hpp"
 #include "gbuffer.hpp"
+#include "shaderfeatures.hpp"
 #include <iostream>
 #include <stdexcept>
 #include <array>
-
-Pipeline::Pipeline(VkDevice device, VkPhysicalDevice physicalDevice)
-    : device(device), physicalDevice(physicalDevice), geometryPipeline(VK_NULL_HANDLE),
-    pipelineLayout(VK_NULL_HANDLE), lightingPipeline(VK_NULL_HANDLE), lightingPipelineLayout(VK_NULL_HANDLE),
-    forwardPipeline(VK_NULL_HANDLE), forwardPipelineLayout(VK_NULL_HANDLE),
+#include <algorithm>
+#include <future>
+
+Pipeline::Pipeline(VkDevice device, VkPhysicalDevice physicalDevice, VkPipelineCache pipelineCache)
+    : device(device), physicalDevice(physicalDevice), pipelineCache(pipelineCache), shaderManager(nullptr),
+    depthPrepassPipeline(VK_NULL_HANDLE),
+    pipelineLayout(VK_NULL_HANDLE), lightingPipelineLayout(VK_NULL_HANDLE),
+    forwardPipelineLayout(VK_NULL_HANDLE),
     debugPipeline(VK_NULL_HANDLE), debugPipelineLayout(VK_NULL_HANDLE),
-    lightingDescriptorSetLayout(VK_NULL_HANDLE), geometryRenderPass(VK_NULL_HANDLE),
-    lightingRenderPass(VK_NULL_HANDLE), forwardRenderPass(VK_NULL_HANDLE),
-    debugRenderPass(VK_NULL_HANDLE), imguiRenderPass(VK_NULL_HANDLE),
-    swapChainExtent{}, swapChainImageFormat(VK_FORMAT_UNDEFINED), camera(nullptr),
+    lightingDescriptorSetLayout(VK_NULL_HANDLE), passTargets{},
+    compactGBuffer(false), camera(nullptr),
     descriptorSetLayout(VK_NULL_HANDLE), descriptorPool(VK_NULL_HANDLE),
-    materialDescriptorSetLayout(VK_NULL_HANDLE),
-    depthImage(VK_NULL_HANDLE), depthImageMemory(VK_NULL_HANDLE), depthImageView(VK_NULL_HANDLE) {
+    materialDescriptorSetLayout(VK_NULL_HANDLE) {
 }
 
-void Pipeline::initialize(VkExtent2D swapChainExtent, VkFormat swapChainImageFormat,
-    ShaderManager* shaderManager, const std::string& vertShaderName,
+void Pipeline::initialize(ShaderManager* shaderManager, const std::string& vertShaderName,
     const std::string& fragShaderName, Camera* camera, MaterialManager* materialManager,
-    GBuffer* gbuffer, const std::vector<VkImageView>& swapChainImageViews,
-    DirectionalLight* light, PointLight* pointLight) {
+    GBuffer* gbuffer, DirectionalLight* light, ClusteredLighting* clusteredLighting,
+    const PipelinePassTargets& passTargets, const std::vector<uint64_t>& warmVariants) {
 
-    this->swapChainExtent = swapChainExtent;
-    this->swapChainImageFormat = swapChainImageFormat;
+    this->shaderManager = shaderManager;
     this->camera = camera;
-    materialDescriptorSetLayout = materialManager->getDescriptorSetLayout();
+    this->passTargets = passTargets;
+    compactGBuffer = gbuffer->isCompact();
+    materialDescriptorSetLayout = materialManager->getBindlessDescriptorSetLayout();
 
     createDescriptorSetLayout();
     createDescriptorPool();
     createDescriptorSets();
-    createDepthResources(swapChainExtent);
-    createGeometryRenderPass();
-    createGeometryFramebuffers(gbuffer, static_cast<uint32_t>(swapChainImageViews.size()));
-    createLightingRenderPass(swapChainImageFormat);
-    createLightingFramebuffers(swapChainImageViews);
-    createForwardRenderPass(swapChainImageFormat);
-    createForwardFramebuffers(swapChainImageViews);
-    createDebugRenderPass(swapChainImageFormat);
-    createDebugFramebuffers(swapChainImageViews);
-    createImGuiRenderPass(swapChainImageFormat);
-    createImGuiFramebuffers(swapChainImageViews);
-    createGeometryPipeline(shaderManager);
-    createLightingPipeline(shaderManager, gbuffer, light, pointLight);
-    createForwardPipeline(shaderManager, light, pointLight);
-    createDebugPipeline(shaderManager);
-
-    gbuffer->updateDescriptorSets(depthImageView);
+    createGeometryPipelineLayout();
+    createLightingPipelineLayout(gbuffer, light, clusteredLighting);
+    createForwardPipelineLayout(light, clusteredLighting);
+
+    // every feature a kind reads, what the shaders did before they were specialized
+    std::vector<uint64_t> keys = {
+        makeVariantKey(VARIANT_GEOMETRY, ShaderFeatures::MATERIAL_MASK),
+        makeVariantKey(VARIANT_GEOMETRY_CUTOUT, ShaderFeatures::NORMAL_MAP),
+        makeVariantKey(VARIANT_GEOMETRY_EQUAL, ShaderFeatures::MATERIAL_MASK),
+        makeVariantKey(VARIANT_LIGHTING, ShaderFeatures::LIGHT_MASK),
+        makeVariantKey(VARIANT_FORWARD, ShaderFeatures::MATERIAL_MASK | ShaderFeatures::LIGHT_MASK),
+    };
+    keys.insert(keys.end(), warmVariants.begin(), warmVariants.end());
+    createPipelinesParallel(keys);
+}
+
+void Pipeline::createPipelinesParallel(const std::vector<uint64_t>& keys) {
+    std::vector<uint64_t> pending;
+    for (uint64_t key : keys) {
+        if (variants.find(key) == variants.end() && std::find(pending.begin(), pending.end(), key) == pending.end()) {
+            pending.push_back(key);
+        }
+    }
+
+    // the driver compiles each create call on the calling thread. handles are written to their
+    // own slots and the variant map is only touched once every task is done
+    std::vector<std::future<void>> tasks;
+    tasks.push_back(std::async(std::launch::async, [this] { createDepthPrepassPipeline(shaderManager); }));
+    tasks.push_back(std::async(std::launch::async, [this] { createDebugPipeline(shaderManager); }));
+
+    std::vector<VkPipeline> created(pending.size(), VK_NULL_HANDLE);
+    for (size_t i = 0; i < pending.size(); i++) {
+        tasks.push_back(std::async(std::launch::async, [this, &pending, &created, i] {
+            created[i] = createVariant(pending[i]);
+        }));
+    }
+
+    // get() rethrows a task's exception, all of them are waited for before that reaches the caller
+    for (auto& task : tasks) {
+        task.wait();
+    }
+    for (size_t i = 0; i < pending.size(); i++) {
+        if (created[i] != VK_NULL_HANDLE) {
+            variants.emplace(pending[i], created[i]);
+        }
+    }
+    for (auto& task : tasks) {
+        task.get();
+    }
+
+    std::cout << "created " << tasks.size() << " pipelines in parallel (" << variants.size() << " variants)" << std::endl;
+}
+
+std::vector<uint64_t> Pipeline::getVariantKeys() const {
+    std::vector<uint64_t> keys;
+    keys.reserve(variants.size());
+    for (const auto& [key, variant] : variants) {
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+VkPipeline Pipeline::getGeometryPipeline(uint32_t features) {
+    return getVariant(VARIANT_GEOMETRY, features & ShaderFeatures::MATERIAL_MASK);
+}
+
+VkPipeline Pipeline::getGeometryCutoutPipeline(uint32_t features) {
+    // the cutout shader always samples the diffuse texture for its alpha test
+    return getVariant(VARIANT_GEOMETRY_CUTOUT, features & ShaderFeatures::NORMAL_MAP);
+}
+
+VkPipeline Pipeline::getGeometryEqualPipeline(uint32_t features) {
+    return getVariant(VARIANT_GEOMETRY_EQUAL, features & ShaderFeatures::MATERIAL_MASK);
+}
+
+VkPipeline Pipeline::getLightingPipeline(uint32_t features) {
+    return getVariant(VARIANT_LIGHTING, features & ShaderFeatures::LIGHT_MASK);
+}
+
+VkPipeline Pipeline::getForwardPipeline(uint32_t features) {
+    return getVariant(VARIANT_FORWARD, features & (ShaderFeatures::MATERIAL_MASK | ShaderFeatures::LIGHT_MASK));
+}
+
+VkPipeline Pipeline::getVariant(Variant variant, uint32_t features) {
+    uint64_t key = makeVariantKey(variant, features);
+    {
+        std::shared_lock<std::shared_mutex> lock(variantMutex);
+        auto it = variants.find(key);
+        if (it != variants.end()) {
+            return it->second;
+        }
+    }
+
+    // compiled without the lock so a miss does not stall the other recording threads. two of
+    // them missing the same variant both compile it and the slower one destroys its copy
+    VkPipeline created = createVariant(key);
+    std::unique_lock<std::shared_mutex> lock(variantMutex);
+    auto [it, inserted] = variants.emplace(key, created);
+    if (!inserted) {
+        vkDestroyPipeline(device, created, nullptr);
+        return it->second;
+    }
+    std::cout << "pipeline variant " << variant << " created for features 0x" << std::hex << features << std::dec
+              << " (" << variants.size() << " variants)" << std::endl;
+    return created;
+}
+
+VkPipeline Pipeline::createVariant(uint64_t key) {
+    Variant variant = static_cast<Variant>(key >> 32);
+    uint32_t features = static_cast<uint32_t>(key);
+
+    switch (variant) {
+    case VARIANT_GEOMETRY:
+    case VARIANT_GEOMETRY_CUTOUT:
+    case VARIANT_GEOMETRY_EQUAL:
+        return createGeometryVariant(variant, features);
+    case VARIANT_LIGHTING:
+        return createLightingVariant(features);
+    case VARIANT_FORWARD:
+        return createForwardVariant(features);
+    }
+    throw std::runtime_error("unknown pipeline variant");
 }
 
 Pipeline::~Pipeline() {
@@ -62,14 +168,12 @@ Pipeline::~Pipeline() {
     if (debugPipeline != VK_NULL_HANDLE) {
         vkDestroyPipeline(device, debugPipeline, nullptr);
     }
-    if (forwardPipeline != VK_NULL_HANDLE) {
-        vkDestroyPipeline(device, forwardPipeline, nullptr);
-    }
-    if (lightingPipeline != VK_NULL_HANDLE) {
-        vkDestroyPipeline(device, lightingPipeline, nullptr);
+    for (const auto& [key, variant] : variants) {
+        vkDestroyPipeline(device, variant, nullptr);
     }
-    if (geometryPipeline != VK_NULL_HANDLE) {
-        vkDestroyPipeline(device, geometryPipeline, nullptr);
+    variants.clear();
+    if (depthPrepassPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, depthPrepassPipeline, nullptr);
     }
 
     // Pipeline layouts
@@ -86,40 +190,6 @@ Pipeline::~Pipeline() {
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
     }
 
-    // Framebuffers
-    for (auto framebuffer : imguiFramebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-    }
-    for (auto framebuffer : debugFramebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-    }
-    for (auto framebuffer : forwardFramebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-    }
-    for (auto framebuffer : lightingFramebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-    }
-    for (auto framebuffer : geometryFramebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-    }
-
-    // Render passes
-    if (imguiRenderPass != VK_NULL_HANDLE) {
-        vkDestroyRenderPass(device, imguiRenderPass, nullptr);
-    }
-    if (debugRenderPass != VK_NULL_HANDLE) {
-        vkDestroyRenderPass(device, debugRenderPass, nullptr);
-    }
-    if (forwardRenderPass != VK_NULL_HANDLE) {
-        vkDestroyRenderPass(device, forwardRenderPass, nullptr);
-    }
-    if (lightingRenderPass != VK_NULL_HANDLE) {
-        vkDestroyRenderPass(device, lightingRenderPass, nullptr);
-    }
-    if (geometryRenderPass != VK_NULL_HANDLE) {
-        vkDestroyRenderPass(device, geometryRenderPass, nullptr);
-    }
-
     // Descriptor resources
     if (descriptorPool != VK_NULL_HANDLE) {
         vkDestroyDescriptorPool(device, descriptorPool, nullptr);
@@ -127,17 +197,6 @@ Pipeline::~Pipeline() {
     if (descriptorSetLayout != VK_NULL_HANDLE) {
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
     }
-
-    // Depth resources
-    if (depthImageView != VK_NULL_HANDLE) {
-        vkDestroyImageView(device, depthImageView, nullptr);
-    }
-    if (depthImage != VK_NULL_HANDLE) {
-        vkDestroyImage(device, depthImage, nullptr);
-    }
-    if (depthImageMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(device, depthImageMemory, nullptr);
-    }
 }
 
 void Pipeline::createDescriptorSetLayout() {
@@ -148,10 +207,25 @@ void Pipeline::createDescriptorSetLayout() {
     uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
     uboLayoutBinding.pImmutableSamplers = nullptr;
 
+    // model matrices, and the visible instances whose model index gl_InstanceIndex selects
+    VkDescriptorSetLayoutBinding transformLayoutBinding{};
+    transformLayoutBinding.binding = 1;
+    transformLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    transformLayoutBinding.descriptorCount = 1;
+    transformLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutBinding instanceLayoutBinding{};
+    instanceLayoutBinding.binding = 2;
+    instanceLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    instanceLayoutBinding.descriptorCount = 1;
+    instanceLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutBinding bindings[] = { uboLayoutBinding, transformLayoutBinding, instanceLayoutBinding };
+
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = 1;
-    layoutInfo.pBindings = &uboLayoutBinding;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
 
     if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor set layout");
@@ -159,15 +233,17 @@ void Pipeline::createDescriptorSetLayout() {
 }
 
 void Pipeline::createDescriptorPool() {
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = static_cast<uint32_t>(Camera::MAX_FRAMES_IN_FLIGHT);
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT * 2;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes = &poolSize;
-    poolInfo.maxSets = static_cast<uint32_t>(Camera::MAX_FRAMES_IN_FLIGHT);
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
 
     if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool");
@@ -175,20 +251,20 @@ void Pipeline::createDescriptorPool() {
 }
 
 void Pipeline::createDescriptorSets() {
-    std::vector<VkDescriptorSetLayout> layouts(Camera::MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
 
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(Camera::MAX_FRAMES_IN_FLIGHT);
+    allocInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
     allocInfo.pSetLayouts = layouts.data();
 
-    descriptorSets.resize(Camera::MAX_FRAMES_IN_FLIGHT);
+    descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
     if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate descriptor sets");
     }
 
-    for (size_t i = 0; i < Camera::MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         VkDescriptorBufferInfo bufferInfo{};
         bufferInfo.buffer = camera->getBuffer(i);
         bufferInfo.offset = 0;
@@ -207,439 +283,61 @@ void Pipeline::createDescriptorSets() {
     }
 }
 
-VkFormat Pipeline::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
-    for (VkFormat format : candidates) {
-        VkFormatProperties props;
-        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
-
-        if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features) {
-            return format;
-        }
-        else if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features) {
-            return format;
-        }
-    }
-
-    throw std::runtime_error("failed to find supported format");
-}
-
-VkFormat Pipeline::findDepthFormat() {
-    return findSupportedFormat(
-        { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
-    );
-}
-
-bool Pipeline::hasStencilComponent(VkFormat format) {
-    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
-}
-
-void Pipeline::createDepthResources(VkExtent2D swapChainExtent) {
-    depthFormat = findDepthFormat();
-
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = swapChainExtent.width;
-    imageInfo.extent.height = swapChainExtent.height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = depthFormat;
-    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    if (vkCreateImage(device, &imageInfo, nullptr, &depthImage) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create depth image");
-    }
-
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device, depthImage, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-
-    // Find suitable memory type
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-    uint32_t memoryTypeIndex = UINT32_MAX;
-    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((memRequirements.memoryTypeBits & (1 << i)) &&
-            (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            memoryTypeIndex = i;
-            break;
-        }
-    }
-
-    if (memoryTypeIndex == UINT32_MAX) {
-        throw std::runtime_error("failed to find suitable memory type for depth image");
-    }
-
-    allocInfo.memoryTypeIndex = memoryTypeIndex;
-
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &depthImageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate depth image memory");
-    }
-
-    vkBindImageMemory(device, depthImage, depthImageMemory, 0);
-
-    VkImageViewCreateInfo viewInfo{};
-    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = depthImage;
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = depthFormat;
-    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-    viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
-    viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
-
-    if (vkCreateImageView(device, &viewInfo, nullptr, &depthImageView) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create depth image view");
-    }
-}
-
-void Pipeline::createGeometryRenderPass() {
-    // Attachment 0: Albedo
-    VkAttachmentDescription albedoAttachment{};
-    albedoAttachment.format = VK_FORMAT_R8G8B8A8_SRGB;
-    albedoAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    albedoAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    albedoAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    albedoAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    albedoAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    albedoAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    albedoAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    // Attachment 1: Normal
-    VkAttachmentDescription normalAttachment{};
-    normalAttachment.format = VK_FORMAT_A2R10G10B10_UNORM_PACK32;
-    normalAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    normalAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    normalAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    normalAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    normalAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    normalAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    normalAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    // Attachment 2: Roughness
-    VkAttachmentDescription roughnessAttachment{};
-    roughnessAttachment.format = VK_FORMAT_R8_UNORM;
-    roughnessAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    roughnessAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    roughnessAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    roughnessAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    roughnessAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    roughnessAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    roughnessAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    // Attachment 3: Depth
-    VkAttachmentDescription depthAttachment{};
-    depthAttachment.format = depthFormat;
-    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-
-    // Color attachment references
-    VkAttachmentReference colorAttachmentRefs[3]{};
-    colorAttachmentRefs[0].attachment = 0;
-    colorAttachmentRefs[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    colorAttachmentRefs[1].attachment = 1;
-    colorAttachmentRefs[1].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    colorAttachmentRefs[2].attachment = 2;
-    colorAttachmentRefs[2].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    // Depth attachment reference
-    VkAttachmentReference depthAttachmentRef{};
-    depthAttachmentRef.attachment = 3;
-    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    // Subpass
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 3;
-    subpass.pColorAttachments = colorAttachmentRefs;
-    subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-    // Subpass dependency
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-    std::array<VkAttachmentDescription, 4> attachments = { albedoAttachment, normalAttachment, roughnessAttachment, depthAttachment };
-
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &geometryRenderPass) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create geometry render pass");
-    }
-}
-
-void Pipeline::createLightingRenderPass(VkFormat swapChainImageFormat) {
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = swapChainImageFormat;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    dependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &lightingRenderPass) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create lighting render pass");
-    }
-}
-
-void Pipeline::createForwardRenderPass(VkFormat swapChainImageFormat) {
-    // Color attachment - load to preserve lighting output
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = swapChainImageFormat;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    // Depth attachment - load to use deferred depth (read-only for transparent depth testing)
-    VkAttachmentDescription depthAttachment{};
-    depthAttachment.format = depthFormat;
-    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    // Geometry pass leaves depth in READ_ONLY_OPTIMAL, we keep it there since we only test, not write
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentReference depthAttachmentRef{};
-    depthAttachmentRef.attachment = 1;
-    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-    subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-    // wait for lighting pass color output, depth was written in geometry pass
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-
-    std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
-
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &forwardRenderPass) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create forward render pass");
-    }
-}
-
-void Pipeline::createImGuiRenderPass(VkFormat swapChainImageFormat) {
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = swapChainImageFormat;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &imguiRenderPass) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create imgui render pass");
-    }
+void Pipeline::updateInstanceDescriptors(uint32_t frame, VkBuffer transformBuffer, VkBuffer instanceBuffer) {
+    VkDescriptorBufferInfo transformInfo{};
+    transformInfo.buffer = transformBuffer;
+    transformInfo.offset = 0;
+    transformInfo.range = VK_WHOLE_SIZE;
+
+    VkDescriptorBufferInfo instanceInfo{};
+    instanceInfo.buffer = instanceBuffer;
+    instanceInfo.offset = 0;
+    instanceInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet descriptorWrites[2]{};
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet = descriptorSets[frame];
+    descriptorWrites[0].dstBinding = 1;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &transformInfo;
+
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstSet = descriptorSets[frame];
+    descriptorWrites[1].dstBinding = 2;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pBufferInfo = &instanceInfo;
+
+    vkUpdateDescriptorSets(device, 2, descriptorWrites, 0, nullptr);
 }
 
-void Pipeline::createGeometryFramebuffers(GBuffer* gbuffer, uint32_t swapChainImageCount) {
-    geometryFramebuffers.resize(swapChainImageCount);
-
-    for (uint32_t i = 0; i < swapChainImageCount; i++) {
-        std::array<VkImageView, 4> attachments = {
-            gbuffer->getAlbedoImageView(),
-            gbuffer->getNormalImageView(),
-            gbuffer->getRoughnessImageView(),
-            depthImageView
-        };
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = geometryRenderPass;
-        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-        framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = swapChainExtent.width;
-        framebufferInfo.height = swapChainExtent.height;
-        framebufferInfo.layers = 1;
-
-        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &geometryFramebuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create geometry framebuffer");
-        }
-    }
-}
-
-void Pipeline::createLightingFramebuffers(const std::vector<VkImageView>& swapChainImageViews) {
-    lightingFramebuffers.resize(swapChainImageViews.size());
-
-    for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-        VkImageView attachments[] = { swapChainImageViews[i] };
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = lightingRenderPass;
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = swapChainExtent.width;
-        framebufferInfo.height = swapChainExtent.height;
-        framebufferInfo.layers = 1;
-
-        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &lightingFramebuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create lighting framebuffer");
-        }
-    }
-}
-
-void Pipeline::createImGuiFramebuffers(const std::vector<VkImageView>& swapChainImageViews) {
-    imguiFramebuffers.resize(swapChainImageViews.size());
-
-    for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-        VkImageView attachments[] = { swapChainImageViews[i] };
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = imguiRenderPass;
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = swapChainExtent.width;
-        framebufferInfo.height = swapChainExtent.height;
-        framebufferInfo.layers = 1;
+void Pipeline::createGeometryPipelineLayout() {
+    // set 0 for camera, set 1 for the bindless materials. the material of a draw comes with its
+    // instances, so there are no push constants
+    VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout, materialDescriptorSetLayout };
 
-        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &imguiFramebuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create imgui framebuffer");
-        }
-    }
-}
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges = nullptr;
 
-void Pipeline::createForwardFramebuffers(const std::vector<VkImageView>& swapChainImageViews) {
-    forwardFramebuffers.resize(swapChainImageViews.size());
-
-    for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-        std::array<VkImageView, 2> attachments = {
-            swapChainImageViews[i],
-            depthImageView
-        };
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = forwardRenderPass;
-        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-        framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = swapChainExtent.width;
-        framebufferInfo.height = swapChainExtent.height;
-        framebufferInfo.layers = 1;
-
-        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &forwardFramebuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create forward framebuffer");
-        }
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout");
     }
 }
 
-void Pipeline::createGeometryPipeline(ShaderManager* shaderManager) {
+VkPipeline Pipeline::createGeometryVariant(Variant variant, uint32_t features) {
+    // the cutout variant is alpha tested with discard, kept as its own pipeline so opaque draws
+    // keep early depth testing
+    const char* fragShaderName = variant == VARIANT_GEOMETRY_CUTOUT ?
+        (compactGBuffer ? "geometry_cutout_compact_frag.spv" : "geometry_cutout_frag.spv") :
+        (compactGBuffer ? "geometry_compact_frag.spv" : "geometry_frag.spv");
     VkShaderModule vertShaderModule = shaderManager->getShaderModule("geometry_vert.spv");
-    VkShaderModule fragShaderModule = shaderManager->getShaderModule("geometry_frag.spv");
+    VkShaderModule fragShaderModule = shaderManager->getShaderModule(fragShaderName);
+    ShaderFeatures specialization(features);
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -652,6 +350,7 @@ void Pipeline::createGeometryPipeline(ShaderManager* shaderManager) {
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = specialization.getSpecializationInfo();
 
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
@@ -671,24 +370,19 @@ void Pipeline::createGeometryPipeline(ShaderManager* shaderManager) {
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = static_cast<float>(swapChainExtent.height);
-    viewport.width = static_cast<float>(swapChainExtent.width);
-    viewport.height = -static_cast<float>(swapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = swapChainExtent;
-
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+
+    // every pipeline in this file takes its viewport and scissor when recording: dynamic
+    // resolution renders into a sub-region, and no pipeline has to be rebuilt on a resize
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     // rasterization
     VkPipelineRasterizationStateCreateInfo rasterizer{};
@@ -697,7 +391,8 @@ void Pipeline::createGeometryPipeline(ShaderManager* shaderManager) {
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
     rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    // two sided cutouts for foliage
+    rasterizer.cullMode = variant == VARIANT_GEOMETRY_CUTOUT ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
     rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
     rasterizer.depthBiasEnable = VK_FALSE;
     rasterizer.depthBiasConstantFactor = 0.0f;
@@ -714,12 +409,14 @@ void Pipeline::createGeometryPipeline(ShaderManager* shaderManager) {
     multisampling.alphaToCoverageEnable = VK_FALSE;
     multisampling.alphaToOneEnable = VK_FALSE;
 
-    // Depth stencil state
+    // Depth stencil state. the equal variant is used after the depth prepass: depth is already
+    // final, so only the visible fragment of each pixel passes and runs the material shader
+    bool depthEqual = variant == VARIANT_GEOMETRY_EQUAL;
     VkPipelineDepthStencilStateCreateInfo depthStencil{};
     depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
     depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthWriteEnable = depthEqual ? VK_FALSE : VK_TRUE;
+    depthStencil.depthCompareOp = depthEqual ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.minDepthBounds = 0.0f;
     depthStencil.maxDepthBounds = 1.0f;
@@ -728,6 +425,7 @@ void Pipeline::createGeometryPipeline(ShaderManager* shaderManager) {
     depthStencil.back = {};
 
     // color blending - three attachments for albedo, normal, and roughness outputs
+    // the compact layout has only albedo (roughness in alpha) and normal
     VkPipelineColorBlendAttachmentState colorBlendAttachments[3]{};
     colorBlendAttachments[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
         VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -744,37 +442,117 @@ void Pipeline::createGeometryPipeline(ShaderManager* shaderManager) {
     colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     colorBlending.logicOpEnable = VK_FALSE;
     colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 3;
+    colorBlending.attachmentCount = compactGBuffer ? 2 : 3;
     colorBlending.pAttachments = colorBlendAttachments;
     colorBlending.blendConstants[0] = 0.0f;
     colorBlending.blendConstants[1] = 0.0f;
     colorBlending.blendConstants[2] = 0.0f;
     colorBlending.blendConstants[3] = 0.0f;
 
-    // pipeline layout - set 0 for camera, set 1 for materials
-    VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout, materialDescriptorSetLayout };
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = passTargets.geometry.renderPass;
+    pipelineInfo.subpass = passTargets.geometry.subpass;
+    pipelineInfo.basePipelineHandle = nullptr;
+    pipelineInfo.basePipelineIndex = -1;
 
-    // push constant for material data (vec4 + uint + uint + float + float = 32 bytes)
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = 32; // vec4 diffuseColor (16) + uint hasTexture (4) + uint hasNormalMap (4) + float dissolve (4) + float roughness (4)
+    VkPipeline geometryPipeline;
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &geometryPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create geometry pipeline");
+    }
+    return geometryPipeline;
+}
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 2;
-    pipelineLayoutInfo.pSetLayouts = setLayouts;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+void Pipeline::createDepthPrepassPipeline(ShaderManager* shaderManager) {
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = shaderManager->getShaderModule("depth_prepass_vert.spv");
+    vertShaderStageInfo.pName = "main";
 
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout");
-    }
+    // positions only, read from the scene's tightly packed position stream
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof(float) * 3;
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
+    VkVertexInputAttributeDescription attributeDescription{};
+    attributeDescription.binding = 0;
+    attributeDescription.location = 0;
+    attributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescription.offset = 0;
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = 1;
+    vertexInputInfo.pVertexAttributeDescriptions = &attributeDescription;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.minSampleShading = 1.0f;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    // depth only, no color attachments
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 0;
+    colorBlending.pAttachments = nullptr;
+
+    // shares the geometry layout, only set 0 (camera) is used
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.stageCount = 1;
+    pipelineInfo.pStages = &vertShaderStageInfo;
     pipelineInfo.pVertexInputState = &vertexInputInfo;
     pipelineInfo.pInputAssemblyState = &inputAssembly;
     pipelineInfo.pViewportState = &viewportState;
@@ -782,21 +560,21 @@ void Pipeline::createGeometryPipeline(ShaderManager* shaderManager) {
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = geometryRenderPass;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.renderPass = passTargets.depthPrepass.renderPass;
+    pipelineInfo.subpass = passTargets.depthPrepass.subpass;
     pipelineInfo.basePipelineHandle = nullptr;
     pipelineInfo.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineInfo, nullptr, &geometryPipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create geometry pipeline");
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &depthPrepassPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth prepass pipeline");
     }
 
-    std::cout << "geometry pipeline created" << std::endl;
+    std::cout << "depth prepass pipeline created" << std::endl;
 }
 
-void Pipeline::createLightingPipeline(ShaderManager* shaderManager, GBuffer* gbuffer, DirectionalLight* light, PointLight* pointLight) {
+void Pipeline::createLightingPipelineLayout(GBuffer* gbuffer, DirectionalLight* light, ClusteredLighting* clusteredLighting) {
     // Get descriptor set layout from GBuffer
     lightingDescriptorSetLayout = gbuffer->getDescriptorSetLayout();
 
@@ -804,8 +582,8 @@ void Pipeline::createLightingPipeline(ShaderManager* shaderManager, GBuffer* gbu
     // Set 0: camera UBO (for inverse view-projection matrix for depth reconstruction)
     // Set 1: G-Buffer samplers
     // Set 2: Directional Light UBO
-    // Set 3: Point Light UBO
-    VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout, lightingDescriptorSetLayout, light->getDescriptorSetLayout(), pointLight->getDescriptorSetLayout() };
+    // Set 3: Clustered lighting (cluster params, point lights, per cluster light lists, point shadow cube)
+    VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout, lightingDescriptorSetLayout, light->getDescriptorSetLayout(), clusteredLighting->getDescriptorSetLayout() };
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -817,10 +595,14 @@ void Pipeline::createLightingPipeline(ShaderManager* shaderManager, GBuffer* gbu
     if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &lightingPipelineLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create lighting pipeline layout");
     }
+}
 
+VkPipeline Pipeline::createLightingVariant(uint32_t features) {
     // Shaders
     VkShaderModule vertShaderModule = shaderManager->getShaderModule("lighting_vert.spv");
-    VkShaderModule fragShaderModule = shaderManager->getShaderModule("lighting_frag.spv");
+    VkShaderModule fragShaderModule = shaderManager->getShaderModule(
+        compactGBuffer ? "lighting_compact_frag.spv" : "lighting_frag.spv");
+    ShaderFeatures specialization(features);
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -833,6 +615,7 @@ void Pipeline::createLightingPipeline(ShaderManager* shaderManager, GBuffer* gbu
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = specialization.getSpecializationInfo();
 
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
@@ -850,25 +633,17 @@ void Pipeline::createLightingPipeline(ShaderManager* shaderManager, GBuffer* gbu
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    // Viewport and scissor
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = static_cast<float>(swapChainExtent.height);
-    viewport.width = static_cast<float>(swapChainExtent.width);
-    viewport.height = -static_cast<float>(swapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = swapChainExtent;
-
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     // Rasterization - no culling for fullscreen triangle
     VkPipelineRasterizationStateCreateInfo rasterizer{};
@@ -925,24 +700,40 @@ void Pipeline::createLightingPipeline(ShaderManager* shaderManager, GBuffer* gbu
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = lightingPipelineLayout;
-    pipelineInfo.renderPass = lightingRenderPass;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.renderPass = passTargets.lighting.renderPass;
+    pipelineInfo.subpass = passTargets.lighting.subpass;
     pipelineInfo.basePipelineHandle = nullptr;
     pipelineInfo.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineInfo, nullptr, &lightingPipeline) != VK_SUCCESS) {
+    VkPipeline lightingPipeline;
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &lightingPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create lighting pipeline");
     }
+    return lightingPipeline;
+}
+
+void Pipeline::createForwardPipelineLayout(DirectionalLight* light, ClusteredLighting* clusteredLighting) {
+    VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout, materialDescriptorSetLayout, light->getDescriptorSetLayout(), clusteredLighting->getDescriptorSetLayout() };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 4;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges = nullptr;
 
-    std::cout << "lighting pipeline created" << std::endl;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &forwardPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create forward pipeline layout");
+    }
 }
 
-void Pipeline::createForwardPipeline(ShaderManager* shaderManager, DirectionalLight* light, PointLight* pointLight) {
+VkPipeline Pipeline::createForwardVariant(uint32_t features) {
     // forward pipeline uses same vertex shader as geometry but different fragment shader
     VkShaderModule vertShaderModule = shaderManager->getShaderModule("geometry_vert.spv");
     VkShaderModule fragShaderModule = shaderManager->getShaderModule("forward_frag.spv");
+    ShaderFeatures specialization(features);
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -955,6 +746,7 @@ void Pipeline::createForwardPipeline(ShaderManager* shaderManager, DirectionalLi
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = specialization.getSpecializationInfo();
 
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
@@ -973,24 +765,17 @@ void Pipeline::createForwardPipeline(ShaderManager* shaderManager, DirectionalLi
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = static_cast<float>(swapChainExtent.height);
-    viewport.width = static_cast<float>(swapChainExtent.width);
-    viewport.height = -static_cast<float>(swapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = swapChainExtent;
-
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -1033,25 +818,6 @@ void Pipeline::createForwardPipeline(ShaderManager* shaderManager, DirectionalLi
     colorBlending.attachmentCount = 1;
     colorBlending.pAttachments = &colorBlendAttachment;
 
-    VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout, materialDescriptorSetLayout, light->getDescriptorSetLayout(), pointLight->getDescriptorSetLayout() };
-
-    // push constants
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = 32;
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 4;
-    pipelineLayoutInfo.pSetLayouts = setLayouts;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &forwardPipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create forward pipeline layout");
-    }
-
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineInfo.stageCount = 2;
@@ -1063,103 +829,18 @@ void Pipeline::createForwardPipeline(ShaderManager* shaderManager, DirectionalLi
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = forwardPipelineLayout;
-    pipelineInfo.renderPass = forwardRenderPass;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.renderPass = passTargets.forward.renderPass;
+    pipelineInfo.subpass = passTargets.forward.subpass;
     pipelineInfo.basePipelineHandle = nullptr;
     pipelineInfo.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineInfo, nullptr, &forwardPipeline) != VK_SUCCESS) {
+    VkPipeline forwardPipeline;
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &forwardPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create forward pipeline");
     }
-
-    std::cout << "forward pipeline created" << std::endl;
-}
-
-void Pipeline::createDebugRenderPass(VkFormat swapChainImageFormat) {
-    // Color attachment - load from forward pass, store for imgui
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = swapChainImageFormat;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    // Depth attachment - read-only for depth testing
-    VkAttachmentDescription depthAttachment{};
-    depthAttachment.format = depthFormat;
-    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentReference depthAttachmentRef{};
-    depthAttachmentRef.attachment = 1;
-    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-    subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-
-    std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
-
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &debugRenderPass) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create debug render pass");
-    }
-}
-
-void Pipeline::createDebugFramebuffers(const std::vector<VkImageView>& swapChainImageViews) {
-    debugFramebuffers.resize(swapChainImageViews.size());
-
-    for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-        std::array<VkImageView, 2> attachments = {
-            swapChainImageViews[i],
-            depthImageView
-        };
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = debugRenderPass;
-        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-        framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = swapChainExtent.width;
-        framebufferInfo.height = swapChainExtent.height;
-        framebufferInfo.layers = 1;
-
-        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &debugFramebuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create debug framebuffer");
-        }
-    }
+    return forwardPipeline;
 }
 
 void Pipeline::createDebugPipeline(ShaderManager* shaderManager) {
@@ -1210,24 +891,17 @@ void Pipeline::createDebugPipeline(ShaderManager* shaderManager) {
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = static_cast<float>(swapChainExtent.height);
-    viewport.width = static_cast<float>(swapChainExtent.width);
-    viewport.height = -static_cast<float>(swapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = swapChainExtent;
-
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -1286,14 +960,14 @@ void Pipeline::createDebugPipeline(ShaderManager* shaderManager) {
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = debugPipelineLayout;
-    pipelineInfo.renderPass = debugRenderPass;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.renderPass = passTargets.debug.renderPass;
+    pipelineInfo.subpass = passTargets.debug.subpass;
     pipelineInfo.basePipelineHandle = nullptr;
     pipelineInfo.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineInfo, nullptr, &debugPipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &debugPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create debug pipeline");
     }
 
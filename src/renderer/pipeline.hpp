@@ -1,116 +1,126 @@
 #pragma once
 
 #include <Vulkan/vulkan.h>
+#include <shared_mutex>
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include "framegraph.hpp"
 
 class ShaderManager;
 class Camera;
 class MaterialManager;
 class GBuffer;
 class DirectionalLight;
-class PointLight;
+class ClusteredLighting;
 
+// render pass/subpass each pipeline is built for, taken from the compiled frame graph
+struct PipelinePassTargets {
+	FrameGraph::PassTarget depthPrepass;
+	FrameGraph::PassTarget geometry;
+	FrameGraph::PassTarget lighting;
+	FrameGraph::PassTarget forward;
+	FrameGraph::PassTarget debug;
+};
+
+/*
+	The material shaders are built as variants of a ShaderFeatures mask. A variant is created the
+	first time a pass asks for it and cached for the lifetime of the Pipeline, keyed by the kind
+	of pipeline and the mask. Each getter drops the bits its shader does not read, so masks that
+	only differ in those share one pipeline. initialize creates its fixed pipelines and a warm set
+	of variants on several threads, all through the given VkPipelineCache.
+*/
 class Pipeline {
 
 public:
-	Pipeline(VkDevice device, VkPhysicalDevice physicalDevice);
+	Pipeline(VkDevice device, VkPhysicalDevice physicalDevice, VkPipelineCache pipelineCache);
 	~Pipeline();
 
-	void initialize(VkExtent2D swapChainExtent, VkFormat swapChainImageFormat,
-		ShaderManager* shaderManager, const std::string& vertShaderName,
+	// warmVariants are getVariantKeys() of an earlier Pipeline, created up front next to the
+	// variants every frame needs
+	void initialize(ShaderManager* shaderManager, const std::string& vertShaderName,
 		const std::string& fragShaderName, Camera* camera, MaterialManager* materialManager,
-		GBuffer* gbuffer, const std::vector<VkImageView>& swapChainImageViews,
-		DirectionalLight* light, PointLight* pointLight);
+		GBuffer* gbuffer, DirectionalLight* light, ClusteredLighting* clusteredLighting,
+		const PipelinePassTargets& passTargets, const std::vector<uint64_t>& warmVariants);
 
 	Pipeline(const Pipeline&) = delete;
 	Pipeline& operator=(const Pipeline&) = delete;
 
-	VkPipeline getGeometryPipeline() const { return geometryPipeline; }
+	// features is a ShaderFeatures mask, material bits for the geometry variants, material and
+	// light bits for forward, light bits for lighting
+	VkPipeline getGeometryPipeline(uint32_t features);
+	VkPipeline getGeometryCutoutPipeline(uint32_t features);
+	VkPipeline getGeometryEqualPipeline(uint32_t features);
+	VkPipeline getLightingPipeline(uint32_t features);
+	VkPipeline getForwardPipeline(uint32_t features);
+	size_t getVariantCount() const { return variants.size(); }
+	std::vector<uint64_t> getVariantKeys() const;
+
+	VkPipeline getDepthPrepassPipeline() const { return depthPrepassPipeline; }
 	VkPipelineLayout getGeometryPipelineLayout() const { return pipelineLayout; }
 	VkPipelineLayout getPipelineLayout() const { return pipelineLayout; }
-	VkPipeline getLightingPipeline() const { return lightingPipeline; }
 	VkPipelineLayout getLightingPipelineLayout() const { return lightingPipelineLayout; }
-	VkPipeline getForwardPipeline() const { return forwardPipeline; }
 	VkPipelineLayout getForwardPipelineLayout() const { return forwardPipelineLayout; }
 	VkPipeline getDebugPipeline() const { return debugPipeline; }
 	VkPipelineLayout getDebugPipelineLayout() const { return debugPipelineLayout; }
-	VkRenderPass getGeometryRenderPass() const { return geometryRenderPass; }
-	VkRenderPass getLightingRenderPass() const { return lightingRenderPass; }
-	VkRenderPass getForwardRenderPass() const { return forwardRenderPass; }
-	VkRenderPass getDebugRenderPass() const { return debugRenderPass; }
-	VkRenderPass getImGuiRenderPass() const { return imguiRenderPass; }
-	VkFramebuffer getGeometryFramebuffer(uint32_t index) const { return geometryFramebuffers[index]; }
-	VkFramebuffer getLightingFramebuffer(uint32_t index) const { return lightingFramebuffers[index]; }
-	VkFramebuffer getForwardFramebuffer(uint32_t index) const { return forwardFramebuffers[index]; }
-	VkFramebuffer getDebugFramebuffer(uint32_t index) const { return debugFramebuffers[index]; }
-	VkFramebuffer getImGuiFramebuffer(uint32_t index) const { return imguiFramebuffers[index]; }
-	const std::vector<VkFramebuffer>& getGeometryFramebuffers() const { return geometryFramebuffers; }
-	const std::vector<VkFramebuffer>& getLightingFramebuffers() const { return lightingFramebuffers; }
-	const std::vector<VkFramebuffer>& getForwardFramebuffers() const { return forwardFramebuffers; }
-	const std::vector<VkFramebuffer>& getDebugFramebuffers() const { return debugFramebuffers; }
-	const std::vector<VkFramebuffer>& getImGuiFramebuffers() const { return imguiFramebuffers; }
 	VkDescriptorSet getDescriptorSet(uint32_t frame) const { return descriptorSets[frame]; }
-	VkImageView getDepthImageView() const { return depthImageView; }
-
-	void createGeometryFramebuffers(GBuffer* gbuffer, uint32_t swapChainImageCount);
-	void createLightingFramebuffers(const std::vector<VkImageView>& swapChainImageViews);
-	void createImGuiFramebuffers(const std::vector<VkImageView>& swapChainImageViews);
-	void createForwardFramebuffers(const std::vector<VkImageView>& swapChainImageViews);
-	void createDebugFramebuffers(const std::vector<VkImageView>& swapChainImageViews);
-	void createLightingPipeline(ShaderManager* shaderManager, GBuffer* gbuffer, DirectionalLight* light, PointLight* pointLight);
-	void createForwardPipeline(ShaderManager* shaderManager, DirectionalLight* light, PointLight* pointLight);
+
+	// points set 0 of one frame at the scene's transforms and visible instances, the frame's
+	// previous submission must have finished
+	void updateInstanceDescriptors(uint32_t frame, VkBuffer transformBuffer, VkBuffer instanceBuffer);
+
 	void createDebugPipeline(ShaderManager* shaderManager);
 
 private:
+	enum Variant : uint32_t {
+		VARIANT_GEOMETRY = 0,
+		VARIANT_GEOMETRY_CUTOUT,
+		VARIANT_GEOMETRY_EQUAL,
+		VARIANT_LIGHTING,
+		VARIANT_FORWARD
+	};
+
 	VkDevice device;
 	VkPhysicalDevice physicalDevice;
-	VkPipeline geometryPipeline;
+	VkPipelineCache pipelineCache;
+	ShaderManager* shaderManager;
+	// variant << 32 | features
+	std::unordered_map<uint64_t, VkPipeline> variants;
+	// passes are recorded on several threads. lookups share it, only adding a variant is exclusive
+	std::shared_mutex variantMutex;
+	VkPipeline depthPrepassPipeline;
 	VkPipelineLayout pipelineLayout;
-	VkPipeline lightingPipeline;
 	VkPipelineLayout lightingPipelineLayout;
-	VkPipeline forwardPipeline;
 	VkPipelineLayout forwardPipelineLayout;
 	VkPipeline debugPipeline;
 	VkPipelineLayout debugPipelineLayout;
 	VkDescriptorSetLayout lightingDescriptorSetLayout;
-	VkRenderPass geometryRenderPass;
-	VkRenderPass lightingRenderPass;
-	VkRenderPass forwardRenderPass;
-	VkRenderPass debugRenderPass;
-	VkRenderPass imguiRenderPass;
-	std::vector<VkFramebuffer> geometryFramebuffers;
-	std::vector<VkFramebuffer> lightingFramebuffers;
-	std::vector<VkFramebuffer> forwardFramebuffers;
-	std::vector<VkFramebuffer> debugFramebuffers;
-	std::vector<VkFramebuffer> imguiFramebuffers;
-	VkExtent2D swapChainExtent;
-	VkFormat swapChainImageFormat;
+	PipelinePassTargets passTargets;
+	bool compactGBuffer;
 
 	Camera* camera;
 	VkDescriptorSetLayout descriptorSetLayout;
 	VkDescriptorPool descriptorPool;
 	std::vector<VkDescriptorSet> descriptorSets;
 
-	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
-	VkImageView depthImageView;
-	VkFormat depthFormat;
-
 	VkDescriptorSetLayout materialDescriptorSetLayout;
 
 	void createDescriptorSetLayout();
 	void createDescriptorPool();
 	void createDescriptorSets();
-	void createDepthResources(VkExtent2D swapChainExtent);
-	void createGeometryPipeline(ShaderManager* shaderManager);
-	void createGeometryRenderPass();
-	void createLightingRenderPass(VkFormat swapChainImageFormat);
-	void createForwardRenderPass(VkFormat swapChainImageFormat);
-	void createDebugRenderPass(VkFormat swapChainImageFormat);
-	void createImGuiRenderPass(VkFormat swapChainImageFormat);
-
-	VkFormat findDepthFormat();
-	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
-	bool hasStencilComponent(VkFormat format);
+	void createGeometryPipelineLayout();
+	void createLightingPipelineLayout(GBuffer* gbuffer, DirectionalLight* light, ClusteredLighting* clusteredLighting);
+	void createForwardPipelineLayout(DirectionalLight* light, ClusteredLighting* clusteredLighting);
+	void createDepthPrepassPipeline(ShaderManager* shaderManager);
+
+	static uint64_t makeVariantKey(Variant variant, uint32_t features) { return (static_cast<uint64_t>(variant) << 32) | features; }
+
+	// returns the cached variant, creating it on first use. safe to call from recording threads
+	VkPipeline getVariant(Variant variant, uint32_t features);
+	VkPipeline createVariant(uint64_t key);
+	// creates the fixed pipelines and the variants in keys that are not cached yet, one task each
+	void createPipelinesParallel(const std::vector<uint64_t>& keys);
+	VkPipeline createGeometryVariant(Variant variant, uint32_t features);
+	VkPipeline createLightingVariant(uint32_t features);
+	VkPipeline createForwardVariant(uint32_t features);
 };
\ No newline at end of file
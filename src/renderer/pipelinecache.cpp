@@ -0,0 +1,116 @@
+#include "pipelinecache.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path)
+    : device(device)
+    , properties{}
+    , path(path)
+    , cache(VK_NULL_HANDLE)
+    , warm(false)
+{
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    std::vector<char> data = loadFile();
+    warm = !data.empty();
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache");
+    }
+}
+
+PipelineCache::~PipelineCache() {
+    cleanup();
+}
+
+void PipelineCache::cleanup() {
+    if (cache != VK_NULL_HANDLE) {
+        vkDestroyPipelineCache(device, cache, nullptr);
+        cache = VK_NULL_HANDLE;
+    }
+}
+
+PipelineCache::FileHeader PipelineCache::makeHeader(uint64_t dataSize) const {
+    FileHeader header{};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = dataSize;
+    return header;
+}
+
+std::vector<char> PipelineCache::loadFile() const {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "no pipeline cache at " << path << ", starting cold" << std::endl;
+        return {};
+    }
+
+    FileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    FileHeader expected = makeHeader(header.dataSize);
+    if (!file || memcmp(&header, &expected, sizeof(header)) != 0) {
+        std::cout << "pipeline cache " << path << " is from another device or driver, starting cold" << std::endl;
+        return {};
+    }
+
+    std::vector<char> data(header.dataSize);
+    file.read(data.data(), data.size());
+    if (!file) {
+        std::cout << "pipeline cache is truncated: " << path << std::endl;
+        return {};
+    }
+
+    // the driver checks its own header too, but not every driver survives a bad one
+    VkPipelineCacheHeaderVersionOne driverHeader{};
+    if (data.size() < sizeof(driverHeader)) {
+        return {};
+    }
+    memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+    if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+        memcmp(driverHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        std::cout << "pipeline cache " << path << " does not match the driver, starting cold" << std::endl;
+        return {};
+    }
+
+    std::cout << "pipeline cache loaded: " << path << " (" << data.size() << " bytes)" << std::endl;
+    return data;
+}
+
+bool PipelineCache::save() const {
+    if (cache == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+        return false;
+    }
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS) {
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "failed to write pipeline cache: " << path << std::endl;
+        return false;
+    }
+
+    FileHeader header = makeHeader(dataSize);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(data.data(), dataSize);
+
+    std::cout << "pipeline cache saved: " << path << " (" << dataSize << " bytes)" << std::endl;
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+    VkPipelineCache kept on disk between runs. The file starts with the identity of the device
+    and driver that wrote it; a cache from another GPU or driver version is ignored instead of
+    handed to the driver, and gets replaced when the cache is saved. Pipelines created through
+    getCache() compile warm once the file exists.
+*/
+class PipelineCache {
+public:
+    static constexpr uint32_t FILE_MAGIC = 0x43504147; // "GAPC"
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path);
+    ~PipelineCache();
+
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    VkPipelineCache getCache() const { return cache; }
+    // true when the cache was seeded from a valid file, what cold and warm timings are told apart by
+    bool isWarm() const { return warm; }
+
+    // writes the driver's current cache data to the file
+    bool save() const;
+    void cleanup();
+
+private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint32_t reserved;  // keeps the struct free of padding, it is compared bytewise
+        uint64_t dataSize;
+    };
+
+    VkDevice device;
+    VkPhysicalDeviceProperties properties;
+    std::string path;
+    VkPipelineCache cache;
+    bool warm;
+
+    FileHeader makeHeader(uint64_t dataSize) const;
+    // the file's cache data, empty when it is missing or was written by another device or driver
+    std::vector<char> loadFile() const;
+};
@@ -0,0 +1,670 @@
+#include "pointshadowmap.hpp"
+#include "shadermanager.hpp"
+#include "commandbuffer.hpp"
+#include "vertex.hpp"
+#include "../core/scene.hpp"
+#include "../core/pointlight.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    constexpr uint32_t CUBE_FACES = 6;
+    // one bit per cube face, every draw is broadcast to all six layers
+    constexpr uint32_t CUBE_VIEW_MASK = (1u << CUBE_FACES) - 1;
+
+    // matches PointShadowPushConstants in shaders/point_shadow.vert
+    struct PointShadowPushConstants {
+        glm::vec4 lightPosition;
+        glm::vec2 depthRange;
+    };
+
+    // fnv-1a over the raw bytes of a value
+    template <typename T>
+    void hashValue(uint64_t& hash, const T& value) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+        for (size_t i = 0; i < sizeof(T); i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    }
+}
+
+PointShadowMap::PointShadowMap(VkDevice device, VmaAllocator allocator, VkFormat depthFormat,
+    ShaderManager* shaderManager, MaterialManager* materialManager, CommandBuffer* commandBuffer)
+    : device(device)
+    , depthFormat(depthFormat)
+    , currentTier(0)
+    , sampler(VK_NULL_HANDLE)
+    , renderPass(VK_NULL_HANDLE)
+    , pipelineLayout(VK_NULL_HANDLE)
+    , pipeline(VK_NULL_HANDLE)
+    , cutoutPipeline(VK_NULL_HANDLE)
+    , instanceList(device)
+    , active(false)
+    , farPlane(NEAR_PLANE * 2.0f)
+    , casterCount(0)
+    , renderedValid(false)
+    , renderedTier(0)
+    , renderedPosition(0.0f)
+    , renderedRange(0.0f)
+    , renderedRevision(0)
+    , renderedCasterHash(0)
+{
+    createSampler();
+    createRenderPass();
+    createPipelines(shaderManager, materialManager);
+    createTier(allocator, 0);
+
+    // the smallest cube starts out readable so the lighting descriptors are valid before the
+    // light ever casts a shadow, larger tiers are always rendered before they are sampled
+    VkCommandBuffer cmd = commandBuffer->beginSingleTimeCommands();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = tiers[0].image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = CUBE_FACES;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    commandBuffer->endSingleTimeCommands(cmd);
+
+    std::cout << "point shadow map created" << std::endl;
+}
+
+PointShadowMap::~PointShadowMap() {
+}
+
+void PointShadowMap::cleanup(VmaAllocator allocator) {
+    if (pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, pipeline, nullptr);
+        pipeline = VK_NULL_HANDLE;
+    }
+
+    if (cutoutPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, cutoutPipeline, nullptr);
+        cutoutPipeline = VK_NULL_HANDLE;
+    }
+
+    if (pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        pipelineLayout = VK_NULL_HANDLE;
+    }
+
+    for (CubeTarget& target : tiers) {
+        if (target.framebuffer != VK_NULL_HANDLE) {
+            vkDestroyFramebuffer(device, target.framebuffer, nullptr);
+        }
+        if (target.arrayView != VK_NULL_HANDLE) {
+            vkDestroyImageView(device, target.arrayView, nullptr);
+        }
+        if (target.cubeView != VK_NULL_HANDLE) {
+            vkDestroyImageView(device, target.cubeView, nullptr);
+        }
+        if (target.image != VK_NULL_HANDLE) {
+            vmaDestroyImage(allocator, target.image, target.allocation);
+        }
+        target = CubeTarget{};
+    }
+
+    if (renderPass != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(device, renderPass, nullptr);
+        renderPass = VK_NULL_HANDLE;
+    }
+
+    if (sampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, sampler, nullptr);
+        sampler = VK_NULL_HANDLE;
+    }
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        indirectBuffers[i].destroy(allocator);
+        drawLists[i] = CubeDrawList{};
+    }
+    instanceList.cleanup(allocator);
+}
+
+void PointShadowMap::createTier(VmaAllocator allocator, uint32_t tier) {
+    CubeTarget& target = tiers[tier];
+    target.resolution = MIN_RESOLUTION << tier;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = { target.resolution, target.resolution, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = CUBE_FACES;
+    imageInfo.format = depthFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    if (vmaCreateImage(allocator, &imageInfo, &allocInfo, &target.image, &target.allocation, nullptr) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create point shadow map image");
+    }
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = target.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_CUBE;
+    viewInfo.format = depthFormat;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = CUBE_FACES;
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &target.cubeView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create point shadow map cube view");
+    }
+
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &target.arrayView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create point shadow map array view");
+    }
+
+    // with multiview the framebuffer has a single layer, the views select the image layers
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &target.arrayView;
+    framebufferInfo.width = target.resolution;
+    framebufferInfo.height = target.resolution;
+    framebufferInfo.layers = 1;
+
+    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &target.framebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create point shadow framebuffer");
+    }
+
+    std::cout << "point shadow cube created (" << target.resolution << "x" << target.resolution << ")" << std::endl;
+}
+
+void PointShadowMap::createSampler() {
+    // hardware depth comparison, seamless cube filtering is always on in vulkan
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.0f;
+    samplerInfo.compareEnable = VK_TRUE;
+    samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create point shadow sampler");
+    }
+}
+
+void PointShadowMap::createRenderPass() {
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkAttachmentReference depthRef{};
+    depthRef.attachment = 0;
+    depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 0;
+    subpass.pDepthStencilAttachment = &depthRef;
+
+    VkSubpassDependency dependencies[2]{};
+
+    // wait for earlier frames to finish sampling the cube before overwriting it
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // make the depth visible to the lighting and forward passes
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    // one subpass rendering all six faces, the faces see the same geometry from one point
+    // so they are marked as correlated
+    uint32_t viewMask = CUBE_VIEW_MASK;
+    uint32_t correlationMask = CUBE_VIEW_MASK;
+
+    VkRenderPassMultiviewCreateInfo multiviewInfo{};
+    multiviewInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
+    multiviewInfo.subpassCount = 1;
+    multiviewInfo.pViewMasks = &viewMask;
+    multiviewInfo.correlationMaskCount = 1;
+    multiviewInfo.pCorrelationMasks = &correlationMask;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.pNext = &multiviewInfo;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &depthAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 2;
+    renderPassInfo.pDependencies = dependencies;
+
+    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create point shadow render pass");
+    }
+}
+
+void PointShadowMap::createPipelines(ShaderManager* shaderManager, MaterialManager* materialManager) {
+    VkPipelineShaderStageCreateInfo shaderStages[2]{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = shaderManager->getShaderModule("point_shadow_vert.spv");
+    shaderStages[0].pName = "main";
+
+    // the cascade cutout shader only needs the texture coordinate, it works here unchanged
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = shaderManager->getShaderModule("shadow_cutout_frag.spv");
+    shaderStages[1].pName = "main";
+
+    // position and texture coordinate only, the rest of the vertex is skipped
+    auto bindingDescription = Vertex::getBindingDescription();
+
+    VkVertexInputAttributeDescription attributeDescriptions[2]{};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[0].offset = offsetof(Vertex, pos);
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[1].offset = offsetof(Vertex, texCoord);
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = 2;
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // the size depends on the resolution tier, set when the pass is recorded
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    // two sided with slope scaled bias against acne
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_TRUE;
+    rasterizer.depthBiasConstantFactor = 1.25f;
+    rasterizer.depthBiasClamp = 0.0f;
+    rasterizer.depthBiasSlopeFactor = 1.75f;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 0;
+
+    // set 0 for the material (cutout alpha), set 1 for the instances, push constant for the light
+    // position and depth range
+    VkDescriptorSetLayout setLayouts[] = { materialManager->getDescriptorSetLayout(), instanceList.getDescriptorSetLayout() };
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PointShadowPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create point shadow pipeline layout");
+    }
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = nullptr;
+    pipelineInfo.basePipelineIndex = -1;
+
+    if (vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineInfo, nullptr, &cutoutPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create point shadow cutout pipeline");
+    }
+
+    // opaque casters write depth only, no fragment shader
+    pipelineInfo.stageCount = 1;
+
+    if (vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create point shadow pipeline");
+    }
+
+    std::cout << "point shadow pipelines created" << std::endl;
+}
+
+uint32_t PointShadowMap::chooseTier(const glm::vec3& position, float range, const glm::mat4& view,
+    const glm::mat4& proj, VkExtent2D extent) const {
+    float distance = glm::length(glm::vec3(view * glm::vec4(position, 1.0f)));
+
+    // the camera is inside the light's range, its shadows can fill the screen
+    if (distance <= range) {
+        return TIER_COUNT - 1;
+    }
+
+    // screen space radius of the range sphere, in pixels
+    float tanAngle = range / std::sqrt(distance * distance - range * range);
+    float radiusPixels = tanAngle * std::abs(proj[1][1]) * static_cast<float>(extent.height) * 0.5f;
+
+    uint32_t tier = 0;
+    while (tier + 1 < TIER_COUNT && static_cast<float>(MIN_RESOLUTION << tier) < radiusPixels) {
+        tier++;
+    }
+
+    // only drop a tier once the light is clearly smaller than it, so the cube doesn't
+    // flip between two sizes while the camera hovers around a boundary
+    if (tier < currentTier && radiusPixels > 0.75f * static_cast<float>(MIN_RESOLUTION << (currentTier - 1))) {
+        tier = currentTier;
+    }
+
+    return tier;
+}
+
+void PointShadowMap::update(VmaAllocator allocator, uint32_t currentFrame, const PointLight* light,
+    const glm::mat4& view, const glm::mat4& proj, VkExtent2D extent, const Scene* scene) {
+    CubeDrawList& drawList = drawLists[currentFrame];
+    drawList.pending = false;
+    drawList.cutouts.clear();
+
+    active = light->isEnabled() && light->getCastShadows() && light->getIntensity() > 0.0f &&
+        scene && scene->hasUnifiedBuffers();
+    if (!active) {
+        return;
+    }
+
+    glm::vec3 position = light->getPosition();
+    float range = PointLight::computeRange(light->getIntensity());
+    farPlane = std::max(range, NEAR_PLANE * 2.0f);
+
+    uint32_t tier = chooseTier(position, range, view, proj, extent);
+    if (tiers[tier].image == VK_NULL_HANDLE) {
+        createTier(allocator, tier);
+    }
+
+    bool dirty = !renderedValid || tier != renderedTier ||
+        position != renderedPosition || range != renderedRange;
+    bool geometryChanged = renderedRevision != scene->getGeometryRevision();
+    if (!dirty && !geometryChanged) {
+        return;
+    }
+
+    commandScratch.clear();
+    instanceScratch.clear();
+    uint64_t casterHash = collectCasters(currentFrame, position, range, scene);
+    renderedRevision = scene->getGeometryRevision();
+
+    // the scene changed somewhere, but not inside this light's range
+    if (!dirty && casterHash == renderedCasterHash) {
+        drawList.cutouts.clear();
+        return;
+    }
+
+    currentTier = tier;
+    renderedValid = true;
+    renderedTier = tier;
+    renderedPosition = position;
+    renderedRange = range;
+    renderedCasterHash = casterHash;
+
+    drawList.pending = true;
+    drawList.tier = tier;
+    drawList.lightPosition = glm::vec4(position, 1.0f);
+    drawList.farPlane = farPlane;
+
+    if (commandScratch.empty()) {
+        return;
+    }
+
+    VkDeviceSize requiredSize = commandScratch.size() * sizeof(VkDrawIndexedIndirectCommand);
+    if (indirectBuffers[currentFrame].getSize() < requiredSize) {
+        // this frame's previous use already finished, the in flight fence waited for it
+        indirectBuffers[currentFrame].destroy(allocator);
+        indirectBuffers[currentFrame].create(allocator, requiredSize * 2,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU,
+            nullptr, nullptr);
+    }
+
+    void* data;
+    vmaMapMemory(allocator, indirectBuffers[currentFrame].getAllocation(), &data);
+    memcpy(data, commandScratch.data(), requiredSize);
+    vmaUnmapMemory(allocator, indirectBuffers[currentFrame].getAllocation());
+
+    instanceList.upload(allocator, currentFrame, instanceScratch,
+        scene->getTransformBuffer(currentFrame), scene->getInstanceRevision());
+}
+
+uint64_t PointShadowMap::collectCasters(uint32_t currentFrame, const glm::vec3& position, float range, const Scene* scene) {
+    CubeDrawList& drawList = drawLists[currentFrame];
+    uint64_t hash = 14695981039346656037ull;
+
+    // the hash covers which submeshes are in range and where they are, so a change elsewhere
+    // in the scene leaves it untouched
+    const TransformHierarchy& transforms = scene->getTransforms();
+    auto appendInRange = [&](const MaterialBatch& batch) {
+        uint32_t first = static_cast<uint32_t>(commandScratch.size());
+        for (const auto& cmd : batch.drawCommands) {
+            uint32_t firstInstance = static_cast<uint32_t>(instanceScratch.size());
+            for (uint32_t modelIndex : cmd.instances) {
+                if (modelIndex >= transforms.size() || cmd.submeshIndex >= transforms.getBoundsCount(modelIndex)) continue;
+
+                const AABB& worldAABB = transforms.getWorldBounds(modelIndex, cmd.submeshIndex);
+                if (!worldAABB.intersectsSphere(position, range)) continue;
+
+                instanceScratch.push_back(modelIndex);
+                hashValue(hash, modelIndex);
+                hashValue(hash, worldAABB.min);
+                hashValue(hash, worldAABB.max);
+            }
+
+            uint32_t instanceCount = static_cast<uint32_t>(instanceScratch.size()) - firstInstance;
+            if (instanceCount == 0) continue;
+
+            VkDrawIndexedIndirectCommand draw = cmd.indirectCommand;
+            draw.instanceCount = instanceCount;
+            draw.firstInstance = firstInstance;
+            commandScratch.push_back(draw);
+            hashValue(hash, draw);
+        }
+        return DrawRange{ batch.material, first, static_cast<uint32_t>(commandScratch.size()) - first };
+    };
+
+    // every opaque material shares the depth only pipeline, so they become one draw range
+    drawList.opaque.material = nullptr;
+    drawList.opaque.firstCommand = static_cast<uint32_t>(commandScratch.size());
+    for (const auto& [material, batch] : scene->getOpaqueBatches()) {
+        appendInRange(batch);
+    }
+    drawList.opaque.commandCount = static_cast<uint32_t>(commandScratch.size()) - drawList.opaque.firstCommand;
+
+    for (const auto& [material, batch] : scene->getCutoutBatches()) {
+        if (!material || material->descriptorSet == VK_NULL_HANDLE) continue;
+
+        DrawRange drawRange = appendInRange(batch);
+        if (drawRange.commandCount > 0) {
+            drawList.cutouts.push_back(drawRange);
+            hashValue(hash, material);
+        }
+    }
+
+    casterCount = static_cast<uint32_t>(instanceScratch.size());
+    return hash;
+}
+
+void PointShadowMap::recordShadowPass(VkCommandBuffer commandBuffer, uint32_t currentFrame, const Scene* scene, PassDrawStats& stats) {
+    const CubeDrawList& drawList = drawLists[currentFrame];
+    if (!drawList.pending || !scene || !scene->hasUnifiedBuffers()) {
+        return;
+    }
+
+    const CubeTarget& target = tiers[drawList.tier];
+    VkExtent2D extent = { target.resolution, target.resolution };
+
+    VkClearValue clearValue{};
+    clearValue.depthStencil = { 1.0f, 0 };
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = target.framebuffer;
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = extent;
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+
+    // the clear alone is enough when nothing is in range
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    if (drawList.opaque.commandCount > 0 || !drawList.cutouts.empty()) {
+        // not flipped, cube faces are addressed the same way they are rendered
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = { 0, 0 };
+        scissor.extent = extent;
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        scene->bindUnifiedBuffers(commandBuffer);
+
+        VkDescriptorSet instanceSet = instanceList.getDescriptorSet(currentFrame);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout, 1, 1, &instanceSet, 0, nullptr);
+        stats.descriptorBinds++;
+
+        PointShadowPushConstants pushConstants{};
+        pushConstants.lightPosition = drawList.lightPosition;
+        pushConstants.depthRange = glm::vec2(NEAR_PLANE, drawList.farPlane);
+
+        VkBuffer indirectBuffer = indirectBuffers[currentFrame].getBuffer();
+        const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+
+        if (drawList.opaque.commandCount > 0) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                0, sizeof(pushConstants), &pushConstants);
+            vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer,
+                drawList.opaque.firstCommand * stride, drawList.opaque.commandCount, stride);
+            stats.pipelineBinds++;
+            stats.drawCalls++;
+            stats.draws += drawList.opaque.commandCount;
+        }
+
+        if (!drawList.cutouts.empty()) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, cutoutPipeline);
+            stats.pipelineBinds++;
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                0, sizeof(pushConstants), &pushConstants);
+
+            for (const DrawRange& range : drawList.cutouts) {
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    pipelineLayout, 0, 1, &range.material->descriptorSet, 0, nullptr);
+                vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer,
+                    range.firstCommand * stride, range.commandCount, stride);
+                stats.descriptorBinds++;
+                stats.drawCalls++;
+                stats.draws += range.commandCount;
+            }
+        }
+    }
+
+    vkCmdEndRenderPass(commandBuffer);
+}
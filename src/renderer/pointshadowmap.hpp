@@ -0,0 +1,126 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include "gpubuffer.hpp"
+#include "instancelist.hpp"
+#include "materialmanager.hpp"
+#include "drawsort.hpp"
+#include "vk_mem_alloc.h"
+#include <vector>
+#include "framesinflight.hpp"
+
+class Scene;
+class ShaderManager;
+class CommandBuffer;
+class PointLight;
+
+/*
+    Omnidirectional shadow for the primary point light. All six faces of a depth cubemap are
+    rendered in one pass with multiview: the render pass broadcasts every draw to the six layers
+    and point_shadow.vert picks the face from gl_ViewIndex.
+    Casters are culled against the light's range sphere. The cube is kept from earlier frames and
+    only re-rendered when the light moves, its range changes or the geometry inside the range changes.
+    The face resolution follows how much of the screen the light's range covers, each resolution
+    tier has its own cube so switching never has to wait for the gpu.
+*/
+class PointShadowMap {
+public:
+    static constexpr uint32_t TIER_COUNT = 4;
+    static constexpr uint32_t MIN_RESOLUTION = 128;    // tiers are 128, 256, 512 and 1024
+    static constexpr float NEAR_PLANE = 1.0f;
+
+    PointShadowMap(VkDevice device, VmaAllocator allocator, VkFormat depthFormat,
+        ShaderManager* shaderManager, MaterialManager* materialManager, CommandBuffer* commandBuffer);
+    ~PointShadowMap();
+
+    PointShadowMap(const PointShadowMap&) = delete;
+    PointShadowMap& operator=(const PointShadowMap&) = delete;
+
+    void cleanup(VmaAllocator allocator);
+
+    // picks the resolution tier, then culls casters if the cube needs re-rendering
+    void update(VmaAllocator allocator, uint32_t currentFrame, const PointLight* light,
+        const glm::mat4& view, const glm::mat4& proj, VkExtent2D extent, const Scene* scene);
+
+    // renders the cube if update() marked it for this frame
+    void recordShadowPass(VkCommandBuffer commandBuffer, uint32_t currentFrame, const Scene* scene, PassDrawStats& stats);
+
+    // forces the cube to re-render on the next update
+    void invalidate() { renderedValid = false; }
+
+    bool isActive() const { return active; }
+    bool isRendering(uint32_t frame) const { return drawLists[frame].pending; }
+    uint32_t getResolution() const { return tiers[currentTier].resolution; }
+    uint32_t getCasterCount() const { return casterCount; }
+    float getFarPlane() const { return farPlane; }
+
+    VkImageView getCubeView() const { return tiers[currentTier].cubeView; }
+    VkSampler getSampler() const { return sampler; }
+
+private:
+    // a range of draws in this frame's indirect buffer
+    struct DrawRange {
+        const MaterialManager::Material* material;
+        uint32_t firstCommand;
+        uint32_t commandCount;
+    };
+
+    struct CubeDrawList {
+        bool pending = false;
+        uint32_t tier = 0;
+        glm::vec4 lightPosition = glm::vec4(0.0f);
+        float farPlane = 0.0f;
+        DrawRange opaque{};
+        std::vector<DrawRange> cutouts;
+    };
+
+    // one depth cube per resolution, created the first time it is needed
+    struct CubeTarget {
+        uint32_t resolution = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VkImageView cubeView = VK_NULL_HANDLE;      // sampled by the lighting shaders
+        VkImageView arrayView = VK_NULL_HANDLE;     // six layers written by the multiview pass
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    };
+
+    VkDevice device;
+    VkFormat depthFormat;
+
+    CubeTarget tiers[TIER_COUNT];
+    uint32_t currentTier;
+    VkSampler sampler;
+
+    VkRenderPass renderPass;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+    VkPipeline cutoutPipeline;
+
+    GPUBuffer indirectBuffers[MAX_FRAMES_IN_FLIGHT];
+    InstanceList instanceList;
+    CubeDrawList drawLists[MAX_FRAMES_IN_FLIGHT];
+    std::vector<VkDrawIndexedIndirectCommand> commandScratch;
+    std::vector<uint32_t> instanceScratch;
+
+    bool active;
+    float farPlane;
+    uint32_t casterCount;
+
+    // what the cube currently holds
+    bool renderedValid;
+    uint32_t renderedTier;
+    glm::vec3 renderedPosition;
+    float renderedRange;
+    uint64_t renderedRevision;
+    uint64_t renderedCasterHash;
+
+    void createTier(VmaAllocator allocator, uint32_t tier);
+    void createSampler();
+    void createRenderPass();
+    void createPipelines(ShaderManager* shaderManager, MaterialManager* materialManager);
+
+    uint32_t chooseTier(const glm::vec3& position, float range, const glm::mat4& view,
+        const glm::mat4& proj, VkExtent2D extent) const;
+    uint64_t collectCasters(uint32_t currentFrame, const glm::vec3& position, float range, const Scene* scene);
+};
@@ -0,0 +1,19 @@
+#include "shaderfeatures.hpp"
+
+ShaderFeatures::ShaderFeatures(uint32_t mask)
+    : entries{}
+    , values{}
+    , info{}
+{
+    for (uint32_t i = 0; i < COUNT; i++) {
+        entries[i].constantID = i;
+        entries[i].offset = i * sizeof(VkBool32);
+        entries[i].size = sizeof(VkBool32);
+        values[i] = (mask >> i) & 1u ? VK_TRUE : VK_FALSE;
+    }
+
+    info.mapEntryCount = COUNT;
+    info.pMapEntries = entries;
+    info.dataSize = sizeof(values);
+    info.pData = values;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Vulkan/vulkan.h>
+#include <cstdint>
+
+/*
+    Feature mask of a shader permutation. Every bit is a bool specialization constant whose
+    constant_id is the bit's index (shaders/features.glsl), so a pipeline built for a mask has
+    the branches on features it lacks removed when the driver compiles it. Material bits are
+    picked per batch from the material, light bits once per frame from the scene's lights.
+*/
+class ShaderFeatures {
+public:
+    enum Bit : uint32_t {
+        DIFFUSE_TEXTURE = 1u << 0,
+        NORMAL_MAP = 1u << 1,
+        DIRECTIONAL_LIGHT = 1u << 2,
+        POINT_LIGHTS = 1u << 3,
+    };
+
+    static constexpr uint32_t COUNT = 4;
+    static constexpr uint32_t MATERIAL_MASK = DIFFUSE_TEXTURE | NORMAL_MAP;
+    static constexpr uint32_t LIGHT_MASK = DIRECTIONAL_LIGHT | POINT_LIGHTS;
+
+    explicit ShaderFeatures(uint32_t mask);
+
+    // info points into this object, keep it alive until the pipeline is created
+    ShaderFeatures(const ShaderFeatures&) = delete;
+    ShaderFeatures& operator=(const ShaderFeatures&) = delete;
+
+    const VkSpecializationInfo* getSpecializationInfo() const { return &info; }
+
+private:
+    VkSpecializationMapEntry entries[COUNT];
+    VkBool32 values[COUNT];
+    VkSpecializationInfo info;
+};
@@ -11,6 +11,7 @@ ShaderManager::~ShaderManager() {
 }
 
 VkShaderModule ShaderManager::getShaderModule(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
     auto it = shaderCache.find(filename);
     if (it != shaderCache.end()) {
         return it->second;
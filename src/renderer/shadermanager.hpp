@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Vulkan/vulkan.h>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -13,6 +14,7 @@ public:
     ShaderManager(const ShaderManager&) = delete;
     ShaderManager& operator=(const ShaderManager&) = delete;
 
+    // safe to call from several threads, pipelines are created in parallel
     VkShaderModule getShaderModule(const std::string& filename);
 
     void cleanup();
@@ -20,6 +22,7 @@ public:
 private:
     VkDevice device;
     std::unordered_map<std::string, VkShaderModule> shaderCache;
+    std::mutex cacheMutex;
 
     std::vector<char> readFile(const std::string& filename);
     VkShaderModule createShaderModule(const std::vector<char>& code);
@@ -4,9 +4,11 @@
 #include <iostream>
 #include <array>
 
-SwapChain::SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, GLFWwindow* window) :device(device) {
+SwapChain::SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, GLFWwindow* window,
+	VkPresentModeKHR presentMode, VkSwapchainKHR oldSwapChain)
+	:device(device), requestedPresentMode(presentMode), presentMode(presentMode) {
 
-	createSwapChain(physicalDevice, surface, window);
+	createSwapChain(physicalDevice, surface, window, oldSwapChain);
 	createImageViews();
 }
 
@@ -22,12 +24,13 @@ SwapChain::~SwapChain() {
 	vkDestroySwapchainKHR(device, swapChain, nullptr);
 }
 
-void SwapChain::createSwapChain(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, GLFWwindow* window) {
+void SwapChain::createSwapChain(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, GLFWwindow* window,
+	VkSwapchainKHR oldSwapChain) {
 
 	SwapChainSupport swapChainSupport = querySwapChainSupport(physicalDevice, surface);
 
 	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-	VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+	presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
 	VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities, window);
 
 	//triple vuffering
@@ -58,7 +61,7 @@ void SwapChain::createSwapChain(VkPhysicalDevice physicalDevice, VkSurfaceKHR su
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	createInfo.oldSwapchain = oldSwapChain;
 
 	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create swap chain");
@@ -135,14 +138,25 @@ VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurfac
     return availableFormats[0];
 }
 
-VkPresentModeKHR SwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
+VkPresentModeKHR SwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const {
 
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
-        }
-    }
-    return VK_PRESENT_MODE_FIFO_KHR;
+	for (const auto& availablePresentMode : availablePresentModes) {
+		if (availablePresentMode == requestedPresentMode) {
+			return availablePresentMode;
+		}
+	}
+	// the only mode every surface supports
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+const char* SwapChain::getPresentModeName(VkPresentModeKHR mode) {
+	switch (mode) {
+	case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO Relaxed";
+	case VK_PRESENT_MODE_MAILBOX_KHR: return "Mailbox";
+	case VK_PRESENT_MODE_IMMEDIATE_KHR: return "Immediate";
+	default: return "Unknown";
+	}
 }
 
 VkExtent2D SwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window) {
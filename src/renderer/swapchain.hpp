@@ -13,17 +13,26 @@ struct SwapChainSupport {
 class SwapChain {
 
 public:
-	SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, GLFWwindow* window);
+	// presentMode is used when the surface supports it, FIFO otherwise. oldSwapChain is retired by
+	// the new one, the driver can reuse its resources. it still has to be destroyed by its owner
+	// once nothing uses its images
+	SwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, GLFWwindow* window,
+		VkPresentModeKHR presentMode, VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
 	~SwapChain();
 
 	SwapChain(const SwapChain&) = delete;
 	SwapChain& operator = (const SwapChain&) = delete;
 
+	static const char* getPresentModeName(VkPresentModeKHR mode);
+
 	VkSwapchainKHR getSwapChain() const { return swapChain; }
 	VkFormat getImageFormat() const { return swapChainImageFormat; }
 	VkExtent2D getExtent() const { return swapChainExtent; }
 	const std::vector<VkImageView>& getImageViews() const { return swapChainImageViews; }
 	size_t getImageCount() const { return swapChainImages.size(); }
+	// the mode it runs with, FIFO when the requested one is not supported
+	VkPresentModeKHR getPresentMode() const { return presentMode; }
+	VkPresentModeKHR getRequestedPresentMode() const { return requestedPresentMode; }
 
 	//frambuffer
 	void createFramebuffers(VkRenderPass renderPass, VkImageView depthImageView);
@@ -38,14 +47,17 @@ private:
 	std::vector<VkImageView> swapChainImageViews;
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
+	VkPresentModeKHR requestedPresentMode;
+	VkPresentModeKHR presentMode;
 
-	void createSwapChain(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, GLFWwindow* window);
+	void createSwapChain(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, GLFWwindow* window,
+		VkSwapchainKHR oldSwapChain);
 	void createImageViews();
 
 	//query swapchain support and pick settings
 	SwapChainSupport querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
 	VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const;
 	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window);
 
 	//framebuffer helper
@@ -1,5 +1,6 @@
 #include "texturemanager.hpp"
 #include "commandbuffer.hpp"
+#include "../core/cpuprofiler.hpp"
 #include <stdexcept>
 #include <iostream>
 #include <cstring>
@@ -113,6 +114,7 @@ void TextureManager::createDefaultTexture() {
 
     defaultTexture.mipLevels = 1;
     defaultTexture.hasAlpha = false;
+    defaultTexture.alphaCutout = false;
 
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -228,6 +230,8 @@ const TextureManager::Texture* TextureManager::getDefaultTexture() const {
 }
 
 const TextureManager::Texture* TextureManager::loadTexture(const std::string& filepath, bool srgb) {
+    CPU_PROFILE_ZONE("TextureManager::loadTexture");
+
     // Include format in cache key so same file can be loaded as both sRGB and linear
     std::string cacheKey = filepath + (srgb ? ":srgb" : ":linear");
     auto it = textureCache.find(cacheKey);
@@ -345,26 +349,34 @@ TextureManager::Texture TextureManager::createTextureFromFile(const std::string&
     }
 
     bool hasAlpha = false;
+    bool alphaCutout = false;
     if (channels == 4) {
-        // Original image had alpha channel, check if significant pixels are non-opaque
+        // Original image had alpha channel, build an alpha histogram
         // Use threshold of 250 to ignore near-opaque pixels (compression artifacts)
         // Require at least 0.1% of pixels to be transparent to count as alpha texture
         size_t pixelCount = static_cast<size_t>(width) * height;
-        size_t transparentPixels = 0;
+        size_t histogram[256] = {};
+        for (size_t i = 0; i < pixelCount; ++i) {
+            histogram[pixels[i * 4 + 3]]++;
+        }
+
         size_t minTransparentPixels = pixelCount / 1000;  // 0.1%
         if (minTransparentPixels < 1) minTransparentPixels = 1;
 
-        for (size_t i = 0; i < pixelCount; ++i) {
-            if (pixels[i * 4 + 3] < 250) {
-                transparentPixels++;
-                if (transparentPixels >= minTransparentPixels) {
-                    hasAlpha = true;
-                    break;
-                }
-            }
+        size_t transparentPixels = 0;
+        size_t partialPixels = 0;
+        for (int a = 0; a < 250; ++a) {
+            transparentPixels += histogram[a];
+            // values away from 0 and 255 are genuinely translucent
+            if (a > 8) partialPixels += histogram[a];
         }
-    }
 
+        hasAlpha = transparentPixels >= minTransparentPixels;
+
+        // mostly 0 or 255 alpha (foliage, chains, fences): alpha test instead of blending
+        // allow a small share of partial values for antialiased edges
+        alphaCutout = hasAlpha && partialPixels * 10 <= transparentPixels;
+    }
     VkDeviceSize imageSize = width * height * 4;
     // use sRGB for color textures, linear for data textures (normal maps etc.)
     const VkFormat format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
@@ -374,6 +386,7 @@ TextureManager::Texture TextureManager::createTextureFromFile(const std::string&
     texture.height = static_cast<uint32_t>(height);
     texture.mipLevels = calculateMipLevels(texture.width, texture.height);
     texture.hasAlpha = hasAlpha;
+    texture.alphaCutout = alphaCutout;
 
     VkBuffer stagingBuffer;
     VmaAllocation stagingAllocation;
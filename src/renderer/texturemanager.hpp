@@ -16,6 +16,7 @@ public:
         uint32_t height;
         uint32_t mipLevels;
         bool hasAlpha;
+        bool alphaCutout;   // alpha is (almost) only 0 or 255
     };
 
 private:
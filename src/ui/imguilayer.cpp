@@ -17,7 +17,11 @@ ImGuiLayer::~ImGuiLayer() {
 
 void ImGuiLayer::init(GLFWwindow* window, VkInstance instance, VkPhysicalDevice physicalDevice,
     VkDevice device, uint32_t graphicsQueueFamily, VkQueue graphicsQueue,
-    VkRenderPass renderPass, uint32_t imageCount, Scene* scene, DirectionalLight* light, PointLight* pointLight, Camera* camera) {
+    VkRenderPass renderPass, uint32_t subpass, uint32_t imageCount, Scene* scene, DirectionalLight* light, PointLight* pointLight, Camera* camera,
+    RenderSettings* renderSettings, const GeometryPassStats* geometryStats,
+    const DynamicResolution* dynamicResolution, const GpuProfiler* gpuProfiler,
+    const CommandBuffer* commandBuffer, CameraPath* cameraPath,
+    StressSceneSettings* stressSettings) {
     this->device = device;
 
     createDescriptorPool(imageCount);
@@ -42,18 +46,19 @@ void ImGuiLayer::init(GLFWwindow* window, VkInstance instance, VkPhysicalDevice
     init_info.Allocator = nullptr;
     init_info.CheckVkResultFn = nullptr;
     init_info.PipelineInfoMain.RenderPass = renderPass;
-    init_info.PipelineInfoMain.Subpass = 0;
+    init_info.PipelineInfoMain.Subpass = subpass;
     init_info.PipelineInfoMain.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
 
     ImGui_ImplVulkan_Init(&init_info);
 
-    leftPanel = std::make_unique<LeftPanel>();
+    leftPanel = std::make_unique<LeftPanel>(renderSettings, geometryStats, dynamicResolution);
     bottomPanel = std::make_unique<BottomPanel>(scene, "D:/codingfolder/Gathas/assets", light, pointLight);
     directionalLightPanel = std::make_unique<DirectionalLightPanel>(light);
     pointLightPanel = std::make_unique<PointLightPanel>(pointLight);
-    cameraPanel = std::make_unique<CameraPanel>(camera);
-    scenePanel = std::make_unique<ScenePanel>(light);
+    cameraPanel = std::make_unique<CameraPanel>(camera, cameraPath);
+    scenePanel = std::make_unique<ScenePanel>(light, scene, stressSettings);
     rightPanel = std::make_unique<RightPanel>(scene, light, pointLight, directionalLightPanel.get(), pointLightPanel.get(), cameraPanel.get(), scenePanel.get());
+    profilerPanel = std::make_unique<ProfilerPanel>(gpuProfiler, commandBuffer);
 
     std::cout << "imgui layer initialized" << std::endl;
 }
@@ -66,6 +71,7 @@ void ImGuiLayer::cleanup() {
     cameraPanel.reset();
     scenePanel.reset();
     rightPanel.reset();
+    profilerPanel.reset();
 
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -132,6 +138,9 @@ void ImGuiLayer::endFrame(float deltaTime) {
     if (rightPanel) {
         rightPanel->render();
     }
+    if (profilerPanel) {
+        profilerPanel->render();
+    }
     ImGui::Render();
 }
 
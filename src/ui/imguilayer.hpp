@@ -10,12 +10,20 @@
 #include "panels/camerapanel.hpp"
 #include "panels/scenepanel.hpp"
 #include "panels/rightpanel.hpp"
+#include "panels/profilerpanel.hpp"
 #include <memory>
 
 class Scene;
 class DirectionalLight;
 class PointLight;
 class Camera;
+struct RenderSettings;
+class GeometryPassStats;
+class DynamicResolution;
+class GpuProfiler;
+class CommandBuffer;
+class CameraPath;
+struct StressSceneSettings;
 
 class ImGuiLayer {
 public:
@@ -27,7 +35,11 @@ public:
 
     void init(GLFWwindow* window, VkInstance instance, VkPhysicalDevice physicalDevice,
         VkDevice device, uint32_t graphicsQueueFamily, VkQueue graphicsQueue,
-        VkRenderPass renderPass, uint32_t imageCount, Scene* scene, DirectionalLight* light, PointLight* pointLight, Camera* camera);
+        VkRenderPass renderPass, uint32_t subpass, uint32_t imageCount, Scene* scene, DirectionalLight* light, PointLight* pointLight, Camera* camera,
+        RenderSettings* renderSettings, const GeometryPassStats* geometryStats,
+        const DynamicResolution* dynamicResolution, const GpuProfiler* gpuProfiler,
+        const CommandBuffer* commandBuffer, CameraPath* cameraPath,
+        StressSceneSettings* stressSettings);
 
     void cleanup();
 
@@ -52,4 +64,5 @@ private:
     std::unique_ptr<CameraPanel> cameraPanel;
     std::unique_ptr<ScenePanel> scenePanel;
     std::unique_ptr<RightPanel> rightPanel;
+    std::unique_ptr<ProfilerPanel> profilerPanel;
 };
\ No newline at end of file
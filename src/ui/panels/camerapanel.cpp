@@ -1,8 +1,9 @@
 #include "camerapanel.hpp"
 #include "../../core/camera.hpp"
+#include "../../core/camerapath.hpp"
 
-CameraPanel::CameraPanel(Camera* camera)
-    : camera(camera) {
+CameraPanel::CameraPanel(Camera* camera, CameraPath* cameraPath)
+    : camera(camera), cameraPath(cameraPath) {
 }
 
 CameraPanel::~CameraPanel() {
@@ -48,6 +49,48 @@ void CameraPanel::render() {
         }
     }
 
+    if (cameraPath) {
+        ImGui::Separator();
+        ImGui::Text("Camera Path");
+        ImGui::InputText("File", pathFile, sizeof(pathFile));
+
+        if (cameraPath->isRecording()) {
+            ImGui::Text("Recording: %zu frames", cameraPath->getFrameCount());
+            if (ImGui::Button("Stop Recording")) {
+                cameraPath->stopRecording();
+                cameraPath->save(pathFile);
+            }
+        }
+        else if (cameraPath->isPlaying()) {
+            ImGui::Text("Playing: %u / %zu (pass %u)", cameraPath->getPlaybackFrame() + 1,
+                cameraPath->getFrameCount(), cameraPath->getCompletedPasses() + 1);
+            if (ImGui::Button("Stop Playback")) {
+                cameraPath->stopPlayback();
+            }
+        }
+        else {
+            if (ImGui::Button("Record")) {
+                cameraPath->startRecording();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Load")) {
+                cameraPath->load(pathFile);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Play") && (cameraPath->getFrameCount() > 0 || cameraPath->load(pathFile))) {
+                cameraPath->startPlayback(loopPlayback);
+            }
+            ImGui::Checkbox("Loop", &loopPlayback);
+        }
+
+        if (cameraPath->hasStats()) {
+            const FrameTimeStats& cpu = cameraPath->getCpuStats();
+            const FrameTimeStats& gpu = cameraPath->getGpuStats();
+            ImGui::Text("CPU avg %.2f  p95 %.2f  p99 %.2f ms", cpu.avg, cpu.p95, cpu.p99);
+            ImGui::Text("GPU avg %.2f  p95 %.2f  p99 %.2f ms", gpu.avg, gpu.p95, gpu.p99);
+        }
+    }
+
     ImGui::End();
 
     ImGui::PopStyleColor(8);
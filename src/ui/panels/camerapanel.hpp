@@ -3,10 +3,11 @@
 #include "../imgui/imgui.h"
 
 class Camera;
+class CameraPath;
 
 class CameraPanel {
 public:
-    CameraPanel(Camera* camera);
+    CameraPanel(Camera* camera, CameraPath* cameraPath);
     ~CameraPanel();
 
     CameraPanel(const CameraPanel&) = delete;
@@ -18,5 +19,9 @@ public:
 
 private:
     Camera* camera;
+    CameraPath* cameraPath;
     bool isOpen = false;
+
+    char pathFile[256] = "camera_path.gcp";
+    bool loopPlayback = false;
 };
@@ -22,7 +22,7 @@ void DirectionalLightPanel::render() {
     ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoCollapse;
 
     ImGui::SetNextWindowBgAlpha(0.9f);
-    ImGui::SetNextWindowSize(ImVec2(280, 300), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(280, 460), ImGuiCond_FirstUseEver);
 
     ImGui::Begin("Directional Light", &isOpen, window_flags);
 
@@ -48,6 +48,20 @@ void DirectionalLightPanel::render() {
     ImGui::Text("Specular Power");
     ImGui::SliderFloat("##SpecularPower", light->getSpecularPowerPtr(), 1.0f, 128.0f);
 
+    ImGui::Separator();
+    ImGui::Text("Shadows");
+
+    ImGui::Checkbox("Cast Shadows", light->getCastShadowsPtr());
+    ImGui::SliderInt("Cascades", light->getCascadeCountPtr(), 2, static_cast<int>(DirectionalLight::MAX_SHADOW_CASCADES));
+    ImGui::SliderFloat("Split Lambda", light->getSplitLambdaPtr(), 0.0f, 1.0f);
+    ImGui::SliderFloat("Distance", light->getShadowDistancePtr(), 100.0f, 10000.0f);
+    ImGui::SliderFloat("Bias", light->getShadowBiasPtr(), 0.0f, 0.01f, "%.5f");
+
+    // each tap is a hardware 2x2 compare
+    ImGui::SliderInt("PCF Radius", light->getPcfRadiusPtr(), 0, 3);
+    int taps = 2 * light->getPcfRadius() + 1;
+    ImGui::Text("%d x %d taps", taps, taps);
+
     ImGui::End();
 
     ImGui::PopStyleColor(8);
@@ -1,9 +1,17 @@
 #include "leftpanel.hpp"
 #include <glm/common.hpp>
 #include "../consolecapture.hpp"
-
-LeftPanel::LeftPanel()
-    : frameTime(0.0f), fps(0.0f),
+#include "../../core/rendersettings.hpp"
+#include "../../renderer/framesinflight.hpp"
+#include "../../renderer/geometrypassstats.hpp"
+#include "../../renderer/dynamicresolution.hpp"
+#include "../../renderer/swapchain.hpp"
+#include "../../core/cpuprofiler.hpp"
+
+LeftPanel::LeftPanel(RenderSettings* renderSettings, const GeometryPassStats* geometryStats,
+    const DynamicResolution* dynamicResolution)
+    : renderSettings(renderSettings), geometryStats(geometryStats), dynamicResolution(dynamicResolution),
+    frameTime(0.0f), fps(0.0f),
     accumulatedTime(0.0f), frameCount(0),
     displayedFrameTime(0.0f), displayedFPS(0.0f) {
 }
@@ -41,6 +49,73 @@ void LeftPanel::render(float deltaTime) {
 
     ImGui::Checkbox("AABB", &showAABBs);
 
+    if (renderSettings) {
+        ImGui::Checkbox("Depth Prepass", &renderSettings->depthPrepass);
+        ImGui::Checkbox("Parallel Recording", &renderSettings->parallelRecording);
+
+        // latency against throughput, the present mode recreates the swap chain
+        int framesInFlight = static_cast<int>(renderSettings->framesInFlight);
+        if (ImGui::SliderInt("Frames in Flight", &framesInFlight, 1, static_cast<int>(MAX_FRAMES_IN_FLIGHT))) {
+            renderSettings->framesInFlight = static_cast<uint32_t>(framesInFlight);
+        }
+
+        const VkPresentModeKHR presentModes[] = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+            VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+        const char* presentModeNames[IM_ARRAYSIZE(presentModes)];
+        int presentMode = 0;
+        for (int i = 0; i < IM_ARRAYSIZE(presentModes); i++) {
+            presentModeNames[i] = SwapChain::getPresentModeName(presentModes[i]);
+            if (presentModes[i] == renderSettings->presentMode) presentMode = i;
+        }
+        if (ImGui::Combo("Present", &presentMode, presentModeNames, IM_ARRAYSIZE(presentModeNames))) {
+            renderSettings->presentMode = presentModes[presentMode];
+        }
+        // the surface may not support the picked mode, the swap chain then runs FIFO. a new pick
+        // only reaches the swap chain at the end of the frame
+        else if (renderSettings->activePresentMode != VK_PRESENT_MODE_MAX_ENUM_KHR &&
+            renderSettings->activePresentMode != renderSettings->presentMode) {
+            ImGui::TextDisabled("Unsupported, running %s", SwapChain::getPresentModeName(renderSettings->activePresentMode));
+        }
+
+        ImGui::SliderFloat("FPS Limit", &renderSettings->frameRateLimit, 0.0f, 240.0f,
+            renderSettings->frameRateLimit > 0.0f ? "%.0f" : "off");
+    }
+
+    // per pass timings are in the gpu profiler window
+    if (geometryStats && geometryStats->hasOverdraw()) {
+        ImGui::Text("Overdraw: %.2fx", geometryStats->getOverdraw());
+        ImGui::Text("Shaded: %llu", static_cast<unsigned long long>(geometryStats->getShadedFragments()));
+    }
+
+    if (dynamicResolution && renderSettings) {
+        ImGui::Separator();
+        VkExtent2D extent = dynamicResolution->getRenderExtent();
+        ImGui::Text("Resolution: %.0f%% (%ux%u)", dynamicResolution->getScale() * 100.0f, extent.width, extent.height);
+        if (dynamicResolution->getGpuMs() > 0.0f) {
+            ImGui::Text("GPU Frame: %.2f ms", dynamicResolution->getGpuMs());
+        }
+        ImGui::SliderFloat("Target ms", &renderSettings->targetFrameMs, 4.0f, 33.3f, "%.1f");
+        ImGui::SliderFloat("Min Scale", &renderSettings->minResolutionScale, 0.25f, 1.0f, "%.2f");
+    }
+
+#ifdef ENABLE_CPU_PROFILER
+    ImGui::Separator();
+    CpuProfiler& cpuProfiler = CpuProfiler::getInstance();
+    if (cpuProfiler.isCapturing()) {
+        ImGui::Text("Capturing: %u frames left", cpuProfiler.getFramesRemaining());
+    }
+    else {
+        ImGui::InputInt("Frames", &cpuCaptureFrames);
+        cpuCaptureFrames = glm::clamp(cpuCaptureFrames, 1, 1000);
+        if (ImGui::Button("Capture CPU Trace")) {
+            cpuProfiler.requestCapture(static_cast<uint32_t>(cpuCaptureFrames));
+        }
+        if (!cpuProfiler.getLastTracePath().empty()) {
+            ImGui::Text("Last: %s", cpuProfiler.getLastTracePath().c_str());
+        }
+    }
+#endif
+
     ImGui::Separator();
 
     if (ImGui::Button("Clear Console")) {
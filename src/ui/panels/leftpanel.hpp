@@ -2,9 +2,14 @@
 
 #include "../imgui/imgui.h"
 
+struct RenderSettings;
+class GeometryPassStats;
+class DynamicResolution;
+
 class LeftPanel {
 public:
-    LeftPanel();
+    LeftPanel(RenderSettings* renderSettings, const GeometryPassStats* geometryStats,
+        const DynamicResolution* dynamicResolution);
     ~LeftPanel();
 
     LeftPanel(const LeftPanel&) = delete;
@@ -15,6 +20,10 @@ public:
     bool getShowAABBs() const { return showAABBs; }
 
 private:
+    RenderSettings* renderSettings;
+    const GeometryPassStats* geometryStats;
+    const DynamicResolution* dynamicResolution;
+
     float frameTime;
     float fps;
 
@@ -28,4 +37,5 @@ private:
 
     bool autoScroll = true;
     bool showAABBs = false;
+    int cpuCaptureFrames = 60;
 };
\ No newline at end of file
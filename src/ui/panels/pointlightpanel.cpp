@@ -23,7 +23,7 @@ void PointLightPanel::render() {
     ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoCollapse;
 
     ImGui::SetNextWindowBgAlpha(0.9f);
-    ImGui::SetNextWindowSize(ImVec2(280, 250), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(280, 420), ImGuiCond_FirstUseEver);
 
     ImGui::Begin("Point Light", &isOpen, window_flags);
 
@@ -44,6 +44,30 @@ void PointLightPanel::render() {
 
     ImGui::Text("Intensity");
     ImGui::SliderFloat("##PointIntensity", light->getIntensityPtr(), 0.0f, 100000.0f);
+    ImGui::Text("Range: %.1f", PointLight::computeRange(light->getIntensity()));
+
+    ImGui::Checkbox("Cast Shadows##Point", light->getCastShadowsPtr());
+
+    ImGui::Separator();
+
+    ImGui::Text("Scattered Lights (%zu)", light->getScatteredLightCount());
+    ImGui::SliderInt("Count##Scatter", &scatterCount, 0, static_cast<int>(PointLight::MAX_LIGHTS) - 1);
+    ImGui::DragFloat3("Center##Scatter", scatterCenter, 10.0f);
+    ImGui::DragFloat3("Extent##Scatter", scatterExtent, 10.0f, 0.0f, 10000.0f);
+    ImGui::SliderFloat("Intensity##Scatter", &scatterIntensity, 0.0f, 10000.0f);
+    ImGui::InputInt("Seed##Scatter", &scatterSeed);
+    ImGui::Text("Range: %.1f", PointLight::computeRange(scatterIntensity));
+
+    if (ImGui::Button("Scatter")) {
+        light->scatterLights(static_cast<uint32_t>(scatterCount),
+            glm::vec3(scatterCenter[0], scatterCenter[1], scatterCenter[2]),
+            glm::vec3(scatterExtent[0], scatterExtent[1], scatterExtent[2]),
+            scatterIntensity, static_cast<uint32_t>(scatterSeed));
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        light->clearLights();
+    }
 
     ImGui::End();
 
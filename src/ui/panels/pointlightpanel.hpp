@@ -19,4 +19,11 @@ public:
 private:
     PointLight* light;
     bool isOpen = false;
+
+    // scattered light settings
+    int scatterCount = 1024;
+    float scatterCenter[3] = { 0.0f, 200.0f, 0.0f };
+    float scatterExtent[3] = { 1000.0f, 200.0f, 500.0f };
+    float scatterIntensity = 500.0f;
+    int scatterSeed = 1;
 };
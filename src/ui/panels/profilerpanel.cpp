@@ -0,0 +1,64 @@
+#include "profilerpanel.hpp"
+#include "../../renderer/gpuprofiler.hpp"
+#include "../../renderer/commandbuffer.hpp"
+
+ProfilerPanel::ProfilerPanel(const GpuProfiler* gpuProfiler, const CommandBuffer* commandBuffer)
+    : gpuProfiler(gpuProfiler)
+    , commandBuffer(commandBuffer) {
+}
+
+ProfilerPanel::~ProfilerPanel() {
+}
+
+void ProfilerPanel::render() {
+    if (!gpuProfiler) return;
+
+    ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0.8f, 0.8f, 0.8f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_TitleBg, ImVec4(0.8f, 0.8f, 0.8f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_TitleBgActive, ImVec4(0.8f, 0.8f, 0.8f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_Border, ImVec4(0.4f, 0.4f, 0.4f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.0f, 0.0f, 0.0f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(0.95f, 0.95f, 0.95f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_PlotLines, ImVec4(0.4f, 0.4f, 0.8f, 1.0f));
+
+    ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoCollapse;
+
+    ImGui::SetNextWindowBgAlpha(0.7f);
+    ImGui::SetNextWindowSize(ImVec2(320, 520), ImGuiCond_FirstUseEver);
+
+    ImGui::Begin("GPU Profiler", nullptr, window_flags);
+
+    if (!gpuProfiler->isSupported()) {
+        ImGui::Text("Timestamps not supported");
+    }
+    else {
+        for (uint32_t i = 0; i < GpuProfiler::ZONE_COUNT; i++) {
+            GpuProfiler::Zone zone = static_cast<GpuProfiler::Zone>(i);
+
+            ImGui::Text("%-10s %6.3f ms", GpuProfiler::getZoneName(zone), gpuProfiler->getAverageMs(zone));
+
+            // the whole frame gets its own scale, the passes share one so they can be compared
+            float scaleMax = zone == GpuProfiler::FRAME ? 33.3f : 8.0f;
+            ImGui::PushID(static_cast<int>(i));
+            ImGui::PlotLines("##History", gpuProfiler->getHistory(zone), GpuProfiler::HISTORY_SIZE,
+                static_cast<int>(gpuProfiler->getHistoryOffset()), nullptr, 0.0f, scaleMax, ImVec2(0, 30));
+            ImGui::PopID();
+        }
+    }
+
+    // state changes of the last recorded frame, what the draw sort keys are meant to keep low
+    if (commandBuffer) {
+        ImGui::Separator();
+        ImGui::Text("%-10s %5s %5s %5s %6s", "pass", "pipe", "desc", "calls", "draws");
+        for (uint32_t i = 0; i < CommandBuffer::DRAW_PASS_COUNT; i++) {
+            CommandBuffer::DrawPass pass = static_cast<CommandBuffer::DrawPass>(i);
+            const PassDrawStats& stats = commandBuffer->getPassStats(pass);
+            ImGui::Text("%-10s %5u %5u %5u %6u", CommandBuffer::getDrawPassName(pass),
+                stats.pipelineBinds, stats.descriptorBinds, stats.drawCalls, stats.draws);
+        }
+    }
+
+    ImGui::End();
+
+    ImGui::PopStyleColor(7);
+}
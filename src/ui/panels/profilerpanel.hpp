@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../imgui/imgui.h"
+
+class GpuProfiler;
+class CommandBuffer;
+
+class ProfilerPanel {
+public:
+    ProfilerPanel(const GpuProfiler* gpuProfiler, const CommandBuffer* commandBuffer);
+    ~ProfilerPanel();
+
+    ProfilerPanel(const ProfilerPanel&) = delete;
+    ProfilerPanel& operator=(const ProfilerPanel&) = delete;
+
+    void render();
+
+private:
+    const GpuProfiler* gpuProfiler;
+    const CommandBuffer* commandBuffer;
+};
@@ -6,6 +6,9 @@
 #include "../../core/scene.hpp"
 #include "../../core/directionallight.hpp"
 #include "../../core/pointlight.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <iostream>
 
 RightPanel::RightPanel(Scene* scene, DirectionalLight* light, PointLight* pointLight, DirectionalLightPanel* dirLightPanel, PointLightPanel* pointLightPanel, CameraPanel* cameraPanel, ScenePanel* scenePanel)
     : scene(scene), light(light), pointLight(pointLight), dirLightPanel(dirLightPanel), pointLightPanel(pointLightPanel), cameraPanel(cameraPanel), scenePanel(scenePanel), selectedObject("") {
@@ -79,7 +82,8 @@ void RightPanel::render() {
         size_t modelCount = scene->getModelCount();
         for (size_t i = 0; i < modelCount; ++i) {
             const Scene::Model* model = scene->getModel(i);
-            if (model) {
+            // stress copies share one entry below
+            if (model && !model->generated) {
                 std::string label = model->name;
                 if (ImGui::Selectable(label.c_str(), selectedObject == label)) {
                     selectedObject = label;
@@ -87,6 +91,25 @@ void RightPanel::render() {
 
                 // right click context menu for models
                 if (ImGui::BeginPopupContextItem(("scene_context_" + label).c_str())) {
+                    if (ImGui::MenuItem("Place Instance")) {
+                        // in a row along x, one model width apart
+                        float width = 0.0f;
+                        for (const AABB& aabb : model->submeshAABBs) {
+                            width = std::max(width, aabb.max.x - aabb.min.x);
+                        }
+                        size_t placed = 0;
+                        for (size_t j = 0; j < modelCount; ++j) {
+                            placed += scene->getModel(j)->mesh == model->mesh ? 1 : 0;
+                        }
+                        glm::mat4 transform = glm::translate(scene->getTransforms().getWorldTransform(static_cast<uint32_t>(i)),
+                            glm::vec3(std::max(width, 1.0f) * 1.25f * static_cast<float>(placed), 0.0f, 0.0f));
+                        try {
+                            selectedObject = scene->placeInstance(label, transform);
+                        }
+                        catch (const std::exception& e) {
+                            std::cerr << "Failed to place instance: " << e.what() << std::endl;
+                        }
+                    }
                     if (ImGui::MenuItem("Remove Asset")) {
                         scene->removeModel(label);
                     }
@@ -94,6 +117,17 @@ void RightPanel::render() {
                 }
             }
         }
+
+        if (scene->getGeneratedModelCount() > 0) {
+            std::string label = "Stress Copies (" + std::to_string(scene->getGeneratedModelCount()) + ")";
+            ImGui::Selectable(label.c_str(), false);
+            if (ImGui::BeginPopupContextItem("stress_context")) {
+                if (ImGui::MenuItem("Remove")) {
+                    scene->clearStressScene();
+                }
+                ImGui::EndPopup();
+            }
+        }
     }
 
     ImGui::End();
@@ -1,8 +1,11 @@
 #include "scenepanel.hpp"
 #include "../../core/directionallight.hpp"
+#include "../../core/scene.hpp"
+#include <glm/common.hpp>
+#include <iostream>
 
-ScenePanel::ScenePanel(DirectionalLight* light)
-    : light(light) {
+ScenePanel::ScenePanel(DirectionalLight* light, Scene* scene, StressSceneSettings* stressSettings)
+    : light(light), scene(scene), stressSettings(stressSettings) {
 }
 
 ScenePanel::~ScenePanel() {
@@ -36,6 +39,53 @@ void ScenePanel::render() {
     ImGui::Text("Ambient Intensity");
     ImGui::SliderFloat("##AmbientIntensity", light->getAmbientIntensityPtr(), 0.0f, 1.0f);
 
+    if (scene && stressSettings) {
+        ImGui::Separator();
+        ImGui::Text("Stress Scene");
+
+        int count = static_cast<int>(stressSettings->count);
+        ImGui::InputInt("Copies", &count, 1000, 10000);
+        stressSettings->count = static_cast<uint32_t>(glm::clamp(count, 0, 1000000));
+
+        int layout = static_cast<int>(stressSettings->layout);
+        ImGui::Combo("Layout", &layout, "Grid\0Random\0");
+        stressSettings->layout = static_cast<StressSceneSettings::Layout>(layout);
+
+        int source = static_cast<int>(stressSettings->source);
+        ImGui::Combo("Source", &source, "Loaded Models\0Sphere\0");
+        stressSettings->source = static_cast<StressSceneSettings::Source>(source);
+
+        if (stressSettings->source == StressSceneSettings::SPHERE || scene->getModelCount() == scene->getGeneratedModelCount()) {
+            int segments = static_cast<int>(stressSettings->sphereSegments);
+            ImGui::SliderInt("Segments", &segments, 8, 1024);
+            stressSettings->sphereSegments = static_cast<uint32_t>(segments);
+        }
+
+        ImGui::SliderFloat("Spacing", &stressSettings->spacing, 1.0f, 10.0f);
+        ImGui::DragFloatRange2("Scale", &stressSettings->minScale, &stressSettings->maxScale, 0.01f, 0.05f, 10.0f);
+        ImGui::Checkbox("Random Materials", &stressSettings->randomMaterials);
+
+        int seed = static_cast<int>(stressSettings->seed);
+        ImGui::InputInt("Seed", &seed);
+        stressSettings->seed = static_cast<uint32_t>(seed);
+
+        if (ImGui::Button("Generate")) {
+            try {
+                scene->generateStressScene(*stressSettings);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Failed to generate stress scene: " << e.what() << std::endl;
+            }
+        }
+        if (scene->getGeneratedModelCount() > 0) {
+            ImGui::SameLine();
+            if (ImGui::Button("Clear")) {
+                scene->clearStressScene();
+            }
+            ImGui::Text("%zu copies in the scene", scene->getGeneratedModelCount());
+        }
+    }
+
     ImGui::End();
 
     ImGui::PopStyleColor(8);
@@ -3,10 +3,12 @@
 #include "../imgui/imgui.h"
 
 class DirectionalLight;
+class Scene;
+struct StressSceneSettings;
 
 class ScenePanel {
 public:
-    ScenePanel(DirectionalLight* light);
+    ScenePanel(DirectionalLight* light, Scene* scene, StressSceneSettings* stressSettings);
     ~ScenePanel();
 
     ScenePanel(const ScenePanel&) = delete;
@@ -18,5 +20,7 @@ public:
 
 private:
     DirectionalLight* light;
+    Scene* scene;
+    StressSceneSettings* stressSettings;
     bool isOpen = false;
 };
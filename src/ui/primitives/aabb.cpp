@@ -67,3 +67,9 @@ AABB AABB::transform(const glm::mat4& modelMatrix) const {
 
     return AABB(newMin, newMax);
 }
+
+bool AABB::intersectsSphere(const glm::vec3& center, float radius) const {
+    glm::vec3 closest = glm::clamp(center, min, max);
+    glm::vec3 delta = closest - center;
+    return glm::dot(delta, delta) <= radius * radius;
+}
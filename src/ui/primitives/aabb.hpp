@@ -18,6 +18,9 @@ struct AABB {
 
     AABB transform(const glm::mat4& modelMatrix) const;
 
+    // closest point on the box is within radius of center
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+
     static AABB computeFromSubmesh(
         const std::vector<Vertex>& vertices,
         const std::vector<uint32_t>& indices,